@@ -91,6 +91,10 @@ ATOMIC_INLINE uint32_t atomic_fetch_and_add_uint32(uint32_t *p, uint32_t x);
 ATOMIC_INLINE uint32_t atomic_fetch_and_or_uint32(uint32_t *p, uint32_t x);
 ATOMIC_INLINE uint32_t atomic_fetch_and_and_uint32(uint32_t *p, uint32_t x);
 
+/* Load with acquire and store with release semantics, e.g. to take and give back a lock. */
+ATOMIC_INLINE uint32_t atomic_load_acquire_uint32(const uint32_t *v);
+ATOMIC_INLINE void atomic_store_release_uint32(uint32_t *p, uint32_t x);
+
 ATOMIC_INLINE int32_t atomic_add_and_fetch_int32(int32_t *p, int32_t x);
 ATOMIC_INLINE int32_t atomic_sub_and_fetch_int32(int32_t *p, int32_t x);
 ATOMIC_INLINE int32_t atomic_cas_int32(int32_t *v, int32_t old, int32_t _new);
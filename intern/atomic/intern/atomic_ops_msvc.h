@@ -164,6 +164,21 @@ ATOMIC_INLINE int32_t atomic_fetch_and_and_int32(int32_t *p, int32_t x)
   return InterlockedAnd((long *)p, x);
 }
 
+/* Aligned loads and stores are already acquire and release on x86,
+ * only the compiler has to be kept from reordering around them. */
+ATOMIC_INLINE uint32_t atomic_load_acquire_uint32(const uint32_t *v)
+{
+  const uint32_t ret = *(const volatile uint32_t *)v;
+  _ReadWriteBarrier();
+  return ret;
+}
+
+ATOMIC_INLINE void atomic_store_release_uint32(uint32_t *p, uint32_t x)
+{
+  _ReadWriteBarrier();
+  *(volatile uint32_t *)p = x;
+}
+
 /******************************************************************************/
 /* 8-bit operations. */
 
@@ -317,6 +317,37 @@ ATOMIC_INLINE int32_t atomic_fetch_and_and_int32(int32_t *p, int32_t x)
 #  error "Missing implementation for 32-bit atomic operations"
 #endif
 
+#if defined(__ATOMIC_ACQUIRE)
+ATOMIC_INLINE uint32_t atomic_load_acquire_uint32(const uint32_t *v)
+{
+  return __atomic_load_n(v, __ATOMIC_ACQUIRE);
+}
+
+ATOMIC_INLINE void atomic_store_release_uint32(uint32_t *p, uint32_t x)
+{
+  __atomic_store_n(p, x, __ATOMIC_RELEASE);
+}
+
+#elif (defined(__i386__) || defined(__amd64__) || defined(__x86_64__))
+/* Aligned loads and stores are already acquire and release on x86,
+ * only the compiler has to be kept from reordering around them. */
+ATOMIC_INLINE uint32_t atomic_load_acquire_uint32(const uint32_t *v)
+{
+  const uint32_t ret = *(const volatile uint32_t *)v;
+  asm volatile("" : : : "memory");
+  return ret;
+}
+
+ATOMIC_INLINE void atomic_store_release_uint32(uint32_t *p, uint32_t x)
+{
+  asm volatile("" : : : "memory");
+  *(volatile uint32_t *)p = x;
+}
+
+#else
+#  error "Missing implementation for 32-bit atomic load and store"
+#endif
+
 /******************************************************************************/
 /* 8-bit operations. */
 #if (defined(__GCC_HAVE_SYNC_COMPARE_AND_SWAP_1) || defined(JE_FORCE_SYNC_COMPARE_AND_SWAP_1))
@@ -154,11 +154,11 @@ void assignFunctionPointers(OpenSubdiv_Evaluator *evaluator)
 }  // namespace
 
 OpenSubdiv_Evaluator *openSubdiv_createEvaluatorFromTopologyRefiner(
-    OpenSubdiv_TopologyRefiner *topology_refiner)
+    OpenSubdiv_TopologyRefiner *topology_refiner, eOpenSubdivEvaluator evaluator_type)
 {
   OpenSubdiv_Evaluator *evaluator = OBJECT_GUARDED_NEW(OpenSubdiv_Evaluator);
   assignFunctionPointers(evaluator);
-  evaluator->impl = openSubdiv_createEvaluatorInternal(topology_refiner);
+  evaluator->impl = openSubdiv_createEvaluatorInternal(topology_refiner, evaluator_type);
   return evaluator;
 }
 
@@ -32,6 +32,9 @@
 #include <opensubdiv/osd/cpuPatchTable.h>
 #include <opensubdiv/osd/cpuVertexBuffer.h>
 #include <opensubdiv/osd/mesh.h>
+#ifdef OPENSUBDIV_HAS_OPENMP
+#  include <opensubdiv/osd/ompEvaluator.h>
+#endif
 #include <opensubdiv/osd/types.h>
 #include <opensubdiv/version.h>
 
@@ -51,11 +54,46 @@ using OpenSubdiv::Osd::BufferDescriptor;
 using OpenSubdiv::Osd::CpuEvaluator;
 using OpenSubdiv::Osd::CpuPatchTable;
 using OpenSubdiv::Osd::CpuVertexBuffer;
+#ifdef OPENSUBDIV_HAS_OPENMP
+using OpenSubdiv::Osd::OmpEvaluator;
+#endif
 using OpenSubdiv::Osd::PatchCoord;
 
 namespace blender {
 namespace opensubdiv {
 
+// Interface of the evaluator implementation, which hides the OpenSubdiv
+// evaluator (and buffer types it requires) behind virtual calls.
+class EvalOutput {
+ public:
+  virtual ~EvalOutput() = default;
+
+  virtual void updateData(const float *src, int start_vertex, int num_vertices) = 0;
+  virtual void updateVaryingData(const float *src, int start_vertex, int num_vertices) = 0;
+  virtual void updateFaceVaryingData(const int face_varying_channel,
+                                     const float *src,
+                                     int start_vertex,
+                                     int num_vertices) = 0;
+
+  virtual void refine() = 0;
+
+  virtual void evalPatches(const PatchCoord *patch_coord,
+                           const int num_patch_coords,
+                           float *P) = 0;
+  virtual void evalPatchesWithDerivatives(const PatchCoord *patch_coord,
+                                          const int num_patch_coords,
+                                          float *P,
+                                          float *dPdu,
+                                          float *dPdv) = 0;
+  virtual void evalPatchesVarying(const PatchCoord *patch_coord,
+                                  const int num_patch_coords,
+                                  float *varying) = 0;
+  virtual void evalPatchesFaceVarying(const int face_varying_channel,
+                                      const PatchCoord *patch_coord,
+                                      const int num_patch_coords,
+                                      float face_varying[2]) = 0;
+};
+
 namespace {
 
 // Array implementation which stores small data on stack (or, rather, in the class itself).
@@ -183,25 +221,30 @@ class ConstPatchCoordWrapperBuffer : public RawDataWrapperVertexBuffer<const Pat
   }
 };
 
+// PATCH_EVALUATOR is used for patch queries, EVALUATOR for refinement.
 template<typename EVAL_VERTEX_BUFFER,
          typename STENCIL_TABLE,
          typename PATCH_TABLE,
          typename EVALUATOR,
-         typename DEVICE_CONTEXT = void>
+         typename DEVICE_CONTEXT = void,
+         typename PATCH_EVALUATOR = EVALUATOR>
 class FaceVaryingVolatileEval {
  public:
   typedef OpenSubdiv::Osd::EvaluatorCacheT<EVALUATOR> EvaluatorCache;
+  typedef OpenSubdiv::Osd::EvaluatorCacheT<PATCH_EVALUATOR> PatchEvaluatorCache;
 
   FaceVaryingVolatileEval(int face_varying_channel,
                           const StencilTable *face_varying_stencils,
                           int face_varying_width,
                           PATCH_TABLE *patch_table,
                           EvaluatorCache *evaluator_cache = NULL,
-                          DEVICE_CONTEXT *device_context = NULL)
+                          DEVICE_CONTEXT *device_context = NULL,
+                          PatchEvaluatorCache *patch_evaluator_cache = NULL)
       : face_varying_channel_(face_varying_channel),
         src_face_varying_desc_(0, face_varying_width, face_varying_width),
         patch_table_(patch_table),
         evaluator_cache_(evaluator_cache),
+        patch_evaluator_cache_(patch_evaluator_cache),
         device_context_(device_context)
   {
     using OpenSubdiv::Osd::convertToCompatibleStencilTable;
@@ -247,18 +290,18 @@ class FaceVaryingVolatileEval {
     RawDataWrapperBuffer<float> face_varying_data(face_varying);
     BufferDescriptor face_varying_desc(0, 2, 2);
     ConstPatchCoordWrapperBuffer patch_coord_buffer(patch_coord, num_patch_coords);
-    const EVALUATOR *eval_instance = OpenSubdiv::Osd::GetEvaluator<EVALUATOR>(
-        evaluator_cache_, src_face_varying_desc_, face_varying_desc, device_context_);
-    EVALUATOR::EvalPatchesFaceVarying(src_face_varying_data_,
-                                      src_face_varying_desc_,
-                                      &face_varying_data,
-                                      face_varying_desc,
-                                      patch_coord_buffer.GetNumVertices(),
-                                      &patch_coord_buffer,
-                                      patch_table_,
-                                      face_varying_channel_,
-                                      eval_instance,
-                                      device_context_);
+    const PATCH_EVALUATOR *eval_instance = OpenSubdiv::Osd::GetEvaluator<PATCH_EVALUATOR>(
+        patch_evaluator_cache_, src_face_varying_desc_, face_varying_desc, device_context_);
+    PATCH_EVALUATOR::EvalPatchesFaceVarying(src_face_varying_data_,
+                                            src_face_varying_desc_,
+                                            &face_varying_data,
+                                            face_varying_desc,
+                                            patch_coord_buffer.GetNumVertices(),
+                                            &patch_coord_buffer,
+                                            patch_table_,
+                                            face_varying_channel_,
+                                            eval_instance,
+                                            device_context_);
   }
 
  protected:
@@ -274,6 +317,7 @@ class FaceVaryingVolatileEval {
   PATCH_TABLE *patch_table_;
 
   EvaluatorCache *evaluator_cache_;
+  PatchEvaluatorCache *patch_evaluator_cache_;
   DEVICE_CONTEXT *device_context_;
 };
 
@@ -283,20 +327,26 @@ class FaceVaryingVolatileEval {
 // TODO(sergey): Make it possible to evaluate multiple face varying layers.
 //               (or maybe, it's cheap to create new evaluator for existing
 //               topology to evaluate all needed face varying layers?)
+//
+// EVALUATOR refines the control cage, PATCH_EVALUATOR evaluates patches at
+// the requested coordinates.
 template<typename SRC_VERTEX_BUFFER,
          typename EVAL_VERTEX_BUFFER,
          typename STENCIL_TABLE,
          typename PATCH_TABLE,
          typename EVALUATOR,
-         typename DEVICE_CONTEXT = void>
-class VolatileEvalOutput {
+         typename DEVICE_CONTEXT = void,
+         typename PATCH_EVALUATOR = EVALUATOR>
+class VolatileEvalOutput : public EvalOutput {
  public:
   typedef OpenSubdiv::Osd::EvaluatorCacheT<EVALUATOR> EvaluatorCache;
+  typedef OpenSubdiv::Osd::EvaluatorCacheT<PATCH_EVALUATOR> PatchEvaluatorCache;
   typedef FaceVaryingVolatileEval<EVAL_VERTEX_BUFFER,
                                   STENCIL_TABLE,
                                   PATCH_TABLE,
                                   EVALUATOR,
-                                  DEVICE_CONTEXT>
+                                  DEVICE_CONTEXT,
+                                  PATCH_EVALUATOR>
       FaceVaryingEval;
 
   VolatileEvalOutput(const StencilTable *vertex_stencils,
@@ -305,11 +355,13 @@ class VolatileEvalOutput {
                      const int face_varying_width,
                      const PatchTable *patch_table,
                      EvaluatorCache *evaluator_cache = NULL,
-                     DEVICE_CONTEXT *device_context = NULL)
+                     DEVICE_CONTEXT *device_context = NULL,
+                     PatchEvaluatorCache *patch_evaluator_cache = NULL)
       : src_desc_(0, 3, 3),
         src_varying_desc_(0, 3, 3),
         face_varying_width_(face_varying_width),
         evaluator_cache_(evaluator_cache),
+        patch_evaluator_cache_(patch_evaluator_cache),
         device_context_(device_context)
   {
     // Total number of vertices = coarse points + refined points + local points.
@@ -333,12 +385,13 @@ class VolatileEvalOutput {
                                                             face_varying_width,
                                                             patch_table_,
                                                             evaluator_cache_,
-                                                            device_context_));
+                                                            device_context_,
+                                                            patch_evaluator_cache_));
       ++face_varying_channel;
     }
   }
 
-  ~VolatileEvalOutput()
+  ~VolatileEvalOutput() override
   {
     delete src_data_;
     delete src_varying_data_;
@@ -352,12 +405,12 @@ class VolatileEvalOutput {
 
   // TODO(sergey): Implement binding API.
 
-  void updateData(const float *src, int start_vertex, int num_vertices)
+  void updateData(const float *src, int start_vertex, int num_vertices) override
   {
     src_data_->UpdateData(src, start_vertex, num_vertices, device_context_);
   }
 
-  void updateVaryingData(const float *src, int start_vertex, int num_vertices)
+  void updateVaryingData(const float *src, int start_vertex, int num_vertices) override
   {
     src_varying_data_->UpdateData(src, start_vertex, num_vertices, device_context_);
   }
@@ -365,7 +418,7 @@ class VolatileEvalOutput {
   void updateFaceVaryingData(const int face_varying_channel,
                              const float *src,
                              int start_vertex,
-                             int num_vertices)
+                             int num_vertices) override
   {
     assert(face_varying_channel >= 0);
     assert(face_varying_channel < face_varying_evaluators.size());
@@ -384,7 +437,7 @@ class VolatileEvalOutput {
     return face_varying_evaluators.size() != 0;
   }
 
-  void refine()
+  void refine() override
   {
     // Evaluate vertex positions.
     BufferDescriptor dst_desc = src_desc_;
@@ -421,23 +474,23 @@ class VolatileEvalOutput {
   }
 
   // NOTE: P must point to a memory of at least float[3]*num_patch_coords.
-  void evalPatches(const PatchCoord *patch_coord, const int num_patch_coords, float *P)
+  void evalPatches(const PatchCoord *patch_coord, const int num_patch_coords, float *P) override
   {
     RawDataWrapperBuffer<float> P_data(P);
     // TODO(sergey): Support interleaved vertex-varying data.
     BufferDescriptor P_desc(0, 3, 3);
     ConstPatchCoordWrapperBuffer patch_coord_buffer(patch_coord, num_patch_coords);
-    const EVALUATOR *eval_instance = OpenSubdiv::Osd::GetEvaluator<EVALUATOR>(
-        evaluator_cache_, src_desc_, P_desc, device_context_);
-    EVALUATOR::EvalPatches(src_data_,
-                           src_desc_,
-                           &P_data,
-                           P_desc,
-                           patch_coord_buffer.GetNumVertices(),
-                           &patch_coord_buffer,
-                           patch_table_,
-                           eval_instance,
-                           device_context_);
+    const PATCH_EVALUATOR *eval_instance = OpenSubdiv::Osd::GetEvaluator<PATCH_EVALUATOR>(
+        patch_evaluator_cache_, src_desc_, P_desc, device_context_);
+    PATCH_EVALUATOR::EvalPatches(src_data_,
+                                 src_desc_,
+                                 &P_data,
+                                 P_desc,
+                                 patch_coord_buffer.GetNumVertices(),
+                                 &patch_coord_buffer,
+                                 patch_table_,
+                                 eval_instance,
+                                 device_context_);
   }
 
   // NOTE: P, dPdu, dPdv must point to a memory of at least float[3]*num_patch_coords.
@@ -445,7 +498,7 @@ class VolatileEvalOutput {
                                   const int num_patch_coords,
                                   float *P,
                                   float *dPdu,
-                                  float *dPdv)
+                                  float *dPdv) override
   {
     assert(dPdu);
     assert(dPdv);
@@ -455,48 +508,48 @@ class VolatileEvalOutput {
     BufferDescriptor P_desc(0, 3, 3);
     BufferDescriptor dpDu_desc(0, 3, 3), pPdv_desc(0, 3, 3);
     ConstPatchCoordWrapperBuffer patch_coord_buffer(patch_coord, num_patch_coords);
-    const EVALUATOR *eval_instance = OpenSubdiv::Osd::GetEvaluator<EVALUATOR>(
-        evaluator_cache_, src_desc_, P_desc, dpDu_desc, pPdv_desc, device_context_);
-    EVALUATOR::EvalPatches(src_data_,
-                           src_desc_,
-                           &P_data,
-                           P_desc,
-                           &dPdu_data,
-                           dpDu_desc,
-                           &dPdv_data,
-                           pPdv_desc,
-                           patch_coord_buffer.GetNumVertices(),
-                           &patch_coord_buffer,
-                           patch_table_,
-                           eval_instance,
-                           device_context_);
+    const PATCH_EVALUATOR *eval_instance = OpenSubdiv::Osd::GetEvaluator<PATCH_EVALUATOR>(
+        patch_evaluator_cache_, src_desc_, P_desc, dpDu_desc, pPdv_desc, device_context_);
+    PATCH_EVALUATOR::EvalPatches(src_data_,
+                                 src_desc_,
+                                 &P_data,
+                                 P_desc,
+                                 &dPdu_data,
+                                 dpDu_desc,
+                                 &dPdv_data,
+                                 pPdv_desc,
+                                 patch_coord_buffer.GetNumVertices(),
+                                 &patch_coord_buffer,
+                                 patch_table_,
+                                 eval_instance,
+                                 device_context_);
   }
 
   // NOTE: varying must point to a memory of at least float[3]*num_patch_coords.
   void evalPatchesVarying(const PatchCoord *patch_coord,
                           const int num_patch_coords,
-                          float *varying)
+                          float *varying) override
   {
     RawDataWrapperBuffer<float> varying_data(varying);
     BufferDescriptor varying_desc(3, 3, 6);
     ConstPatchCoordWrapperBuffer patch_coord_buffer(patch_coord, num_patch_coords);
-    const EVALUATOR *eval_instance = OpenSubdiv::Osd::GetEvaluator<EVALUATOR>(
-        evaluator_cache_, src_varying_desc_, varying_desc, device_context_);
-    EVALUATOR::EvalPatchesVarying(src_varying_data_,
-                                  src_varying_desc_,
-                                  &varying_data,
-                                  varying_desc,
-                                  patch_coord_buffer.GetNumVertices(),
-                                  &patch_coord_buffer,
-                                  patch_table_,
-                                  eval_instance,
-                                  device_context_);
+    const PATCH_EVALUATOR *eval_instance = OpenSubdiv::Osd::GetEvaluator<PATCH_EVALUATOR>(
+        patch_evaluator_cache_, src_varying_desc_, varying_desc, device_context_);
+    PATCH_EVALUATOR::EvalPatchesVarying(src_varying_data_,
+                                        src_varying_desc_,
+                                        &varying_data,
+                                        varying_desc,
+                                        patch_coord_buffer.GetNumVertices(),
+                                        &patch_coord_buffer,
+                                        patch_table_,
+                                        eval_instance,
+                                        device_context_);
   }
 
   void evalPatchesFaceVarying(const int face_varying_channel,
                               const PatchCoord *patch_coord,
                               const int num_patch_coords,
-                              float face_varying[2])
+                              float face_varying[2]) override
   {
     assert(face_varying_channel >= 0);
     assert(face_varying_channel < face_varying_evaluators.size());
@@ -520,6 +573,7 @@ class VolatileEvalOutput {
   vector<FaceVaryingEval *> face_varying_evaluators;
 
   EvaluatorCache *evaluator_cache_;
+  PatchEvaluatorCache *patch_evaluator_cache_;
   DEVICE_CONTEXT *device_context_;
 };
 
@@ -566,51 +620,87 @@ class CpuEvalOutput : public VolatileEvalOutput<CpuVertexBuffer,
   }
 };
 
+#ifdef OPENSUBDIV_HAS_OPENMP
+// Same as above, but stencils are evaluated from multiple threads.
+//
+// Patches are still evaluated with the CPU evaluator: patch queries come from
+// threads of Blender's task scheduler, which are not to spawn OpenMP threads
+// of their own.
+class OmpEvalOutput : public VolatileEvalOutput<CpuVertexBuffer,
+                                                CpuVertexBuffer,
+                                                StencilTable,
+                                                CpuPatchTable,
+                                                OmpEvaluator,
+                                                void,
+                                                CpuEvaluator> {
+ public:
+  OmpEvalOutput(const StencilTable *vertex_stencils,
+                const StencilTable *varying_stencils,
+                const vector<const StencilTable *> &all_face_varying_stencils,
+                const int face_varying_width,
+                const PatchTable *patch_table,
+                EvaluatorCache *evaluator_cache = NULL)
+      : VolatileEvalOutput<CpuVertexBuffer,
+                           CpuVertexBuffer,
+                           StencilTable,
+                           CpuPatchTable,
+                           OmpEvaluator,
+                           void,
+                           CpuEvaluator>(vertex_stencils,
+                                         varying_stencils,
+                                         all_face_varying_stencils,
+                                         face_varying_width,
+                                         patch_table,
+                                         evaluator_cache)
+  {
+  }
+};
+#endif
+
 ////////////////////////////////////////////////////////////////////////////////
 // Evaluator wrapper for anonymous API.
 
-CpuEvalOutputAPI::CpuEvalOutputAPI(CpuEvalOutput *implementation,
-                                   OpenSubdiv::Far::PatchMap *patch_map)
+EvalOutputAPI::EvalOutputAPI(EvalOutput *implementation, OpenSubdiv::Far::PatchMap *patch_map)
     : implementation_(implementation), patch_map_(patch_map)
 {
 }
 
-CpuEvalOutputAPI::~CpuEvalOutputAPI()
+EvalOutputAPI::~EvalOutputAPI()
 {
   delete implementation_;
 }
 
-void CpuEvalOutputAPI::setCoarsePositions(const float *positions,
-                                          const int start_vertex_index,
-                                          const int num_vertices)
+void EvalOutputAPI::setCoarsePositions(const float *positions,
+                                       const int start_vertex_index,
+                                       const int num_vertices)
 {
   // TODO(sergey): Add sanity check on indices.
   implementation_->updateData(positions, start_vertex_index, num_vertices);
 }
 
-void CpuEvalOutputAPI::setVaryingData(const float *varying_data,
-                                      const int start_vertex_index,
-                                      const int num_vertices)
+void EvalOutputAPI::setVaryingData(const float *varying_data,
+                                   const int start_vertex_index,
+                                   const int num_vertices)
 {
   // TODO(sergey): Add sanity check on indices.
   implementation_->updateVaryingData(varying_data, start_vertex_index, num_vertices);
 }
 
-void CpuEvalOutputAPI::setFaceVaryingData(const int face_varying_channel,
-                                          const float *face_varying_data,
-                                          const int start_vertex_index,
-                                          const int num_vertices)
+void EvalOutputAPI::setFaceVaryingData(const int face_varying_channel,
+                                       const float *face_varying_data,
+                                       const int start_vertex_index,
+                                       const int num_vertices)
 {
   // TODO(sergey): Add sanity check on indices.
   implementation_->updateFaceVaryingData(
       face_varying_channel, face_varying_data, start_vertex_index, num_vertices);
 }
 
-void CpuEvalOutputAPI::setCoarsePositionsFromBuffer(const void *buffer,
-                                                    const int start_offset,
-                                                    const int stride,
-                                                    const int start_vertex_index,
-                                                    const int num_vertices)
+void EvalOutputAPI::setCoarsePositionsFromBuffer(const void *buffer,
+                                                 const int start_offset,
+                                                 const int stride,
+                                                 const int start_vertex_index,
+                                                 const int num_vertices)
 {
   // TODO(sergey): Add sanity check on indices.
   const unsigned char *current_buffer = (unsigned char *)buffer;
@@ -623,11 +713,11 @@ void CpuEvalOutputAPI::setCoarsePositionsFromBuffer(const void *buffer,
   }
 }
 
-void CpuEvalOutputAPI::setVaryingDataFromBuffer(const void *buffer,
-                                                const int start_offset,
-                                                const int stride,
-                                                const int start_vertex_index,
-                                                const int num_vertices)
+void EvalOutputAPI::setVaryingDataFromBuffer(const void *buffer,
+                                             const int start_offset,
+                                             const int stride,
+                                             const int start_vertex_index,
+                                             const int num_vertices)
 {
   // TODO(sergey): Add sanity check on indices.
   const unsigned char *current_buffer = (unsigned char *)buffer;
@@ -640,12 +730,12 @@ void CpuEvalOutputAPI::setVaryingDataFromBuffer(const void *buffer,
   }
 }
 
-void CpuEvalOutputAPI::setFaceVaryingDataFromBuffer(const int face_varying_channel,
-                                                    const void *buffer,
-                                                    const int start_offset,
-                                                    const int stride,
-                                                    const int start_vertex_index,
-                                                    const int num_vertices)
+void EvalOutputAPI::setFaceVaryingDataFromBuffer(const int face_varying_channel,
+                                                 const void *buffer,
+                                                 const int start_offset,
+                                                 const int stride,
+                                                 const int start_vertex_index,
+                                                 const int num_vertices)
 {
   // TODO(sergey): Add sanity check on indices.
   const unsigned char *current_buffer = (unsigned char *)buffer;
@@ -660,17 +750,17 @@ void CpuEvalOutputAPI::setFaceVaryingDataFromBuffer(const int face_varying_chann
   }
 }
 
-void CpuEvalOutputAPI::refine()
+void EvalOutputAPI::refine()
 {
   implementation_->refine();
 }
 
-void CpuEvalOutputAPI::evaluateLimit(const int ptex_face_index,
-                                     float face_u,
-                                     float face_v,
-                                     float P[3],
-                                     float dPdu[3],
-                                     float dPdv[3])
+void EvalOutputAPI::evaluateLimit(const int ptex_face_index,
+                                  float face_u,
+                                  float face_v,
+                                  float P[3],
+                                  float dPdu[3],
+                                  float dPdv[3])
 {
   assert(face_u >= 0.0f);
   assert(face_u <= 1.0f);
@@ -686,10 +776,10 @@ void CpuEvalOutputAPI::evaluateLimit(const int ptex_face_index,
   }
 }
 
-void CpuEvalOutputAPI::evaluateVarying(const int ptex_face_index,
-                                       float face_u,
-                                       float face_v,
-                                       float varying[3])
+void EvalOutputAPI::evaluateVarying(const int ptex_face_index,
+                                    float face_u,
+                                    float face_v,
+                                    float varying[3])
 {
   assert(face_u >= 0.0f);
   assert(face_u <= 1.0f);
@@ -700,11 +790,11 @@ void CpuEvalOutputAPI::evaluateVarying(const int ptex_face_index,
   implementation_->evalPatchesVarying(&patch_coord, 1, varying);
 }
 
-void CpuEvalOutputAPI::evaluateFaceVarying(const int face_varying_channel,
-                                           const int ptex_face_index,
-                                           float face_u,
-                                           float face_v,
-                                           float face_varying[2])
+void EvalOutputAPI::evaluateFaceVarying(const int face_varying_channel,
+                                        const int ptex_face_index,
+                                        float face_u,
+                                        float face_v,
+                                        float face_varying[2])
 {
   assert(face_u >= 0.0f);
   assert(face_u <= 1.0f);
@@ -715,11 +805,11 @@ void CpuEvalOutputAPI::evaluateFaceVarying(const int face_varying_channel,
   implementation_->evalPatchesFaceVarying(face_varying_channel, &patch_coord, 1, face_varying);
 }
 
-void CpuEvalOutputAPI::evaluatePatchesLimit(const OpenSubdiv_PatchCoord *patch_coords,
-                                            const int num_patch_coords,
-                                            float *P,
-                                            float *dPdu,
-                                            float *dPdv)
+void EvalOutputAPI::evaluatePatchesLimit(const OpenSubdiv_PatchCoord *patch_coords,
+                                         const int num_patch_coords,
+                                         float *P,
+                                         float *dPdu,
+                                         float *dPdv)
 {
   StackOrHeapPatchCoordArray patch_coords_array;
   convertPatchCoordsToArray(patch_coords, num_patch_coords, patch_map_, &patch_coords_array);
@@ -748,7 +838,7 @@ OpenSubdiv_EvaluatorImpl::~OpenSubdiv_EvaluatorImpl()
 }
 
 OpenSubdiv_EvaluatorImpl *openSubdiv_createEvaluatorInternal(
-    OpenSubdiv_TopologyRefiner *topology_refiner)
+    OpenSubdiv_TopologyRefiner *topology_refiner, eOpenSubdivEvaluator evaluator_type)
 {
   using blender::opensubdiv::vector;
   TopologyRefiner *refiner = topology_refiner->impl->topology_refiner;
@@ -852,14 +942,24 @@ OpenSubdiv_EvaluatorImpl *openSubdiv_createEvaluatorInternal(
     }
   }
   // Create OpenSubdiv's CPU side evaluator.
-  // TODO(sergey): Make it possible to use different evaluators.
-  blender::opensubdiv::CpuEvalOutput *eval_output = new blender::opensubdiv::CpuEvalOutput(
-      vertex_stencils, varying_stencils, all_face_varying_stencils, 2, patch_table);
+  blender::opensubdiv::EvalOutput *eval_output = NULL;
+#ifdef OPENSUBDIV_HAS_OPENMP
+  if (evaluator_type == OPENSUBDIV_EVALUATOR_OPENMP) {
+    eval_output = new blender::opensubdiv::OmpEvalOutput(
+        vertex_stencils, varying_stencils, all_face_varying_stencils, 2, patch_table);
+  }
+#else
+  (void)evaluator_type;
+#endif
+  if (eval_output == NULL) {
+    eval_output = new blender::opensubdiv::CpuEvalOutput(
+        vertex_stencils, varying_stencils, all_face_varying_stencils, 2, patch_table);
+  }
   OpenSubdiv::Far::PatchMap *patch_map = new PatchMap(*patch_table);
   // Wrap everything we need into an object which we control from our side.
   OpenSubdiv_EvaluatorImpl *evaluator_descr;
   evaluator_descr = new OpenSubdiv_EvaluatorImpl();
-  evaluator_descr->eval_output = new blender::opensubdiv::CpuEvalOutputAPI(eval_output, patch_map);
+  evaluator_descr->eval_output = new blender::opensubdiv::EvalOutputAPI(eval_output, patch_map);
   evaluator_descr->patch_map = patch_map;
   evaluator_descr->patch_table = patch_table;
   // TOOD(sergey): Look into whether we've got duplicated stencils arrays.
@@ -28,6 +28,8 @@
 
 #include "internal/base/memory.h"
 
+#include "opensubdiv_capi_type.h"
+
 struct OpenSubdiv_PatchCoord;
 struct OpenSubdiv_TopologyRefiner;
 
@@ -35,19 +37,22 @@ namespace blender {
 namespace opensubdiv {
 
 // Anonymous forward declaration of actual evaluator implementation.
-class CpuEvalOutput;
+class EvalOutput;
 
 // Wrapper around implementaiton, which defines API which we are capable to
 // provide over the implementation.
 //
+// The implementation is using one of OpenSubdiv's CPU side evaluators, so the
+// results are always written to a CPU side memory.
+//
 // TODO(sergey):  It is almost the same as C-API object, so ideally need to
 // merge them somehow, but how to do this and keep files with all the templates
 // and such separate?
-class CpuEvalOutputAPI {
+class EvalOutputAPI {
  public:
   // NOTE: API object becomes an owner of evaluator. Patch we are referencing.
-  CpuEvalOutputAPI(CpuEvalOutput *implementation, OpenSubdiv::Far::PatchMap *patch_map);
-  ~CpuEvalOutputAPI();
+  EvalOutputAPI(EvalOutput *implementation, OpenSubdiv::Far::PatchMap *patch_map);
+  ~EvalOutputAPI();
 
   // Set coarse positions from a continuous array of coordinates.
   void setCoarsePositions(const float *positions,
@@ -131,7 +136,7 @@ class CpuEvalOutputAPI {
                             float *dPdv);
 
  protected:
-  CpuEvalOutput *implementation_;
+  EvalOutput *implementation_;
   OpenSubdiv::Far::PatchMap *patch_map_;
 };
 
@@ -143,7 +148,7 @@ struct OpenSubdiv_EvaluatorImpl {
   OpenSubdiv_EvaluatorImpl();
   ~OpenSubdiv_EvaluatorImpl();
 
-  blender::opensubdiv::CpuEvalOutputAPI *eval_output;
+  blender::opensubdiv::EvalOutputAPI *eval_output;
   const OpenSubdiv::Far::PatchMap *patch_map;
   const OpenSubdiv::Far::PatchTable *patch_table;
 
@@ -151,7 +156,7 @@ struct OpenSubdiv_EvaluatorImpl {
 };
 
 OpenSubdiv_EvaluatorImpl *openSubdiv_createEvaluatorInternal(
-    struct OpenSubdiv_TopologyRefiner *topology_refiner);
+    struct OpenSubdiv_TopologyRefiner *topology_refiner, eOpenSubdivEvaluator evaluator_type);
 
 void openSubdiv_deleteEvaluatorInternal(OpenSubdiv_EvaluatorImpl *evaluator);
 
@@ -19,6 +19,8 @@
 #ifndef OPENSUBDIV_EVALUATOR_CAPI_H_
 #define OPENSUBDIV_EVALUATOR_CAPI_H_
 
+#include "opensubdiv_capi_type.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -126,8 +128,12 @@ typedef struct OpenSubdiv_Evaluator {
   struct OpenSubdiv_EvaluatorImpl *impl;
 } OpenSubdiv_Evaluator;
 
+// Create evaluator of the given type.
+//
+// Types which are not available in the current build, or which do not evaluate
+// into a CPU side memory, fall back to OPENSUBDIV_EVALUATOR_CPU.
 OpenSubdiv_Evaluator *openSubdiv_createEvaluatorFromTopologyRefiner(
-    struct OpenSubdiv_TopologyRefiner *topology_refiner);
+    struct OpenSubdiv_TopologyRefiner *topology_refiner, eOpenSubdivEvaluator evaluator_type);
 
 void openSubdiv_deleteEvaluator(OpenSubdiv_Evaluator *evaluator);
 
@@ -250,6 +250,8 @@ void BKE_pchan_bbone_deform_segment_index(const struct bPoseChannel *pchan,
                                           int *r_index,
                                           float *r_blend_next);
 
+void BKE_armature_deform_weights_free(struct Object *ob);
+
 /* like EBONE_VISIBLE */
 #define PBONE_VISIBLE(arm, bone) \
   (CHECK_TYPE_INLINE(arm, bArmature *), \
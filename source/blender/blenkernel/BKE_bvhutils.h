@@ -260,6 +260,10 @@ bool bvhcache_has_tree(const struct BVHCache *bvh_cache, const BVHTree *tree);
 struct BVHCache *bvhcache_init(void);
 void bvhcache_free(struct BVHCache *bvh_cache);
 
+/* Reuse (refit) the trees of a mesh for an other mesh with the same topology. */
+struct BVHCache *bvhcache_detach(struct Mesh *mesh);
+void bvhcache_attach(struct BVHCache *bvh_cache, struct Mesh *mesh);
+
 #ifdef __cplusplus
 }
 #endif
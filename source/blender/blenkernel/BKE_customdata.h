@@ -34,6 +34,7 @@
 extern "C" {
 #endif
 
+struct BLI_HashMurmur64A;
 struct BMesh;
 struct CustomData;
 struct CustomData_MeshMasks;
@@ -395,6 +396,7 @@ void CustomData_set_layer_flag(struct CustomData *data, int type, int flag);
 void CustomData_clear_layer_flag(struct CustomData *data, int type, int flag);
 
 void CustomData_bmesh_set_default(struct CustomData *data, void **block);
+void CustomData_bmesh_alloc_block(struct CustomData *data, void **block);
 void CustomData_bmesh_free_block(struct CustomData *data, void **block);
 void CustomData_bmesh_free_block_data(struct CustomData *data, void *block);
 void CustomData_bmesh_free_block_data_exclude_by_type(struct CustomData *data,
@@ -422,6 +424,10 @@ void CustomData_file_write_prepare(struct CustomData *data,
 void CustomData_file_write_info(int type, const char **r_struct_name, int *r_struct_num);
 int CustomData_sizeof(int type);
 
+bool CustomData_data_hash(const struct CustomData *data,
+                          const int totelem,
+                          struct BLI_HashMurmur64A *mm64);
+
 /* get the name of a layer type */
 const char *CustomData_layertype_name(int type);
 bool CustomData_layertype_is_singleton(int type);
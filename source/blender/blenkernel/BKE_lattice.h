@@ -33,6 +33,7 @@ extern "C" {
 struct BPoint;
 struct Depsgraph;
 struct Lattice;
+struct LatticeDeformWeights;
 struct MDeformVert;
 struct Main;
 struct Mesh;
@@ -75,7 +76,9 @@ void lattice_deform_verts(struct Object *laOb,
                           int numVerts,
                           short flag,
                           const char *vgroup,
-                          float influence);
+                          float influence,
+                          struct LatticeDeformWeights **weights_cache);
+void BKE_lattice_deform_weights_free(struct LatticeDeformWeights *weights);
 void armature_deform_verts(struct Object *armOb,
                            struct Object *target,
                            const struct Mesh *mesh,
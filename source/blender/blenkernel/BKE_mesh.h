@@ -53,6 +53,7 @@ struct MVert;
 struct Main;
 struct MemArena;
 struct Mesh;
+struct MeshLoopFanCache;
 struct ModifierData;
 struct Object;
 struct Scene;
@@ -414,6 +415,26 @@ void BKE_mesh_normals_loop_split(const struct MVert *mverts,
                                  MLoopNorSpaceArray *r_lnors_spacearr,
                                  short (*clnors_data)[2],
                                  int *r_loop_to_poly);
+void BKE_mesh_normals_loop_split_ex(const struct MVert *mverts,
+                                    const int numVerts,
+                                    struct MEdge *medges,
+                                    const int numEdges,
+                                    struct MLoop *mloops,
+                                    float (*r_loopnors)[3],
+                                    const int numLoops,
+                                    struct MPoly *mpolys,
+                                    const float (*polynors)[3],
+                                    const int numPolys,
+                                    const bool use_split_normals,
+                                    const float split_angle,
+                                    MLoopNorSpaceArray *r_lnors_spacearr,
+                                    short (*clnors_data)[2],
+                                    int *r_loop_to_poly,
+                                    struct MeshLoopFanCache **fan_cache_p);
+
+struct MeshLoopFanCache *BKE_mesh_loop_fan_cache_new(void);
+struct MeshLoopFanCache *BKE_mesh_loop_fan_cache_share(struct MeshLoopFanCache *fan_cache);
+void BKE_mesh_loop_fan_cache_free(struct MeshLoopFanCache *fan_cache);
 
 void BKE_mesh_normals_loop_custom_set(const struct MVert *mverts,
                                       const int numVerts,
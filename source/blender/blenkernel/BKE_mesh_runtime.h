@@ -96,6 +96,19 @@ struct Mesh *mesh_create_eval_no_deform_render(struct Depsgraph *depsgraph,
                                                struct Object *ob,
                                                const struct CustomData_MeshMasks *dataMask);
 
+/**
+ * Mesh passed to the deform only modifiers of a stack until its final mesh is created,
+ * see #BKE_mesh_deform_shared_ensure.
+ */
+typedef struct MeshDeformShared {
+  struct Mesh *mesh_input;
+  /** Created on first request, NULL until then. */
+  struct Mesh *mesh;
+} MeshDeformShared;
+
+struct Mesh *BKE_mesh_deform_shared_ensure(struct MeshDeformShared *shared);
+void BKE_mesh_deform_shared_free(struct MeshDeformShared *shared);
+
 void BKE_mesh_runtime_eval_to_meshkey(struct Mesh *me_deformed,
                                       struct Mesh *me,
                                       struct KeyBlock *kb);
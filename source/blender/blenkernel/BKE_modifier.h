@@ -497,6 +497,15 @@ void BKE_modifier_deform_vertsEM(ModifierData *md,
 struct Mesh *BKE_modifier_get_evaluated_mesh_from_evaluated_object(struct Object *ob_eval,
                                                                    const bool get_cage_mesh);
 
+/* modifier_cache.c */
+struct Mesh *BKE_modifier_modify_mesh_cached(struct ModifierData *md,
+                                             const struct ModifierEvalContext *ctx,
+                                             struct Mesh *me,
+                                             const struct CustomData_MeshMasks *mask);
+void BKE_modifier_result_cache_remove(const struct ModifierData *md);
+void BKE_modifier_result_cache_clear(void);
+size_t BKE_modifier_result_cache_mem_in_use(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -56,6 +56,14 @@ typedef enum eSubdivFVarLinearInterpolation {
   SUBDIV_FVAR_LINEAR_INTERPOLATION_ALL,
 } eSubdivFVarLinearInterpolation;
 
+/* OpenSubdiv evaluator which is used to refine the limit surface and to evaluate it.
+ * Only evaluators which write their results to a CPU side memory are used here. */
+typedef enum eSubdivEvaluatorType {
+  SUBDIV_EVALUATOR_TYPE_CPU,
+  /* Refinement is done from multiple threads, patches are evaluated by the calling thread. */
+  SUBDIV_EVALUATOR_TYPE_OPENMP,
+} eSubdivEvaluatorType;
+
 typedef struct SubdivSettings {
   /* Simple subdivision corresponds to "Simple" option in the interface. When its enabled the
    * subdivided mesh is not "smoothed": new vertices are added uniformly on the existing surface.
@@ -86,6 +94,9 @@ typedef struct SubdivSettings {
 
   eSubdivVtxBoundaryInterpolation vtx_boundary_interpolation;
   eSubdivFVarLinearInterpolation fvar_linear_interpolation;
+
+  /* Falls back to SUBDIV_EVALUATOR_TYPE_CPU when the evaluator is not available. */
+  eSubdivEvaluatorType evaluator_type;
 } SubdivSettings;
 
 /* NOTE: Order of enumerators MUST match order of values in SubdivStats. */
@@ -205,6 +216,9 @@ void BKE_subdiv_exit(void);
 /* NOTE: uv_smooth is eSubsurfUVSmooth. */
 eSubdivFVarLinearInterpolation BKE_subdiv_fvar_interpolation_from_uv_smooth(int uv_smooth);
 
+/* NOTE: compute_type is eOpensubdiv_Computee_Type. */
+eSubdivEvaluatorType BKE_subdiv_evaluator_type_from_compute_type(int compute_type);
+
 /* =============================== STATISTICS =============================== */
 
 void BKE_subdiv_stats_init(SubdivStats *stats);
@@ -31,6 +31,7 @@ extern "C" {
 #endif
 
 struct Mesh;
+struct OpenSubdiv_PatchCoord;
 struct Subdiv;
 
 /* Returns true if evaluator is ready for use. */
@@ -103,11 +104,24 @@ void BKE_subdiv_eval_displacement(struct Subdiv *subdiv,
 void BKE_subdiv_eval_final_point(
     struct Subdiv *subdiv, const int ptex_face_index, const float u, const float v, float r_P[3]);
 
+/* Batched queries.
+ *
+ * Evaluate limit surface at all given patch coordinates with a single call to the evaluator,
+ * which avoids per-point overhead of the single point queries. Derivatives are optional.
+ *
+ * NOTE: Is safe to be called from multiple threads for different output arrays. */
+void BKE_subdiv_eval_limit_points_and_derivatives(struct Subdiv *subdiv,
+                                                  const struct OpenSubdiv_PatchCoord *patch_coords,
+                                                  const int num_patch_coords,
+                                                  float (*r_P)[3],
+                                                  float (*r_dPdu)[3],
+                                                  float (*r_dPdv)[3]);
+
 /* Patch queries at given resolution.
  *
  * Will evaluate patch at uniformly distributed (u, v) coordinates on a grid
  * of given resolution, producing resolution^2 evaluation points. The order
- * goes as u in rows, v in columns. */
+ * goes as u in rows, v in columns. All points are evaluated as one batch. */
 
 void BKE_subdiv_eval_limit_patch_resolution_point(struct Subdiv *subdiv,
                                                   const int ptex_face_index,
@@ -873,6 +873,72 @@ void BKE_mesh_wrapper_deferred_finalize(Mesh *me_eval,
   BLI_assert(me_eval->runtime.wrapper_type_finalize == 0);
 }
 
+/**
+ * Get the mesh of deform only modifiers until the final mesh is created. All of them share a
+ * single mesh referencing the input data layers, instead of each modifier creating a temporary
+ * mesh of its own. It's only created once a modifier requests a mesh.
+ */
+Mesh *BKE_mesh_deform_shared_ensure(MeshDeformShared *shared)
+{
+  if (shared->mesh == NULL) {
+    shared->mesh = BKE_mesh_copy_for_eval(shared->mesh_input, true);
+    ASSERT_IS_VALID_MESH(shared->mesh);
+  }
+  return shared->mesh;
+}
+
+void BKE_mesh_deform_shared_free(MeshDeformShared *shared)
+{
+  if (shared->mesh != NULL) {
+    BKE_id_free(NULL, shared->mesh);
+    shared->mesh = NULL;
+  }
+}
+
+/**
+ * Apply a deform only modifier while there is no final mesh. Modifiers depending on normals get
+ * the shared mesh with the deformed coordinates, the others only get it when they request a mesh
+ * through #MOD_deform_mesh_eval_get.
+ */
+static void mesh_deform_shared_deform_verts(ModifierData *md,
+                                            const ModifierTypeInfo *mti,
+                                            const ModifierEvalContext *mectx,
+                                            MeshDeformShared *shared,
+                                            float (*deformed_verts)[3],
+                                            const int num_deformed_verts,
+                                            const bool is_prev_deform)
+{
+  Object *ob = mectx->object;
+  const bool use_normals = mti->dependsOnNormals && mti->dependsOnNormals(md);
+
+  /* Simulations keep a copy of the mesh they get, or build their own (with extra layers) when
+   * they don't get one. */
+  if (ELEM(md->type,
+           eModifierType_Cloth,
+           eModifierType_Collision,
+           eModifierType_ParticleSystem,
+           eModifierType_Softbody,
+           eModifierType_Surface) &&
+      !use_normals) {
+    BKE_modifier_deform_verts(md, mectx, NULL, deformed_verts, num_deformed_verts);
+    return;
+  }
+
+  Mesh *mesh = shared->mesh;
+  if (use_normals) {
+    mesh = BKE_mesh_deform_shared_ensure(shared);
+    /* if this is not the last modifier in the stack then recalculate the normals
+     * to avoid giving bogus normals to the next modifier see: [#23673] */
+    if (is_prev_deform) {
+      BKE_mesh_vert_coords_apply(mesh, deformed_verts);
+    }
+  }
+
+  ob->runtime.mesh_deform_shared = (mesh == NULL) ? shared : NULL;
+  BKE_modifier_deform_verts(md, mectx, mesh, deformed_verts, num_deformed_verts);
+  ob->runtime.mesh_deform_shared = NULL;
+}
+
 static void mesh_calc_modifiers(struct Depsgraph *depsgraph,
                                 Scene *scene,
                                 Object *ob,
@@ -902,6 +968,10 @@ static void mesh_calc_modifiers(struct Depsgraph *depsgraph,
   int num_deformed_verts = mesh_input->totvert;
   bool isPrevDeform = false;
 
+  /* Mesh passed to deform only modifiers as long as there is no final mesh,
+   * see #mesh_deform_shared_deform_verts. */
+  MeshDeformShared mesh_deform_shared = {mesh_input, NULL};
+
   /* Mesh with constructive modifiers but no deformation applied. Tracked
    * along with final mesh if undeformed / orco coordinates are requested
    * for texturing. */
@@ -973,18 +1043,18 @@ static void mesh_calc_modifiers(struct Depsgraph *depsgraph,
       }
 
       if (mti->type == eModifierTypeType_OnlyDeform && !sculpt_dyntopo) {
+        const bool is_prev_deform = (deformed_verts != NULL) && isPrevDeform;
         if (!deformed_verts) {
           deformed_verts = BKE_mesh_vert_coords_alloc(mesh_input, &num_deformed_verts);
         }
-        else if (isPrevDeform && mti->dependsOnNormals && mti->dependsOnNormals(md)) {
-          if (mesh_final == NULL) {
-            mesh_final = BKE_mesh_copy_for_eval(mesh_input, true);
-            ASSERT_IS_VALID_MESH(mesh_final);
-          }
-          BKE_mesh_vert_coords_apply(mesh_final, deformed_verts);
-        }
 
-        BKE_modifier_deform_verts(md, &mectx, mesh_final, deformed_verts, num_deformed_verts);
+        mesh_deform_shared_deform_verts(md,
+                                        mti,
+                                        &mectx,
+                                        &mesh_deform_shared,
+                                        deformed_verts,
+                                        num_deformed_verts,
+                                        is_prev_deform);
 
         isPrevDeform = true;
       }
@@ -1085,6 +1155,8 @@ static void mesh_calc_modifiers(struct Depsgraph *depsgraph,
      * a result of previous modifiers (could be a Mesh or just
      * deformed vertices) and (b) what type the modifier is. */
     if (mti->type == eModifierTypeType_OnlyDeform) {
+      const bool is_prev_deform = (deformed_verts != NULL) && isPrevDeform;
+
       /* No existing verts to deform, need to build them. */
       if (!deformed_verts) {
         if (mesh_final) {
@@ -1097,16 +1169,24 @@ static void mesh_calc_modifiers(struct Depsgraph *depsgraph,
           deformed_verts = BKE_mesh_vert_coords_alloc(mesh_input, &num_deformed_verts);
         }
       }
-      /* if this is not the last modifier in the stack then recalculate the normals
-       * to avoid giving bogus normals to the next modifier see: [#23673] */
-      else if (isPrevDeform && mti->dependsOnNormals && mti->dependsOnNormals(md)) {
-        if (mesh_final == NULL) {
-          mesh_final = BKE_mesh_copy_for_eval(mesh_input, true);
-          ASSERT_IS_VALID_MESH(mesh_final);
+
+      if (mesh_final == NULL) {
+        mesh_deform_shared_deform_verts(md,
+                                        mti,
+                                        &mectx,
+                                        &mesh_deform_shared,
+                                        deformed_verts,
+                                        num_deformed_verts,
+                                        is_prev_deform);
+      }
+      else {
+        /* if this is not the last modifier in the stack then recalculate the normals
+         * to avoid giving bogus normals to the next modifier see: [#23673] */
+        if (is_prev_deform && mti->dependsOnNormals && mti->dependsOnNormals(md)) {
+          BKE_mesh_vert_coords_apply(mesh_final, deformed_verts);
         }
-        BKE_mesh_vert_coords_apply(mesh_final, deformed_verts);
+        BKE_modifier_deform_verts(md, &mectx, mesh_final, deformed_verts, num_deformed_verts);
       }
-      BKE_modifier_deform_verts(md, &mectx, mesh_final, deformed_verts, num_deformed_verts);
     }
     else {
       have_non_onlydeform_modifiers_appled = true;
@@ -1188,7 +1268,7 @@ static void mesh_calc_modifiers(struct Depsgraph *depsgraph,
         }
       }
 
-      Mesh *mesh_next = BKE_modifier_modify_mesh(md, &mectx, mesh_final);
+      Mesh *mesh_next = BKE_modifier_modify_mesh_cached(md, &mectx, mesh_final, &mask);
       ASSERT_IS_VALID_MESH(mesh_next);
 
       if (mesh_next) {
@@ -1291,6 +1371,8 @@ static void mesh_calc_modifiers(struct Depsgraph *depsgraph,
     BKE_modifier_free_temporary_data(md);
   }
 
+  BKE_mesh_deform_shared_free(&mesh_deform_shared);
+
   /* Yay, we are done. If we have a Mesh and deformed vertices,
    * we need to apply these back onto the Mesh. If we have no
    * Mesh then we need to build one. */
@@ -1578,7 +1660,9 @@ static void editbmesh_calc_modifiers(struct Depsgraph *depsgraph,
       /* apply vertex coordinates or build a DerivedMesh as necessary */
       if (mesh_final) {
         if (deformed_verts) {
-          Mesh *mesh_tmp = BKE_mesh_copy_for_eval(mesh_final, false);
+          /* Reference the layers when 'mesh_final' is freed right away, they are shared and
+           * only the vertices get copied when applying the coordinates. */
+          Mesh *mesh_tmp = BKE_mesh_copy_for_eval(mesh_final, mesh_final != mesh_cage);
           if (mesh_final != mesh_cage) {
             BKE_id_free(NULL, mesh_final);
           }
@@ -1689,7 +1773,7 @@ static void editbmesh_calc_modifiers(struct Depsgraph *depsgraph,
    * then we need to build one. */
   if (mesh_final) {
     if (deformed_verts) {
-      Mesh *mesh_tmp = BKE_mesh_copy_for_eval(mesh_final, false);
+      Mesh *mesh_tmp = BKE_mesh_copy_for_eval(mesh_final, mesh_final != mesh_cage);
       if (mesh_final != mesh_cage) {
         BKE_id_free(NULL, mesh_final);
       }
@@ -1771,6 +1855,14 @@ static void mesh_build_data(struct Depsgraph *depsgraph,
    * they aren't cleaned up properly on mode switch, causing crashes, e.g T58150. */
   BLI_assert(ob->id.tag & LIB_TAG_COPIED_ON_WRITE);
 
+  /* Keep the BVH trees of the previous result, they can be refitted when only
+   * deform modifiers (or animation) changed, instead of being rebuilt every time. */
+  struct BVHCache *bvh_cache_prev = NULL;
+  if (ob->runtime.data_eval != NULL && ob->runtime.is_data_eval_owned &&
+      GS(ob->runtime.data_eval->name) == ID_ME) {
+    bvh_cache_prev = bvhcache_detach((Mesh *)ob->runtime.data_eval);
+  }
+
   BKE_object_free_derived_caches(ob);
   if (DEG_is_active(depsgraph)) {
     BKE_sculpt_update_object_before_eval(ob);
@@ -1808,6 +1900,15 @@ static void mesh_build_data(struct Depsgraph *depsgraph,
   const bool is_mesh_eval_owned = (mesh_eval != mesh->runtime.mesh_eval);
   BKE_object_eval_assign_data(ob, &mesh_eval->id, is_mesh_eval_owned);
 
+  if (bvh_cache_prev != NULL) {
+    if (is_mesh_eval_owned) {
+      bvhcache_attach(bvh_cache_prev, mesh_eval);
+    }
+    else {
+      bvhcache_free(bvh_cache_prev);
+    }
+  }
+
   ob->runtime.mesh_deform_eval = mesh_deform_eval;
   ob->runtime.last_data_mask = *dataMask;
   ob->runtime.last_need_mapping = need_mapping;
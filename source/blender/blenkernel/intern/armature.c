@@ -55,6 +55,7 @@
 #include "BKE_armature.h"
 #include "BKE_constraint.h"
 #include "BKE_curve.h"
+#include "BKE_customdata.h"
 #include "BKE_deform.h"
 #include "BKE_displist.h"
 #include "BKE_idprop.h"
@@ -1501,6 +1502,42 @@ static void pchan_bone_deform(bPoseChannel *pchan,
   (*contrib) += weight;
 }
 
+/**
+ * Vertex weights of an armature deformation in a compressed sparse row layout:
+ * vertex `i` is deformed by `pchans[j]` with `weights[j]`, for `offsets[i] <= j < offsets[i + 1]`.
+ *
+ * Only groups of deforming bones are stored, so the per vertex loop doesn't have to look them
+ * up. Evaluated objects keep the table in #Object_Runtime.armature_deform_weights (one per
+ * armature object) and re-use it while the weights and the group to bone mapping are unchanged.
+ *
+ * Edited weights reach the evaluated mesh through a copy-on-write update, which gives it new
+ * deform-vert arrays. The table keeps the arrays it was built from alive (so their address can't
+ * be re-used), so a different pointer is what tells weights changed. Geometry updates flushed
+ * from shape keys or drivers keep the arrays, and the table. Code editing the weights of an
+ * evaluated mesh in place has to free the table, see #BKE_armature_deform_weights_free.
+ */
+typedef struct ArmatureDeformWeights {
+  struct ArmatureDeformWeights *next;
+
+  /* What the table was built from. */
+  const Object *armOb;
+  const MDeformVert *dverts;
+  int totvert;
+  int defbase_tot;
+  bPoseChannel **defnrToPC;
+
+  /**
+   * A #CD_REFERENCE copy of the deform-vert layer, which keeps the weights alive, so the address
+   * of #dverts can't be re-used by a different array.
+   */
+  CustomData vdata;
+  int vdata_len;
+
+  int *offsets;
+  bPoseChannel **pchans;
+  float *weights;
+} ArmatureDeformWeights;
+
 typedef struct ArmatureUserdata {
   Object *armOb;
   Object *target;
@@ -1512,7 +1549,6 @@ typedef struct ArmatureUserdata {
   bool use_envelope;
   bool use_quaternion;
   bool invert_vgroup;
-  bool use_dverts;
 
   int armature_def_nr;
 
@@ -1522,24 +1558,215 @@ typedef struct ArmatureUserdata {
   int defbase_tot;
   bPoseChannel **defnrToPC;
 
+  ArmatureDeformWeights *weights;
+
   float premat[4][4];
   float postmat[4][4];
 } ArmatureUserdata;
 
+static const MDeformVert *armature_vert_dvert_get(const ArmatureUserdata *data, const int i)
+{
+  if (data->mesh) {
+    BLI_assert(i < data->mesh->totvert);
+    return data->mesh->dvert ? data->mesh->dvert + i : NULL;
+  }
+  if (data->dverts && i < data->target_totvert) {
+    return data->dverts + i;
+  }
+  return NULL;
+}
+
+static void armature_deform_weights_count_task(void *__restrict userdata,
+                                               const int i,
+                                               const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const ArmatureUserdata *data = userdata;
+  const MDeformVert *dvert = armature_vert_dvert_get(data, i);
+  int count = 0;
+
+  if (dvert) {
+    for (int j = 0; j < dvert->totweight; j++) {
+      const uint index = dvert->dw[j].def_nr;
+      if (index < data->defbase_tot && data->defnrToPC[index]) {
+        count++;
+      }
+    }
+  }
+  data->weights->offsets[i + 1] = count;
+}
+
+static void armature_deform_weights_fill_task(void *__restrict userdata,
+                                              const int i,
+                                              const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const ArmatureUserdata *data = userdata;
+  ArmatureDeformWeights *weights = data->weights;
+  const MDeformVert *dvert = armature_vert_dvert_get(data, i);
+  int offset = weights->offsets[i];
+
+  if (offset == weights->offsets[i + 1]) {
+    return;
+  }
+  for (int j = 0; j < dvert->totweight; j++) {
+    const uint index = dvert->dw[j].def_nr;
+    if (index < data->defbase_tot && data->defnrToPC[index]) {
+      weights->pchans[offset] = data->defnrToPC[index];
+      weights->weights[offset] = dvert->dw[j].weight;
+      offset++;
+    }
+  }
+}
+
+static ArmatureDeformWeights *armature_deform_weights_build(ArmatureUserdata *data,
+                                                            const int totvert)
+{
+  ArmatureDeformWeights *weights = MEM_callocN(sizeof(*weights), __func__);
+  weights->armOb = data->armOb;
+  weights->dverts = data->mesh ? data->mesh->dvert : data->dverts;
+  weights->totvert = totvert;
+  weights->defbase_tot = data->defbase_tot;
+  weights->defnrToPC = MEM_dupallocN(data->defnrToPC);
+  weights->offsets = MEM_malloc_arrayN(totvert + 1, sizeof(*weights->offsets), __func__);
+
+  data->weights = weights;
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 1024;
+  BLI_task_parallel_range(0, totvert, data, armature_deform_weights_count_task, &settings);
+
+  weights->offsets[0] = 0;
+  for (int i = 0; i < totvert; i++) {
+    weights->offsets[i + 1] += weights->offsets[i];
+  }
+
+  const int weights_len = weights->offsets[totvert];
+  weights->pchans = MEM_malloc_arrayN(weights_len, sizeof(*weights->pchans), __func__);
+  weights->weights = MEM_malloc_arrayN(weights_len, sizeof(*weights->weights), __func__);
+  BLI_task_parallel_range(0, totvert, data, armature_deform_weights_fill_task, &settings);
+
+  return weights;
+}
+
+static void armature_deform_weights_free(ArmatureDeformWeights *weights)
+{
+  CustomData_free(&weights->vdata, weights->vdata_len);
+  MEM_freeN(weights->defnrToPC);
+  MEM_freeN(weights->offsets);
+  MEM_freeN(weights->pchans);
+  MEM_freeN(weights->weights);
+  MEM_freeN(weights);
+}
+
+/**
+ * Free the weight tables of \a ob,
+ * also needed after editing the weights of its evaluated mesh in place.
+ */
+void BKE_armature_deform_weights_free(Object *ob)
+{
+  ArmatureDeformWeights *weights = ob->runtime.armature_deform_weights;
+  while (weights) {
+    ArmatureDeformWeights *weights_next = weights->next;
+    armature_deform_weights_free(weights);
+    weights = weights_next;
+  }
+  ob->runtime.armature_deform_weights = NULL;
+}
+
+static bool armature_deform_weights_is_valid(const ArmatureDeformWeights *weights,
+                                             const ArmatureUserdata *data,
+                                             const int totvert)
+{
+  return (weights->dverts == (data->mesh ? data->mesh->dvert : data->dverts)) &&
+         (weights->totvert == totvert) && (weights->defbase_tot == data->defbase_tot) &&
+         (memcmp(weights->defnrToPC,
+                 data->defnrToPC,
+                 sizeof(*data->defnrToPC) * (size_t)data->defbase_tot) == 0);
+}
+
+/**
+ * Reference the deform-vert layer of \a vdata the table was built from.
+ * \return false when the layer can't be kept alive, then the table can't be re-used.
+ */
+static bool armature_deform_weights_reference(ArmatureDeformWeights *weights,
+                                              const CustomData *vdata,
+                                              const int vdata_len)
+{
+  CustomData_copy(vdata, &weights->vdata, CD_MASK_MDEFORMVERT, CD_REFERENCE, vdata_len);
+  weights->vdata_len = vdata_len;
+
+  const int layer_index = CustomData_get_layer_index(&weights->vdata, CD_MDEFORMVERT);
+  if (layer_index != -1 && weights->vdata.layers[layer_index].sharing &&
+      weights->vdata.layers[layer_index].data == weights->dverts) {
+    return true;
+  }
+  CustomData_free(&weights->vdata, vdata_len);
+  CustomData_reset(&weights->vdata);
+  return false;
+}
+
+/**
+ * Get the table of vertex weights, from the cache of the target object when possible.
+ * \param r_free: Set when the table is not stored in the target object and must be freed.
+ */
+static ArmatureDeformWeights *armature_deform_weights_ensure(ArmatureUserdata *data,
+                                                             const int totvert,
+                                                             bool *r_free)
+{
+  Object *target = data->target;
+  const CustomData *vdata = NULL;
+  int vdata_len = 0;
+
+  /* Weights of original objects may be edited in place, only cache for evaluated ones. */
+  if (target->type == OB_MESH && DEG_is_evaluated_object(target)) {
+    const Mesh *me = data->mesh ? data->mesh : target->data;
+    vdata = &me->vdata;
+    vdata_len = me->totvert;
+  }
+
+  if (vdata) {
+    ArmatureDeformWeights **weights_p = &target->runtime.armature_deform_weights;
+    for (; *weights_p; weights_p = &(*weights_p)->next) {
+      ArmatureDeformWeights *weights = *weights_p;
+      if (weights->armOb != data->armOb) {
+        continue;
+      }
+      if (armature_deform_weights_is_valid(weights, data, totvert)) {
+        *r_free = false;
+        return weights;
+      }
+      *weights_p = weights->next;
+      armature_deform_weights_free(weights);
+      break;
+    }
+  }
+
+  ArmatureDeformWeights *weights = armature_deform_weights_build(data, totvert);
+  if (vdata && armature_deform_weights_reference(weights, vdata, vdata_len)) {
+    weights->next = target->runtime.armature_deform_weights;
+    target->runtime.armature_deform_weights = weights;
+    *r_free = false;
+  }
+  else {
+    *r_free = true;
+  }
+  return weights;
+}
+
 static void armature_vert_task(void *__restrict userdata,
                                const int i,
                                const TaskParallelTLS *__restrict UNUSED(tls))
 {
   const ArmatureUserdata *data = userdata;
+  const ArmatureDeformWeights *weights = data->weights;
   float(*const vertexCos)[3] = data->vertexCos;
   float(*const defMats)[3][3] = data->defMats;
   float(*const prevCos)[3] = data->prevCos;
   const bool use_envelope = data->use_envelope;
   const bool use_quaternion = data->use_quaternion;
-  const bool use_dverts = data->use_dverts;
   const int armature_def_nr = data->armature_def_nr;
 
-  MDeformVert *dvert;
+  const MDeformVert *dvert;
   DualQuat sumdq, *dq = NULL;
   bPoseChannel *pchan;
   float *co, dco[3];
@@ -1563,26 +1790,7 @@ static void armature_vert_task(void *__restrict userdata,
     }
   }
 
-  if (use_dverts || armature_def_nr != -1) {
-    if (data->mesh) {
-      BLI_assert(i < data->mesh->totvert);
-      if (data->mesh->dvert != NULL) {
-        dvert = data->mesh->dvert + i;
-      }
-      else {
-        dvert = NULL;
-      }
-    }
-    else if (data->dverts && i < data->target_totvert) {
-      dvert = data->dverts + i;
-    }
-    else {
-      dvert = NULL;
-    }
-  }
-  else {
-    dvert = NULL;
-  }
+  dvert = (armature_def_nr != -1) ? armature_vert_dvert_get(data, i) : NULL;
 
   if (armature_def_nr != -1 && dvert) {
     armature_weight = BKE_defvert_find_weight(dvert, armature_def_nr);
@@ -1609,36 +1817,24 @@ static void armature_vert_task(void *__restrict userdata,
   /* Apply the object's matrix */
   mul_m4_v3(data->premat, co);
 
-  if (use_dverts && dvert && dvert->totweight) { /* use weight groups ? */
-    MDeformWeight *dw = dvert->dw;
-    int deformed = 0;
-    unsigned int j;
-    for (j = dvert->totweight; j != 0; j--, dw++) {
-      const uint index = dw->def_nr;
-      if (index < data->defbase_tot && (pchan = data->defnrToPC[index])) {
-        float weight = dw->weight;
-        Bone *bone = pchan->bone;
-
-        deformed = 1;
-
-        if (bone && bone->flag & BONE_MULT_VG_ENV) {
-          weight *= distfactor_to_bone(
-              co, bone->arm_head, bone->arm_tail, bone->rad_head, bone->rad_tail, bone->dist);
-        }
+  /* use weight groups ? */
+  if (weights && weights->offsets[i] != weights->offsets[i + 1]) {
+    for (int j = weights->offsets[i]; j < weights->offsets[i + 1]; j++) {
+      float weight = weights->weights[j];
+      Bone *bone;
 
-        pchan_bone_deform(pchan, weight, vec, dq, smat, co, &contrib);
-      }
-    }
-    /* if there are vertexgroups but not groups with bones
-     * (like for softbody groups) */
-    if (deformed == 0 && use_envelope) {
-      for (pchan = data->armOb->pose->chanbase.first; pchan; pchan = pchan->next) {
-        if (!(pchan->bone->flag & BONE_NO_DEFORM)) {
-          contrib += dist_bone_deform(pchan, vec, dq, smat, co);
-        }
+      pchan = weights->pchans[j];
+      bone = pchan->bone;
+
+      if (bone->flag & BONE_MULT_VG_ENV) {
+        weight *= distfactor_to_bone(
+            co, bone->arm_head, bone->arm_tail, bone->rad_head, bone->rad_tail, bone->dist);
       }
+
+      pchan_bone_deform(pchan, weight, vec, dq, smat, co, &contrib);
     }
   }
+  /* if there are no vertexgroups with bones (like for softbody groups) */
   else if (use_envelope) {
     for (pchan = data->armOb->pose->chanbase.first; pchan; pchan = pchan->next) {
       if (!(pchan->bone->flag & BONE_NO_DEFORM)) {
@@ -1799,7 +1995,6 @@ void armature_deform_verts(Object *armOb,
                            .use_envelope = use_envelope,
                            .use_quaternion = use_quaternion,
                            .invert_vgroup = invert_vgroup,
-                           .use_dverts = use_dverts,
                            .armature_def_nr = armature_def_nr,
                            .target_totvert = target_totvert,
                            .dverts = dverts,
@@ -1812,11 +2007,19 @@ void armature_deform_verts(Object *armOb,
   mul_m4_m4m4(data.postmat, obinv, armOb->obmat);
   invert_m4_m4(data.premat, data.postmat);
 
+  bool free_weights = false;
+  if (use_dverts) {
+    data.weights = armature_deform_weights_ensure(&data, numVerts, &free_weights);
+  }
+
   TaskParallelSettings settings;
   BLI_parallel_range_settings_defaults(&settings);
   settings.min_iter_per_thread = 32;
   BLI_task_parallel_range(0, numVerts, &data, armature_vert_task, &settings);
 
+  if (free_weights) {
+    armature_deform_weights_free(data.weights);
+  }
   if (defnrToPC) {
     MEM_freeN(defnrToPC);
   }
@@ -35,26 +35,55 @@
 #include "BLI_utildefines.h"
 
 #include "BKE_bvhutils.h"
+#include "BKE_customdata.h"
 #include "BKE_editmesh.h"
 #include "BKE_mesh.h"
 #include "BKE_mesh_runtime.h"
 
 #include "MEM_guardedalloc.h"
 
+#include "atomic_ops.h"
+
+/* Trees built here are typically cached and queried many times (shrinkwrap, snapping,
+ * data-transfer... etc), so it's worth spending more time building them. */
+#define BVHTREE_FROM_MESH_BUILD_FLAG (BVH_BUILD_SAH | BVH_BUILD_PACKED)
+
+/* Rebuild refitted trees once their quality drops below this (see #BLI_bvhtree_refit). */
+#define BVHCACHE_REFIT_QUALITY_MIN 0.5f
+
 /* -------------------------------------------------------------------- */
 /** \name BVHCache
  * \{ */
 
 typedef struct BVHCacheItem {
   bool is_filled;
+  /**
+   * The tree was built for an other mesh with the same topology, see #bvhcache_attach.
+   * Cleared (with release semantics) once the tree is refitted, so it can be read without lock.
+   */
+  uint32_t is_refit_pending;
   BVHTree *tree;
 } BVHCacheItem;
 
 typedef struct BVHCache {
   BVHCacheItem items[BVHTREE_MAX_ITEM];
   ThreadMutex mutex;
+
+  /** Mesh owning this cache, set when it has trees to refit. */
+  const Mesh *mesh;
+  /**
+   * Topology of the mesh the trees were built for, referenced (or copied) when the cache is
+   * detached, see #bvhcache_topology_store.
+   */
+  CustomData edata, ldata, pdata;
+  int totvert, totedge, totloop, totpoly;
+  bool has_topology;
 } BVHCache;
 
+static void bvhcache_refit_pending(BVHCache *bvh_cache,
+                                   BVHCacheType type,
+                                   const MLoopTri *looptri);
+
 /**
  * Queries a bvhcache for the cache bvhtree of the request type
  *
@@ -86,18 +115,35 @@ static bool bvhcache_find(BVHCache **bvh_cache_p,
     BLI_mutex_unlock(mesh_eval_mutex);
   }
   BVHCache *bvh_cache = *bvh_cache_p;
+  BVHCacheItem *item = &bvh_cache->items[type];
 
-  if (bvh_cache->items[type].is_filled) {
-    *r_tree = bvh_cache->items[type].tree;
+  /* A pending refit can replace or free the tree, once it's done the item doesn't change until
+   * it's filled by #bvhcache_insert. */
+  if (atomic_load_acquire_uint32(&item->is_refit_pending)) {
+    const MLoopTri *looptri = NULL;
+    if (ELEM(type, BVHTREE_FROM_LOOPTRI, BVHTREE_FROM_LOOPTRI_NO_HIDDEN)) {
+      /* Cast away const, #BKE_mesh_runtime_looptri_ensure only writes to the runtime data.
+       * Tessellation has its own lock, don't hold the cache lock meanwhile. */
+      looptri = BKE_mesh_runtime_looptri_ensure((Mesh *)bvh_cache->mesh);
+    }
+    BLI_mutex_lock(&bvh_cache->mutex);
+    bvhcache_refit_pending(bvh_cache, type, looptri);
+    BLI_mutex_unlock(&bvh_cache->mutex);
+  }
+
+  if (item->is_filled) {
+    *r_tree = item->tree;
     return true;
   }
   if (do_lock) {
     BLI_mutex_lock(&bvh_cache->mutex);
-    bool in_cache = bvhcache_find(bvh_cache_p, type, r_tree, NULL, NULL);
-    if (in_cache) {
+    /* The tree may have been built by an other thread meanwhile. */
+    if (item->is_filled) {
+      *r_tree = item->tree;
       BLI_mutex_unlock(&bvh_cache->mutex);
-      return in_cache;
+      return true;
     }
+    /* Keep the lock while the caller builds the tree, see #bvhcache_unlock. */
     *r_locked = true;
   }
   return false;
@@ -128,6 +174,9 @@ BVHCache *bvhcache_init(void)
 {
   BVHCache *cache = MEM_callocN(sizeof(BVHCache), __func__);
   BLI_mutex_init(&cache->mutex);
+  CustomData_reset(&cache->edata);
+  CustomData_reset(&cache->ldata);
+  CustomData_reset(&cache->pdata);
   return cache;
 }
 /**
@@ -146,11 +195,14 @@ static void bvhcache_insert(BVHCache *bvh_cache, BVHTree *tree, BVHCacheType typ
   item->is_filled = true;
 }
 
+static void bvhcache_topology_free(BVHCache *bvh_cache);
+
 /**
  * frees a bvhcache
  */
 void bvhcache_free(BVHCache *bvh_cache)
 {
+  bvhcache_topology_free(bvh_cache);
   for (BVHCacheType index = 0; index < BVHTREE_MAX_ITEM; index++) {
     BVHCacheItem *item = &bvh_cache->items[index];
     BLI_bvhtree_free(item->tree);
@@ -160,6 +212,262 @@ void bvhcache_free(BVHCache *bvh_cache)
   MEM_freeN(bvh_cache);
 }
 
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name BVHCache Refit
+ *
+ * Evaluating a deformed mesh creates a new mesh every time,
+ * so the trees cached for the previous result are moved to the new mesh when its topology
+ * is unchanged. They are refitted (see #BLI_bvhtree_refit) the first time they are used,
+ * only rebuilding trees when the deformation degraded them too much.
+ * \{ */
+
+static bool bvhcache_type_supports_refit(const BVHCacheType type)
+{
+  switch (type) {
+    case BVHTREE_FROM_VERTS:
+    case BVHTREE_FROM_EDGES:
+    case BVHTREE_FROM_LOOPTRI:
+    case BVHTREE_FROM_LOOPTRI_NO_HIDDEN:
+    case BVHTREE_FROM_LOOSEVERTS:
+    case BVHTREE_FROM_LOOSEEDGES:
+      return true;
+    /* Legacy faces aren't kept up to date on evaluated meshes,
+     * edit-mesh trees aren't cached on evaluated meshes. */
+    case BVHTREE_FROM_FACES:
+    case BVHTREE_FROM_EM_VERTS:
+    case BVHTREE_FROM_EM_EDGES:
+    case BVHTREE_FROM_EM_LOOPTRI:
+    case BVHTREE_MAX_ITEM:
+      break;
+  }
+  return false;
+}
+
+/**
+ * Reference the layer of \a type from \a src, it's copied when the data isn't reference counted
+ * (see #CustomDataLayer.sharing) and could be freed along with the mesh.
+ */
+static void bvhcache_topology_layer_store(
+    const CustomData *src, CustomData *dst, const int type, const CustomDataMask mask, int totelem)
+{
+  CustomData_copy(src, dst, mask, CD_REFERENCE, totelem);
+  const int layer_index = CustomData_get_layer_index(dst, type);
+  if (layer_index != -1 && dst->layers[layer_index].sharing == NULL) {
+    CustomData_free(dst, totelem);
+    CustomData_copy(src, dst, mask, CD_DUPLICATE, totelem);
+  }
+}
+
+/**
+ * Keep all data that defines which elements are stored in the trees (not their positions),
+ * to compare it with the mesh the cache is attached to.
+ */
+static void bvhcache_topology_store(BVHCache *bvh_cache, const Mesh *mesh)
+{
+  bvhcache_topology_free(bvh_cache);
+  bvhcache_topology_layer_store(
+      &mesh->edata, &bvh_cache->edata, CD_MEDGE, CD_MASK_MEDGE, mesh->totedge);
+  bvhcache_topology_layer_store(
+      &mesh->ldata, &bvh_cache->ldata, CD_MLOOP, CD_MASK_MLOOP, mesh->totloop);
+  bvhcache_topology_layer_store(
+      &mesh->pdata, &bvh_cache->pdata, CD_MPOLY, CD_MASK_MPOLY, mesh->totpoly);
+  bvh_cache->totvert = mesh->totvert;
+  bvh_cache->totedge = mesh->totedge;
+  bvh_cache->totloop = mesh->totloop;
+  bvh_cache->totpoly = mesh->totpoly;
+  bvh_cache->has_topology = true;
+}
+
+static void bvhcache_topology_free(BVHCache *bvh_cache)
+{
+  if (bvh_cache->has_topology) {
+    CustomData_free(&bvh_cache->edata, bvh_cache->totedge);
+    CustomData_free(&bvh_cache->ldata, bvh_cache->totloop);
+    CustomData_free(&bvh_cache->pdata, bvh_cache->totpoly);
+    CustomData_reset(&bvh_cache->edata);
+    CustomData_reset(&bvh_cache->ldata);
+    CustomData_reset(&bvh_cache->pdata);
+    bvh_cache->has_topology = false;
+  }
+}
+
+static bool bvhcache_topology_layer_equals(const CustomData *stored,
+                                           const void *data,
+                                           const int type,
+                                           const size_t size)
+{
+  const void *data_stored = CustomData_get_layer(stored, type);
+  if (data_stored == data) {
+    /* Shared data, writers duplicate it first. */
+    return true;
+  }
+  if (data_stored == NULL || data == NULL) {
+    return false;
+  }
+  return memcmp(data_stored, data, size) == 0;
+}
+
+static bool bvhcache_topology_equals(const BVHCache *bvh_cache, const Mesh *mesh)
+{
+  return bvh_cache->has_topology && (bvh_cache->totvert == mesh->totvert) &&
+         (bvh_cache->totedge == mesh->totedge) && (bvh_cache->totloop == mesh->totloop) &&
+         (bvh_cache->totpoly == mesh->totpoly) &&
+         bvhcache_topology_layer_equals(
+             &bvh_cache->edata, mesh->medge, CD_MEDGE, sizeof(MEdge) * (size_t)mesh->totedge) &&
+         bvhcache_topology_layer_equals(
+             &bvh_cache->ldata, mesh->mloop, CD_MLOOP, sizeof(MLoop) * (size_t)mesh->totloop) &&
+         bvhcache_topology_layer_equals(
+             &bvh_cache->pdata, mesh->mpoly, CD_MPOLY, sizeof(MPoly) * (size_t)mesh->totpoly);
+}
+
+typedef struct BVHCacheRefitData {
+  const MVert *vert;
+  const MEdge *edge;
+  const MLoop *loop;
+  const MLoopTri *looptri;
+} BVHCacheRefitData;
+
+static int bvhcache_refit_vert_cb(void *userdata, int index, float (*r_co)[3])
+{
+  const BVHCacheRefitData *data = userdata;
+  copy_v3_v3(r_co[0], data->vert[index].co);
+  return 1;
+}
+
+static int bvhcache_refit_edge_cb(void *userdata, int index, float (*r_co)[3])
+{
+  const BVHCacheRefitData *data = userdata;
+  const MEdge *edge = &data->edge[index];
+  copy_v3_v3(r_co[0], data->vert[edge->v1].co);
+  copy_v3_v3(r_co[1], data->vert[edge->v2].co);
+  return 2;
+}
+
+static int bvhcache_refit_looptri_cb(void *userdata, int index, float (*r_co)[3])
+{
+  const BVHCacheRefitData *data = userdata;
+  const MLoopTri *lt = &data->looptri[index];
+  copy_v3_v3(r_co[0], data->vert[data->loop[lt->tri[0]].v].co);
+  copy_v3_v3(r_co[1], data->vert[data->loop[lt->tri[1]].v].co);
+  copy_v3_v3(r_co[2], data->vert[data->loop[lt->tri[2]].v].co);
+  return 3;
+}
+
+/**
+ * Refit a tree moved from an other mesh, or remove it from the cache so it's rebuilt.
+ * The cache mutex must be locked, \a looptri is needed for trees of triangles.
+ */
+static void bvhcache_refit_pending(BVHCache *bvh_cache,
+                                   BVHCacheType type,
+                                   const MLoopTri *looptri)
+{
+  BVHCacheItem *item = &bvh_cache->items[type];
+
+  if (item->is_refit_pending) {
+    BVHTree *tree = item->tree;
+
+    if (tree != NULL) {
+      const Mesh *mesh = bvh_cache->mesh;
+      BVHCacheRefitData data = {
+          .vert = mesh->mvert,
+          .edge = mesh->medge,
+          .loop = mesh->mloop,
+          .looptri = looptri,
+      };
+
+      switch (type) {
+        case BVHTREE_FROM_VERTS:
+        case BVHTREE_FROM_LOOSEVERTS:
+          BLI_bvhtree_refit(tree, bvhcache_refit_vert_cb, &data);
+          break;
+        case BVHTREE_FROM_EDGES:
+        case BVHTREE_FROM_LOOSEEDGES:
+          BLI_bvhtree_refit(tree, bvhcache_refit_edge_cb, &data);
+          break;
+        case BVHTREE_FROM_LOOPTRI:
+        case BVHTREE_FROM_LOOPTRI_NO_HIDDEN:
+          BLI_bvhtree_refit(tree, bvhcache_refit_looptri_cb, &data);
+          break;
+        default:
+          BLI_assert(0);
+          break;
+      }
+
+      if (BLI_bvhtree_get_refit_quality(tree) < BVHCACHE_REFIT_QUALITY_MIN) {
+        BLI_bvhtree_free(tree);
+        item->tree = NULL;
+        item->is_filled = false;
+      }
+    }
+    atomic_store_release_uint32(&item->is_refit_pending, 0);
+  }
+}
+
+/**
+ * Take the cached trees of a mesh that's about to be freed, see #bvhcache_attach.
+ *
+ * \return NULL when there is nothing to reuse.
+ */
+BVHCache *bvhcache_detach(Mesh *mesh)
+{
+  BVHCache *bvh_cache = mesh->runtime.bvh_cache;
+  if (bvh_cache == NULL) {
+    return NULL;
+  }
+
+  bool has_trees = false;
+  for (BVHCacheType type = 0; type < BVHTREE_MAX_ITEM; type++) {
+    BVHCacheItem *item = &bvh_cache->items[type];
+    /* Trees that weren't used since they were moved to this mesh aren't likely needed. */
+    if (item->is_refit_pending || !bvhcache_type_supports_refit(type)) {
+      BLI_bvhtree_free(item->tree);
+      item->tree = NULL;
+      item->is_filled = false;
+      item->is_refit_pending = 0;
+    }
+    else if (item->is_filled) {
+      has_trees = true;
+    }
+  }
+
+  if (!has_trees) {
+    return NULL;
+  }
+
+  bvhcache_topology_store(bvh_cache, mesh);
+
+  mesh->runtime.bvh_cache = NULL;
+  bvh_cache->mesh = NULL;
+  return bvh_cache;
+}
+
+/**
+ * Reuse the trees from #bvhcache_detach for a mesh with the same topology,
+ * the cache is freed otherwise.
+ */
+void bvhcache_attach(BVHCache *bvh_cache, Mesh *mesh)
+{
+  if (bvh_cache == NULL) {
+    return;
+  }
+
+  if ((mesh->runtime.bvh_cache != NULL) || !bvhcache_topology_equals(bvh_cache, mesh)) {
+    bvhcache_free(bvh_cache);
+    return;
+  }
+  /* Don't keep the previous topology alive, it's stored again when detaching. */
+  bvhcache_topology_free(bvh_cache);
+
+  for (BVHCacheType type = 0; type < BVHTREE_MAX_ITEM; type++) {
+    BVHCacheItem *item = &bvh_cache->items[type];
+    item->is_refit_pending = item->is_filled;
+  }
+  bvh_cache->mesh = mesh;
+  mesh->runtime.bvh_cache = bvh_cache;
+}
+
 /** \} */
 /* -------------------------------------------------------------------- */
 /** \name Local Callbacks
@@ -555,7 +863,8 @@ static BVHTree *bvhtree_from_editmesh_verts_create_tree(float epsilon,
     verts_num_active = verts_num;
   }
 
-  BVHTree *tree = BLI_bvhtree_new(verts_num_active, epsilon, tree_type, axis);
+  BVHTree *tree = BLI_bvhtree_new_ex(
+      verts_num_active, epsilon, tree_type, axis, BVHTREE_FROM_MESH_BUILD_FLAG);
 
   if (tree) {
     for (int i = 0; i < verts_num; i++) {
@@ -590,7 +899,8 @@ static BVHTree *bvhtree_from_mesh_verts_create_tree(float epsilon,
   }
 
   if (verts_num_active) {
-    tree = BLI_bvhtree_new(verts_num_active, epsilon, tree_type, axis);
+    tree = BLI_bvhtree_new_ex(
+        verts_num_active, epsilon, tree_type, axis, BVHTREE_FROM_MESH_BUILD_FLAG);
 
     if (tree) {
       for (int i = 0; i < verts_num; i++) {
@@ -751,7 +1061,8 @@ static BVHTree *bvhtree_from_editmesh_edges_create_tree(float epsilon,
     edges_num_active = edges_num;
   }
 
-  BVHTree *tree = BLI_bvhtree_new(edges_num_active, epsilon, tree_type, axis);
+  BVHTree *tree = BLI_bvhtree_new_ex(
+      edges_num_active, epsilon, tree_type, axis, BVHTREE_FROM_MESH_BUILD_FLAG);
 
   if (tree) {
     int i;
@@ -794,7 +1105,8 @@ static BVHTree *bvhtree_from_mesh_edges_create_tree(const MVert *vert,
 
   if (edges_num_active) {
     /* Create a bvh-tree of the given target */
-    tree = BLI_bvhtree_new(edges_num_active, epsilon, tree_type, axis);
+    tree = BLI_bvhtree_new_ex(
+        edges_num_active, epsilon, tree_type, axis, BVHTREE_FROM_MESH_BUILD_FLAG);
     if (tree) {
       for (int i = 0; i < edge_num; i++) {
         if (edges_mask && !BLI_BITMAP_TEST_BOOL(edges_mask, i)) {
@@ -969,7 +1281,8 @@ static BVHTree *bvhtree_from_mesh_faces_create_tree(float epsilon,
 
     /* Create a bvh-tree of the given target */
     /* printf("%s: building BVH, total=%d\n", __func__, numFaces); */
-    tree = BLI_bvhtree_new(faces_num_active, epsilon, tree_type, axis);
+    tree = BLI_bvhtree_new_ex(
+        faces_num_active, epsilon, tree_type, axis, BVHTREE_FROM_MESH_BUILD_FLAG);
     if (tree) {
       if (vert && face) {
         for (i = 0; i < faces_num; i++) {
@@ -1096,7 +1409,8 @@ static BVHTree *bvhtree_from_editmesh_looptri_create_tree(float epsilon,
 
     /* Create a bvh-tree of the given target */
     /* printf("%s: building BVH, total=%d\n", __func__, numFaces); */
-    tree = BLI_bvhtree_new(looptri_num_active, epsilon, tree_type, axis);
+    tree = BLI_bvhtree_new_ex(
+        looptri_num_active, epsilon, tree_type, axis, BVHTREE_FROM_MESH_BUILD_FLAG);
     if (tree) {
       const struct BMLoop *(*looptris)[3] = (void *)em->looptris;
 
@@ -1148,7 +1462,8 @@ static BVHTree *bvhtree_from_mesh_looptri_create_tree(float epsilon,
   if (looptri_num_active) {
     /* Create a bvh-tree of the given target */
     /* printf("%s: building BVH, total=%d\n", __func__, numFaces); */
-    tree = BLI_bvhtree_new(looptri_num_active, epsilon, tree_type, axis);
+    tree = BLI_bvhtree_new_ex(
+        looptri_num_active, epsilon, tree_type, axis, BVHTREE_FROM_MESH_BUILD_FLAG);
     if (tree) {
       if (vert && looptri) {
         for (int i = 0; i < looptri_num; i++) {
@@ -26,6 +26,8 @@
 
 #include "MEM_guardedalloc.h"
 
+#include "atomic_ops.h"
+
 /* Since we have versioning code here (CustomData_verify_versions()). */
 #define DNA_DEPRECATED_ALLOW
 
@@ -35,6 +37,7 @@
 #include "DNA_meshdata_types.h"
 #include "DNA_pointcloud_types.h"
 
+#include "BLI_hash_mm2a.h"
 #include "BLI_math.h"
 #include "BLI_math_color_blend.h"
 #include "BLI_mempool.h"
@@ -2035,6 +2038,101 @@ static bool customdata_typemap_is_valid(const CustomData *data)
 }
 #endif
 
+/* -------------------------------------------------------------------- */
+/** \name Layer Data Sharing
+ *
+ * Layers copied as #CD_REFERENCE from a layer owning its data share that data with reference
+ * counting, instead of only pointing to it. The data is freed by whichever of the layers
+ * releases it last, so the copies can safely outlive the custom-data they were copied from
+ * (evaluated meshes rely on this, modifier stacks free intermediate meshes as they go).
+ *
+ * Referencing layers keep the #CD_FLAG_NOFREE flag, so code writing to them still has to call
+ * #CustomData_duplicate_referenced_layer first, which is where the data actually gets copied.
+ * \{ */
+
+typedef struct CustomDataLayerSharing {
+  int users;
+  /** False once the owner layer took back its data (reallocated or replaced it). */
+  bool owns_data;
+} CustomDataLayerSharing;
+
+static void customData_layer_share(const CustomDataLayer *src_layer, CustomDataLayer *dst_layer)
+{
+  CustomDataLayerSharing *sharing = src_layer->sharing;
+
+  if (sharing == NULL) {
+    /* The source may be shared from multiple threads at once (e.g. evaluating several objects
+     * using the same mesh), so this is the only place where it is modified concurrently. */
+    CustomDataLayerSharing *sharing_new = MEM_mallocN(sizeof(*sharing_new), __func__);
+    sharing_new->users = 1;
+    sharing_new->owns_data = true;
+    sharing = atomic_cas_ptr((void **)&((CustomDataLayer *)src_layer)->sharing, NULL, sharing_new);
+    if (sharing == NULL) {
+      sharing = sharing_new;
+    }
+    else {
+      MEM_freeN(sharing_new);
+    }
+  }
+
+  atomic_add_and_fetch_int32(&sharing->users, 1);
+  dst_layer->sharing = sharing;
+}
+
+/**
+ * Remove a user from the shared data of \a layer.
+ * \return true when this was the last user and the data must be freed now.
+ */
+static bool customData_layer_sharing_release(CustomDataLayer *layer)
+{
+  CustomDataLayerSharing *sharing = layer->sharing;
+  layer->sharing = NULL;
+
+  if (atomic_sub_and_fetch_int32(&sharing->users, 1) != 0) {
+    return false;
+  }
+  const bool owns_data = sharing->owns_data;
+  MEM_freeN(sharing);
+  return owns_data;
+}
+
+static void customData_layer_data_free(CustomDataLayer *layer, int totelem)
+{
+  const LayerTypeInfo *typeInfo = layerType_getInfo(layer->type);
+
+  if (typeInfo->free) {
+    typeInfo->free(layer->data, totelem, typeInfo->size);
+  }
+
+  if (layer->data) {
+    MEM_freeN(layer->data);
+  }
+}
+
+/**
+ * Stop sharing the data of \a layer, for when its data pointer gets replaced or reallocated.
+ * As with plain references, it's up to the caller not to do that while other users still
+ * need the data.
+ */
+static void customData_layer_unshare(CustomDataLayer *layer)
+{
+  if (layer->flag & CD_FLAG_NOFREE) {
+    /* A reference, free the data if its owner is already gone. */
+    void *data = layer->data;
+    if (customData_layer_sharing_release(layer) && data) {
+      const LayerTypeInfo *typeInfo = layerType_getInfo(layer->type);
+      customData_layer_data_free(layer, (int)(MEM_allocN_len(data) / typeInfo->size));
+    }
+  }
+  else {
+    /* The owner, the data stays its own (other users won't free it anymore). */
+    layer->sharing->owns_data = false;
+    customData_layer_sharing_release(layer);
+  }
+}
+
+/** \} */
+
 bool CustomData_merge(const struct CustomData *source,
                       struct CustomData *dest,
                       CustomDataMask mask,
@@ -2101,6 +2199,16 @@ bool CustomData_merge(const struct CustomData *source,
       newlayer = customData_add_layer__internal(dest, type, alloctype, data, totelem, layer->name);
     }
 
+    if (newlayer && data) {
+      if (alloctype == CD_ASSIGN) {
+        /* The source layer is discarded by the caller, so it hands over its users too. */
+        newlayer->sharing = layer->sharing;
+      }
+      else if ((alloctype == CD_REFERENCE) && (layer->sharing || !(flag & CD_FLAG_NOFREE))) {
+        customData_layer_share(layer, newlayer);
+      }
+    }
+
     if (newlayer) {
       newlayer->uid = layer->uid;
 
@@ -2127,6 +2235,9 @@ void CustomData_realloc(CustomData *data, int totelem)
     if (layer->flag & CD_FLAG_NOFREE) {
       continue;
     }
+    if (layer->sharing) {
+      customData_layer_unshare(layer);
+    }
     typeInfo = layerType_getInfo(layer->type);
     layer->data = MEM_reallocN(layer->data, (size_t)totelem * typeInfo->size);
   }
@@ -2149,18 +2260,15 @@ void CustomData_copy(const struct CustomData *source,
 
 static void customData_free_layer__internal(CustomDataLayer *layer, int totelem)
 {
-  const LayerTypeInfo *typeInfo;
-
-  if (!(layer->flag & CD_FLAG_NOFREE) && layer->data) {
-    typeInfo = layerType_getInfo(layer->type);
+  bool do_free = !(layer->flag & CD_FLAG_NOFREE);
 
-    if (typeInfo->free) {
-      typeInfo->free(layer->data, totelem, typeInfo->size);
-    }
+  if (layer->sharing) {
+    /* Shared data is freed by its last user, be it the owner or a reference. */
+    do_free = customData_layer_sharing_release(layer);
+  }
 
-    if (layer->data) {
-      MEM_freeN(layer->data);
-    }
+  if (do_free && layer->data) {
+    customData_layer_data_free(layer, totelem);
   }
 }
 
@@ -2549,6 +2657,7 @@ static CustomDataLayer *customData_add_layer__internal(CustomData *data,
   data->layers[index].type = type;
   data->layers[index].flag = flag;
   data->layers[index].data = newlayerdata;
+  data->layers[index].sharing = NULL;
 
   /* Set default name if none exists. Note we only call DATA_()  once
    * we know there is a default name, to avoid overhead of locale lookups
@@ -2734,12 +2843,21 @@ static void *customData_duplicate_referenced_layer_index(CustomData *data,
 
   layer = &data->layers[layer_index];
 
+  if ((layer->flag & CD_FLAG_NOFREE) && layer->sharing && layer->sharing->users == 1 &&
+      layer->sharing->owns_data) {
+    /* The layer it was referencing is gone, take over the data instead of copying it. */
+    MEM_freeN(layer->sharing);
+    layer->sharing = NULL;
+    layer->flag &= ~CD_FLAG_NOFREE;
+  }
+
   if (layer->flag & CD_FLAG_NOFREE) {
     /* MEM_dupallocN won't work in case of complex layers, like e.g.
      * CD_MDEFORMVERT, which has pointers to allocated data...
      * So in case a custom copy function is defined, use it!
      */
     const LayerTypeInfo *typeInfo = layerType_getInfo(layer->type);
+    void *src_data = layer->data;
 
     if (typeInfo->copy) {
       void *dst_data = MEM_malloc_arrayN(
@@ -2751,6 +2869,14 @@ static void *customData_duplicate_referenced_layer_index(CustomData *data,
       layer->data = MEM_dupallocN(layer->data);
     }
 
+    if (layer->sharing && customData_layer_sharing_release(layer)) {
+      /* The owner is already gone, this was the last user of the shared data. */
+      void *dst_data = layer->data;
+      layer->data = src_data;
+      customData_layer_data_free(layer, totelem);
+      layer->data = dst_data;
+    }
+
     layer->flag &= ~CD_FLAG_NOFREE;
   }
 
@@ -3240,6 +3366,9 @@ void *CustomData_set_layer(const CustomData *data, int type, void *ptr)
     return NULL;
   }
 
+  if (data->layers[layer_index].sharing) {
+    customData_layer_unshare(&data->layers[layer_index]);
+  }
   data->layers[layer_index].data = ptr;
 
   return ptr;
@@ -3253,6 +3382,9 @@ void *CustomData_set_layer_n(const struct CustomData *data, int type, int n, voi
     return NULL;
   }
 
+  if (data->layers[layer_index].sharing) {
+    customData_layer_unshare(&data->layers[layer_index]);
+  }
   data->layers[layer_index].data = ptr;
 
   return ptr;
@@ -3619,9 +3751,12 @@ void CustomData_bmesh_free_block_data(CustomData *data, void *block)
   }
 }
 
-static void CustomData_bmesh_alloc_block(CustomData *data, void **block)
+/**
+ * Allocate a block without initializing it, for callers that fill in the block later
+ * (possibly from another thread, since the allocation itself isn't thread-safe).
+ */
+void CustomData_bmesh_alloc_block(CustomData *data, void **block)
 {
-
   if (*block) {
     CustomData_bmesh_free_block(data, block);
   }
@@ -4260,6 +4395,55 @@ const char *CustomData_layertype_name(int type)
   return layerType_getName(type);
 }
 
+/**
+ * Add the layers and their contents to \a mm64, so custom-data with equal contents gives equal
+ * hashes. Run-time flags and state (like being referenced) are ignored.
+ *
+ * \return false when a layer holds data that can't be hashed
+ * (types storing pointers, with the exception of deform weights).
+ */
+bool CustomData_data_hash(const CustomData *data, const int totelem, BLI_HashMurmur64A *mm64)
+{
+  BLI_hash_mm64a_add_int(mm64, data->totlayer);
+
+  for (int i = 0; i < data->totlayer; i++) {
+    const CustomDataLayer *layer = &data->layers[i];
+    const LayerTypeInfo *typeInfo = layerType_getInfo(layer->type);
+
+    BLI_hash_mm64a_add_int(mm64, layer->type);
+    BLI_hash_mm64a_add_int(mm64, layer->flag & ~CD_FLAG_NOFREE);
+    BLI_hash_mm64a_add_int(mm64, layer->active);
+    BLI_hash_mm64a_add_int(mm64, layer->active_rnd);
+    BLI_hash_mm64a_add_int(mm64, layer->active_clone);
+    BLI_hash_mm64a_add_int(mm64, layer->active_mask);
+    BLI_hash_mm64a_add(mm64, (const uchar *)layer->name, strlen(layer->name));
+
+    if (layer->data == NULL) {
+      continue;
+    }
+
+    if (layer->type == CD_MDEFORMVERT) {
+      const MDeformVert *dvert = layer->data;
+      for (int j = 0; j < totelem; j++, dvert++) {
+        BLI_hash_mm64a_add_int(mm64, dvert->totweight);
+        if (dvert->dw) {
+          BLI_hash_mm64a_add(
+              mm64, (const uchar *)dvert->dw, sizeof(*dvert->dw) * (size_t)dvert->totweight);
+        }
+      }
+    }
+    else if (typeInfo->free) {
+      /* Types that need freeing own data through pointers. */
+      return false;
+    }
+    else {
+      BLI_hash_mm64a_add(mm64, layer->data, (size_t)typeInfo->size * (size_t)totelem);
+    }
+  }
+
+  return true;
+}
+
 /**
  * Can only ever be one of these.
  */
@@ -299,7 +299,7 @@ void BKE_lattice_resize(Lattice *lt, int uNew, int vNew, int wNew, Object *ltOb)
 
     copy_m4_m4(mat, ltOb->obmat);
     unit_m4(ltOb->obmat);
-    lattice_deform_verts(ltOb, NULL, NULL, vert_coords, uNew * vNew * wNew, 0, NULL, 1.0f);
+    lattice_deform_verts(ltOb, NULL, NULL, vert_coords, uNew * vNew * wNew, 0, NULL, 1.0f, NULL);
     copy_m4_m4(ltOb->obmat, mat);
 
     lt->typeu = typeu;
@@ -351,7 +351,11 @@ Lattice *BKE_lattice_copy(Main *bmain, const Lattice *lt)
 
 typedef struct LatticeDeformData {
   Object *object;
+  /** The lattice itself, or the edit lattice. */
+  const Lattice *lt;
   float *latticedata;
+  /** Weights of the lattice's own vertex group, per point, NULL when it has none. */
+  float *lattice_weights;
   float latmat[4][4];
 } LatticeDeformData;
 
@@ -368,16 +372,29 @@ LatticeDeformData *init_latt_deform(Object *oblatt, Object *ob)
   float fu, fv, fw;
   int u, v, w;
   float *latticedata;
+  float *lattice_weights = NULL;
   float latmat[4][4];
   LatticeDeformData *lattice_deform_data;
+  MDeformVert *dvert = BKE_lattice_deform_verts_get(oblatt);
 
   if (lt->editlatt) {
     lt = lt->editlatt->latt;
   }
   bp = lt->def;
 
-  fp = latticedata = MEM_mallocN(sizeof(float) * 3 * lt->pntsu * lt->pntsv * lt->pntsw,
-                                 "latticedata");
+  const int totpoint = lt->pntsu * lt->pntsv * lt->pntsw;
+  fp = latticedata = MEM_mallocN(sizeof(float) * 3 * totpoint, "latticedata");
+
+  /* vgroup influence, looked up once per point instead of once per deformed vertex */
+  if (lt->vgroup[0] && dvert) {
+    const int defgrp_index = BKE_object_defgroup_name_index(oblatt, lt->vgroup);
+    if (defgrp_index != -1) {
+      lattice_weights = MEM_malloc_arrayN(totpoint, sizeof(float), "lattice_weights");
+      for (int i = 0; i < totpoint; i++) {
+        lattice_weights[i] = BKE_defvert_find_weight(dvert + i, defgrp_index);
+      }
+    }
+  }
 
   /* for example with a particle system: (ob == NULL) */
   if (ob == NULL) {
@@ -417,150 +434,143 @@ LatticeDeformData *init_latt_deform(Object *oblatt, Object *ob)
 
   lattice_deform_data = MEM_mallocN(sizeof(LatticeDeformData), "Lattice Deform Data");
   lattice_deform_data->latticedata = latticedata;
+  lattice_deform_data->lattice_weights = lattice_weights;
   lattice_deform_data->object = oblatt;
+  lattice_deform_data->lt = lt;
   copy_m4_m4(lattice_deform_data->latmat, latmat);
 
   return lattice_deform_data;
 }
 
-void calc_latt_deform(LatticeDeformData *lattice_deform_data, float co[3], float weight)
+/**
+ * Offsets of the 4 lattice points along one axis which influence position \a co,
+ * clamped to the lattice, and their B-Spline weights.
+ */
+static void lattice_deform_axis_basis(const float co,
+                                      const int pnts,
+                                      const float f,
+                                      const float d,
+                                      const char type,
+                                      const int stride,
+                                      int r_offsets[4],
+                                      float r_weights[4])
 {
-  Object *ob = lattice_deform_data->object;
-  Lattice *lt = ob->data;
-  float u, v, w, tu[4], tv[4], tw[4];
-  float vec[3];
-  int idx_w, idx_v, idx_u;
-  int ui, vi, wi, uu, vv, ww;
+  int index;
 
-  /* vgroup influence */
-  int defgrp_index = -1;
-  float co_prev[3], weight_blend = 0.0f;
-  MDeformVert *dvert = BKE_lattice_deform_verts_get(ob);
-  float *__restrict latticedata = lattice_deform_data->latticedata;
-
-  if (lt->editlatt) {
-    lt = lt->editlatt->latt;
+  if (pnts > 1) {
+    float t = (co - f) / d;
+    index = (int)floor(t);
+    t -= index;
+    key_curve_position_weights(t, r_weights, type);
   }
-  if (latticedata == NULL) {
-    return;
+  else {
+    r_weights[0] = r_weights[2] = r_weights[3] = 0.0;
+    r_weights[1] = 1.0;
+    index = 0;
   }
 
-  if (lt->vgroup[0] && dvert) {
-    defgrp_index = BKE_object_defgroup_name_index(ob, lt->vgroup);
-    copy_v3_v3(co_prev, co);
+  for (int i = 0; i < 4; i++) {
+    r_offsets[i] = clamp_i(index + i - 1, 0, pnts - 1) * stride;
   }
+}
+
+/**
+ * The basis of lattice deformation for one vertex: offsets of the lattice points (along U, V
+ * and W) influencing local coordinate \a co and their weights. The offsets of one point along
+ * each axis add up to its index.
+ */
+static void lattice_deform_basis(const LatticeDeformData *lattice_deform_data,
+                                 const float co[3],
+                                 int r_offsets[3][4],
+                                 float r_weights[3][4])
+{
+  const Lattice *lt = lattice_deform_data->lt;
+  float vec[3];
 
   /* co is in local coords, treat with latmat */
   mul_v3_m4v3(vec, lattice_deform_data->latmat, co);
 
   /* u v w coords */
+  lattice_deform_axis_basis(
+      vec[0], lt->pntsu, lt->fu, lt->du, lt->typeu, 1, r_offsets[0], r_weights[0]);
+  lattice_deform_axis_basis(
+      vec[1], lt->pntsv, lt->fv, lt->dv, lt->typev, lt->pntsu, r_offsets[1], r_weights[1]);
+  lattice_deform_axis_basis(vec[2],
+                            lt->pntsw,
+                            lt->fw,
+                            lt->dw,
+                            lt->typew,
+                            lt->pntsu * lt->pntsv,
+                            r_offsets[2],
+                            r_weights[2]);
+}
 
-  if (lt->pntsu > 1) {
-    u = (vec[0] - lt->fu) / lt->du;
-    ui = (int)floor(u);
-    u -= ui;
-    key_curve_position_weights(u, tu, lt->typeu);
-  }
-  else {
-    tu[0] = tu[2] = tu[3] = 0.0;
-    tu[1] = 1.0;
-    ui = 0;
-  }
-
-  if (lt->pntsv > 1) {
-    v = (vec[1] - lt->fv) / lt->dv;
-    vi = (int)floor(v);
-    v -= vi;
-    key_curve_position_weights(v, tv, lt->typev);
-  }
-  else {
-    tv[0] = tv[2] = tv[3] = 0.0;
-    tv[1] = 1.0;
-    vi = 0;
-  }
+/** Gather the offsets of the lattice points given by a basis, see #lattice_deform_basis. */
+static void lattice_deform_apply(const LatticeDeformData *lattice_deform_data,
+                                 const int offsets[3][4],
+                                 const float weights[3][4],
+                                 float co[3],
+                                 const float weight)
+{
+  const float *__restrict latticedata = lattice_deform_data->latticedata;
+  const float *__restrict lattice_weights = lattice_deform_data->lattice_weights;
+  float co_prev[3], weight_blend = 0.0f;
 
-  if (lt->pntsw > 1) {
-    w = (vec[2] - lt->fw) / lt->dw;
-    wi = (int)floor(w);
-    w -= wi;
-    key_curve_position_weights(w, tw, lt->typew);
-  }
-  else {
-    tw[0] = tw[2] = tw[3] = 0.0;
-    tw[1] = 1.0;
-    wi = 0;
+  if (lattice_weights) {
+    copy_v3_v3(co_prev, co);
   }
 
-  for (ww = wi - 1; ww <= wi + 2; ww++) {
-    w = tw[ww - wi + 1];
-
-    if (w != 0.0f) {
-      if (ww > 0) {
-        if (ww < lt->pntsw) {
-          idx_w = ww * lt->pntsu * lt->pntsv;
-        }
-        else {
-          idx_w = (lt->pntsw - 1) * lt->pntsu * lt->pntsv;
-        }
-      }
-      else {
-        idx_w = 0;
+  for (int ww = 0; ww < 4; ww++) {
+    const float w = weights[2][ww];
+    if (w == 0.0f) {
+      continue;
+    }
+    for (int vv = 0; vv < 4; vv++) {
+      const float v = w * weights[1][vv];
+      if (v == 0.0f) {
+        continue;
       }
+      const int idx_v = offsets[2][ww] + offsets[1][vv];
+      for (int uu = 0; uu < 4; uu++) {
+        const float u = weight * v * weights[0][uu];
+        if (u == 0.0f) {
+          continue;
+        }
+        const int idx_u = idx_v + offsets[0][uu];
 
-      for (vv = vi - 1; vv <= vi + 2; vv++) {
-        v = w * tv[vv - vi + 1];
-
-        if (v != 0.0f) {
-          if (vv > 0) {
-            if (vv < lt->pntsv) {
-              idx_v = idx_w + vv * lt->pntsu;
-            }
-            else {
-              idx_v = idx_w + (lt->pntsv - 1) * lt->pntsu;
-            }
-          }
-          else {
-            idx_v = idx_w;
-          }
+        madd_v3_v3fl(co, &latticedata[idx_u * 3], u);
 
-          for (uu = ui - 1; uu <= ui + 2; uu++) {
-            u = weight * v * tu[uu - ui + 1];
-
-            if (u != 0.0f) {
-              if (uu > 0) {
-                if (uu < lt->pntsu) {
-                  idx_u = idx_v + uu;
-                }
-                else {
-                  idx_u = idx_v + (lt->pntsu - 1);
-                }
-              }
-              else {
-                idx_u = idx_v;
-              }
-
-              madd_v3_v3fl(co, &latticedata[idx_u * 3], u);
-
-              if (defgrp_index != -1) {
-                weight_blend += (u * BKE_defvert_find_weight(dvert + idx_u, defgrp_index));
-              }
-            }
-          }
+        if (lattice_weights) {
+          weight_blend += u * lattice_weights[idx_u];
         }
       }
     }
   }
 
-  if (defgrp_index != -1) {
+  if (lattice_weights) {
     interp_v3_v3v3(co, co_prev, co, weight_blend);
   }
 }
 
+void calc_latt_deform(LatticeDeformData *lattice_deform_data, float co[3], float weight)
+{
+  int offsets[3][4];
+  float weights[3][4];
+
+  if (lattice_deform_data->latticedata == NULL) {
+    return;
+  }
+
+  lattice_deform_basis(lattice_deform_data, co, offsets, weights);
+  lattice_deform_apply(lattice_deform_data, offsets, weights, co, weight);
+}
+
 void end_latt_deform(LatticeDeformData *lattice_deform_data)
 {
   if (lattice_deform_data->latticedata) {
     MEM_freeN(lattice_deform_data->latticedata);
   }
+  MEM_SAFE_FREE(lattice_deform_data->lattice_weights);
 
   MEM_freeN(lattice_deform_data);
 }
@@ -652,7 +662,7 @@ static bool where_on_path_deform(
 /* returns quaternion for rotation, using cd->no_rot_axis */
 /* axis is using another define!!! */
 static bool calc_curve_deform(
-    Object *par, float co[3], const short axis, CurveDeform *cd, float r_quat[4])
+    Object *par, float co[3], const short axis, const CurveDeform *cd, float r_quat[4])
 {
   Curve *cu = par->data;
   float fac, loc[4], dir[3], new_quat[4], radius;
@@ -759,6 +769,55 @@ static bool calc_curve_deform(
   return false;
 }
 
+typedef struct CurveDeformUserdata {
+  Object *cuOb;
+  const CurveDeform *cd;
+  float (*vert_coords)[3];
+  const MDeformVert *dvert;
+  int defgrp_index;
+  short defaxis;
+  bool invert_vgroup;
+  /** The coordinates were already transformed to curve space, while finding the bounds. */
+  bool is_curvespace;
+} CurveDeformUserdata;
+
+static float curve_deform_vert_weight(const CurveDeformUserdata *data, const int index)
+{
+  const float weight = BKE_defvert_find_weight(data->dvert + index, data->defgrp_index);
+  return data->invert_vgroup ? 1.0f - weight : weight;
+}
+
+static void curve_deform_vert_task(void *__restrict userdata,
+                                   const int index,
+                                   const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const CurveDeformUserdata *data = userdata;
+  const CurveDeform *cd = data->cd;
+  float *co = data->vert_coords[index];
+
+  if (data->dvert) {
+    const float weight = curve_deform_vert_weight(data, index);
+    float vec[3];
+
+    if (weight > 0.0f) {
+      if (!data->is_curvespace) {
+        mul_m4_v3(cd->curvespace, co);
+      }
+      copy_v3_v3(vec, co);
+      calc_curve_deform(data->cuOb, vec, data->defaxis, cd, NULL);
+      interp_v3_v3v3(co, co, vec, weight);
+      mul_m4_v3(cd->objectspace, co);
+    }
+  }
+  else {
+    if (!data->is_curvespace) {
+      mul_m4_v3(cd->curvespace, co);
+    }
+    calc_curve_deform(data->cuOb, co, data->defaxis, cd, NULL);
+    mul_m4_v3(cd->objectspace, co);
+  }
+}
+
 void curve_deform_verts(Object *cuOb,
                         Object *target,
                         float (*vert_coords)[3],
@@ -772,7 +831,6 @@ void curve_deform_verts(Object *cuOb,
   int a;
   CurveDeform cd;
   const bool is_neg_axis = (defaxis > 2);
-  const bool invert_vgroup = (flag & MOD_CURVE_INVERT_VGROUP) != 0;
 
   if (cuOb->type != OB_CURVE) {
     return;
@@ -793,78 +851,34 @@ void curve_deform_verts(Object *cuOb,
     cd.dmax[0] = cd.dmax[1] = cd.dmax[2] = 0.0f;
   }
 
-  if (dvert) {
-    MDeformVert *dvert_iter;
-    float vec[3];
-
-    if (cu->flag & CU_DEFORM_BOUNDS_OFF) {
-      for (a = 0, dvert_iter = dvert; a < numVerts; a++, dvert_iter++) {
-        const float weight = invert_vgroup ?
-                                 1.0f - BKE_defvert_find_weight(dvert_iter, defgrp_index) :
-                                 BKE_defvert_find_weight(dvert_iter, defgrp_index);
-
-        if (weight > 0.0f) {
-          mul_m4_v3(cd.curvespace, vert_coords[a]);
-          copy_v3_v3(vec, vert_coords[a]);
-          calc_curve_deform(cuOb, vec, defaxis, &cd, NULL);
-          interp_v3_v3v3(vert_coords[a], vert_coords[a], vec, weight);
-          mul_m4_v3(cd.objectspace, vert_coords[a]);
-        }
-      }
-    }
-    else {
-      /* set mesh min/max bounds */
-      INIT_MINMAX(cd.dmin, cd.dmax);
-
-      for (a = 0, dvert_iter = dvert; a < numVerts; a++, dvert_iter++) {
-        const float weight = invert_vgroup ?
-                                 1.0f - BKE_defvert_find_weight(dvert_iter, defgrp_index) :
-                                 BKE_defvert_find_weight(dvert_iter, defgrp_index);
-        if (weight > 0.0f) {
-          mul_m4_v3(cd.curvespace, vert_coords[a]);
-          minmax_v3v3_v3(cd.dmin, cd.dmax, vert_coords[a]);
-        }
-      }
+  CurveDeformUserdata data = {
+      .cuOb = cuOb,
+      .cd = &cd,
+      .vert_coords = vert_coords,
+      .dvert = dvert,
+      .defgrp_index = defgrp_index,
+      .defaxis = defaxis,
+      .invert_vgroup = (flag & MOD_CURVE_INVERT_VGROUP) != 0,
+      .is_curvespace = false,
+  };
 
-      for (a = 0, dvert_iter = dvert; a < numVerts; a++, dvert_iter++) {
-        const float weight = invert_vgroup ?
-                                 1.0f - BKE_defvert_find_weight(dvert_iter, defgrp_index) :
-                                 BKE_defvert_find_weight(dvert_iter, defgrp_index);
-
-        if (weight > 0.0f) {
-          /* already in 'cd.curvespace', prev for loop */
-          copy_v3_v3(vec, vert_coords[a]);
-          calc_curve_deform(cuOb, vec, defaxis, &cd, NULL);
-          interp_v3_v3v3(vert_coords[a], vert_coords[a], vec, weight);
-          mul_m4_v3(cd.objectspace, vert_coords[a]);
-        }
-      }
-    }
-  }
-  else {
-    if (cu->flag & CU_DEFORM_BOUNDS_OFF) {
-      for (a = 0; a < numVerts; a++) {
-        mul_m4_v3(cd.curvespace, vert_coords[a]);
-        calc_curve_deform(cuOb, vert_coords[a], defaxis, &cd, NULL);
-        mul_m4_v3(cd.objectspace, vert_coords[a]);
-      }
-    }
-    else {
-      /* set mesh min max bounds */
-      INIT_MINMAX(cd.dmin, cd.dmax);
+  if ((cu->flag & CU_DEFORM_BOUNDS_OFF) == 0) {
+    /* set mesh min/max bounds */
+    INIT_MINMAX(cd.dmin, cd.dmax);
 
-      for (a = 0; a < numVerts; a++) {
+    for (a = 0; a < numVerts; a++) {
+      if (dvert == NULL || curve_deform_vert_weight(&data, a) > 0.0f) {
         mul_m4_v3(cd.curvespace, vert_coords[a]);
         minmax_v3v3_v3(cd.dmin, cd.dmax, vert_coords[a]);
       }
-
-      for (a = 0; a < numVerts; a++) {
-        /* already in 'cd.curvespace', prev for loop */
-        calc_curve_deform(cuOb, vert_coords[a], defaxis, &cd, NULL);
-        mul_m4_v3(cd.objectspace, vert_coords[a]);
-      }
     }
+    data.is_curvespace = true;
   }
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 32;
+  BLI_task_parallel_range(0, numVerts, &data, curve_deform_vert_task, &settings);
 }
 
 /* input vec and orco = local coord in armature space */
@@ -902,8 +916,31 @@ void curve_deform_vector(
   mul_m4_v3(cd.objectspace, vec);
 }
 
+/**
+ * Per vertex basis of a lattice deformation, see #lattice_deform_basis.
+ *
+ * The basis only depends on the coordinates being deformed and the lattice resolution and
+ * transform, not on the deformed lattice points. While the coordinates are unchanged
+ * (typically rest positions, for the first modifier of the stack), it's kept in the runtime
+ * data of the modifier, and evaluation only gathers the lattice point offsets.
+ */
+typedef struct LatticeDeformWeights {
+  /* What the basis was computed from. */
+  float (*vert_coords)[3];
+  int verts_num;
+  float latmat[4][4];
+  short pnts[3];
+  char type[3];
+  float f[3], d[3];
+
+  /** Only computed once the same coordinates are deformed again, NULL before that. */
+  int (*offsets)[3][4];
+  float (*weights)[3][4];
+} LatticeDeformWeights;
+
 typedef struct LatticeDeformUserdata {
   LatticeDeformData *lattice_deform_data;
+  LatticeDeformWeights *lattice_deform_weights;
   float (*vert_coords)[3];
   MDeformVert *dvert;
   int defgrp_index;
@@ -911,23 +948,133 @@ typedef struct LatticeDeformUserdata {
   bool invert_vgroup;
 } LatticeDeformUserdata;
 
+static void lattice_deform_weights_key_set(LatticeDeformWeights *weights,
+                                           const LatticeDeformData *lattice_deform_data)
+{
+  const Lattice *lt = lattice_deform_data->lt;
+  copy_m4_m4(weights->latmat, lattice_deform_data->latmat);
+  weights->pnts[0] = lt->pntsu;
+  weights->pnts[1] = lt->pntsv;
+  weights->pnts[2] = lt->pntsw;
+  weights->type[0] = lt->typeu;
+  weights->type[1] = lt->typev;
+  weights->type[2] = lt->typew;
+  copy_v3_fl3(weights->f, lt->fu, lt->fv, lt->fw);
+  copy_v3_fl3(weights->d, lt->du, lt->dv, lt->dw);
+}
+
+static bool lattice_deform_weights_is_valid(const LatticeDeformWeights *weights,
+                                            const LatticeDeformData *lattice_deform_data,
+                                            const float (*vert_coords)[3],
+                                            const int verts_num)
+{
+  LatticeDeformWeights key;
+  lattice_deform_weights_key_set(&key, lattice_deform_data);
+
+  return (weights->verts_num == verts_num) &&
+         (memcmp(weights->latmat, key.latmat, sizeof(key.latmat)) == 0) &&
+         (memcmp(weights->pnts, key.pnts, sizeof(key.pnts)) == 0) &&
+         (memcmp(weights->type, key.type, sizeof(key.type)) == 0) &&
+         (memcmp(weights->f, key.f, sizeof(key.f)) == 0) &&
+         (memcmp(weights->d, key.d, sizeof(key.d)) == 0) &&
+         (memcmp(weights->vert_coords, vert_coords, sizeof(*vert_coords) * verts_num) == 0);
+}
+
+void BKE_lattice_deform_weights_free(LatticeDeformWeights *weights)
+{
+  MEM_freeN(weights->vert_coords);
+  MEM_SAFE_FREE(weights->offsets);
+  MEM_SAFE_FREE(weights->weights);
+  MEM_freeN(weights);
+}
+
+static void lattice_deform_weights_task(void *__restrict userdata,
+                                        const int index,
+                                        const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const LatticeDeformUserdata *data = userdata;
+  LatticeDeformWeights *weights = data->lattice_deform_weights;
+
+  lattice_deform_basis(data->lattice_deform_data,
+                       data->vert_coords[index],
+                       weights->offsets[index],
+                       weights->weights[index]);
+}
+
+/**
+ * Get the cached basis for \a data, when the coordinates are the same as last time.
+ * Coordinates seen for the first time are only remembered, so deforming coordinates which
+ * change on every evaluation doesn't pay for computing and storing their basis.
+ */
+static LatticeDeformWeights *lattice_deform_weights_ensure(LatticeDeformUserdata *data,
+                                                           const int verts_num,
+                                                           LatticeDeformWeights **weights_cache,
+                                                           const TaskParallelSettings *settings)
+{
+  LatticeDeformWeights *weights = *weights_cache;
+
+  if (weights && lattice_deform_weights_is_valid(weights,
+                                                 data->lattice_deform_data,
+                                                 (const float(*)[3])data->vert_coords,
+                                                 verts_num)) {
+    if (weights->offsets == NULL) {
+      weights->offsets = MEM_malloc_arrayN(verts_num, sizeof(*weights->offsets), __func__);
+      weights->weights = MEM_malloc_arrayN(verts_num, sizeof(*weights->weights), __func__);
+      data->lattice_deform_weights = weights;
+      BLI_task_parallel_range(0, verts_num, data, lattice_deform_weights_task, settings);
+    }
+    return weights;
+  }
+
+  if (weights == NULL) {
+    weights = MEM_callocN(sizeof(*weights), __func__);
+    *weights_cache = weights;
+  }
+  else {
+    MEM_SAFE_FREE(weights->offsets);
+    MEM_SAFE_FREE(weights->weights);
+    if (weights->verts_num != verts_num) {
+      MEM_SAFE_FREE(weights->vert_coords);
+    }
+  }
+  if (weights->vert_coords == NULL) {
+    weights->vert_coords = MEM_malloc_arrayN(verts_num, sizeof(*weights->vert_coords), __func__);
+  }
+  memcpy(weights->vert_coords, data->vert_coords, sizeof(*weights->vert_coords) * verts_num);
+  weights->verts_num = verts_num;
+  lattice_deform_weights_key_set(weights, data->lattice_deform_data);
+  return NULL;
+}
+
 static void lattice_deform_vert_task(void *__restrict userdata,
                                      const int index,
                                      const TaskParallelTLS *__restrict UNUSED(tls))
 {
   const LatticeDeformUserdata *data = userdata;
+  const LatticeDeformWeights *weights = data->lattice_deform_weights;
+  float weight = data->fac;
 
   if (data->dvert != NULL) {
-    const float weight = data->invert_vgroup ?
-                             1.0f -
-                                 BKE_defvert_find_weight(data->dvert + index, data->defgrp_index) :
-                             BKE_defvert_find_weight(data->dvert + index, data->defgrp_index);
-    if (weight > 0.0f) {
-      calc_latt_deform(data->lattice_deform_data, data->vert_coords[index], weight * data->fac);
+    const float weight_vgroup = data->invert_vgroup ?
+                                    1.0f - BKE_defvert_find_weight(data->dvert + index,
+                                                                   data->defgrp_index) :
+                                    BKE_defvert_find_weight(data->dvert + index,
+                                                            data->defgrp_index);
+    if (!(weight_vgroup > 0.0f)) {
+      return;
     }
+    weight *= weight_vgroup;
+  }
+
+  if (weights) {
+    lattice_deform_apply(data->lattice_deform_data,
+                         weights->offsets[index],
+                         weights->weights[index],
+                         data->vert_coords[index],
+                         weight);
   }
   else {
-    calc_latt_deform(data->lattice_deform_data, data->vert_coords[index], data->fac);
+    calc_latt_deform(data->lattice_deform_data, data->vert_coords[index], weight);
   }
 }
 
@@ -938,7 +1085,8 @@ void lattice_deform_verts(Object *laOb,
                           int numVerts,
                           short flag,
                           const char *vgroup,
-                          float fac)
+                          float fac,
+                          LatticeDeformWeights **weights_cache)
 {
   LatticeDeformData *lattice_deform_data;
   MDeformVert *dvert = NULL;
@@ -982,6 +1130,12 @@ void lattice_deform_verts(Object *laOb,
   TaskParallelSettings settings;
   BLI_parallel_range_settings_defaults(&settings);
   settings.min_iter_per_thread = 32;
+
+  if (weights_cache != NULL && lattice_deform_data->latticedata != NULL) {
+    data.lattice_deform_weights = lattice_deform_weights_ensure(
+        &data, numVerts, weights_cache, &settings);
+  }
+
   BLI_task_parallel_range(0, numVerts, &data, lattice_deform_vert_task, &settings);
 
   end_latt_deform(lattice_deform_data);
@@ -993,7 +1147,8 @@ bool object_deform_mball(Object *ob, ListBase *dispbase)
     DispList *dl;
 
     for (dl = dispbase->first; dl; dl = dl->next) {
-      lattice_deform_verts(ob->parent, ob, NULL, (float(*)[3])dl->verts, dl->nr, 0, NULL, 1.0f);
+      lattice_deform_verts(
+          ob->parent, ob, NULL, (float(*)[3])dl->verts, dl->nr, 0, NULL, 1.0f, NULL);
     }
 
     return true;
@@ -21,6 +21,7 @@
 
 #include "BLI_ghash.h"
 #include "BLI_listbase.h"
+#include "BLI_oahash.h"
 #include "BLI_utildefines.h"
 
 #include "DNA_ID.h"
@@ -42,7 +43,7 @@
  * This doesn't account for adding/removing data-blocks,
  * and should only be used when performing many lookups.
  *
- * \note GHash's are initialized on demand,
+ * \note Hashes are initialized on demand,
  * since its likely some types will never have lookups run on them,
  * so its a waste to create and never use.
  * \{ */
@@ -55,9 +56,9 @@ struct IDNameLib_Key {
 };
 
 struct IDNameLib_TypeMap {
-  GHash *map;
+  OAHash *map;
   short id_type;
-  /* only for storage of keys in the ghash, avoid many single allocs */
+  /* only for storage of keys in the hash, avoid many single allocs */
   struct IDNameLib_Key *keys;
 };
 
@@ -66,7 +67,7 @@ struct IDNameLib_TypeMap {
  */
 struct IDNameLib_Map {
   struct IDNameLib_TypeMap type_maps[MAX_LIBARRAY];
-  struct GHash *uuid_map;
+  struct OAHash *uuid_map;
   struct Main *bmain;
   struct GSet *valid_id_pointers;
   int idmap_types;
@@ -117,11 +118,11 @@ struct IDNameLib_Map *BKE_main_idmap_create(struct Main *bmain,
 
   if (idmap_types & MAIN_IDMAP_TYPE_UUID) {
     ID *id;
-    id_map->uuid_map = BLI_ghash_int_new(__func__);
+    id_map->uuid_map = BLI_oahash_int_new(__func__);
     FOREACH_MAIN_ID_BEGIN (bmain, id) {
       BLI_assert(id->session_uuid != MAIN_ID_SESSION_UUID_UNSET);
       void **id_ptr_v;
-      const bool existing_key = BLI_ghash_ensure_p(
+      const bool existing_key = BLI_oahash_ensure_p(
           id_map->uuid_map, POINTER_FROM_UINT(id->session_uuid), &id_ptr_v);
       BLI_assert(existing_key == false);
       UNUSED_VARS_NDEBUG(existing_key);
@@ -187,21 +188,21 @@ ID *BKE_main_idmap_lookup_name(struct IDNameLib_Map *id_map,
     if (lb_len == 0) {
       return NULL;
     }
-    type_map->map = BLI_ghash_new_ex(idkey_hash, idkey_cmp, __func__, lb_len);
+    type_map->map = BLI_oahash_new_ex(idkey_hash, idkey_cmp, __func__, lb_len);
     type_map->keys = MEM_mallocN(sizeof(struct IDNameLib_Key) * lb_len, __func__);
 
-    GHash *map = type_map->map;
+    OAHash *map = type_map->map;
     struct IDNameLib_Key *key = type_map->keys;
 
     for (ID *id = lb->first; id; id = id->next, key++) {
       key->name = id->name + 2;
       key->lib = id->lib;
-      BLI_ghash_insert(map, key, id);
+      BLI_oahash_insert(map, key, id);
     }
   }
 
   const struct IDNameLib_Key key_lookup = {name, lib};
-  return BLI_ghash_lookup(type_map->map, &key_lookup);
+  return BLI_oahash_lookup(type_map->map, &key_lookup);
 }
 
 ID *BKE_main_idmap_lookup_id(struct IDNameLib_Map *id_map, const ID *id)
@@ -221,7 +222,7 @@ ID *BKE_main_idmap_lookup_id(struct IDNameLib_Map *id_map, const ID *id)
 ID *BKE_main_idmap_lookup_uuid(struct IDNameLib_Map *id_map, const uint session_uuid)
 {
   if (id_map->idmap_types & MAIN_IDMAP_TYPE_UUID) {
-    return BLI_ghash_lookup(id_map->uuid_map, POINTER_FROM_UINT(session_uuid));
+    return BLI_oahash_lookup(id_map->uuid_map, POINTER_FROM_UINT(session_uuid));
   }
   return NULL;
 }
@@ -232,14 +233,14 @@ void BKE_main_idmap_destroy(struct IDNameLib_Map *id_map)
     struct IDNameLib_TypeMap *type_map = id_map->type_maps;
     for (int i = 0; i < MAX_LIBARRAY; i++, type_map++) {
       if (type_map->map) {
-        BLI_ghash_free(type_map->map, NULL, NULL);
+        BLI_oahash_free(type_map->map, NULL, NULL);
         type_map->map = NULL;
         MEM_freeN(type_map->keys);
       }
     }
   }
   if (id_map->idmap_types & MAIN_IDMAP_TYPE_UUID) {
-    BLI_ghash_free(id_map->uuid_map, NULL, NULL);
+    BLI_oahash_free(id_map->uuid_map, NULL, NULL);
   }
 
   if (id_map->valid_id_pointers != NULL) {
@@ -43,6 +43,7 @@
 #include "BLI_polyfill_2d.h"
 #include "BLI_stack.h"
 #include "BLI_task.h"
+#include "BLI_threads.h"
 #include "BLI_utildefines.h"
 
 #include "BKE_customdata.h"
@@ -215,7 +216,6 @@ typedef struct MeshCalcNormalsData {
   const MLoop *mloop;
   MVert *mverts;
   float (*pnors)[3];
-  float (*lnors_weighted)[3];
   float (*vnors)[3];
 } MeshCalcNormalsData;
 
@@ -229,64 +229,85 @@ static void mesh_calc_normals_poly_cb(void *__restrict userdata,
   BKE_mesh_calc_poly_normal(mp, data->mloop + mp->loopstart, data->mverts, data->pnors[pidx]);
 }
 
-static void mesh_calc_normals_poly_prepare_cb(void *__restrict userdata,
-                                              const int pidx,
-                                              const TaskParallelTLS *__restrict UNUSED(tls))
+static void mesh_calc_normals_poly_and_accum_cb(void *__restrict userdata,
+                                                const int pidx,
+                                                const TaskParallelTLS *__restrict UNUSED(tls))
 {
   MeshCalcNormalsData *data = userdata;
   const MPoly *mp = &data->mpolys[pidx];
   const MLoop *ml = &data->mloop[mp->loopstart];
   const MVert *mverts = data->mverts;
+  float(*vnors)[3] = data->vnors;
 
   float pnor_temp[3];
   float *pnor = data->pnors ? data->pnors[pidx] : pnor_temp;
-  float(*lnors_weighted)[3] = data->lnors_weighted;
 
   const int nverts = mp->totloop;
-  float(*edgevecbuf)[3] = BLI_array_alloca(edgevecbuf, (size_t)nverts);
+  /* Triangles & quads (the vast majority of polygons) don't need a variable length buffer. */
+  float edgevec_quad[4][3];
+  float(*edgevecbuf)[3] = (nverts <= 4) ? edgevec_quad :
+                                          BLI_array_alloca(edgevecbuf, (size_t)nverts);
   int i;
 
-  /* Polygon Normal and edge-vector */
-  /* inline version of #BKE_mesh_calc_poly_normal, also does edge-vectors */
-  {
-    int i_prev = nverts - 1;
-    const float *v_prev = mverts[ml[i_prev].v].co;
-    const float *v_curr;
+  /* Polygon Normal */
+  if (nverts == 3) {
+    normal_tri_v3(pnor, mverts[ml[0].v].co, mverts[ml[1].v].co, mverts[ml[2].v].co);
+  }
+  else if (nverts == 4) {
+    normal_quad_v3(pnor,
+                   mverts[ml[0].v].co,
+                   mverts[ml[1].v].co,
+                   mverts[ml[2].v].co,
+                   mverts[ml[3].v].co);
+  }
+  else {
+    const float *v_prev = mverts[ml[nverts - 1].v].co;
 
     zero_v3(pnor);
     /* Newell's Method */
     for (i = 0; i < nverts; i++) {
-      v_curr = mverts[ml[i].v].co;
+      const float *v_curr = mverts[ml[i].v].co;
       add_newell_cross_v3_v3v3(pnor, v_prev, v_curr);
+      v_prev = v_curr;
+    }
+    normalize_v3(pnor);
+  }
+  if (UNLIKELY(is_zero_v3(pnor))) {
+    pnor[2] = 1.0f; /* other axes set to 0.0 */
+  }
 
-      /* Unrelated to normalize, calculate edge-vector */
+  /* Edge-vectors */
+  {
+    int i_prev = nverts - 1;
+    const float *v_prev = mverts[ml[i_prev].v].co;
+
+    for (i = 0; i < nverts; i++) {
+      const float *v_curr = mverts[ml[i].v].co;
       sub_v3_v3v3(edgevecbuf[i_prev], v_prev, v_curr);
       normalize_v3(edgevecbuf[i_prev]);
       i_prev = i;
-
       v_prev = v_curr;
     }
-    if (UNLIKELY(normalize_v3(pnor) == 0.0f)) {
-      pnor[2] = 1.0f; /* other axes set to 0.0 */
-    }
   }
 
-  /* accumulate angle weighted face normal */
-  /* inline version of #accumulate_vertex_normals_poly_v3,
-   * split between this threaded callback and #mesh_calc_normals_poly_accum_cb. */
+  /* Accumulate angle weighted face normal into the vertex normals. */
+  /* Inline version of #accumulate_vertex_normals_poly_v3. Vertices are shared between polygons,
+   * so add atomically: contention is rare, and this avoids a per-loop buffer of weighted normals
+   * that would have to be summed up on a single thread afterwards. */
   {
     const float *prev_edge = edgevecbuf[nverts - 1];
 
     for (i = 0; i < nverts; i++) {
-      const int lidx = mp->loopstart + i;
       const float *cur_edge = edgevecbuf[i];
 
       /* calculate angle between the two poly edges incident on
        * this vertex */
       const float fac = saacos(-dot_v3v3(cur_edge, prev_edge));
+      float *vnor = vnors[ml[i].v];
 
-      /* Store for later accumulation */
-      mul_v3_v3fl(lnors_weighted[lidx], pnor, fac);
+      atomic_add_and_fetch_fl(&vnor[0], pnor[0] * fac);
+      atomic_add_and_fetch_fl(&vnor[1], pnor[1] * fac);
+      atomic_add_and_fetch_fl(&vnor[2], pnor[2] * fac);
 
       prev_edge = cur_edge;
     }
@@ -315,7 +336,7 @@ void BKE_mesh_calc_normals_poly(MVert *mverts,
                                 int numVerts,
                                 const MLoop *mloop,
                                 const MPoly *mpolys,
-                                int numLoops,
+                                int UNUSED(numLoops),
                                 int numPolys,
                                 float (*r_polynors)[3],
                                 const bool only_face_normals)
@@ -325,6 +346,8 @@ void BKE_mesh_calc_normals_poly(MVert *mverts,
   TaskParallelSettings settings;
   BLI_parallel_range_settings_defaults(&settings);
   settings.min_iter_per_thread = 1024;
+  /* The cost of n-gons depends on their number of sides. */
+  settings.use_adaptive_grain_size = true;
 
   if (only_face_normals) {
     BLI_assert((pnors != NULL) || (numPolys == 0));
@@ -342,8 +365,6 @@ void BKE_mesh_calc_normals_poly(MVert *mverts,
   }
 
   float(*vnors)[3] = r_vertnors;
-  float(*lnors_weighted)[3] = MEM_malloc_arrayN(
-      (size_t)numLoops, sizeof(*lnors_weighted), __func__);
   bool free_vnors = false;
 
   /* first go through and calculate normals for all the polys */
@@ -360,20 +381,11 @@ void BKE_mesh_calc_normals_poly(MVert *mverts,
       .mloop = mloop,
       .mverts = mverts,
       .pnors = pnors,
-      .lnors_weighted = lnors_weighted,
       .vnors = vnors,
   };
 
-  /* Compute poly normals, and prepare weighted loop normals. */
-  BLI_task_parallel_range(0, numPolys, &data, mesh_calc_normals_poly_prepare_cb, &settings);
-
-  /* Actually accumulate weighted loop normals into vertex ones. */
-  /* Unfortunately, not possible to thread that
-   * (not in a reasonable, totally lock- and barrier-free fashion),
-   * since several loops will point to the same vertex... */
-  for (int lidx = 0; lidx < numLoops; lidx++) {
-    add_v3_v3(vnors[mloop[lidx].v], data.lnors_weighted[lidx]);
-  }
+  /* Compute poly normals, and accumulate them into vertex ones. */
+  BLI_task_parallel_range(0, numPolys, &data, mesh_calc_normals_poly_and_accum_cb, &settings);
 
   /* Normalize and validate computed vertex normals. */
   BLI_task_parallel_range(0, numVerts, &data, mesh_calc_normals_poly_finalize_cb, &settings);
@@ -381,7 +393,6 @@ void BKE_mesh_calc_normals_poly(MVert *mverts,
   if (free_vnors) {
     MEM_freeN(vnors);
   }
-  MEM_freeN(lnors_weighted);
 }
 
 void BKE_mesh_ensure_normals(Mesh *mesh)
@@ -776,26 +787,54 @@ void BKE_lnor_space_custom_normal_to_data(MLoopNorSpace *lnor_space,
 
 #define LOOP_SPLIT_TASK_BLOCK_SIZE 1024
 
-typedef struct LoopSplitTaskData {
-  /* Specific to each instance (each task). */
+/**
+ * Smooth fans of loops around their pivot vertex, as found by #loop_split_generator.
+ *
+ * Fan `i` starts from loop `fan_loops[i]` and is made of the steps in
+ * `[fan_offsets[i], fan_offsets[i + 1])`. A fan without any step is a 'single' loop
+ * (both its edges are sharp), which simply takes its poly normal.
+ *
+ * This only depends on the topology and on which edges are sharp, not on vertex coordinates,
+ * so it remains valid as long as the mesh is only deformed, see #MeshLoopFanCache.
+ */
+typedef struct MeshLoopFanTopology {
+  /** Copies of the data the fans were generated from, to check whether they are still valid. */
+  MLoop *mloops;
+  int (*edge_to_loops)[2];
+  int *loop_to_poly;
+  int numEdges;
+  int numLoops;
 
-  /** We have to create those outside of tasks, since afaik memarena is not threadsafe. */
-  MLoopNorSpace *lnor_space;
-  float (*lnor)[3];
-  const MLoop *ml_curr;
-  const MLoop *ml_prev;
-  int ml_curr_index;
-  int ml_prev_index;
-  /** Also used a flag to switch between single or fan process! */
-  const int *e2l_prev;
-  int mp_index;
+  int *fan_loops;
+  int *fan_offsets;
+  int fans_len;
 
-  /** This one is special, it's owned and managed by worker tasks,
-   * avoid to have to create it for each fan! */
-  BLI_Stack *edge_vectors;
+  /** For each step of a fan: its edge, the loop using the pivot vertex and the poly of it. */
+  int *step_edges;
+  int *step_loops;
+  int *step_polys;
+  int steps_len;
+
+  int users;
+} MeshLoopFanTopology;
 
-  char pad_c;
-} LoopSplitTaskData;
+/**
+ * Shared between a mesh and its copies (see #BKE_mesh_runtime_reset_on_copy),
+ * so evaluated copies of a deformed mesh re-use the fans found by previous evaluations.
+ *
+ * A copy whose topology or sharp edges differ from the fans stored in a shared cache gets a cache
+ * of its own instead of replacing them, so copies that diverge don't keep invalidating each other.
+ */
+typedef struct MeshLoopFanCache {
+  ThreadMutex mutex;
+  MeshLoopFanTopology *topology;
+  int users;
+} MeshLoopFanCache;
+
+typedef struct LoopSplitTLS {
+  /** Temp edge vectors stack, only used when computing lnor spacearr. */
+  BLI_Stack *edge_vectors;
+} LoopSplitTLS;
 
 typedef struct LoopSplitTaskDataCommon {
   /* Read/write.
@@ -814,6 +853,10 @@ typedef struct LoopSplitTaskDataCommon {
   int *loop_to_poly;
   const float (*polynors)[3];
 
+  /** Smooth fans, and their lnor spaces (allocated as one block, may be NULL). */
+  const MeshLoopFanTopology *fans;
+  MLoopNorSpace *lnor_spaces;
+
   int numEdges;
   int numLoops;
   int numPolys;
@@ -1025,25 +1068,28 @@ void BKE_mesh_loop_manifold_fan_around_vert_next(const MLoop *mloops,
   /* And now we are back in sync, mlfan_curr_index is the index of mlfan_curr! Pff! */
 }
 
-static void split_loop_nor_single_do(LoopSplitTaskDataCommon *common_data, LoopSplitTaskData *data)
+static void split_loop_nor_single_do(LoopSplitTaskDataCommon *common_data,
+                                     MLoopNorSpace *lnor_space,
+                                     const int ml_curr_index)
 {
   MLoopNorSpaceArray *lnors_spacearr = common_data->lnors_spacearr;
   const short(*clnors_data)[2] = common_data->clnors_data;
 
   const MVert *mverts = common_data->mverts;
   const MEdge *medges = common_data->medges;
+  const MLoop *mloops = common_data->mloops;
+  const MPoly *mpolys = common_data->mpolys;
   const float(*polynors)[3] = common_data->polynors;
 
-  MLoopNorSpace *lnor_space = data->lnor_space;
-  float(*lnor)[3] = data->lnor;
-  const MLoop *ml_curr = data->ml_curr;
-  const MLoop *ml_prev = data->ml_prev;
-  const int ml_curr_index = data->ml_curr_index;
-#if 0 /* Not needed for 'single' loop. */
-  const int ml_prev_index = data->ml_prev_index;
-  const int *e2l_prev = data->e2l_prev;
-#endif
-  const int mp_index = data->mp_index;
+  const int mp_index = common_data->loop_to_poly[ml_curr_index];
+  const MPoly *mp = &mpolys[mp_index];
+  const int ml_prev_index = (ml_curr_index == mp->loopstart) ?
+                                mp->loopstart + mp->totloop - 1 :
+                                ml_curr_index - 1;
+
+  float(*lnor)[3] = &common_data->loopnors[ml_curr_index];
+  const MLoop *ml_curr = &mloops[ml_curr_index];
+  const MLoop *ml_prev = &mloops[ml_prev_index];
 
   /* Simple case (both edges around that vertex are sharp in current polygon),
    * this loop just takes its poly normal.
@@ -1087,7 +1133,10 @@ static void split_loop_nor_single_do(LoopSplitTaskDataCommon *common_data, LoopS
   }
 }
 
-static void split_loop_nor_fan_do(LoopSplitTaskDataCommon *common_data, LoopSplitTaskData *data)
+static void split_loop_nor_fan_do(LoopSplitTaskDataCommon *common_data,
+                                  MLoopNorSpace *lnor_space,
+                                  const int fan_index,
+                                  BLI_Stack *edge_vectors)
 {
   MLoopNorSpaceArray *lnors_spacearr = common_data->lnors_spacearr;
   float(*loopnors)[3] = common_data->loopnors;
@@ -1096,23 +1145,12 @@ static void split_loop_nor_fan_do(LoopSplitTaskDataCommon *common_data, LoopSpli
   const MVert *mverts = common_data->mverts;
   const MEdge *medges = common_data->medges;
   const MLoop *mloops = common_data->mloops;
-  const MPoly *mpolys = common_data->mpolys;
-  const int(*edge_to_loops)[2] = common_data->edge_to_loops;
-  const int *loop_to_poly = common_data->loop_to_poly;
   const float(*polynors)[3] = common_data->polynors;
 
-  MLoopNorSpace *lnor_space = data->lnor_space;
-#if 0 /* Not needed for 'fan' loops. */
-  float(*lnor)[3] = data->lnor;
-#endif
-  const MLoop *ml_curr = data->ml_curr;
-  const MLoop *ml_prev = data->ml_prev;
-  const int ml_curr_index = data->ml_curr_index;
-  const int ml_prev_index = data->ml_prev_index;
-  const int mp_index = data->mp_index;
-  const int *e2l_prev = data->e2l_prev;
-
-  BLI_Stack *edge_vectors = data->edge_vectors;
+  const MeshLoopFanTopology *fans = common_data->fans;
+  const int step_start = fans->fan_offsets[fan_index];
+  const int step_end = fans->fan_offsets[fan_index + 1];
+  const MLoop *ml_curr = &mloops[fans->fan_loops[fan_index]];
 
   /* Gah... We have to fan around current vertex, until we find the other non-smooth edge,
    * and accumulate face normals into the vertex!
@@ -1120,6 +1158,8 @@ static void split_loop_nor_fan_do(LoopSplitTaskDataCommon *common_data, LoopSpli
    * same as the vertex normal, but I do not see any easy way to detect that (would need to count
    * number of sharp edges per vertex, I doubt the additional memory usage would be worth it,
    * especially as it should not be a common case in real-life meshes anyway).
+   *
+   * The walk itself was done by #loop_split_generator, here we only go over its steps.
    */
   const unsigned int mv_pivot_index = ml_curr->v; /* The vertex we are "fanning" around! */
   const MVert *mv_pivot = &mverts[mv_pivot_index];
@@ -1127,12 +1167,11 @@ static void split_loop_nor_fan_do(LoopSplitTaskDataCommon *common_data, LoopSpli
   /* ml_curr would be mlfan_prev if we needed that one. */
   const MEdge *me_org = &medges[ml_curr->e];
 
-  const int *e2lfan_curr;
   float vec_curr[3], vec_prev[3], vec_org[3];
-  const MLoop *mlfan_curr;
   float lnor[3] = {0.0f, 0.0f, 0.0f};
   /* mlfan_vert_index: the loop of our current edge might not be the loop of our current vertex! */
-  int mlfan_curr_index, mlfan_vert_index, mpfan_curr_index;
+  int mlfan_vert_index = -1;
+  int step;
 
   /* We validate clnors data on the fly - cheapest way to do! */
   int clnors_avg[2] = {0, 0};
@@ -1140,20 +1179,7 @@ static void split_loop_nor_fan_do(LoopSplitTaskDataCommon *common_data, LoopSpli
   int clnors_nbr = 0;
   bool clnors_invalid = false;
 
-  /* Temp loop normal stack. */
-  BLI_SMALLSTACK_DECLARE(normal, float *);
-  /* Temp clnors stack. */
-  BLI_SMALLSTACK_DECLARE(clnors, short *);
-
-  e2lfan_curr = e2l_prev;
-  mlfan_curr = ml_prev;
-  mlfan_curr_index = ml_prev_index;
-  mlfan_vert_index = ml_curr_index;
-  mpfan_curr_index = mp_index;
-
-  BLI_assert(mlfan_curr_index >= 0);
-  BLI_assert(mlfan_vert_index >= 0);
-  BLI_assert(mpfan_curr_index >= 0);
+  BLI_assert(step_end > step_start);
 
   /* Only need to compute previous edge's vector once, then we can just reuse old current one! */
   {
@@ -1168,10 +1194,11 @@ static void split_loop_nor_fan_do(LoopSplitTaskDataCommon *common_data, LoopSpli
     }
   }
 
-  //  printf("FAN: vert %d, start edge %d\n", mv_pivot_index, ml_curr->e);
+  for (step = step_start; step < step_end; step++) {
+    const MEdge *me_curr = &medges[fans->step_edges[step]];
+    const int mpfan_curr_index = fans->step_polys[step];
+    mlfan_vert_index = fans->step_loops[step];
 
-  while (true) {
-    const MEdge *me_curr = &medges[mlfan_curr->e];
     /* Compute edge vectors.
      * NOTE: We could pre-compute those into an array, in the first iteration, instead of computing
      *       them twice (or more) here. However, time gained is not worth memory and time lost,
@@ -1185,8 +1212,6 @@ static void split_loop_nor_fan_do(LoopSplitTaskDataCommon *common_data, LoopSpli
       normalize_v3(vec_curr);
     }
 
-    //      printf("\thandling edge %d / loop %d\n", mlfan_curr->e, mlfan_curr_index);
-
     {
       /* Code similar to accumulate_vertex_normals_poly_v3. */
       /* Calculate angle between the two poly edges incident on this vertex. */
@@ -1206,14 +1231,9 @@ static void split_loop_nor_fan_do(LoopSplitTaskDataCommon *common_data, LoopSpli
         clnors_avg[0] += (*clnor)[0];
         clnors_avg[1] += (*clnor)[1];
         clnors_nbr++;
-        /* We store here a pointer to all custom lnors processed. */
-        BLI_SMALLSTACK_PUSH(clnors, (short *)*clnor);
       }
     }
 
-    /* We store here a pointer to all loop-normals processed. */
-    BLI_SMALLSTACK_PUSH(normal, (float *)(loopnors[mlfan_vert_index]));
-
     if (lnors_spacearr) {
       /* Assign current lnor space to current 'vertex' loop. */
       BKE_lnor_space_add_loop(lnors_spacearr, lnor_space, mlfan_vert_index, NULL, false);
@@ -1223,28 +1243,7 @@ static void split_loop_nor_fan_do(LoopSplitTaskDataCommon *common_data, LoopSpli
       }
     }
 
-    if (IS_EDGE_SHARP(e2lfan_curr) || (me_curr == me_org)) {
-      /* Current edge is sharp and we have finished with this fan of faces around this vert,
-       * or this vert is smooth, and we have completed a full turn around it.
-       */
-      //          printf("FAN: Finished!\n");
-      break;
-    }
-
     copy_v3_v3(vec_prev, vec_curr);
-
-    /* Find next loop of the smooth fan. */
-    BKE_mesh_loop_manifold_fan_around_vert_next(mloops,
-                                                mpolys,
-                                                loop_to_poly,
-                                                e2lfan_curr,
-                                                mv_pivot_index,
-                                                &mlfan_curr,
-                                                &mlfan_curr_index,
-                                                &mlfan_vert_index,
-                                                &mpfan_curr_index);
-
-    e2lfan_curr = edge_to_loops[mlfan_curr->e];
   }
 
   {
@@ -1264,23 +1263,18 @@ static void split_loop_nor_fan_do(LoopSplitTaskDataCommon *common_data, LoopSpli
 
       if (clnors_data) {
         if (clnors_invalid) {
-          short *clnor;
-
           clnors_avg[0] /= clnors_nbr;
           clnors_avg[1] /= clnors_nbr;
           /* Fix/update all clnors of this fan with computed average value. */
           if (G.debug & G_DEBUG) {
             printf("Invalid clnors in this fan!\n");
           }
-          while ((clnor = BLI_SMALLSTACK_POP(clnors))) {
-            // print_v2("org clnor", clnor);
+          for (step = step_start; step < step_end; step++) {
+            short *clnor = clnors_data[fans->step_loops[step]];
             clnor[0] = (short)clnors_avg[0];
             clnor[1] = (short)clnors_avg[1];
           }
-          // print_v2("new clnors", clnors_avg);
         }
-        /* Extra bonus: since small-stack is local to this function,
-         * no more need to empty it at all cost! */
 
         BKE_lnor_space_custom_data_to_normal(lnor_space, *clnor_ref, lnor);
       }
@@ -1289,63 +1283,43 @@ static void split_loop_nor_fan_do(LoopSplitTaskDataCommon *common_data, LoopSpli
     /* In case we get a zero normal here, just use vertex normal already set! */
     if (LIKELY(lnor_len != 0.0f)) {
       /* Copy back the final computed normal into all related loop-normals. */
-      float *nor;
-
-      while ((nor = BLI_SMALLSTACK_POP(normal))) {
-        copy_v3_v3(nor, lnor);
+      for (step = step_start; step < step_end; step++) {
+        copy_v3_v3(loopnors[fans->step_loops[step]], lnor);
       }
     }
-    /* Extra bonus: since small-stack is local to this function,
-     * no more need to empty it at all cost! */
   }
 }
 
-static void loop_split_worker_do(LoopSplitTaskDataCommon *common_data,
-                                 LoopSplitTaskData *data,
-                                 BLI_Stack *edge_vectors)
+static void loop_split_worker(void *__restrict userdata,
+                              const int fan_index,
+                              const TaskParallelTLS *__restrict tls)
 {
-  BLI_assert(data->ml_curr);
-  if (data->e2l_prev) {
-    BLI_assert((edge_vectors == NULL) || BLI_stack_is_empty(edge_vectors));
-    data->edge_vectors = edge_vectors;
-    split_loop_nor_fan_do(common_data, data);
+  LoopSplitTaskDataCommon *common_data = userdata;
+  const MeshLoopFanTopology *fans = common_data->fans;
+  MLoopNorSpace *lnor_space = common_data->lnor_spaces ? &common_data->lnor_spaces[fan_index] :
+                                                         NULL;
+
+  if (fans->fan_offsets[fan_index] == fans->fan_offsets[fan_index + 1]) {
+    /* No need for edge_vectors for 'single' case! */
+    split_loop_nor_single_do(common_data, lnor_space, fans->fan_loops[fan_index]);
   }
   else {
-    /* No need for edge_vectors for 'single' case! */
-    split_loop_nor_single_do(common_data, data);
+    LoopSplitTLS *tls_data = tls->userdata_chunk;
+    if (common_data->lnors_spacearr && tls_data->edge_vectors == NULL) {
+      tls_data->edge_vectors = BLI_stack_new(sizeof(float[3]), __func__);
+    }
+    BLI_assert((tls_data->edge_vectors == NULL) || BLI_stack_is_empty(tls_data->edge_vectors));
+    split_loop_nor_fan_do(common_data, lnor_space, fan_index, tls_data->edge_vectors);
   }
 }
 
-static void loop_split_worker(TaskPool *__restrict pool, void *taskdata)
+static void loop_split_worker_free(const void *__restrict UNUSED(userdata),
+                                   void *__restrict tls_v)
 {
-  LoopSplitTaskDataCommon *common_data = BLI_task_pool_user_data(pool);
-  LoopSplitTaskData *data = taskdata;
-
-  /* Temp edge vectors stack, only used when computing lnor spacearr. */
-  BLI_Stack *edge_vectors = common_data->lnors_spacearr ?
-                                BLI_stack_new(sizeof(float[3]), __func__) :
-                                NULL;
-
-#ifdef DEBUG_TIME
-  TIMEIT_START_AVERAGED(loop_split_worker);
-#endif
-
-  for (int i = 0; i < LOOP_SPLIT_TASK_BLOCK_SIZE; i++, data++) {
-    /* A NULL ml_curr is used to tag ended data! */
-    if (data->ml_curr == NULL) {
-      break;
-    }
-
-    loop_split_worker_do(common_data, data, edge_vectors);
-  }
-
-  if (edge_vectors) {
-    BLI_stack_free(edge_vectors);
+  LoopSplitTLS *tls_data = tls_v;
+  if (tls_data->edge_vectors) {
+    BLI_stack_free(tls_data->edge_vectors);
   }
-
-#ifdef DEBUG_TIME
-  TIMEIT_END_AVERAGED(loop_split_worker);
-#endif
 }
 
 /**
@@ -1424,15 +1398,81 @@ static bool loop_split_generator_check_cyclic_smooth_fan(const MLoop *mloops,
   }
 }
 
-static void loop_split_generator(TaskPool *pool, LoopSplitTaskDataCommon *common_data)
+/**
+ * Walk around the pivot vertex of \a ml_curr, until we find the other non-smooth edge
+ * (or are back to the first edge for cyclic smooth fans), storing all steps of that fan.
+ */
+static void loop_split_generator_fan_steps(const LoopSplitTaskDataCommon *common_data,
+                                           MeshLoopFanTopology *fans,
+                                           const MLoop *ml_curr,
+                                           const MLoop *ml_prev,
+                                           const int ml_curr_index,
+                                           const int ml_prev_index,
+                                           const int mp_index,
+                                           const int *e2l_prev)
 {
-  MLoopNorSpaceArray *lnors_spacearr = common_data->lnors_spacearr;
-  float(*loopnors)[3] = common_data->loopnors;
+  const MLoop *mloops = common_data->mloops;
+  const MPoly *mpolys = common_data->mpolys;
+  const int(*edge_to_loops)[2] = common_data->edge_to_loops;
+  const int *loop_to_poly = common_data->loop_to_poly;
+
+  const unsigned int mv_pivot_index = ml_curr->v; /* The vertex we are "fanning" around! */
+  const int *e2lfan_curr;
+  const MLoop *mlfan_curr;
+  /* mlfan_vert_index: the loop of our current edge might not be the loop of our current vertex! */
+  int mlfan_curr_index, mlfan_vert_index, mpfan_curr_index;
+
+  e2lfan_curr = e2l_prev;
+  mlfan_curr = ml_prev;
+  mlfan_curr_index = ml_prev_index;
+  mlfan_vert_index = ml_curr_index;
+  mpfan_curr_index = mp_index;
+
+  BLI_assert(mlfan_curr_index >= 0);
+  BLI_assert(mlfan_vert_index >= 0);
+  BLI_assert(mpfan_curr_index >= 0);
+
+  while (true) {
+    if (UNLIKELY(fans->steps_len == common_data->numLoops)) {
+      /* Each loop is in exactly one fan, this only happens with invalid geometry
+       * (where we would walk around forever otherwise). */
+      break;
+    }
+
+    fans->step_edges[fans->steps_len] = (int)mlfan_curr->e;
+    fans->step_loops[fans->steps_len] = mlfan_vert_index;
+    fans->step_polys[fans->steps_len] = mpfan_curr_index;
+    fans->steps_len++;
+
+    if (IS_EDGE_SHARP(e2lfan_curr) || (mlfan_curr->e == ml_curr->e)) {
+      /* Current edge is sharp and we have finished with this fan of faces around this vert,
+       * or this vert is smooth, and we have completed a full turn around it.
+       */
+      break;
+    }
 
+    /* Find next loop of the smooth fan. */
+    BKE_mesh_loop_manifold_fan_around_vert_next(mloops,
+                                                mpolys,
+                                                loop_to_poly,
+                                                e2lfan_curr,
+                                                mv_pivot_index,
+                                                &mlfan_curr,
+                                                &mlfan_curr_index,
+                                                &mlfan_vert_index,
+                                                &mpfan_curr_index);
+
+    e2lfan_curr = edge_to_loops[mlfan_curr->e];
+  }
+}
+
+static MeshLoopFanTopology *loop_split_generator(const LoopSplitTaskDataCommon *common_data)
+{
   const MLoop *mloops = common_data->mloops;
   const MPoly *mpolys = common_data->mpolys;
   const int *loop_to_poly = common_data->loop_to_poly;
   const int(*edge_to_loops)[2] = common_data->edge_to_loops;
+  const int numEdges = common_data->numEdges;
   const int numLoops = common_data->numLoops;
   const int numPolys = common_data->numPolys;
 
@@ -1446,37 +1486,41 @@ static void loop_split_generator(TaskPool *pool, LoopSplitTaskDataCommon *common
 
   BLI_bitmap *skip_loops = BLI_BITMAP_NEW(numLoops, __func__);
 
-  LoopSplitTaskData *data_buff = NULL;
-  int data_idx = 0;
-
-  /* Temp edge vectors stack, only used when computing lnor spacearr
-   * (and we are not multi-threading). */
-  BLI_Stack *edge_vectors = NULL;
+  MeshLoopFanTopology *fans = MEM_callocN(sizeof(*fans), __func__);
 
 #ifdef DEBUG_TIME
   TIMEIT_START_AVERAGED(loop_split_generator);
 #endif
 
-  if (!pool) {
-    if (lnors_spacearr) {
-      edge_vectors = BLI_stack_new(sizeof(float[3]), __func__);
-    }
-  }
+  fans->mloops = MEM_malloc_arrayN((size_t)numLoops, sizeof(*fans->mloops), __func__);
+  fans->edge_to_loops = MEM_malloc_arrayN(
+      (size_t)numEdges, sizeof(*fans->edge_to_loops), __func__);
+  fans->loop_to_poly = MEM_malloc_arrayN((size_t)numLoops, sizeof(*fans->loop_to_poly), __func__);
+  memcpy(fans->mloops, mloops, sizeof(*fans->mloops) * (size_t)numLoops);
+  memcpy(fans->edge_to_loops, edge_to_loops, sizeof(*fans->edge_to_loops) * (size_t)numEdges);
+  memcpy(fans->loop_to_poly, loop_to_poly, sizeof(*fans->loop_to_poly) * (size_t)numLoops);
+  fans->numEdges = numEdges;
+  fans->numLoops = numLoops;
+
+  fans->fan_loops = MEM_malloc_arrayN((size_t)numLoops, sizeof(int), __func__);
+  fans->fan_offsets = MEM_malloc_arrayN((size_t)numLoops + 1, sizeof(int), __func__);
+  /* Each loop is in exactly one fan, so there is at most one step per loop. */
+  fans->step_edges = MEM_malloc_arrayN((size_t)numLoops, sizeof(int), __func__);
+  fans->step_loops = MEM_malloc_arrayN((size_t)numLoops, sizeof(int), __func__);
+  fans->step_polys = MEM_malloc_arrayN((size_t)numLoops, sizeof(int), __func__);
 
   /* We now know edges that can be smoothed (with their vector, and their two loops),
-   * and edges that will be hard! Now, time to generate the normals.
+   * and edges that will be hard! Now, time to find the fans.
    */
   for (mp = mpolys, mp_index = 0; mp_index < numPolys; mp++, mp_index++) {
-    float(*lnors)[3];
     const int ml_last_index = (mp->loopstart + mp->totloop) - 1;
     ml_curr_index = mp->loopstart;
     ml_prev_index = ml_last_index;
 
     ml_curr = &mloops[ml_curr_index];
     ml_prev = &mloops[ml_prev_index];
-    lnors = &loopnors[ml_curr_index];
 
-    for (; ml_curr_index <= ml_last_index; ml_curr++, ml_curr_index++, lnors++) {
+    for (; ml_curr_index <= ml_last_index; ml_curr++, ml_curr_index++) {
       const int *e2l_curr = edge_to_loops[ml_curr->e];
       const int *e2l_prev = edge_to_loops[ml_prev->e];
 
@@ -1495,7 +1539,7 @@ static void loop_split_generator(TaskPool *pool, LoopSplitTaskDataCommon *common
 
       /* Note: In theory, we could make loop_split_generator_check_cyclic_smooth_fan() store
        * mlfan_vert_index'es and edge indexes in two stacks, to avoid having to fan again around
-       * the vert during actual computation of clnor & clnorspace. However, this would complicate
+       * the vert when storing the steps of the fan. However, this would complicate
        * the code, add more memory usage, and despite its logical complexity,
        * loop_manifold_fan_around_vert_next() is quite cheap in term of CPU cycles,
        * so really think it's not worth it. */
@@ -1514,37 +1558,13 @@ static void loop_split_generator(TaskPool *pool, LoopSplitTaskDataCommon *common
         //              printf("SKIPPING!\n");
       }
       else {
-        LoopSplitTaskData *data, data_local;
-
-        //              printf("PROCESSING!\n");
+        fans->fan_loops[fans->fans_len] = ml_curr_index;
+        fans->fan_offsets[fans->fans_len] = fans->steps_len;
+        fans->fans_len++;
 
-        if (pool) {
-          if (data_idx == 0) {
-            data_buff = MEM_calloc_arrayN(
-                LOOP_SPLIT_TASK_BLOCK_SIZE, sizeof(*data_buff), __func__);
-          }
-          data = &data_buff[data_idx];
-        }
-        else {
-          data = &data_local;
-          memset(data, 0, sizeof(*data));
-        }
-
-        if (IS_EDGE_SHARP(e2l_curr) && IS_EDGE_SHARP(e2l_prev)) {
-          data->lnor = lnors;
-          data->ml_curr = ml_curr;
-          data->ml_prev = ml_prev;
-          data->ml_curr_index = ml_curr_index;
-#if 0 /* Not needed for 'single' loop. */
-          data->ml_prev_index = ml_prev_index;
-          data->e2l_prev = NULL; /* Tag as 'single' task. */
-#endif
-          data->mp_index = mp_index;
-          if (lnors_spacearr) {
-            data->lnor_space = BKE_lnor_space_create(lnors_spacearr);
-          }
-        }
-        /* We *do not need* to check/tag loops as already computed!
+        /* Single loops (both edges sharp) do not get any step.
+         *
+         * We *do not need* to check/tag loops as already computed!
          * Due to the fact a loop only links to one of its two edges,
          * a same fan *will never be walked more than once!*
          * Since we consider edges having neighbor polys with inverted
@@ -1553,30 +1573,15 @@ static void loop_split_generator(TaskPool *pool, LoopSplitTaskDataCommon *common
          * and not the alternative (smooth curr_edge, sharp prev_edge).
          * All this due/thanks to link between normals and loop ordering (i.e. winding).
          */
-        else {
-#if 0 /* Not needed for 'fan' loops. */
-          data->lnor = lnors;
-#endif
-          data->ml_curr = ml_curr;
-          data->ml_prev = ml_prev;
-          data->ml_curr_index = ml_curr_index;
-          data->ml_prev_index = ml_prev_index;
-          data->e2l_prev = e2l_prev; /* Also tag as 'fan' task. */
-          data->mp_index = mp_index;
-          if (lnors_spacearr) {
-            data->lnor_space = BKE_lnor_space_create(lnors_spacearr);
-          }
-        }
-
-        if (pool) {
-          data_idx++;
-          if (data_idx == LOOP_SPLIT_TASK_BLOCK_SIZE) {
-            BLI_task_pool_push(pool, loop_split_worker, data_buff, true, NULL);
-            data_idx = 0;
-          }
-        }
-        else {
-          loop_split_worker_do(common_data, data, edge_vectors);
+        if (!(IS_EDGE_SHARP(e2l_curr) && IS_EDGE_SHARP(e2l_prev))) {
+          loop_split_generator_fan_steps(common_data,
+                                         fans,
+                                         ml_curr,
+                                         ml_prev,
+                                         ml_curr_index,
+                                         ml_prev_index,
+                                         mp_index,
+                                         e2l_prev);
         }
       }
 
@@ -1584,21 +1589,149 @@ static void loop_split_generator(TaskPool *pool, LoopSplitTaskDataCommon *common
       ml_prev_index = ml_curr_index;
     }
   }
+  fans->fan_offsets[fans->fans_len] = fans->steps_len;
 
-  /* Last block of data... Since it is calloc'ed and we use first NULL item as stopper,
-   * everything is fine. */
-  if (pool && data_idx) {
-    BLI_task_pool_push(pool, loop_split_worker, data_buff, true, NULL);
-  }
-
-  if (edge_vectors) {
-    BLI_stack_free(edge_vectors);
-  }
   MEM_freeN(skip_loops);
 
 #ifdef DEBUG_TIME
   TIMEIT_END_AVERAGED(loop_split_generator);
 #endif
+
+  return fans;
+}
+
+static void loop_split_fans_free(MeshLoopFanTopology *fans)
+{
+  MEM_SAFE_FREE(fans->mloops);
+  MEM_SAFE_FREE(fans->edge_to_loops);
+  MEM_SAFE_FREE(fans->loop_to_poly);
+  MEM_SAFE_FREE(fans->fan_loops);
+  MEM_SAFE_FREE(fans->fan_offsets);
+  MEM_SAFE_FREE(fans->step_edges);
+  MEM_SAFE_FREE(fans->step_loops);
+  MEM_SAFE_FREE(fans->step_polys);
+  MEM_freeN(fans);
+}
+
+static void loop_split_fans_release(MeshLoopFanTopology *fans)
+{
+  if (atomic_sub_and_fetch_int32(&fans->users, 1) == 0) {
+    loop_split_fans_free(fans);
+  }
+}
+
+/** Whether \a fans were generated from the same topology and sharp edges as \a common_data. */
+static bool loop_split_fans_match(const MeshLoopFanTopology *fans,
+                                  const LoopSplitTaskDataCommon *common_data)
+{
+  if (fans->numEdges != common_data->numEdges || fans->numLoops != common_data->numLoops) {
+    return false;
+  }
+  if (common_data->numLoops == 0) {
+    return true;
+  }
+  return (memcmp(fans->edge_to_loops,
+                 common_data->edge_to_loops,
+                 sizeof(*fans->edge_to_loops) * (size_t)fans->numEdges) == 0) &&
+         (memcmp(fans->loop_to_poly,
+                 common_data->loop_to_poly,
+                 sizeof(*fans->loop_to_poly) * (size_t)fans->numLoops) == 0) &&
+         (memcmp(fans->mloops,
+                 common_data->mloops,
+                 sizeof(*fans->mloops) * (size_t)fans->numLoops) == 0);
+}
+
+/**
+ * Get the smooth fans of \a common_data, either re-used from the cache (when they still match)
+ * or generated from scratch. Release them with #loop_split_fans_release.
+ *
+ * \param fan_cache_p: Optional cache, replaced by a new one when it's shared with other meshes
+ * and holds fans that don't match.
+ */
+static MeshLoopFanTopology *loop_split_fans_ensure(MeshLoopFanCache **fan_cache_p,
+                                                   const LoopSplitTaskDataCommon *common_data)
+{
+  MeshLoopFanCache *fan_cache = fan_cache_p ? *fan_cache_p : NULL;
+  MeshLoopFanTopology *fans = NULL;
+  bool is_mismatch = false;
+
+  if (fan_cache != NULL) {
+    BLI_mutex_lock(&fan_cache->mutex);
+    fans = fan_cache->topology;
+    if (fans) {
+      atomic_add_and_fetch_int32(&fans->users, 1);
+    }
+    BLI_mutex_unlock(&fan_cache->mutex);
+
+    if (fans) {
+      if (loop_split_fans_match(fans, common_data)) {
+        return fans;
+      }
+      loop_split_fans_release(fans);
+      is_mismatch = true;
+    }
+  }
+
+  fans = loop_split_generator(common_data);
+  fans->users = 1;
+
+  if (fan_cache != NULL && is_mismatch &&
+      atomic_load_acquire_uint32((const uint32_t *)&fan_cache->users) > 1) {
+    /* The fans of the other users are kept, this mesh continues with a cache of its own. */
+    MeshLoopFanCache *fan_cache_new = BKE_mesh_loop_fan_cache_new();
+    if (atomic_cas_ptr((void **)fan_cache_p, fan_cache, fan_cache_new) == fan_cache) {
+      BKE_mesh_loop_fan_cache_free(fan_cache);
+      fan_cache = fan_cache_new;
+    }
+    else {
+      /* Replaced by an other thread computing normals of the same mesh. */
+      BKE_mesh_loop_fan_cache_free(fan_cache_new);
+      fan_cache = NULL;
+    }
+  }
+
+  if (fan_cache != NULL) {
+    MeshLoopFanTopology *fans_old;
+    atomic_add_and_fetch_int32(&fans->users, 1);
+
+    BLI_mutex_lock(&fan_cache->mutex);
+    fans_old = fan_cache->topology;
+    fan_cache->topology = fans;
+    BLI_mutex_unlock(&fan_cache->mutex);
+
+    if (fans_old) {
+      loop_split_fans_release(fans_old);
+    }
+  }
+
+  return fans;
+}
+
+MeshLoopFanCache *BKE_mesh_loop_fan_cache_new(void)
+{
+  MeshLoopFanCache *fan_cache = MEM_callocN(sizeof(*fan_cache), __func__);
+  BLI_mutex_init(&fan_cache->mutex);
+  fan_cache->users = 1;
+  return fan_cache;
+}
+
+/** Add a user to \a fan_cache, to share it with a copy of its mesh. */
+MeshLoopFanCache *BKE_mesh_loop_fan_cache_share(MeshLoopFanCache *fan_cache)
+{
+  atomic_add_and_fetch_int32(&fan_cache->users, 1);
+  return fan_cache;
+}
+
+void BKE_mesh_loop_fan_cache_free(MeshLoopFanCache *fan_cache)
+{
+  if (atomic_sub_and_fetch_int32(&fan_cache->users, 1) != 0) {
+    return;
+  }
+  if (fan_cache->topology) {
+    loop_split_fans_release(fan_cache->topology);
+  }
+  BLI_mutex_end(&fan_cache->mutex);
+  MEM_freeN(fan_cache);
 }
 
 /**
@@ -1607,7 +1740,7 @@ static void loop_split_generator(TaskPool *pool, LoopSplitTaskDataCommon *common
  * (splitting edges).
  */
 void BKE_mesh_normals_loop_split(const MVert *mverts,
-                                 const int UNUSED(numVerts),
+                                 const int numVerts,
                                  MEdge *medges,
                                  const int numEdges,
                                  MLoop *mloops,
@@ -1621,6 +1754,46 @@ void BKE_mesh_normals_loop_split(const MVert *mverts,
                                  MLoopNorSpaceArray *r_lnors_spacearr,
                                  short (*clnors_data)[2],
                                  int *r_loop_to_poly)
+{
+  BKE_mesh_normals_loop_split_ex(mverts,
+                                 numVerts,
+                                 medges,
+                                 numEdges,
+                                 mloops,
+                                 r_loopnors,
+                                 numLoops,
+                                 mpolys,
+                                 polynors,
+                                 numPolys,
+                                 use_split_normals,
+                                 split_angle,
+                                 r_lnors_spacearr,
+                                 clnors_data,
+                                 r_loop_to_poly,
+                                 NULL);
+}
+
+/**
+ * Same as #BKE_mesh_normals_loop_split, with an optional \a fan_cache_p (usually the one of the
+ * mesh runtime data), so the smooth fans only have to be found again when the topology
+ * or the sharp edges changed. The cache may be replaced, see #MeshLoopFanCache.
+ */
+void BKE_mesh_normals_loop_split_ex(const MVert *mverts,
+                                    const int UNUSED(numVerts),
+                                    MEdge *medges,
+                                    const int numEdges,
+                                    MLoop *mloops,
+                                    float (*r_loopnors)[3],
+                                    const int numLoops,
+                                    MPoly *mpolys,
+                                    const float (*polynors)[3],
+                                    const int numPolys,
+                                    const bool use_split_normals,
+                                    const float split_angle,
+                                    MLoopNorSpaceArray *r_lnors_spacearr,
+                                    short (*clnors_data)[2],
+                                    int *r_loop_to_poly,
+                                    MeshLoopFanCache **fan_cache_p)
 {
   /* For now this is not supported.
    * If we do not use split normals, we do not generate anything fancy! */
@@ -1715,19 +1888,31 @@ void BKE_mesh_normals_loop_split(const MVert *mverts,
   /* This first loop check which edges are actually smooth, and compute edge vectors. */
   mesh_edges_sharp_tag(&common_data, check_angle, split_angle, false);
 
-  if (numLoops < LOOP_SPLIT_TASK_BLOCK_SIZE * 8) {
-    /* Not enough loops to be worth the whole threading overhead... */
-    loop_split_generator(NULL, &common_data);
-  }
-  else {
-    TaskPool *task_pool = BLI_task_pool_create(&common_data, TASK_PRIORITY_HIGH);
+  /* Then find the smooth fans, unless they did not change since the last evaluation. */
+  MeshLoopFanTopology *fans = loop_split_fans_ensure(fan_cache_p, &common_data);
+  common_data.fans = fans;
 
-    loop_split_generator(task_pool, &common_data);
+  if (r_lnors_spacearr && fans->fans_len != 0) {
+    /* Same as #BKE_lnor_space_create for all fans at once, spaces can't be created in tasks. */
+    r_lnors_spacearr->num_spaces += fans->fans_len;
+    common_data.lnor_spaces = BLI_memarena_calloc(r_lnors_spacearr->mem,
+                                                  sizeof(MLoopNorSpace) * (size_t)fans->fans_len);
+  }
 
-    BLI_task_pool_work_and_wait(task_pool);
+  /* And finally, compute the normals of all fans, this is the only part depending on
+   * vertex coordinates. */
+  LoopSplitTLS tls = {NULL};
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  /* Not enough loops to be worth the whole threading overhead otherwise... */
+  settings.use_threading = (numLoops >= LOOP_SPLIT_TASK_BLOCK_SIZE * 8);
+  settings.min_iter_per_thread = LOOP_SPLIT_TASK_BLOCK_SIZE;
+  settings.userdata_chunk = &tls;
+  settings.userdata_chunk_size = sizeof(tls);
+  settings.func_free = loop_split_worker_free;
+  BLI_task_parallel_range(0, fans->fans_len, &common_data, loop_split_worker, &settings);
 
-    BLI_task_pool_free(task_pool);
-  }
+  loop_split_fans_release(fans);
 
   MEM_freeN(edge_to_loops);
   if (!r_loop_to_poly) {
@@ -3234,146 +3419,199 @@ int BKE_mesh_tessface_calc_ex(CustomData *fdata,
 #undef ML_TO_MF_QUAD
 }
 
-/**
- * Calculate tessellation into #MLoopTri which exist only for this purpose.
- */
-void BKE_mesh_recalc_looptri(const MLoop *mloop,
-                             const MPoly *mpoly,
-                             const MVert *mvert,
-                             int totloop,
-                             int totpoly,
-                             MLoopTri *mlooptri)
+static void mesh_recalc_looptri__single_poly(const MLoop *mloop,
+                                             const MPoly *mpoly,
+                                             const MVert *mvert,
+                                             const uint poly_index,
+                                             uint mlooptri_index,
+                                             MLoopTri *mlooptri,
+                                             MemArena **pf_arena_p)
 {
-  /* use this to avoid locking pthread for _every_ polygon
-   * and calling the fill function */
-
-#define USE_TESSFACE_SPEEDUP
-
-  const MPoly *mp;
-  const MLoop *ml;
+  const MPoly *mp = &mpoly[poly_index];
+  const uint mp_loopstart = (uint)mp->loopstart;
+  const uint mp_totloop = (uint)mp->totloop;
   MLoopTri *mlt;
-  MemArena *arena = NULL;
-  int poly_index, mlooptri_index;
-  unsigned int j;
+  uint l1, l2, l3;
 
-  mlooptri_index = 0;
-  mp = mpoly;
-  for (poly_index = 0; poly_index < totpoly; poly_index++, mp++) {
-    const unsigned int mp_loopstart = (unsigned int)mp->loopstart;
-    const unsigned int mp_totloop = (unsigned int)mp->totloop;
-    unsigned int l1, l2, l3;
-    if (mp_totloop < 3) {
-      /* do nothing */
+#define ML_TO_MLT(i1, i2, i3) \
+  { \
+    mlt = &mlooptri[mlooptri_index]; \
+    l1 = mp_loopstart + i1; \
+    l2 = mp_loopstart + i2; \
+    l3 = mp_loopstart + i3; \
+    ARRAY_SET_ITEMS(mlt->tri, l1, l2, l3); \
+    mlt->poly = poly_index; \
+  } \
+  ((void)0)
+
+  if (mp_totloop < 3) {
+    /* do nothing */
+  }
+  else if (mp_totloop == 3) {
+    ML_TO_MLT(0, 1, 2);
+  }
+  else if (mp_totloop == 4) {
+    ML_TO_MLT(0, 1, 2);
+    MLoopTri *mlt_a = mlt;
+    mlooptri_index++;
+    ML_TO_MLT(0, 2, 3);
+    MLoopTri *mlt_b = mlt;
+
+    if (UNLIKELY(is_quad_flip_v3_first_third_fast(mvert[mloop[mlt_a->tri[0]].v].co,
+                                                  mvert[mloop[mlt_a->tri[1]].v].co,
+                                                  mvert[mloop[mlt_a->tri[2]].v].co,
+                                                  mvert[mloop[mlt_b->tri[2]].v].co))) {
+      /* flip out of degenerate 0-2 state. */
+      mlt_a->tri[2] = mlt_b->tri[2];
+      mlt_b->tri[0] = mlt_a->tri[1];
     }
+  }
+  else {
+    const MLoop *ml;
+    const float *co_curr, *co_prev;
 
-#ifdef USE_TESSFACE_SPEEDUP
+    float normal[3];
 
-#  define ML_TO_MLT(i1, i2, i3) \
-    { \
-      mlt = &mlooptri[mlooptri_index]; \
-      l1 = mp_loopstart + i1; \
-      l2 = mp_loopstart + i2; \
-      l3 = mp_loopstart + i3; \
-      ARRAY_SET_ITEMS(mlt->tri, l1, l2, l3); \
-      mlt->poly = (unsigned int)poly_index; \
-    } \
-    ((void)0)
+    float axis_mat[3][3];
+    float(*projverts)[2];
+    uint(*tris)[3];
 
-    else if (mp_totloop == 3) {
-      ML_TO_MLT(0, 1, 2);
-      mlooptri_index++;
-    }
-    else if (mp_totloop == 4) {
-      ML_TO_MLT(0, 1, 2);
-      MLoopTri *mlt_a = mlt;
-      mlooptri_index++;
-      ML_TO_MLT(0, 2, 3);
-      MLoopTri *mlt_b = mlt;
-      mlooptri_index++;
-
-      if (UNLIKELY(is_quad_flip_v3_first_third_fast(mvert[mloop[mlt_a->tri[0]].v].co,
-                                                    mvert[mloop[mlt_a->tri[1]].v].co,
-                                                    mvert[mloop[mlt_a->tri[2]].v].co,
-                                                    mvert[mloop[mlt_b->tri[2]].v].co))) {
-        /* flip out of degenerate 0-2 state. */
-        mlt_a->tri[2] = mlt_b->tri[2];
-        mlt_b->tri[0] = mlt_a->tri[1];
-      }
+    const uint totfilltri = mp_totloop - 2;
+    uint j;
+
+    MemArena *pf_arena = *pf_arena_p;
+    if (UNLIKELY(pf_arena == NULL)) {
+      pf_arena = *pf_arena_p = BLI_memarena_new(BLI_MEMARENA_STD_BUFSIZE, __func__);
     }
-#endif /* USE_TESSFACE_SPEEDUP */
-    else {
-      const float *co_curr, *co_prev;
 
-      float normal[3];
+    tris = BLI_memarena_alloc(pf_arena, sizeof(*tris) * (size_t)totfilltri);
+    projverts = BLI_memarena_alloc(pf_arena, sizeof(*projverts) * (size_t)mp_totloop);
 
-      float axis_mat[3][3];
-      float(*projverts)[2];
-      unsigned int(*tris)[3];
+    zero_v3(normal);
 
-      const unsigned int totfilltri = mp_totloop - 2;
-
-      if (UNLIKELY(arena == NULL)) {
-        arena = BLI_memarena_new(BLI_MEMARENA_STD_BUFSIZE, __func__);
-      }
+    /* calc normal, flipped: to get a positive 2d cross product */
+    ml = mloop + mp_loopstart;
+    co_prev = mvert[ml[mp_totloop - 1].v].co;
+    for (j = 0; j < mp_totloop; j++, ml++) {
+      co_curr = mvert[ml->v].co;
+      add_newell_cross_v3_v3v3(normal, co_prev, co_curr);
+      co_prev = co_curr;
+    }
+    if (UNLIKELY(normalize_v3(normal) == 0.0f)) {
+      normal[2] = 1.0f;
+    }
 
-      tris = BLI_memarena_alloc(arena, sizeof(*tris) * (size_t)totfilltri);
-      projverts = BLI_memarena_alloc(arena, sizeof(*projverts) * (size_t)mp_totloop);
+    /* project verts to 2d */
+    axis_dominant_v3_to_m3_negate(axis_mat, normal);
 
-      zero_v3(normal);
+    ml = mloop + mp_loopstart;
+    for (j = 0; j < mp_totloop; j++, ml++) {
+      mul_v2_m3v3(projverts[j], axis_mat, mvert[ml->v].co);
+    }
 
-      /* calc normal, flipped: to get a positive 2d cross product */
-      ml = mloop + mp_loopstart;
-      co_prev = mvert[ml[mp_totloop - 1].v].co;
-      for (j = 0; j < mp_totloop; j++, ml++) {
-        co_curr = mvert[ml->v].co;
-        add_newell_cross_v3_v3v3(normal, co_prev, co_curr);
-        co_prev = co_curr;
-      }
-      if (UNLIKELY(normalize_v3(normal) == 0.0f)) {
-        normal[2] = 1.0f;
-      }
+    BLI_polyfill_calc_arena(projverts, mp_totloop, 1, tris, pf_arena);
 
-      /* project verts to 2d */
-      axis_dominant_v3_to_m3_negate(axis_mat, normal);
+    /* apply fill */
+    for (j = 0; j < totfilltri; j++, mlooptri_index++) {
+      uint *tri = tris[j];
 
-      ml = mloop + mp_loopstart;
-      for (j = 0; j < mp_totloop; j++, ml++) {
-        mul_v2_m3v3(projverts[j], axis_mat, mvert[ml->v].co);
-      }
+      mlt = &mlooptri[mlooptri_index];
 
-      BLI_polyfill_calc_arena(projverts, mp_totloop, 1, tris, arena);
+      /* set loop indices, transformed to vert indices later */
+      l1 = mp_loopstart + tri[0];
+      l2 = mp_loopstart + tri[1];
+      l3 = mp_loopstart + tri[2];
 
-      /* apply fill */
-      for (j = 0; j < totfilltri; j++) {
-        unsigned int *tri = tris[j];
+      ARRAY_SET_ITEMS(mlt->tri, l1, l2, l3);
+      mlt->poly = poly_index;
+    }
 
-        mlt = &mlooptri[mlooptri_index];
+    BLI_memarena_clear(pf_arena);
+  }
 
-        /* set loop indices, transformed to vert indices later */
-        l1 = mp_loopstart + tri[0];
-        l2 = mp_loopstart + tri[1];
-        l3 = mp_loopstart + tri[2];
+#undef ML_TO_MLT
+}
 
-        ARRAY_SET_ITEMS(mlt->tri, l1, l2, l3);
-        mlt->poly = (unsigned int)poly_index;
+typedef struct MeshRecalcLoopTriData {
+  const MLoop *mloop;
+  const MPoly *mpoly;
+  const MVert *mvert;
+  /** Index of the first triangle of each polygon. */
+  const uint *tri_offsets;
+  MLoopTri *mlooptri;
+} MeshRecalcLoopTriData;
+
+typedef struct MeshRecalcLoopTriTLS {
+  /** Only created for n-gons. */
+  MemArena *pf_arena;
+} MeshRecalcLoopTriTLS;
+
+static void mesh_recalc_looptri_cb(void *__restrict userdata,
+                                   const int poly_index,
+                                   const TaskParallelTLS *__restrict tls)
+{
+  const MeshRecalcLoopTriData *data = userdata;
+  MeshRecalcLoopTriTLS *tls_data = tls->userdata_chunk;
+
+  mesh_recalc_looptri__single_poly(data->mloop,
+                                   data->mpoly,
+                                   data->mvert,
+                                   (uint)poly_index,
+                                   data->tri_offsets[poly_index],
+                                   data->mlooptri,
+                                   &tls_data->pf_arena);
+}
 
-        mlooptri_index++;
-      }
+static void mesh_recalc_looptri_free(const void *__restrict UNUSED(userdata),
+                                     void *__restrict tls_v)
+{
+  MeshRecalcLoopTriTLS *tls_data = tls_v;
+  if (tls_data->pf_arena) {
+    BLI_memarena_free(tls_data->pf_arena);
+  }
+}
 
-      BLI_memarena_clear(arena);
+/**
+ * Calculate tessellation into #MLoopTri which exist only for this purpose.
+ */
+void BKE_mesh_recalc_looptri(const MLoop *mloop,
+                             const MPoly *mpoly,
+                             const MVert *mvert,
+                             int UNUSED(totloop),
+                             int totpoly,
+                             MLoopTri *mlooptri)
+{
+  /* Polygons are not required to be stored in loop order, so the triangle offsets can't be
+   * derived from the loop start and are accumulated before tessellating in parallel. */
+  uint *tri_offsets = MEM_mallocN(sizeof(*tri_offsets) * (size_t)totpoly, __func__);
+  uint tri_offset = 0;
+  for (int i = 0; i < totpoly; i++) {
+    tri_offsets[i] = tri_offset;
+    if (mpoly[i].totloop >= 3) {
+      tri_offset += (uint)mpoly[i].totloop - 2;
     }
   }
 
-  if (arena) {
-    BLI_memarena_free(arena);
-    arena = NULL;
-  }
+  MeshRecalcLoopTriData data = {
+      .mloop = mloop,
+      .mpoly = mpoly,
+      .mvert = mvert,
+      .tri_offsets = tri_offsets,
+      .mlooptri = mlooptri,
+  };
+  MeshRecalcLoopTriTLS tls_data_dummy = {NULL};
 
-  BLI_assert(mlooptri_index == poly_to_tri_count(totpoly, totloop));
-  UNUSED_VARS_NDEBUG(totloop);
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 1024;
+  settings.use_adaptive_grain_size = true;
+  settings.userdata_chunk = &tls_data_dummy;
+  settings.userdata_chunk_size = sizeof(tls_data_dummy);
+  settings.func_free = mesh_recalc_looptri_free;
 
-#undef USE_TESSFACE_SPEEDUP
-#undef ML_TO_MLT
+  BLI_task_parallel_range(0, totpoly, &data, mesh_recalc_looptri_cb, &settings);
+
+  MEM_freeN(tri_offsets);
 }
 
 static void bm_corners_to_loops_ex(ID *id,
@@ -78,6 +78,49 @@ static bool mesh_remap_bvhtree_query_nearest(BVHTreeFromMesh *treedata,
   }
 }
 
+/**
+ * Batch version of #mesh_remap_bvhtree_query_nearest for all destination vertices.
+ *
+ * \param r_vcos_dst: The destination vertices, converted to tree coordinates.
+ * \return the nearest item for each destination vertex,
+ * its index is -1 when nothing was found within `max_dist_sq`.
+ */
+static BVHTreeNearest *mesh_remap_bvhtree_query_nearest_verts(
+    BVHTreeFromMesh *treedata,
+    const SpaceTransform *space_transform,
+    const MVert *verts_dst,
+    const int numverts_dst,
+    const float max_dist_sq,
+    float (**r_vcos_dst)[3])
+{
+  float(*vcos_dst)[3] = MEM_mallocN(sizeof(*vcos_dst) * (size_t)numverts_dst, __func__);
+  BVHTreeNearest *nearest = MEM_mallocN(sizeof(*nearest) * (size_t)numverts_dst, __func__);
+
+  for (int i = 0; i < numverts_dst; i++) {
+    copy_v3_v3(vcos_dst[i], verts_dst[i].co);
+
+    /* Convert the vertex to tree coordinates, if needed. */
+    if (space_transform) {
+      BLI_space_transform_apply(space_transform, vcos_dst[i]);
+    }
+
+    nearest[i].index = -1;
+    nearest[i].dist_sq = max_dist_sq;
+  }
+
+  /* Use local proximity heuristics (to reduce the nearest search). */
+  BLI_bvhtree_find_nearest_batch(treedata->tree,
+                                 (const float(*)[3])vcos_dst,
+                                 numverts_dst,
+                                 nearest,
+                                 treedata->nearest_callback,
+                                 treedata,
+                                 BVH_NEAREST_USE_PREVIOUS);
+
+  *r_vcos_dst = vcos_dst;
+  return nearest;
+}
+
 static bool mesh_remap_bvhtree_query_raycast(BVHTreeFromMesh *treedata,
                                              BVHTreeRayHit *rayhit,
                                              const float co[3],
@@ -525,51 +568,48 @@ void BKE_mesh_remap_calc_verts_from_mesh(const int mode,
     float tmp_co[3], tmp_no[3];
 
     if (mode == MREMAP_MODE_VERT_NEAREST) {
+      float(*vcos_dst)[3];
+      BVHTreeNearest *nearest_dst;
+
       BKE_bvhtree_from_mesh_get(&treedata, me_src, BVHTREE_FROM_VERTS, 2);
-      nearest.index = -1;
+      nearest_dst = mesh_remap_bvhtree_query_nearest_verts(
+          &treedata, space_transform, verts_dst, numverts_dst, max_dist_sq, &vcos_dst);
 
       for (i = 0; i < numverts_dst; i++) {
-        copy_v3_v3(tmp_co, verts_dst[i].co);
-
-        /* Convert the vertex to tree coordinates, if needed. */
-        if (space_transform) {
-          BLI_space_transform_apply(space_transform, tmp_co);
-        }
-
-        if (mesh_remap_bvhtree_query_nearest(
-                &treedata, &nearest, tmp_co, max_dist_sq, &hit_dist)) {
-          mesh_remap_item_define(r_map, i, hit_dist, 0, 1, &nearest.index, &full_weight);
+        if (nearest_dst[i].index != -1) {
+          hit_dist = sqrtf(nearest_dst[i].dist_sq);
+          mesh_remap_item_define(r_map, i, hit_dist, 0, 1, &nearest_dst[i].index, &full_weight);
         }
         else {
           /* No source for this dest vertex! */
           BKE_mesh_remap_item_define_invalid(r_map, i);
         }
       }
+
+      MEM_freeN(vcos_dst);
+      MEM_freeN(nearest_dst);
     }
     else if (ELEM(mode, MREMAP_MODE_VERT_EDGE_NEAREST, MREMAP_MODE_VERT_EDGEINTERP_NEAREST)) {
       MEdge *edges_src = me_src->medge;
       float(*vcos_src)[3] = BKE_mesh_vert_coords_alloc(me_src, NULL);
+      float(*vcos_dst)[3];
+      BVHTreeNearest *nearest_dst;
 
       BKE_bvhtree_from_mesh_get(&treedata, me_src, BVHTREE_FROM_EDGES, 2);
-      nearest.index = -1;
+      nearest_dst = mesh_remap_bvhtree_query_nearest_verts(
+          &treedata, space_transform, verts_dst, numverts_dst, max_dist_sq, &vcos_dst);
 
       for (i = 0; i < numverts_dst; i++) {
-        copy_v3_v3(tmp_co, verts_dst[i].co);
-
-        /* Convert the vertex to tree coordinates, if needed. */
-        if (space_transform) {
-          BLI_space_transform_apply(space_transform, tmp_co);
-        }
-
-        if (mesh_remap_bvhtree_query_nearest(
-                &treedata, &nearest, tmp_co, max_dist_sq, &hit_dist)) {
-          MEdge *me = &edges_src[nearest.index];
+        if (nearest_dst[i].index != -1) {
+          MEdge *me = &edges_src[nearest_dst[i].index];
           const float *v1cos = vcos_src[me->v1];
           const float *v2cos = vcos_src[me->v2];
 
+          hit_dist = sqrtf(nearest_dst[i].dist_sq);
+
           if (mode == MREMAP_MODE_VERT_EDGE_NEAREST) {
-            const float dist_v1 = len_squared_v3v3(tmp_co, v1cos);
-            const float dist_v2 = len_squared_v3v3(tmp_co, v2cos);
+            const float dist_v1 = len_squared_v3v3(vcos_dst[i], v1cos);
+            const float dist_v2 = len_squared_v3v3(vcos_dst[i], v2cos);
             const int index = (int)((dist_v1 > dist_v2) ? me->v2 : me->v1);
             mesh_remap_item_define(r_map, i, hit_dist, 0, 1, &index, &full_weight);
           }
@@ -581,7 +621,7 @@ void BKE_mesh_remap_calc_verts_from_mesh(const int mode,
             indices[1] = (int)me->v2;
 
             /* Weight is inverse of point factor here... */
-            weights[0] = line_point_factor_v3(tmp_co, v2cos, v1cos);
+            weights[0] = line_point_factor_v3(vcos_dst[i], v2cos, v1cos);
             CLAMP(weights[0], 0.0f, 1.0f);
             weights[1] = 1.0f - weights[0];
 
@@ -595,6 +635,8 @@ void BKE_mesh_remap_calc_verts_from_mesh(const int mode,
       }
 
       MEM_freeN(vcos_src);
+      MEM_freeN(vcos_dst);
+      MEM_freeN(nearest_dst);
     }
     else if (ELEM(mode,
                   MREMAP_MODE_VERT_POLY_NEAREST,
@@ -54,6 +54,7 @@ void BKE_mesh_runtime_reset(Mesh *mesh)
   mesh->runtime.eval_mutex = MEM_mallocN(sizeof(ThreadMutex), "mesh runtime eval_mutex");
   BLI_mutex_init(mesh->runtime.eval_mutex);
   mesh->runtime.bvh_cache = NULL;
+  mesh->runtime.loop_fan_cache = BKE_mesh_loop_fan_cache_new();
 }
 
 /* Clear all pointers which we don't want to be shared on copying the datablock.
@@ -73,6 +74,11 @@ void BKE_mesh_runtime_reset_on_copy(Mesh *mesh, const int UNUSED(flag))
 
   mesh->runtime.eval_mutex = MEM_mallocN(sizeof(ThreadMutex), "mesh runtime eval_mutex");
   BLI_mutex_init(mesh->runtime.eval_mutex);
+
+  /* Copies share the smooth fans of loop normals, they are only re-used when still valid. */
+  runtime->loop_fan_cache = (runtime->loop_fan_cache != NULL) ?
+                                BKE_mesh_loop_fan_cache_share(runtime->loop_fan_cache) :
+                                BKE_mesh_loop_fan_cache_new();
 }
 
 void BKE_mesh_runtime_clear_cache(Mesh *mesh)
@@ -82,6 +88,10 @@ void BKE_mesh_runtime_clear_cache(Mesh *mesh)
     MEM_freeN(mesh->runtime.eval_mutex);
     mesh->runtime.eval_mutex = NULL;
   }
+  if (mesh->runtime.loop_fan_cache != NULL) {
+    BKE_mesh_loop_fan_cache_free(mesh->runtime.loop_fan_cache);
+    mesh->runtime.loop_fan_cache = NULL;
+  }
   if (mesh->runtime.mesh_eval != NULL) {
     mesh->runtime.mesh_eval->edit_mesh = NULL;
     BKE_id_free(NULL, mesh->runtime.mesh_eval);
@@ -37,6 +37,7 @@
 #include "BLI_edgehash.h"
 #include "BLI_math_base.h"
 #include "BLI_math_vector.h"
+#include "BLI_task.h"
 #include "BLI_utildefines.h"
 
 #include "BKE_customdata.h"
@@ -1513,22 +1514,272 @@ void BKE_mesh_calc_edges_legacy(Mesh *me, const bool use_old)
   BKE_mesh_strip_loose_faces(me);
 }
 
+/* -------------------------------------------------------------------- */
+/* Edge calculation from polygons.
+ *
+ * Every edge use (an existing edge when updating, or a loop and the loop before it) is a record
+ * with a "key": its position in the order the edges would be inserted into an #EdgeHash, that is
+ * existing edges followed by the loops of each polygon in polygon order.
+ * Records are scattered into buckets by their lower vertex index, each bucket is de-duplicated
+ * on its own (in parallel), then the new edge indices come from a prefix sum over the keys of
+ * the first use of each edge. This gives the same edge order as inserting the edges one by one
+ * into an #EdgeHash, which is what this code used to do. */
+
+/** Records are put into bucket `v_low % MESH_CALC_EDGES_BUCKETS`. */
+#define MESH_CALC_EDGES_BUCKETS 64
+#define MESH_CALC_EDGES_CHUNK_EDGES 4096
+#define MESH_CALC_EDGES_CHUNK_POLYS 1024
+/** Records sharing their lower vertex are scanned for duplicates up to this number,
+ * larger groups (high valence vertices) are sorted instead. */
+#define MESH_CALC_EDGES_GROUP_SCAN_MAX 32
+
+typedef struct CalcEdgesRecord {
+  uint v_low, v_high;
+  /** Position of this use in the order the edges are visited in. */
+  uint key;
+  /** The key of the first use of this edge, set when de-duplicating. */
+  uint key_first;
+  /** The loop using this edge, -1 for existing edges. */
+  int loop;
+} CalcEdgesRecord;
+
+typedef struct CalcEdgesData {
+  const MEdge *medge;
+  const MPoly *mpoly;
+  MLoop *mloop;
+  int totedge;
+  int totpoly;
+
+  /** Chunks of existing edges, followed by chunks of polygons. */
+  int chunks_edge_len;
+  /** The key of the first loop of each chunk of polygons. */
+  uint *chunk_poly_keys;
+  CalcEdgesRecord **chunk_records;
+  uint *chunk_records_len;
+  /** #MESH_CALC_EDGES_BUCKETS record counts for each chunk,
+   * which are then turned into offsets into #CalcEdgesData.records. */
+  uint *chunk_bucket_offsets;
+  /** The range of records for each bucket (#MESH_CALC_EDGES_BUCKETS + 1 values). */
+  uint bucket_offsets[MESH_CALC_EDGES_BUCKETS + 1];
+  CalcEdgesRecord *records;
+
+  /** For each key: 1 when it's the first use of an edge, then the index of its edge. */
+  uint *key_edge_index;
+
+  MEdge *medge_new;
+  short ed_flag;
+} CalcEdgesData;
+
+static void calc_edges_record_init(
+    CalcEdgesRecord *rec, uint v1, uint v2, const uint key, const int loop)
+{
+  if (v1 > v2) {
+    SWAP(uint, v1, v2);
+  }
+  rec->v_low = v1;
+  rec->v_high = v2;
+  rec->key = key;
+  rec->key_first = key;
+  rec->loop = loop;
+}
+
+/**
+ * Fill in the records of a chunk (in key order) and count them per bucket.
+ * Loops using the same vertex twice don't get a record, they're assigned to edge zero.
+ */
+static void calc_edges_chunk_records_cb(void *__restrict userdata,
+                                        const int chunk,
+                                        const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  CalcEdgesData *data = userdata;
+  uint *bucket_counts = &data->chunk_bucket_offsets[chunk * MESH_CALC_EDGES_BUCKETS];
+  CalcEdgesRecord *records, *rec;
+
+  if (chunk < data->chunks_edge_len) {
+    const int i_start = chunk * MESH_CALC_EDGES_CHUNK_EDGES;
+    const int i_end = min_ii(i_start + MESH_CALC_EDGES_CHUNK_EDGES, data->totedge);
+    rec = records = MEM_mallocN(sizeof(*records) * (size_t)(i_end - i_start), __func__);
+    for (int i = i_start; i < i_end; i++) {
+      calc_edges_record_init(rec++, data->medge[i].v1, data->medge[i].v2, (uint)i, -1);
+    }
+  }
+  else {
+    const int i_start = (chunk - data->chunks_edge_len) * MESH_CALC_EDGES_CHUNK_POLYS;
+    const int i_end = min_ii(i_start + MESH_CALC_EDGES_CHUNK_POLYS, data->totpoly);
+    size_t records_len_max = 0;
+    for (int i = i_start; i < i_end; i++) {
+      records_len_max += (size_t)data->mpoly[i].totloop;
+    }
+    rec = records = MEM_mallocN(sizeof(*records) * max_zz(records_len_max, 1), __func__);
+    /* Keys of loops follow the keys of the existing edges, in polygon order. */
+    uint key = data->chunk_poly_keys[chunk - data->chunks_edge_len];
+    for (int i = i_start; i < i_end; i++) {
+      const MPoly *mp = &data->mpoly[i];
+      const int l_end = mp->loopstart + mp->totloop;
+      for (int l = mp->loopstart, l_prev = l_end - 1; l < l_end; l_prev = l++, key++) {
+        MLoop *ml_prev = &data->mloop[l_prev];
+        if (ml_prev->v == data->mloop[l].v) {
+          /* This is an invalid edge; normally this does not happen in Blender, but it can be part
+           * of an imported mesh with invalid geometry. See T76514. */
+          ml_prev->e = 0;
+          continue;
+        }
+        calc_edges_record_init(rec++, ml_prev->v, data->mloop[l].v, key, l_prev);
+      }
+    }
+  }
+
+  const uint records_len = (uint)(rec - records);
+  for (uint i = 0; i < records_len; i++) {
+    bucket_counts[records[i].v_low % MESH_CALC_EDGES_BUCKETS]++;
+  }
+  data->chunk_records[chunk] = records;
+  data->chunk_records_len[chunk] = records_len;
+}
+
+/** Move the records of a chunk into their buckets, keeping them in key order. */
+static void calc_edges_chunk_scatter_cb(void *__restrict userdata,
+                                        const int chunk,
+                                        const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  CalcEdgesData *data = userdata;
+  uint *bucket_offsets = &data->chunk_bucket_offsets[chunk * MESH_CALC_EDGES_BUCKETS];
+  const CalcEdgesRecord *rec = data->chunk_records[chunk];
+
+  for (uint i = 0; i < data->chunk_records_len[chunk]; i++, rec++) {
+    data->records[bucket_offsets[rec->v_low % MESH_CALC_EDGES_BUCKETS]++] = *rec;
+  }
+  MEM_freeN(data->chunk_records[chunk]);
+}
+
+static int calc_edges_record_cmp(const void *a_v, const void *b_v)
+{
+  const CalcEdgesRecord *a = a_v, *b = b_v;
+  if (a->v_high != b->v_high) {
+    return (a->v_high < b->v_high) ? -1 : 1;
+  }
+  if (a->key != b->key) {
+    return (a->key < b->key) ? -1 : 1;
+  }
+  return 0;
+}
+
+/**
+ * Set #CalcEdgesRecord.key_first for all records in a group sharing the same lower vertex,
+ * the records are in key order.
+ */
+static void calc_edges_group_dedup(CalcEdgesRecord *group, const uint group_len)
+{
+  if (group_len <= MESH_CALC_EDGES_GROUP_SCAN_MAX) {
+    for (uint i = 1; i < group_len; i++) {
+      for (uint j = 0; j < i; j++) {
+        if (group[j].v_high == group[i].v_high) {
+          group[i].key_first = group[j].key_first;
+          break;
+        }
+      }
+    }
+  }
+  else {
+    qsort(group, group_len, sizeof(*group), calc_edges_record_cmp);
+    for (uint i = 1; i < group_len; i++) {
+      if (group[i - 1].v_high == group[i].v_high) {
+        group[i].key_first = group[i - 1].key_first;
+      }
+    }
+  }
+}
+
+/** De-duplicate the records of a bucket and tag the keys that are the first use of an edge. */
+static void calc_edges_bucket_dedup_cb(void *__restrict userdata,
+                                       const int bucket,
+                                       const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  CalcEdgesData *data = userdata;
+  CalcEdgesRecord *records = &data->records[data->bucket_offsets[bucket]];
+  const uint records_len = data->bucket_offsets[bucket + 1] - data->bucket_offsets[bucket];
+  if (records_len == 0) {
+    return;
+  }
+
+  /* Counting sort by the lower vertex, within a bucket `v_low / MESH_CALC_EDGES_BUCKETS` is a
+   * dense index. The sort is stable so each group stays in key order. */
+  uint group_index_max = 0;
+  for (uint i = 0; i < records_len; i++) {
+    group_index_max = MAX2(group_index_max, records[i].v_low / MESH_CALC_EDGES_BUCKETS);
+  }
+  const uint groups_len = group_index_max + 1;
+  uint *group_offsets = MEM_calloc_arrayN(groups_len + 1, sizeof(*group_offsets), __func__);
+  for (uint i = 0; i < records_len; i++) {
+    group_offsets[records[i].v_low / MESH_CALC_EDGES_BUCKETS + 1]++;
+  }
+  for (uint i = 0; i < groups_len; i++) {
+    group_offsets[i + 1] += group_offsets[i];
+  }
+
+  CalcEdgesRecord *records_sorted = MEM_mallocN(sizeof(*records_sorted) * records_len, __func__);
+  for (uint i = 0; i < records_len; i++) {
+    records_sorted[group_offsets[records[i].v_low / MESH_CALC_EDGES_BUCKETS]++] = records[i];
+  }
+  /* Offsets were shifted by the scatter, each now holds the end of its group. */
+  for (uint i = 0, group_start = 0; i < groups_len; i++) {
+    const uint group_end = group_offsets[i];
+    calc_edges_group_dedup(&records_sorted[group_start], group_end - group_start);
+    group_start = group_end;
+  }
+  MEM_freeN(group_offsets);
+
+  for (uint i = 0; i < records_len; i++) {
+    const CalcEdgesRecord *rec = &records_sorted[i];
+    if (rec->key == rec->key_first) {
+      data->key_edge_index[rec->key] = 1;
+    }
+  }
+  memcpy(records, records_sorted, sizeof(*records) * records_len);
+  MEM_freeN(records_sorted);
+}
+
+/** Write the edges of a bucket and assign them to their loops. */
+static void calc_edges_bucket_write_cb(void *__restrict userdata,
+                                       const int bucket,
+                                       const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  CalcEdgesData *data = userdata;
+
+  for (uint i = data->bucket_offsets[bucket]; i < data->bucket_offsets[bucket + 1]; i++) {
+    const CalcEdgesRecord *rec = &data->records[i];
+    const uint med_index = data->key_edge_index[rec->key_first];
+    if (rec->key == rec->key_first) {
+      MEdge *med = &data->medge_new[med_index];
+      if (rec->loop == -1) {
+        *med = data->medge[rec->key]; /* copy from the original */
+      }
+      else {
+        med->v1 = rec->v_low;
+        med->v2 = rec->v_high;
+        med->flag = data->ed_flag;
+      }
+    }
+    if (rec->loop != -1) {
+      data->mloop[rec->loop].e = med_index;
+    }
+  }
+}
+
 /**
  * Calculate edges from polygons
  *
  * \param mesh: The mesh to add edges into
  * \param update: When true create new edges co-exist
+ *
+ * \note The resulting edge order matches inserting all existing edges (when \a update is set),
+ * followed by the edges of each polygon in order, into an ordered hash set.
  */
 void BKE_mesh_calc_edges(Mesh *mesh, bool update, const bool select)
 {
   CustomData edata;
-  EdgeHashIterator *ehi;
-  MPoly *mp;
-  MEdge *med, *med_orig;
-  EdgeHash *eh;
-  unsigned int eh_reserve;
-  int i, totedge, totpoly = mesh->totpoly;
-  int med_index;
+  CalcEdgesData data = {NULL};
+  int totedge;
   /* select for newly created meshes which are selected [#25595] */
   const short ed_flag = (ME_EDGEDRAW | ME_EDGERENDER) | (select ? SELECT : 0);
 
@@ -1536,77 +1787,82 @@ void BKE_mesh_calc_edges(Mesh *mesh, bool update, const bool select)
     update = false;
   }
 
-  eh_reserve = max_ii(update ? mesh->totedge : 0, BLI_EDGEHASH_SIZE_GUESS_FROM_POLYS(totpoly));
-  eh = BLI_edgehash_new_ex(__func__, eh_reserve);
-
-  if (update) {
-    /* assume existing edges are valid
-     * useful when adding more faces and generating edges from them */
-    med = mesh->medge;
-    for (i = 0; i < mesh->totedge; i++, med++) {
-      BLI_edgehash_insert(eh, med->v1, med->v2, med);
+  data.medge = mesh->medge;
+  data.mpoly = mesh->mpoly;
+  data.mloop = mesh->mloop;
+  data.totedge = update ? mesh->totedge : 0;
+  data.totpoly = mesh->totpoly;
+  data.ed_flag = ed_flag;
+
+  data.chunks_edge_len = divide_ceil_u((uint)data.totedge, MESH_CALC_EDGES_CHUNK_EDGES);
+  const int chunks_poly_len = (int)divide_ceil_u((uint)data.totpoly, MESH_CALC_EDGES_CHUNK_POLYS);
+  const int chunks_len = data.chunks_edge_len + chunks_poly_len;
+
+  /* Polygons are not required to be stored in loop order, number their loops as they are
+   * visited so the keys follow the polygon order. */
+  size_t keys_len = (size_t)data.totedge;
+  data.chunk_poly_keys = MEM_mallocN(sizeof(*data.chunk_poly_keys) * max_ii(chunks_poly_len, 1),
+                                     __func__);
+  for (int i = 0; i < data.totpoly; i++) {
+    if (i % MESH_CALC_EDGES_CHUNK_POLYS == 0) {
+      data.chunk_poly_keys[i / MESH_CALC_EDGES_CHUNK_POLYS] = (uint)keys_len;
     }
-  }
-
-  /* mesh loops (bmesh only) */
-  for (mp = mesh->mpoly, i = 0; i < totpoly; mp++, i++) {
-    MLoop *l = &mesh->mloop[mp->loopstart];
-    int j, v_prev = (l + (mp->totloop - 1))->v;
-    for (j = 0; j < mp->totloop; j++, l++) {
-      if (v_prev != l->v) {
-        void **val_p;
-        if (!BLI_edgehash_ensure_p(eh, v_prev, l->v, &val_p)) {
-          *val_p = NULL;
-        }
-      }
-      v_prev = l->v;
+    keys_len += (size_t)data.mpoly[i].totloop;
+  }
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = (chunks_len > 1);
+  settings.min_iter_per_thread = 1;
+
+  /* Gather the records of each chunk, then move them into their buckets. */
+  data.chunk_records = MEM_mallocN(sizeof(*data.chunk_records) * (size_t)chunks_len, __func__);
+  data.chunk_records_len = MEM_mallocN(sizeof(*data.chunk_records_len) * (size_t)chunks_len,
+                                       __func__);
+  data.chunk_bucket_offsets = MEM_calloc_arrayN((size_t)chunks_len * MESH_CALC_EDGES_BUCKETS,
+                                                sizeof(*data.chunk_bucket_offsets),
+                                                __func__);
+  BLI_task_parallel_range(0, chunks_len, &data, calc_edges_chunk_records_cb, &settings);
+  MEM_freeN(data.chunk_poly_keys);
+
+  uint records_len = 0;
+  for (int bucket = 0; bucket < MESH_CALC_EDGES_BUCKETS; bucket++) {
+    data.bucket_offsets[bucket] = records_len;
+    for (int chunk = 0; chunk < chunks_len; chunk++) {
+      uint *offset = &data.chunk_bucket_offsets[chunk * MESH_CALC_EDGES_BUCKETS + bucket];
+      const uint count = *offset;
+      *offset = records_len;
+      records_len += count;
     }
   }
+  data.bucket_offsets[MESH_CALC_EDGES_BUCKETS] = records_len;
+
+  data.records = MEM_mallocN(sizeof(*data.records) * max_zz(records_len, 1), __func__);
+  BLI_task_parallel_range(0, chunks_len, &data, calc_edges_chunk_scatter_cb, &settings);
+  MEM_freeN(data.chunk_records);
+  MEM_freeN(data.chunk_records_len);
+  MEM_freeN(data.chunk_bucket_offsets);
+
+  /* De-duplicate each bucket, then number the edges in key order. */
+  data.key_edge_index = MEM_calloc_arrayN(max_zz(keys_len, 1), sizeof(uint), __func__);
+  BLI_task_parallel_range(
+      0, MESH_CALC_EDGES_BUCKETS, &data, calc_edges_bucket_dedup_cb, &settings);
 
-  totedge = BLI_edgehash_len(eh);
+  totedge = 0;
+  for (size_t key = 0; key < keys_len; key++) {
+    const uint is_first = data.key_edge_index[key];
+    data.key_edge_index[key] = (uint)totedge;
+    totedge += (int)is_first;
+  }
 
   /* write new edges into a temporary CustomData */
   CustomData_reset(&edata);
-  CustomData_add_layer(&edata, CD_MEDGE, CD_CALLOC, NULL, totedge);
+  data.medge_new = CustomData_add_layer(&edata, CD_MEDGE, CD_CALLOC, NULL, totedge);
+  BLI_task_parallel_range(
+      0, MESH_CALC_EDGES_BUCKETS, &data, calc_edges_bucket_write_cb, &settings);
 
-  med = CustomData_get_layer(&edata, CD_MEDGE);
-  for (ehi = BLI_edgehashIterator_new(eh), i = 0; BLI_edgehashIterator_isDone(ehi) == false;
-       BLI_edgehashIterator_step(ehi), ++i, ++med) {
-    if (update && (med_orig = BLI_edgehashIterator_getValue(ehi))) {
-      *med = *med_orig; /* copy from the original */
-    }
-    else {
-      BLI_edgehashIterator_getKey(ehi, &med->v1, &med->v2);
-      med->flag = ed_flag;
-    }
-
-    /* store the new edge index in the hash value */
-    BLI_edgehashIterator_setValue(ehi, POINTER_FROM_INT(i));
-  }
-  BLI_edgehashIterator_free(ehi);
-
-  if (mesh->totpoly) {
-    /* second pass, iterate through all loops again and assign
-     * the newly created edges to them. */
-    for (mp = mesh->mpoly, i = 0; i < mesh->totpoly; mp++, i++) {
-      MLoop *l = &mesh->mloop[mp->loopstart];
-      MLoop *l_prev = (l + (mp->totloop - 1));
-      int j;
-      for (j = 0; j < mp->totloop; j++, l++) {
-        /* Lookup hashed edge index, if it's valid. */
-        if (l_prev->v != l->v) {
-          med_index = POINTER_AS_INT(BLI_edgehash_lookup(eh, l_prev->v, l->v));
-        }
-        else {
-          /* This is an invalid edge; normally this does not happen in Blender, but it can be part
-           * of an imported mesh with invalid geometry. See T76514. */
-          med_index = 0;
-        }
-        l_prev->e = med_index;
-        l_prev = l;
-      }
-    }
-  }
+  MEM_freeN(data.records);
+  MEM_freeN(data.key_edge_index);
 
   /* free old CustomData and assign new one */
   CustomData_free(&mesh->edata, mesh->totedge);
@@ -1614,8 +1870,6 @@ void BKE_mesh_calc_edges(Mesh *mesh, bool update, const bool select)
   mesh->totedge = totedge;
 
   mesh->medge = CustomData_get_layer(&mesh->edata, CD_MEDGE);
-
-  BLI_edgehash_free(eh, NULL);
 }
 
 void BKE_mesh_calc_edges_loose(Mesh *mesh)
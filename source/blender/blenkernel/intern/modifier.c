@@ -183,6 +183,9 @@ void BKE_modifier_free_ex(ModifierData *md, const int flag)
   if (md->error) {
     MEM_freeN(md->error);
   }
+  if (md->orig_modifier_data == NULL) {
+    BKE_modifier_result_cache_remove(md);
+  }
 
   MEM_freeN(md);
 }
@@ -0,0 +1,583 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup bke
+ *
+ * Cache of modifier results, for modifiers with #eModifierFlag_UseResultCache.
+ *
+ * Results are looked up by a hash of everything the modifier reads: its settings, the input
+ * mesh (topology, coordinates and all other layers) and the few object and scene properties
+ * modifiers depend on. This way evaluating an unchanged input again, as happens when scrubbing
+ * back and forth over frames where only preceding modifiers are animated, reuses the result.
+ *
+ * Cached meshes are shared with the evaluated meshes by referencing their layers, so a cache
+ * hit doesn't copy any data. All results share one memory budget
+ * (#UserDef.modifier_cache_limit), the least recently used ones are freed first.
+ */
+
+#include <string.h>
+
+#include "MEM_guardedalloc.h"
+
+#include "DNA_genfile.h"
+#include "DNA_mesh_types.h"
+#include "DNA_object_types.h"
+#include "DNA_scene_types.h"
+#include "DNA_sdna_types.h"
+#include "DNA_userdef_types.h"
+
+#include "BLI_ghash.h"
+#include "BLI_hash_mm2a.h"
+#include "BLI_listbase.h"
+#include "BLI_threads.h"
+#include "BLI_utildefines.h"
+
+#include "BKE_customdata.h"
+#include "BKE_lib_id.h"
+#include "BKE_lib_query.h"
+#include "BKE_mesh.h"
+#include "BKE_modifier.h"
+
+#include "DEG_depsgraph_query.h"
+
+/* A collision would give wrong results, hence the 64 bits hash. */
+#define RESULT_HASH_SEED 0
+
+/* Nested pointers followed when hashing modifier settings. */
+#define RESULT_HASH_DEPTH_MAX 4
+
+typedef struct ModifierResultKey {
+  /** The original modifier, results are never shared between modifiers. */
+  const ModifierData *md;
+  uint64_t hash;
+} ModifierResultKey;
+
+typedef struct ModifierResult {
+  struct ModifierResult *next, *prev;
+  /** Other results of the same modifier. */
+  struct ModifierResult *md_next, *md_prev;
+  ModifierResultKey key;
+  Mesh *mesh;
+  size_t mem_size;
+} ModifierResult;
+
+static struct {
+  ThreadMutex mutex;
+  /** #ModifierResultKey -> #ModifierResult. */
+  GHash *results;
+  /** #ModifierData -> first #ModifierResult of the modifier, see #ModifierResult.md_next. */
+  GHash *results_by_md;
+  /** Least recently used first. */
+  ListBase lru;
+  size_t mem_in_use;
+} g_result_cache = {BLI_MUTEX_INITIALIZER};
+
+/* -------------------------------------------------------------------- */
+/** \name Result Key
+ * \{ */
+
+typedef struct ResultHash {
+  BLI_HashMurmur64A mm64;
+} ResultHash;
+
+static void result_hash_add(ResultHash *rhash, const void *data, const size_t len)
+{
+  BLI_hash_mm64a_add(&rhash->mm64, data, len);
+}
+
+static void result_hash_add_int(ResultHash *rhash, const int data)
+{
+  BLI_hash_mm64a_add_int(&rhash->mm64, data);
+}
+
+static bool result_hash_add_dna_struct(ResultHash *rhash,
+                                       const SDNA *sdna,
+                                       const int struct_nr,
+                                       const char *data,
+                                       const int member_first,
+                                       const int depth);
+
+/**
+ * Hash the data pointed to by a DNA member, the length of arrays is known from the allocation.
+ * \return false for data that can't be hashed (ID's, untyped data and function pointers).
+ */
+static bool result_hash_add_dna_pointer(ResultHash *rhash,
+                                        const SDNA *sdna,
+                                        const short type,
+                                        const char *name,
+                                        const void *ptr,
+                                        const int depth)
+{
+  if (ptr == NULL) {
+    result_hash_add_int(rhash, 0);
+    return true;
+  }
+  /* Function pointers, pointers to pointers and untyped data. */
+  if (name[0] == '(' || name[1] == '*' || STREQ(sdna->types[type], "void")) {
+    return false;
+  }
+  if (depth >= RESULT_HASH_DEPTH_MAX) {
+    return false;
+  }
+
+  const int struct_nr = DNA_struct_find_nr(sdna, sdna->types[type]);
+  const int type_size = sdna->types_size[type];
+  const size_t data_len = MEM_allocN_len(ptr);
+  result_hash_add_int(rhash, (int)data_len);
+
+  if (struct_nr == -1) {
+    result_hash_add(rhash, ptr, data_len);
+    return true;
+  }
+
+  /* Data-blocks are evaluated separately, the result would depend on their evaluation. */
+  const short *sp = sdna->structs[struct_nr];
+  if (sp[1] > 0 && STREQ(sdna->types[sp[2]], "ID")) {
+    return false;
+  }
+
+  for (size_t offset = 0; offset + type_size <= data_len; offset += type_size) {
+    if (!result_hash_add_dna_struct(
+            rhash, sdna, struct_nr, (const char *)ptr + offset, 0, depth + 1)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * Hash the members of a DNA struct, starting with \a member_first.
+ */
+static bool result_hash_add_dna_struct(ResultHash *rhash,
+                                       const SDNA *sdna,
+                                       const int struct_nr,
+                                       const char *data,
+                                       const int member_first,
+                                       const int depth)
+{
+  const short *sp = sdna->structs[struct_nr];
+  const int members_len = sp[1];
+  sp += 2;
+
+  for (int i = 0; i < members_len; i++, sp += 2) {
+    const short type = sp[0];
+    const short name = sp[1];
+    const char *member_name = sdna->names[name];
+    const int member_size = DNA_elem_size_nr(sdna, type, name);
+
+    if (i >= member_first) {
+      const int array_len = sdna->names_array_len[name];
+      if (ELEM(member_name[0], '*', '(')) {
+        const void *const *ptr_array = (const void *const *)data;
+        for (int j = 0; j < array_len; j++) {
+          if (!result_hash_add_dna_pointer(rhash, sdna, type, member_name, ptr_array[j], depth)) {
+            return false;
+          }
+        }
+      }
+      else {
+        const int member_struct_nr = DNA_struct_find_nr(sdna, sdna->types[type]);
+        if (member_struct_nr != -1) {
+          for (int j = 0; j < array_len; j++) {
+            if (!result_hash_add_dna_struct(rhash,
+                                            sdna,
+                                            member_struct_nr,
+                                            data + j * sdna->types_size[type],
+                                            0,
+                                            depth)) {
+              return false;
+            }
+          }
+        }
+        else {
+          result_hash_add(rhash, data, (size_t)member_size);
+        }
+      }
+    }
+    data += member_size;
+  }
+  return true;
+}
+
+static void modifier_result_id_link_cb(void *user_data,
+                                       Object *UNUSED(ob),
+                                       ID **idpoin,
+                                       int UNUSED(cb_flag))
+{
+  bool *r_has_id = user_data;
+  if (*idpoin != NULL) {
+    *r_has_id = true;
+  }
+}
+
+static bool modifier_result_supported(ModifierData *md)
+{
+  const ModifierTypeInfo *mti = BKE_modifier_get_info(md->type);
+
+  if (mti->type == eModifierTypeType_OnlyDeform || mti->modifyMesh == NULL) {
+    return false;
+  }
+  if (mti->flags & eModifierTypeFlag_UsesPointCache) {
+    return false;
+  }
+  if (mti->dependsOnTime && mti->dependsOnTime(md)) {
+    return false;
+  }
+
+  /* Other objects and data-blocks aren't part of the key. */
+  bool has_id = false;
+  if (mti->foreachIDLink) {
+    mti->foreachIDLink(md, NULL, modifier_result_id_link_cb, &has_id);
+  }
+  else if (mti->foreachObjectLink) {
+    mti->foreachObjectLink(md, NULL, (ObjectWalkFunc)modifier_result_id_link_cb, &has_id);
+  }
+  return !has_id;
+}
+
+/**
+ * Hash the properties of the input mesh, which are not custom-data.
+ */
+static void result_hash_add_mesh(ResultHash *rhash, const Mesh *mesh)
+{
+  result_hash_add_int(rhash, mesh->totvert);
+  result_hash_add_int(rhash, mesh->totedge);
+  result_hash_add_int(rhash, mesh->totloop);
+  result_hash_add_int(rhash, mesh->totpoly);
+  result_hash_add_int(rhash, mesh->totcol);
+  result_hash_add_int(rhash, mesh->flag);
+  result_hash_add_int(rhash, mesh->cd_flag);
+  result_hash_add_int(rhash, mesh->texflag);
+  result_hash_add(rhash, &mesh->smoothresh, sizeof(mesh->smoothresh));
+  result_hash_add(rhash, mesh->loc, sizeof(mesh->loc));
+  result_hash_add(rhash, mesh->size, sizeof(mesh->size));
+}
+
+/**
+ * Hash the object and scene properties modifiers read besides their input mesh.
+ */
+static void result_hash_add_context(ResultHash *rhash, const ModifierEvalContext *ctx)
+{
+  Object *ob = ctx->object;
+
+  result_hash_add_int(rhash, ctx->flag);
+
+  result_hash_add_int(rhash, ob->totcol);
+  LISTBASE_FOREACH (const bDeformGroup *, dg, &ob->defbase) {
+    result_hash_add(rhash, dg->name, strlen(dg->name) + 1);
+  }
+  if (ob->type == OB_MESH && ob->data) {
+    result_hash_add_int(rhash, ((const Mesh *)ob->data)->flag);
+  }
+
+  if (ctx->depsgraph) {
+    const Scene *scene = DEG_get_evaluated_scene(ctx->depsgraph);
+    result_hash_add_int(rhash, scene->r.mode & R_SIMPLIFY);
+    result_hash_add_int(rhash, scene->r.simplify_subsurf);
+    result_hash_add_int(rhash, scene->r.simplify_subsurf_render);
+  }
+}
+
+static bool modifier_result_key_calc(ModifierData *md,
+                                     const ModifierEvalContext *ctx,
+                                     const Mesh *mesh,
+                                     const CustomData_MeshMasks *mask,
+                                     ModifierResultKey *r_key)
+{
+  if (mesh->runtime.wrapper_type != ME_WRAPPER_TYPE_MDATA) {
+    return false;
+  }
+  if (!modifier_result_supported(md)) {
+    return false;
+  }
+
+  const ModifierTypeInfo *mti = BKE_modifier_get_info(md->type);
+  const SDNA *sdna = DNA_sdna_current_get();
+  const int struct_nr = DNA_struct_find_nr(sdna, mti->structName);
+  if (struct_nr == -1) {
+    return false;
+  }
+
+  ResultHash rhash;
+  BLI_hash_mm64a_init(&rhash.mm64, RESULT_HASH_SEED);
+
+  /* Settings, skipping the #ModifierData header. */
+  result_hash_add_int(&rhash, md->type);
+  if (!result_hash_add_dna_struct(&rhash, sdna, struct_nr, (const char *)md, 1, 0)) {
+    return false;
+  }
+
+  result_hash_add_context(&rhash, ctx);
+  result_hash_add(&rhash, mask, sizeof(*mask));
+  result_hash_add(&rhash, &mesh->runtime.cd_mask_extra, sizeof(mesh->runtime.cd_mask_extra));
+
+  result_hash_add_mesh(&rhash, mesh);
+  if (!CustomData_data_hash(&mesh->vdata, mesh->totvert, &rhash.mm64) ||
+      !CustomData_data_hash(&mesh->edata, mesh->totedge, &rhash.mm64) ||
+      !CustomData_data_hash(&mesh->ldata, mesh->totloop, &rhash.mm64) ||
+      !CustomData_data_hash(&mesh->pdata, mesh->totpoly, &rhash.mm64)) {
+    return false;
+  }
+
+  r_key->md = BKE_modifier_get_original(md);
+  r_key->hash = BLI_hash_mm64a_end(&rhash.mm64);
+  return true;
+}
+
+static uint modifier_result_key_hash(const void *ptr)
+{
+  const ModifierResultKey *key = ptr;
+  return (uint)(key->hash ^ (key->hash >> 32)) ^ BLI_ghashutil_ptrhash(key->md);
+}
+
+static bool modifier_result_key_cmp(const void *a, const void *b)
+{
+  const ModifierResultKey *key_a = a;
+  const ModifierResultKey *key_b = b;
+  return !((key_a->md == key_b->md) && (key_a->hash == key_b->hash));
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Cache Storage
+ * \{ */
+
+static size_t customdata_mem_size(const CustomData *data, const int totelem)
+{
+  size_t mem_size = 0;
+  for (int i = 0; i < data->totlayer; i++) {
+    mem_size += (size_t)CustomData_sizeof(data->layers[i].type) * (size_t)totelem;
+  }
+  return mem_size;
+}
+
+static size_t modifier_result_mesh_mem_size(const Mesh *mesh)
+{
+  return sizeof(*mesh) + customdata_mem_size(&mesh->vdata, mesh->totvert) +
+         customdata_mem_size(&mesh->edata, mesh->totedge) +
+         customdata_mem_size(&mesh->ldata, mesh->totloop) +
+         customdata_mem_size(&mesh->pdata, mesh->totpoly);
+}
+
+static void modifier_result_link_md(ModifierResult *result)
+{
+  void **first_p;
+  if (BLI_ghash_ensure_p(g_result_cache.results_by_md, (void *)result->key.md, &first_p)) {
+    result->md_next = *first_p;
+    result->md_next->md_prev = result;
+  }
+  *first_p = result;
+}
+
+static void modifier_result_unlink_md(ModifierResult *result)
+{
+  if (result->md_next) {
+    result->md_next->md_prev = result->md_prev;
+  }
+  if (result->md_prev) {
+    result->md_prev->md_next = result->md_next;
+  }
+  else if (result->md_next) {
+    *BLI_ghash_lookup_p(g_result_cache.results_by_md, result->key.md) = result->md_next;
+  }
+  else {
+    BLI_ghash_remove(g_result_cache.results_by_md, result->key.md, NULL, NULL);
+  }
+}
+
+static void modifier_result_free(ModifierResult *result)
+{
+  BLI_ghash_remove(g_result_cache.results, &result->key, NULL, NULL);
+  modifier_result_unlink_md(result);
+  BLI_remlink(&g_result_cache.lru, result);
+  g_result_cache.mem_in_use -= result->mem_size;
+
+  BKE_id_free(NULL, result->mesh);
+  MEM_freeN(result);
+}
+
+/**
+ * A copy of the cached mesh for the caller, referencing all its layers.
+ * Must be called with the cache locked, so the result can't be freed meanwhile.
+ */
+static Mesh *modifier_result_mesh_share(ModifierResult *result)
+{
+  /* Most recently used goes last. */
+  BLI_remlink(&g_result_cache.lru, result);
+  BLI_addtail(&g_result_cache.lru, result);
+
+  return BKE_mesh_copy_for_eval(result->mesh, true);
+}
+
+static Mesh *modifier_result_cache_lookup(const ModifierResultKey *key)
+{
+  Mesh *mesh = NULL;
+
+  BLI_mutex_lock(&g_result_cache.mutex);
+  if (g_result_cache.results) {
+    ModifierResult *result = BLI_ghash_lookup(g_result_cache.results, key);
+    if (result) {
+      mesh = modifier_result_mesh_share(result);
+    }
+  }
+  BLI_mutex_unlock(&g_result_cache.mutex);
+
+  return mesh;
+}
+
+/**
+ * Store \a mesh_result, returning the mesh to use in its place.
+ *
+ * \param mesh_input: The mesh passed to the modifier, when the modifier returned it the
+ * cache stores a copy, since it remains owned by the caller.
+ */
+static Mesh *modifier_result_cache_add(const ModifierResultKey *key,
+                                       Mesh *mesh_result,
+                                       const Mesh *mesh_input)
+{
+  const size_t mem_size = modifier_result_mesh_mem_size(mesh_result);
+  const size_t mem_limit = (size_t)U.modifier_cache_limit * 1024 * 1024;
+
+  if (mem_size > mem_limit) {
+    return mesh_result;
+  }
+
+  Mesh *mesh_cache = mesh_result;
+  if (mesh_result == mesh_input) {
+    mesh_cache = BKE_mesh_copy_for_eval(mesh_result, false);
+  }
+  /* Computed before sharing, copies would otherwise all write them to the shared vertices. */
+  BKE_mesh_ensure_normals(mesh_cache);
+
+  Mesh *mesh = NULL;
+
+  BLI_mutex_lock(&g_result_cache.mutex);
+
+  if (g_result_cache.results == NULL) {
+    g_result_cache.results = BLI_ghash_new(
+        modifier_result_key_hash, modifier_result_key_cmp, __func__);
+    g_result_cache.results_by_md = BLI_ghash_ptr_new(__func__);
+  }
+
+  ModifierResult *result = BLI_ghash_lookup(g_result_cache.results, key);
+  if (result == NULL) {
+    while (g_result_cache.lru.first && g_result_cache.mem_in_use + mem_size > mem_limit) {
+      modifier_result_free(g_result_cache.lru.first);
+    }
+
+    result = MEM_callocN(sizeof(*result), __func__);
+    result->key = *key;
+    result->mesh = mesh_cache;
+    result->mem_size = mem_size;
+    BLI_ghash_insert(g_result_cache.results, &result->key, result);
+    modifier_result_link_md(result);
+    BLI_addtail(&g_result_cache.lru, result);
+    g_result_cache.mem_in_use += mem_size;
+
+    mesh_cache = NULL;
+  }
+  mesh = modifier_result_mesh_share(result);
+
+  BLI_mutex_unlock(&g_result_cache.mutex);
+
+  /* Stored by another thread in the meantime. */
+  if (mesh_cache != NULL && mesh_cache != mesh_input) {
+    BKE_id_free(NULL, mesh_cache);
+  }
+
+  return mesh;
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Public API
+ * \{ */
+
+/**
+ * Same as #BKE_modifier_modify_mesh, reusing results of earlier evaluations with the same
+ * input when the modifier has #eModifierFlag_UseResultCache enabled.
+ *
+ * The returned mesh references the data of the cached result, the caller must follow the
+ * rules for referenced custom-data layers when modifying it.
+ *
+ * \param mask: Data layers the result is to contain, part of the key.
+ */
+Mesh *BKE_modifier_modify_mesh_cached(ModifierData *md,
+                                      const ModifierEvalContext *ctx,
+                                      Mesh *me,
+                                      const CustomData_MeshMasks *mask)
+{
+  ModifierResultKey key;
+
+  if (!(md->flag & eModifierFlag_UseResultCache) || U.modifier_cache_limit <= 0 ||
+      !modifier_result_key_calc(md, ctx, me, mask, &key)) {
+    return BKE_modifier_modify_mesh(md, ctx, me);
+  }
+
+  Mesh *mesh_result = modifier_result_cache_lookup(&key);
+  if (mesh_result != NULL) {
+    return mesh_result;
+  }
+
+  mesh_result = BKE_modifier_modify_mesh(md, ctx, me);
+
+  /* Errors are reported during evaluation, don't skip them. */
+  if (mesh_result == NULL || md->error != NULL) {
+    return mesh_result;
+  }
+
+  return modifier_result_cache_add(&key, mesh_result, me);
+}
+
+/**
+ * Free the cached results of an original modifier, when the modifier itself is freed.
+ */
+void BKE_modifier_result_cache_remove(const ModifierData *md)
+{
+  BLI_mutex_lock(&g_result_cache.mutex);
+  if (g_result_cache.results_by_md) {
+    ModifierResult *result;
+    while ((result = BLI_ghash_lookup(g_result_cache.results_by_md, md))) {
+      modifier_result_free(result);
+    }
+  }
+  BLI_mutex_unlock(&g_result_cache.mutex);
+}
+
+void BKE_modifier_result_cache_clear(void)
+{
+  BLI_mutex_lock(&g_result_cache.mutex);
+  while (g_result_cache.lru.first) {
+    modifier_result_free(g_result_cache.lru.first);
+  }
+  if (g_result_cache.results) {
+    BLI_ghash_free(g_result_cache.results, NULL, NULL);
+    BLI_ghash_free(g_result_cache.results_by_md, NULL, NULL);
+    g_result_cache.results = NULL;
+    g_result_cache.results_by_md = NULL;
+  }
+  BLI_mutex_unlock(&g_result_cache.mutex);
+}
+
+size_t BKE_modifier_result_cache_mem_in_use(void)
+{
+  return g_result_cache.mem_in_use;
+}
+
+/** \} */
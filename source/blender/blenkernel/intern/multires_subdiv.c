@@ -25,6 +25,7 @@
 
 #include "DNA_mesh_types.h"
 #include "DNA_scene_types.h"
+#include "DNA_userdef_types.h"
 
 #include "BLI_utildefines.h"
 
@@ -43,6 +44,8 @@ void BKE_multires_subdiv_settings_init(SubdivSettings *settings, const MultiresM
   settings->vtx_boundary_interpolation = SUBDIV_VTX_BOUNDARY_EDGE_ONLY;
   settings->fvar_linear_interpolation = BKE_subdiv_fvar_interpolation_from_uv_smooth(
       mmd->uv_smooth);
+  settings->evaluator_type = BKE_subdiv_evaluator_type_from_compute_type(
+      U.opensubdiv_compute_type);
 }
 
 void BKE_multires_subdiv_mesh_settings_init(SubdivToMeshSettings *mesh_settings,
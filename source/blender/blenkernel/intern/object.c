@@ -289,6 +289,7 @@ static void object_free_data(ID *id)
   MEM_SAFE_FREE(ob->matbits);
   MEM_SAFE_FREE(ob->iuser);
   MEM_SAFE_FREE(ob->runtime.bb);
+  BKE_armature_deform_weights_free(ob);
 
   BLI_freelistN(&ob->defbase);
   BLI_freelistN(&ob->fmaps);
@@ -4269,6 +4270,7 @@ void BKE_object_runtime_reset_on_copy(Object *object, const int UNUSED(flag))
   runtime->data_eval = NULL;
   runtime->mesh_deform_eval = NULL;
   runtime->curve_cache = NULL;
+  runtime->armature_deform_weights = NULL;
 }
 
 /*
@@ -3021,6 +3021,8 @@ void BKE_pbvh_parallel_range_settings(TaskParallelSettings *settings,
 {
   memset(settings, 0, sizeof(*settings));
   settings->use_threading = use_threading && totnode > 1;
+  /* The cost of processing a node depends on how much of it is affected (by the brush). */
+  settings->use_adaptive_grain_size = true;
 }
 
 MVert *BKE_pbvh_get_verts(const PBVH *pbvh)
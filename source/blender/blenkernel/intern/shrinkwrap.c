@@ -99,6 +99,10 @@ typedef struct ShrinkwrapCalcCBData {
 
   float *proj_axis;
   SpaceTransform *local2aux;
+
+  /* Only for #MOD_SHRINKWRAP_NEAREST_VERTEX. */
+  float (*target_co)[3];
+  BVHTreeNearest *nearest;
 } ShrinkwrapCalcCBData;
 
 /* Checks if the modifier needs target normals with these settings. */
@@ -343,50 +347,51 @@ void BKE_shrinkwrap_compute_boundary_data(struct Mesh *mesh)
  * it builds a kdtree of vertexs we can attach to and then
  * for each vertex performs a nearest vertex search on the tree
  */
-static void shrinkwrap_calc_nearest_vertex_cb_ex(void *__restrict userdata,
-                                                 const int i,
-                                                 const TaskParallelTLS *__restrict tls)
+static float shrinkwrap_calc_nearest_vertex_weight(const ShrinkwrapCalcData *calc, const int i)
+{
+  const float weight = BKE_defvert_array_find_weight_safe(calc->dvert, i, calc->vgroup);
+  return calc->invert_vgroup ? 1.0f - weight : weight;
+}
+
+static void shrinkwrap_calc_nearest_vertex_init_cb_ex(
+    void *__restrict userdata, const int i, const TaskParallelTLS *__restrict UNUSED(tls))
 {
   ShrinkwrapCalcCBData *data = userdata;
 
   ShrinkwrapCalcData *calc = data->calc;
-  BVHTreeFromMesh *treeData = &data->tree->treeData;
-  BVHTreeNearest *nearest = tls->userdata_chunk;
-
-  float *co = calc->vertexCos[i];
-  float tmp_co[3];
-  float weight = BKE_defvert_array_find_weight_safe(calc->dvert, i, calc->vgroup);
-
-  if (calc->invert_vgroup) {
-    weight = 1.0f - weight;
-  }
+  BVHTreeNearest *nearest = &data->nearest[i];
+  float *tmp_co = data->target_co[i];
 
-  if (weight == 0.0f) {
-    return;
-  }
+  nearest->index = -1;
+  /* A zero distance skips the search for vertices that won't move. */
+  nearest->dist_sq = (shrinkwrap_calc_nearest_vertex_weight(calc, i) == 0.0f) ? 0.0f : FLT_MAX;
 
   /* Convert the vertex to tree coordinates */
   if (calc->vert) {
     copy_v3_v3(tmp_co, calc->vert[i].co);
   }
   else {
-    copy_v3_v3(tmp_co, co);
+    copy_v3_v3(tmp_co, calc->vertexCos[i]);
   }
   BLI_space_transform_apply(&calc->local2target, tmp_co);
+}
 
-  /* Use local proximity heuristics (to reduce the nearest search)
-   *
-   * If we already had an hit before.. we assume this vertex is going to have a close hit to that
-   * other vertex so we can initiate the "nearest.dist" with the expected value to that last hit.
-   * This will lead in pruning of the search tree. */
-  if (nearest->index != -1) {
-    nearest->dist_sq = len_squared_v3v3(tmp_co, nearest->co);
-  }
-  else {
-    nearest->dist_sq = FLT_MAX;
-  }
+static void shrinkwrap_calc_nearest_vertex_cb_ex(void *__restrict userdata,
+                                                 const int i,
+                                                 const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  ShrinkwrapCalcCBData *data = userdata;
+
+  ShrinkwrapCalcData *calc = data->calc;
+  const BVHTreeNearest *nearest = &data->nearest[i];
+
+  float *co = calc->vertexCos[i];
+  float tmp_co[3];
+  float weight = shrinkwrap_calc_nearest_vertex_weight(calc, i);
 
-  BLI_bvhtree_find_nearest(treeData->tree, tmp_co, nearest, treeData->nearest_callback, treeData);
+  if (weight == 0.0f) {
+    return;
+  }
 
   /* Found the nearest vertex */
   if (nearest->index != -1) {
@@ -407,23 +412,37 @@ static void shrinkwrap_calc_nearest_vertex_cb_ex(void *__restrict userdata,
 
 static void shrinkwrap_calc_nearest_vertex(ShrinkwrapCalcData *calc)
 {
-  BVHTreeNearest nearest = NULL_BVHTreeNearest;
-
-  /* Setup nearest */
-  nearest.index = -1;
-  nearest.dist_sq = FLT_MAX;
+  BVHTreeFromMesh *treeData = &calc->tree->treeData;
 
   ShrinkwrapCalcCBData data = {
       .calc = calc,
       .tree = calc->tree,
+      .target_co = MEM_mallocN(sizeof(*data.target_co) * (size_t)calc->numVerts, __func__),
+      .nearest = MEM_mallocN(sizeof(*data.nearest) * (size_t)calc->numVerts, __func__),
   };
   TaskParallelSettings settings;
   BLI_parallel_range_settings_defaults(&settings);
   settings.use_threading = (calc->numVerts > BKE_MESH_OMP_LIMIT);
-  settings.userdata_chunk = &nearest;
-  settings.userdata_chunk_size = sizeof(nearest);
+  BLI_task_parallel_range(
+      0, calc->numVerts, &data, shrinkwrap_calc_nearest_vertex_init_cb_ex, &settings);
+
+  /* Use local proximity heuristics (to reduce the nearest search)
+   *
+   * The batch is sorted so nearby vertices are searched one after another,
+   * each search starts with the distance to the previous hit which prunes the search tree. */
+  BLI_bvhtree_find_nearest_batch(treeData->tree,
+                                 (const float(*)[3])data.target_co,
+                                 calc->numVerts,
+                                 data.nearest,
+                                 treeData->nearest_callback,
+                                 treeData,
+                                 BVH_NEAREST_USE_PREVIOUS);
+
   BLI_task_parallel_range(
       0, calc->numVerts, &data, shrinkwrap_calc_nearest_vertex_cb_ex, &settings);
+
+  MEM_freeN(data.target_co);
+  MEM_freeN(data.nearest);
 }
 
 /*
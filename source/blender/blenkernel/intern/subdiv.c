@@ -26,6 +26,7 @@
 #include "DNA_mesh_types.h"
 #include "DNA_meshdata_types.h"
 #include "DNA_modifier_types.h"
+#include "DNA_userdef_types.h"
 
 #include "BLI_utildefines.h"
 
@@ -72,6 +73,17 @@ eSubdivFVarLinearInterpolation BKE_subdiv_fvar_interpolation_from_uv_smooth(int
   return SUBDIV_FVAR_LINEAR_INTERPOLATION_ALL;
 }
 
+eSubdivEvaluatorType BKE_subdiv_evaluator_type_from_compute_type(int compute_type)
+{
+  switch (compute_type) {
+    case USER_OPENSUBDIV_COMPUTE_OPENMP:
+      return SUBDIV_EVALUATOR_TYPE_OPENMP;
+    default:
+      /* GPU evaluators are not used for the CPU side evaluation. */
+      return SUBDIV_EVALUATOR_TYPE_CPU;
+  }
+}
+
 /* ================================ SETTINGS ================================ */
 
 static bool check_mesh_has_non_quad(const Mesh *mesh)
@@ -101,7 +113,8 @@ bool BKE_subdiv_settings_equal(const SubdivSettings *settings_a, const SubdivSet
           settings_a->is_adaptive == settings_b->is_adaptive &&
           settings_a->level == settings_b->level &&
           settings_a->vtx_boundary_interpolation == settings_b->vtx_boundary_interpolation &&
-          settings_a->fvar_linear_interpolation == settings_b->fvar_linear_interpolation);
+          settings_a->fvar_linear_interpolation == settings_b->fvar_linear_interpolation &&
+          settings_a->evaluator_type == settings_b->evaluator_type);
 }
 
 /* ============================== CONSTRUCTION ============================== */
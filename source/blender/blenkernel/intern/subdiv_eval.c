@@ -35,9 +35,23 @@
 
 #include "MEM_guardedalloc.h"
 
+#include "opensubdiv_capi_type.h"
 #include "opensubdiv_evaluator_capi.h"
 #include "opensubdiv_topology_refiner_capi.h"
 
+static eOpenSubdivEvaluator opensubdiv_evaluator_from_subdiv_evaluator_type(
+    eSubdivEvaluatorType evaluator_type)
+{
+  switch (evaluator_type) {
+    case SUBDIV_EVALUATOR_TYPE_CPU:
+      return OPENSUBDIV_EVALUATOR_CPU;
+    case SUBDIV_EVALUATOR_TYPE_OPENMP:
+      return OPENSUBDIV_EVALUATOR_OPENMP;
+  }
+  BLI_assert(!"Unknown evaluator type");
+  return OPENSUBDIV_EVALUATOR_CPU;
+}
+
 bool BKE_subdiv_eval_begin(Subdiv *subdiv)
 {
   BKE_subdiv_stats_reset(&subdiv->stats, SUBDIV_STATS_EVALUATOR_CREATE);
@@ -48,7 +62,9 @@ bool BKE_subdiv_eval_begin(Subdiv *subdiv)
   }
   else if (subdiv->evaluator == NULL) {
     BKE_subdiv_stats_begin(&subdiv->stats, SUBDIV_STATS_EVALUATOR_CREATE);
-    subdiv->evaluator = openSubdiv_createEvaluatorFromTopologyRefiner(subdiv->topology_refiner);
+    subdiv->evaluator = openSubdiv_createEvaluatorFromTopologyRefiner(
+        subdiv->topology_refiner,
+        opensubdiv_evaluator_from_subdiv_evaluator_type(subdiv->settings.evaluator_type));
     BKE_subdiv_stats_end(&subdiv->stats, SUBDIV_STATS_EVALUATOR_CREATE);
     if (subdiv->evaluator == NULL) {
       return false;
@@ -273,6 +289,37 @@ void BKE_subdiv_eval_final_point(
   }
 }
 
+/* ============================ Batched queries ============================= */
+
+void BKE_subdiv_eval_limit_points_and_derivatives(Subdiv *subdiv,
+                                                  const OpenSubdiv_PatchCoord *patch_coords,
+                                                  const int num_patch_coords,
+                                                  float (*r_P)[3],
+                                                  float (*r_dPdu)[3],
+                                                  float (*r_dPdv)[3])
+{
+  OpenSubdiv_Evaluator *evaluator = subdiv->evaluator;
+  evaluator->evaluatePatchesLimit(
+      evaluator, patch_coords, num_patch_coords, (float *)r_P, (float *)r_dPdu, (float *)r_dPdv);
+  if (r_dPdu == NULL || r_dPdv == NULL) {
+    return;
+  }
+  /* Step inside of the face where derivatives are zero, same as in
+   * BKE_subdiv_eval_limit_point_and_derivatives(). */
+  for (int i = 0; i < num_patch_coords; i++) {
+    if (is_zero_v3(r_dPdu[i]) || is_zero_v3(r_dPdv[i])) {
+      const OpenSubdiv_PatchCoord *patch_coord = &patch_coords[i];
+      evaluator->evaluateLimit(evaluator,
+                               patch_coord->ptex_face,
+                               patch_coord->u * 0.999f + 0.0005f,
+                               patch_coord->v * 0.999f + 0.0005f,
+                               r_P[i],
+                               r_dPdu[i],
+                               r_dPdv[i]);
+    }
+  }
+}
+
 /* ===================  Patch queries at given resolution =================== */
 
 /* Move buffer forward by a given number of bytes. */
@@ -293,6 +340,62 @@ static void buffer_write_short_value(void **buffer, const short *values_buffer,
   memcpy(*buffer, values_buffer, sizeof(short) * num_values);
 }
 
+/* Limit surface evaluated at all points of the patch grid. */
+typedef struct PatchResolutionEval {
+  int num_points;
+  float (*P)[3];
+  /* Only allocated when derivatives are requested. */
+  float (*dPdu)[3];
+  float (*dPdv)[3];
+} PatchResolutionEval;
+
+/* Evaluates all points of the grid with a single batched query. */
+static void patch_resolution_eval(Subdiv *subdiv,
+                                  const int ptex_face_index,
+                                  const int resolution,
+                                  const bool use_derivatives,
+                                  PatchResolutionEval *r_eval)
+{
+  const int num_points = resolution * resolution;
+  OpenSubdiv_PatchCoord *patch_coords = MEM_malloc_arrayN(
+      num_points, sizeof(*patch_coords), "subdiv patch coords");
+  const float inv_resolution_1 = 1.0f / (float)(resolution - 1);
+  for (int y = 0, i = 0; y < resolution; y++) {
+    const float v = y * inv_resolution_1;
+    for (int x = 0; x < resolution; x++, i++) {
+      patch_coords[i].ptex_face = ptex_face_index;
+      patch_coords[i].u = x * inv_resolution_1;
+      patch_coords[i].v = v;
+    }
+  }
+  r_eval->num_points = num_points;
+  r_eval->P = MEM_malloc_arrayN(num_points, sizeof(*r_eval->P), "subdiv patch P");
+  r_eval->dPdu = NULL;
+  r_eval->dPdv = NULL;
+  if (use_derivatives) {
+    r_eval->dPdu = MEM_malloc_arrayN(num_points, sizeof(*r_eval->dPdu), "subdiv patch dPdu");
+    r_eval->dPdv = MEM_malloc_arrayN(num_points, sizeof(*r_eval->dPdv), "subdiv patch dPdv");
+  }
+  BKE_subdiv_eval_limit_points_and_derivatives(
+      subdiv, patch_coords, num_points, r_eval->P, r_eval->dPdu, r_eval->dPdv);
+  MEM_freeN(patch_coords);
+}
+
+static void patch_resolution_eval_free(PatchResolutionEval *eval)
+{
+  MEM_freeN(eval->P);
+  MEM_SAFE_FREE(eval->dPdu);
+  MEM_SAFE_FREE(eval->dPdv);
+}
+
+static void patch_resolution_eval_normal(const PatchResolutionEval *eval,
+                                         const int point_index,
+                                         float r_N[3])
+{
+  cross_v3_v3v3(r_N, eval->dPdu[point_index], eval->dPdv[point_index]);
+  normalize_v3(r_N);
+}
+
 void BKE_subdiv_eval_limit_patch_resolution_point(Subdiv *subdiv,
                                                   const int ptex_face_index,
                                                   const int resolution,
@@ -300,16 +403,14 @@ void BKE_subdiv_eval_limit_patch_resolution_point(Subdiv *subdiv,
                                                   const int offset,
                                                   const int stride)
 {
+  PatchResolutionEval eval;
+  patch_resolution_eval(subdiv, ptex_face_index, resolution, false, &eval);
   buffer_apply_offset(&buffer, offset);
-  const float inv_resolution_1 = 1.0f / (float)(resolution - 1);
-  for (int y = 0; y < resolution; y++) {
-    const float v = y * inv_resolution_1;
-    for (int x = 0; x < resolution; x++) {
-      const float u = x * inv_resolution_1;
-      BKE_subdiv_eval_limit_point(subdiv, ptex_face_index, u, v, buffer);
-      buffer_apply_offset(&buffer, stride);
-    }
+  for (int i = 0; i < eval.num_points; i++) {
+    buffer_write_float_value(&buffer, eval.P[i], 3);
+    buffer_apply_offset(&buffer, stride);
   }
+  patch_resolution_eval_free(&eval);
 }
 
 void BKE_subdiv_eval_limit_patch_resolution_point_and_derivatives(Subdiv *subdiv,
@@ -325,21 +426,20 @@ void BKE_subdiv_eval_limit_patch_resolution_point_and_derivatives(Subdiv *subdiv
                                                                   const int dv_offset,
                                                                   const int dv_stride)
 {
+  PatchResolutionEval eval;
+  patch_resolution_eval(subdiv, ptex_face_index, resolution, true, &eval);
   buffer_apply_offset(&point_buffer, point_offset);
   buffer_apply_offset(&du_buffer, du_offset);
   buffer_apply_offset(&dv_buffer, dv_offset);
-  const float inv_resolution_1 = 1.0f / (float)(resolution - 1);
-  for (int y = 0; y < resolution; y++) {
-    const float v = y * inv_resolution_1;
-    for (int x = 0; x < resolution; x++) {
-      const float u = x * inv_resolution_1;
-      BKE_subdiv_eval_limit_point_and_derivatives(
-          subdiv, ptex_face_index, u, v, point_buffer, du_buffer, dv_buffer);
-      buffer_apply_offset(&point_buffer, point_stride);
-      buffer_apply_offset(&du_buffer, du_stride);
-      buffer_apply_offset(&dv_buffer, dv_stride);
-    }
+  for (int i = 0; i < eval.num_points; i++) {
+    buffer_write_float_value(&point_buffer, eval.P[i], 3);
+    buffer_write_float_value(&du_buffer, eval.dPdu[i], 3);
+    buffer_write_float_value(&dv_buffer, eval.dPdv[i], 3);
+    buffer_apply_offset(&point_buffer, point_stride);
+    buffer_apply_offset(&du_buffer, du_stride);
+    buffer_apply_offset(&dv_buffer, dv_stride);
   }
+  patch_resolution_eval_free(&eval);
 }
 
 void BKE_subdiv_eval_limit_patch_resolution_point_and_normal(Subdiv *subdiv,
@@ -352,20 +452,19 @@ void BKE_subdiv_eval_limit_patch_resolution_point_and_normal(Subdiv *subdiv,
                                                              const int normal_offset,
                                                              const int normal_stride)
 {
+  PatchResolutionEval eval;
+  patch_resolution_eval(subdiv, ptex_face_index, resolution, true, &eval);
   buffer_apply_offset(&point_buffer, point_offset);
   buffer_apply_offset(&normal_buffer, normal_offset);
-  const float inv_resolution_1 = 1.0f / (float)(resolution - 1);
-  for (int y = 0; y < resolution; y++) {
-    const float v = y * inv_resolution_1;
-    for (int x = 0; x < resolution; x++) {
-      const float u = x * inv_resolution_1;
-      float normal[3];
-      BKE_subdiv_eval_limit_point_and_normal(subdiv, ptex_face_index, u, v, point_buffer, normal);
-      buffer_write_float_value(&normal_buffer, normal, 3);
-      buffer_apply_offset(&point_buffer, point_stride);
-      buffer_apply_offset(&normal_buffer, normal_stride);
-    }
+  for (int i = 0; i < eval.num_points; i++) {
+    float normal[3];
+    patch_resolution_eval_normal(&eval, i, normal);
+    buffer_write_float_value(&point_buffer, eval.P[i], 3);
+    buffer_write_float_value(&normal_buffer, normal, 3);
+    buffer_apply_offset(&point_buffer, point_stride);
+    buffer_apply_offset(&normal_buffer, normal_stride);
   }
+  patch_resolution_eval_free(&eval);
 }
 
 void BKE_subdiv_eval_limit_patch_resolution_point_and_short_normal(Subdiv *subdiv,
@@ -378,19 +477,19 @@ void BKE_subdiv_eval_limit_patch_resolution_point_and_short_normal(Subdiv *subdi
                                                                    const int normal_offset,
                                                                    const int normal_stride)
 {
+  PatchResolutionEval eval;
+  patch_resolution_eval(subdiv, ptex_face_index, resolution, true, &eval);
   buffer_apply_offset(&point_buffer, point_offset);
   buffer_apply_offset(&normal_buffer, normal_offset);
-  const float inv_resolution_1 = 1.0f / (float)(resolution - 1);
-  for (int y = 0; y < resolution; y++) {
-    const float v = y * inv_resolution_1;
-    for (int x = 0; x < resolution; x++) {
-      const float u = x * inv_resolution_1;
-      short normal[3];
-      BKE_subdiv_eval_limit_point_and_short_normal(
-          subdiv, ptex_face_index, u, v, point_buffer, normal);
-      buffer_write_short_value(&normal_buffer, normal, 3);
-      buffer_apply_offset(&point_buffer, point_stride);
-      buffer_apply_offset(&normal_buffer, normal_stride);
-    }
+  for (int i = 0; i < eval.num_points; i++) {
+    float normal_float[3];
+    short normal[3];
+    patch_resolution_eval_normal(&eval, i, normal_float);
+    normal_float_to_short_v3(normal, normal_float);
+    buffer_write_float_value(&point_buffer, eval.P[i], 3);
+    buffer_write_short_value(&normal_buffer, normal, 3);
+    buffer_apply_offset(&point_buffer, point_stride);
+    buffer_apply_offset(&normal_buffer, normal_stride);
   }
+  patch_resolution_eval_free(&eval);
 }
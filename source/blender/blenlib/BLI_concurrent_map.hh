@@ -0,0 +1,244 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __BLI_CONCURRENT_MAP_HH__
+#define __BLI_CONCURRENT_MAP_HH__
+
+/** \file
+ * \ingroup bli
+ *
+ * A map that can be modified from multiple threads at the same time.
+ *
+ * The keys are split over a fixed number of shards, each shard being a regular #BLI::Map
+ * protected by its own mutex. The shard is chosen from the high bits of the (re-mixed) hash,
+ * so threads adding different keys rarely wait on each other, while the lookups within a shard
+ * stay as fast as with a single-threaded map.
+ *
+ * Since a shard can grow while another thread holds a reference into it, values are returned by
+ * copy, and modifications happen in callbacks that run while the shard is locked.
+ * Iteration is only allowed while no other thread modifies the map.
+ */
+
+#include <mutex>
+
+#include "BLI_map.hh"
+#include "BLI_task.h"
+
+namespace BLI {
+
+template<typename KeyT,
+         typename ValueT,
+         uint ShardsExponent = 6,
+         typename Allocator = GuardedAllocator>
+class ConcurrentMap {
+ private:
+  BLI_STATIC_ASSERT(ShardsExponent > 0 && ShardsExponent <= 16, "");
+
+  static constexpr uint s_shards_len = 1u << ShardsExponent;
+
+  /* Each shard on its own cache line, to avoid false sharing of the locks. */
+  struct alignas(64) Shard {
+    std::mutex mutex;
+    Map<KeyT, ValueT, 4, Allocator> map;
+  };
+
+  Shard *m_shards;
+
+ public:
+  ConcurrentMap()
+  {
+    m_shards = (Shard *)MEM_mallocN_aligned(sizeof(Shard) * s_shards_len, alignof(Shard), AT);
+    for (uint i = 0; i < s_shards_len; i++) {
+      new (&m_shards[i]) Shard();
+    }
+  }
+
+  ~ConcurrentMap()
+  {
+    for (uint i = 0; i < s_shards_len; i++) {
+      m_shards[i].~Shard();
+    }
+    MEM_freeN(m_shards);
+  }
+
+  ConcurrentMap(const ConcurrentMap &other) = delete;
+  ConcurrentMap &operator=(const ConcurrentMap &other) = delete;
+
+  /**
+   * Allocate memory such that at least min_usable_slots can be added before any shard has to
+   * grow, assuming the keys are distributed evenly. Not thread-safe.
+   */
+  void reserve(uint min_usable_slots)
+  {
+    const uint shard_slots = min_usable_slots / s_shards_len + 1;
+    for (uint i = 0; i < s_shards_len; i++) {
+      m_shards[i].map.reserve(shard_slots);
+    }
+  }
+
+  /**
+   * Remove all elements from the map. Not thread-safe.
+   */
+  void clear()
+  {
+    for (uint i = 0; i < s_shards_len; i++) {
+      m_shards[i].map.clear();
+    }
+  }
+
+  /**
+   * Insert a new key-value-pair in the map if the key does not exist yet.
+   * Returns true when the pair was newly inserted.
+   */
+  bool add(const KeyT &key, const ValueT &value)
+  {
+    Shard &shard = this->shard_for_key(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    return shard.map.add(key, value);
+  }
+
+  /**
+   * Remove the key from the map.
+   * Returns true when the key existed.
+   */
+  bool remove(const KeyT &key)
+  {
+    Shard &shard = this->shard_for_key(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if (!shard.map.contains(key)) {
+      return false;
+    }
+    shard.map.remove(key);
+    return true;
+  }
+
+  /**
+   * Returns true when the key exists in the map.
+   */
+  bool contains(const KeyT &key) const
+  {
+    Shard &shard = this->shard_for_key(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    return shard.map.contains(key);
+  }
+
+  /**
+   * Return a copy of the value that corresponds to the key,
+   * or the given default value when the key does not exist.
+   */
+  ValueT lookup_default(const KeyT &key, ValueT default_value) const
+  {
+    Shard &shard = this->shard_for_key(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    return shard.map.lookup_default(key, std::move(default_value));
+  }
+
+  /**
+   * Return a copy of the value that corresponds to the key.
+   * If it does not exist yet, create and insert it first. When multiple threads add the same key
+   * at the same time, only one of them calls create_value and all get the same value back.
+   */
+  template<typename CreateValueF>
+  ValueT lookup_or_add(const KeyT &key, const CreateValueF &create_value)
+  {
+    Shard &shard = this->shard_for_key(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    return shard.map.lookup_or_add(key, create_value);
+  }
+
+  /**
+   * See #Map::add_or_modify, the callbacks are called while the key is locked.
+   * They must not access the map themselves.
+   */
+  template<typename CreateValueF, typename ModifyValueF>
+  auto add_or_modify(const KeyT &key,
+                     const CreateValueF &create_value,
+                     const ModifyValueF &modify_value) -> decltype(create_value(nullptr))
+  {
+    Shard &shard = this->shard_for_key(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    return shard.map.add_or_modify(key, create_value, modify_value);
+  }
+
+  /**
+   * Get the number of elements in the map.
+   * Only exact when no other thread modifies the map.
+   */
+  uint32_t size() const
+  {
+    uint32_t size = 0;
+    for (uint i = 0; i < s_shards_len; i++) {
+      size += m_shards[i].map.size();
+    }
+    return size;
+  }
+
+  bool is_empty() const
+  {
+    return this->size() == 0;
+  }
+
+  /**
+   * Calls the given function for each key-value-pair. Not thread-safe.
+   */
+  template<typename FuncT> void foreach_item(const FuncT &func) const
+  {
+    for (uint i = 0; i < s_shards_len; i++) {
+      m_shards[i].map.foreach_item(func);
+    }
+  }
+
+  /**
+   * Calls the given function for each key-value-pair, with shards split over multiple threads.
+   * The map must not be modified while this runs.
+   */
+  template<typename FuncT> void parallel_foreach_item(const FuncT &func) const
+  {
+    struct ParallelData {
+      const ConcurrentMap *map;
+      const FuncT *func;
+    } data = {this, &func};
+
+    TaskParallelSettings settings;
+    BLI_parallel_range_settings_defaults(&settings);
+    settings.min_iter_per_thread = 1;
+    BLI_task_parallel_range(
+        0,
+        (int)s_shards_len,
+        &data,
+        [](void *__restrict userdata,
+           const int shard_index,
+           const TaskParallelTLS *__restrict UNUSED(tls)) {
+          const ParallelData *data = (const ParallelData *)userdata;
+          data->map->m_shards[shard_index].map.foreach_item(*data->func);
+        },
+        &settings);
+  }
+
+ private:
+  Shard &shard_for_key(const KeyT &key) const
+  {
+    const uint32_t hash = DefaultHash<KeyT>{}(key);
+    /* The map in the shard uses the low bits of the hash, use the high bits of a mixed hash here
+     * so keys within a shard are still spread over the whole table. */
+    const uint32_t shard_index = (hash * 2654435761u) >> (32 - ShardsExponent);
+    return m_shards[shard_index];
+  }
+};
+
+}  // namespace BLI
+
+#endif /* __BLI_CONCURRENT_MAP_HH__ */
@@ -0,0 +1,203 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __BLI_CONCURRENT_SET_HH__
+#define __BLI_CONCURRENT_SET_HH__
+
+/** \file
+ * \ingroup bli
+ *
+ * A set that can be modified from multiple threads at the same time,
+ * e.g. to de-duplicate elements found by a parallel loop.
+ *
+ * Like #BLI::ConcurrentMap, the values are split over shards that are regular #BLI::Set's
+ * protected by their own mutex. Iteration is only allowed while no other thread modifies
+ * the set.
+ */
+
+#include <mutex>
+
+#include "BLI_set.hh"
+#include "BLI_task.h"
+
+namespace BLI {
+
+template<typename T, uint ShardsExponent = 6, typename Allocator = GuardedAllocator>
+class ConcurrentSet {
+ private:
+  BLI_STATIC_ASSERT(ShardsExponent > 0 && ShardsExponent <= 16, "");
+
+  static constexpr uint s_shards_len = 1u << ShardsExponent;
+
+  /* Each shard on its own cache line, to avoid false sharing of the locks. */
+  struct alignas(64) Shard {
+    std::mutex mutex;
+    Set<T, 4, Allocator> set;
+  };
+
+  Shard *m_shards;
+
+ public:
+  ConcurrentSet()
+  {
+    m_shards = (Shard *)MEM_mallocN_aligned(sizeof(Shard) * s_shards_len, alignof(Shard), AT);
+    for (uint i = 0; i < s_shards_len; i++) {
+      new (&m_shards[i]) Shard();
+    }
+  }
+
+  ~ConcurrentSet()
+  {
+    for (uint i = 0; i < s_shards_len; i++) {
+      m_shards[i].~Shard();
+    }
+    MEM_freeN(m_shards);
+  }
+
+  ConcurrentSet(const ConcurrentSet &other) = delete;
+  ConcurrentSet &operator=(const ConcurrentSet &other) = delete;
+
+  /**
+   * Make the set large enough to hold the given amount of elements,
+   * assuming they are distributed evenly over the shards. Not thread-safe.
+   */
+  void reserve(uint32_t min_usable_slots)
+  {
+    const uint32_t shard_slots = min_usable_slots / s_shards_len + 1;
+    for (uint i = 0; i < s_shards_len; i++) {
+      m_shards[i].set.reserve(shard_slots);
+    }
+  }
+
+  /**
+   * Remove all elements from the set. Not thread-safe.
+   */
+  void clear()
+  {
+    for (uint i = 0; i < s_shards_len; i++) {
+      m_shards[i].set.clear();
+    }
+  }
+
+  /**
+   * Add a new value to the set if it does not exist yet.
+   * Returns true of the value has been newly added. When multiple threads add the same value at
+   * the same time, exactly one of them gets true.
+   */
+  bool add(const T &value)
+  {
+    Shard &shard = this->shard_for_value(value);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    return shard.set.add(value);
+  }
+
+  /**
+   * Remove the value from the set.
+   * Returns true when the value existed.
+   */
+  bool remove(const T &value)
+  {
+    Shard &shard = this->shard_for_value(value);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if (!shard.set.contains(value)) {
+      return false;
+    }
+    shard.set.remove(value);
+    return true;
+  }
+
+  /**
+   * Returns true when the value is in the set, otherwise false.
+   */
+  bool contains(const T &value) const
+  {
+    Shard &shard = this->shard_for_value(value);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    return shard.set.contains(value);
+  }
+
+  /**
+   * Get the amount of values stored in the set.
+   * Only exact when no other thread modifies the set.
+   */
+  uint32_t size() const
+  {
+    uint32_t size = 0;
+    for (uint i = 0; i < s_shards_len; i++) {
+      size += m_shards[i].set.size();
+    }
+    return size;
+  }
+
+  bool is_empty() const
+  {
+    return this->size() == 0;
+  }
+
+  /**
+   * Calls the given function for each value. Not thread-safe.
+   */
+  template<typename FuncT> void foreach_value(const FuncT &func) const
+  {
+    for (uint i = 0; i < s_shards_len; i++) {
+      for (const T &value : m_shards[i].set) {
+        func(value);
+      }
+    }
+  }
+
+  /**
+   * Calls the given function for each value, with shards split over multiple threads.
+   * The set must not be modified while this runs.
+   */
+  template<typename FuncT> void parallel_foreach_value(const FuncT &func) const
+  {
+    struct ParallelData {
+      const ConcurrentSet *set;
+      const FuncT *func;
+    } data = {this, &func};
+
+    TaskParallelSettings settings;
+    BLI_parallel_range_settings_defaults(&settings);
+    settings.min_iter_per_thread = 1;
+    BLI_task_parallel_range(
+        0,
+        (int)s_shards_len,
+        &data,
+        [](void *__restrict userdata,
+           const int shard_index,
+           const TaskParallelTLS *__restrict UNUSED(tls)) {
+          const ParallelData *data = (const ParallelData *)userdata;
+          for (const T &value : data->set->m_shards[shard_index].set) {
+            (*data->func)(value);
+          }
+        },
+        &settings);
+  }
+
+ private:
+  Shard &shard_for_value(const T &value) const
+  {
+    const uint32_t hash = DefaultHash<T>{}(value);
+    /* See #ConcurrentMap::shard_for_key. */
+    const uint32_t shard_index = (hash * 2654435761u) >> (32 - ShardsExponent);
+    return m_shards[shard_index];
+  }
+};
+
+}  // namespace BLI
+
+#endif /* __BLI_CONCURRENT_SET_HH__ */
@@ -0,0 +1,74 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup bli
+ *
+ * Gzip files made of independently compressed frames.
+ *
+ * The data is split into frames of a fixed size, each stored as a separate gzip member.
+ * The header of every member has an extra field with the compressed and uncompressed size of
+ * the frame, so frames can be located without decompressing anything. This allows to compress
+ * and decompress frames in parallel, and to seek in the file.
+ *
+ * The result is a regular gzip file (members are concatenated as allowed by RFC 1952), which any
+ * gzip reader can decompress as a whole.
+ */
+
+#ifndef __BLI_GZIP_FRAMES_H__
+#define __BLI_GZIP_FRAMES_H__
+
+#include "BLI_compiler_attrs.h"
+#include "BLI_utildefines.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct BLI_mmap_file;
+
+typedef struct GzipFramesWriter GzipFramesWriter;
+typedef struct GzipFramesReader GzipFramesReader;
+
+/* Write compressed frames to an opened file, level is the zlib compression level.
+ * The file descriptor is not closed by the writer. */
+GzipFramesWriter *BLI_gzip_frames_writer_new(int fd, int level) ATTR_WARN_UNUSED_RESULT;
+bool BLI_gzip_frames_writer_write(GzipFramesWriter *writer, const void *data, size_t length)
+    ATTR_NONNULL(1, 2);
+/* Write the remaining data and free the writer, returns false if any write failed. */
+bool BLI_gzip_frames_writer_free(GzipFramesWriter *writer) ATTR_NONNULL(1);
+
+/* Returns NULL when the mapped file is not made of gzip frames (e.g. a file written by any other
+ * gzip writer), such files can only be read sequentially by zlib.
+ * The mapping needs to stay valid as long as the reader is used. */
+GzipFramesReader *BLI_gzip_frames_reader_new(struct BLI_mmap_file *file) ATTR_WARN_UNUSED_RESULT
+    ATTR_NONNULL(1);
+/* Copy a range of the decompressed data to dest. Returns false when the range is out of bounds,
+ * or when reading or decompressing failed. */
+bool BLI_gzip_frames_reader_read(GzipFramesReader *reader,
+                                 void *dest,
+                                 size_t offset,
+                                 size_t length) ATTR_WARN_UNUSED_RESULT ATTR_NONNULL(1);
+/* Length of the decompressed data. */
+size_t BLI_gzip_frames_reader_length(const GzipFramesReader *reader) ATTR_WARN_UNUSED_RESULT
+    ATTR_NONNULL(1);
+void BLI_gzip_frames_reader_free(GzipFramesReader *reader) ATTR_NONNULL(1);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __BLI_GZIP_FRAMES_H__ */
@@ -44,6 +44,22 @@ uint32_t BLI_hash_mm2a_end(BLI_HashMurmur2A *mm2);
 
 uint32_t BLI_hash_mm2(const unsigned char *data, size_t len, uint32_t seed);
 
+typedef struct BLI_HashMurmur64A {
+  uint64_t hash;
+  uint64_t tail;
+  uint64_t size;
+  uint32_t count;
+  uint32_t _pad;
+} BLI_HashMurmur64A;
+
+void BLI_hash_mm64a_init(BLI_HashMurmur64A *mm64, uint64_t seed);
+
+void BLI_hash_mm64a_add(BLI_HashMurmur64A *mm64, const unsigned char *data, size_t len);
+
+void BLI_hash_mm64a_add_int(BLI_HashMurmur64A *mm64, int data);
+
+uint64_t BLI_hash_mm64a_end(BLI_HashMurmur64A *mm64);
+
 #ifdef __cplusplus
 }
 #endif
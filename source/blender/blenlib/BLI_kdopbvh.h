@@ -97,11 +97,21 @@ enum {
 enum {
   /* Use a priority queue to process nodes in the optimal order (for slow callbacks) */
   BVH_NEAREST_OPTIMAL_ORDER = (1 << 0),
+  /* Batch queries only: start from the result of the previous (nearby) query,
+   * only valid when the callback sets `co` to a point on the primitive. */
+  BVH_NEAREST_USE_PREVIOUS = (1 << 1),
 };
 enum {
   /* calculate IsectRayPrecalc data */
   BVH_RAYCAST_WATERTIGHT = (1 << 0),
 };
+enum {
+  /* Choose splits using the surface area heuristic (slower to build, faster to query). */
+  BVH_BUILD_SAH = (1 << 0),
+  /* Store a flattened copy of the tree with wide nodes,
+   * used by ray-cast & find-nearest to test all children of a node at once. */
+  BVH_BUILD_PACKED = (1 << 1),
+};
 #define BVH_RAYCAST_DEFAULT (BVH_RAYCAST_WATERTIGHT)
 #define BVH_RAYCAST_DIST_MAX (FLT_MAX / 2.0f)
 
@@ -131,6 +141,10 @@ typedef void (*BVHTree_NearestProjectedCallback)(void *userdata,
                                                  const int clip_plane_len,
                                                  BVHTreeNearest *nearest);
 
+/* callback to BLI_bvhtree_refit: fill in the points of a leaf, returns the number of points */
+#define BVH_REFIT_LEAF_POINTS_MAX 4
+typedef int (*BVHTree_RefitLeafCallback)(void *userdata, int index, float (*r_co)[3]);
+
 /* callbacks to BLI_bvhtree_walk_dfs */
 /* return true to traverse into this nodes children, else skip. */
 typedef bool (*BVHTree_WalkParentCallback)(const BVHTreeAxisRange *bounds, void *userdata);
@@ -143,6 +157,7 @@ typedef bool (*BVHTree_WalkOrderCallback)(const BVHTreeAxisRange *bounds,
                                           char axis,
                                           void *userdata);
 
+BVHTree *BLI_bvhtree_new_ex(int maxsize, float epsilon, char tree_type, char axis, int flag);
 BVHTree *BLI_bvhtree_new(int maxsize, float epsilon, char tree_type, char axis);
 void BLI_bvhtree_free(BVHTree *tree);
 
@@ -154,6 +169,9 @@ void BLI_bvhtree_balance(BVHTree *tree);
 bool BLI_bvhtree_update_node(
     BVHTree *tree, int index, const float co[3], const float co_moving[3], int numpoints);
 void BLI_bvhtree_update_tree(BVHTree *tree);
+/* refit all leafs (by their index) and branches, without changing the topology */
+void BLI_bvhtree_refit(BVHTree *tree, BVHTree_RefitLeafCallback callback, void *userdata);
+float BLI_bvhtree_get_refit_quality(const BVHTree *tree);
 
 int BLI_bvhtree_overlap_thread_num(const BVHTree *tree);
 
@@ -231,6 +249,24 @@ void BLI_bvhtree_ray_cast_all(BVHTree *tree,
                               BVHTree_RayCastCallback callback,
                               void *userdata);
 
+/* batch queries: sorted for coherence and run in parallel (callbacks must be thread-safe) */
+void BLI_bvhtree_find_nearest_batch(BVHTree *tree,
+                                    const float (*co)[3],
+                                    const int co_len,
+                                    BVHTreeNearest *nearest,
+                                    BVHTree_NearestPointCallback callback,
+                                    void *userdata,
+                                    int flag);
+void BLI_bvhtree_ray_cast_batch(BVHTree *tree,
+                                const float (*co)[3],
+                                const float (*dir)[3],
+                                const int rays_len,
+                                float radius,
+                                BVHTreeRayHit *hit,
+                                BVHTree_RayCastCallback callback,
+                                void *userdata,
+                                int flag);
+
 float BLI_bvhtree_bb_raycast(const float bv[6],
                              const float light_start[3],
                              const float light_end[3],
@@ -59,6 +59,14 @@ void *BLI_mempool_as_arrayN(BLI_mempool *pool,
                             const char *allocstr) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT
     ATTR_NONNULL(1, 2);
 
+void *BLI_mempool_alloc_threadsafe(BLI_mempool *pool, const int thread_id) ATTR_MALLOC
+    ATTR_WARN_UNUSED_RESULT ATTR_NONNULL(1);
+void *BLI_mempool_calloc_threadsafe(BLI_mempool *pool, const int thread_id) ATTR_MALLOC
+    ATTR_WARN_UNUSED_RESULT ATTR_NONNULL(1);
+void BLI_mempool_free_threadsafe(BLI_mempool *pool, void *addr, const int thread_id)
+    ATTR_NONNULL(1, 2);
+void BLI_mempool_threadsafe_sync(BLI_mempool *pool) ATTR_NONNULL(1);
+
 #ifndef NDEBUG
 void BLI_mempool_set_memory_debug(void);
 #endif
@@ -84,6 +92,9 @@ enum {
    * order of allocation when no chunks have been freed.
    */
   BLI_MEMPOOL_ALLOW_ITER = (1 << 0),
+  /** allow allocating and freeing from multiple threads,
+   * see #BLI_mempool_alloc_threadsafe. */
+  BLI_MEMPOOL_CONCURRENT = (1 << 1),
 };
 
 void BLI_mempool_iternew(BLI_mempool *pool, BLI_mempool_iter *iter) ATTR_NONNULL();
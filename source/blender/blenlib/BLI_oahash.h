@@ -0,0 +1,229 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __BLI_OAHASH_H__
+#define __BLI_OAHASH_H__
+
+/** \file
+ * \ingroup bli
+ *
+ * OAHash is a hash-map using open addressing, with the same interface as #GHash.
+ *
+ * Keys and values are stored inline in the table instead of in separately allocated entries,
+ * and slots are probed in groups of 16 (using SSE2 when available), comparing a few bits of
+ * the hash before calling the comparison function. This avoids most of the pointer chasing
+ * of #GHash, so call sites can switch over by replacing the ``BLI_ghash_`` prefix.
+ *
+ * Differences with #GHash:
+ * - Pointers returned by #BLI_oahash_lookup_p and #BLI_oahash_ensure_p
+ *   are only valid until the next insertion.
+ * - Removing entries while iterating is supported, inserting is not.
+ *
+ * #OASet is the 'set' counterpart (see #GSet).
+ */
+
+#include "BLI_compiler_attrs.h"
+#include "BLI_ghash.h"
+#include "BLI_sys_types.h" /* for bool */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct OAHash OAHash;
+
+typedef struct OAHashIterator {
+  OAHash *oh;
+  unsigned int slot;
+  unsigned int slots_len;
+} OAHashIterator;
+
+typedef struct OAHashIterState {
+  unsigned int slot;
+} OAHashIterState;
+
+/** \name OAHash API
+ *
+ * Defined in ``BLI_oahash.cc``
+ * \{ */
+
+OAHash *BLI_oahash_new_ex(GHashHashFP hashfp,
+                          GHashCmpFP cmpfp,
+                          const char *info,
+                          const unsigned int nentries_reserve) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+OAHash *BLI_oahash_new(GHashHashFP hashfp,
+                       GHashCmpFP cmpfp,
+                       const char *info) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+OAHash *BLI_oahash_copy(OAHash *oh,
+                        GHashKeyCopyFP keycopyfp,
+                        GHashValCopyFP valcopyfp) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+void BLI_oahash_free(OAHash *oh, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp);
+void BLI_oahash_reserve(OAHash *oh, const unsigned int nentries_reserve);
+void BLI_oahash_insert(OAHash *oh, void *key, void *val);
+bool BLI_oahash_reinsert(
+    OAHash *oh, void *key, void *val, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp);
+void *BLI_oahash_replace_key(OAHash *oh, void *key);
+void *BLI_oahash_lookup(OAHash *oh, const void *key) ATTR_WARN_UNUSED_RESULT;
+void *BLI_oahash_lookup_default(OAHash *oh,
+                                const void *key,
+                                void *val_default) ATTR_WARN_UNUSED_RESULT;
+void **BLI_oahash_lookup_p(OAHash *oh, const void *key) ATTR_WARN_UNUSED_RESULT;
+bool BLI_oahash_ensure_p(OAHash *oh, void *key, void ***r_val) ATTR_WARN_UNUSED_RESULT;
+bool BLI_oahash_ensure_p_ex(OAHash *oh, const void *key, void ***r_key, void ***r_val)
+    ATTR_WARN_UNUSED_RESULT;
+bool BLI_oahash_remove(OAHash *oh,
+                       const void *key,
+                       GHashKeyFreeFP keyfreefp,
+                       GHashValFreeFP valfreefp);
+void BLI_oahash_clear(OAHash *oh, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp);
+void BLI_oahash_clear_ex(OAHash *oh,
+                         GHashKeyFreeFP keyfreefp,
+                         GHashValFreeFP valfreefp,
+                         const unsigned int nentries_reserve);
+void *BLI_oahash_popkey(OAHash *oh,
+                        const void *key,
+                        GHashKeyFreeFP keyfreefp) ATTR_WARN_UNUSED_RESULT;
+bool BLI_oahash_haskey(OAHash *oh, const void *key) ATTR_WARN_UNUSED_RESULT;
+bool BLI_oahash_pop(OAHash *oh, OAHashIterState *state, void **r_key, void **r_val)
+    ATTR_WARN_UNUSED_RESULT;
+unsigned int BLI_oahash_len(OAHash *oh) ATTR_WARN_UNUSED_RESULT;
+
+/** \} */
+
+/** \name OAHash Iterator
+ * \{ */
+
+void BLI_oahashIterator_init(OAHashIterator *ohi, OAHash *oh);
+void BLI_oahashIterator_step(OAHashIterator *ohi);
+void *BLI_oahashIterator_getKey(OAHashIterator *ohi) ATTR_WARN_UNUSED_RESULT;
+void *BLI_oahashIterator_getValue(OAHashIterator *ohi) ATTR_WARN_UNUSED_RESULT;
+void **BLI_oahashIterator_getValue_p(OAHashIterator *ohi) ATTR_WARN_UNUSED_RESULT;
+
+BLI_INLINE bool BLI_oahashIterator_done(OAHashIterator *ohi)
+{
+  return ohi->slot == ohi->slots_len;
+}
+
+#define OAHASH_ITER(oh_iter_, oahash_) \
+  for (BLI_oahashIterator_init(&oh_iter_, oahash_); BLI_oahashIterator_done(&oh_iter_) == false; \
+       BLI_oahashIterator_step(&oh_iter_))
+
+#define OAHASH_ITER_INDEX(oh_iter_, oahash_, i_) \
+  for (BLI_oahashIterator_init(&oh_iter_, oahash_), i_ = 0; \
+       BLI_oahashIterator_done(&oh_iter_) == false; \
+       BLI_oahashIterator_step(&oh_iter_), i_++)
+
+/** \} */
+
+/** \name OASet API
+ *
+ * An #OAHash without value storage.
+ * \{ */
+
+typedef struct OASet OASet;
+
+typedef OAHashIterState OASetIterState;
+
+OASet *BLI_oaset_new_ex(GSetHashFP hashfp,
+                        GSetCmpFP cmpfp,
+                        const char *info,
+                        const unsigned int nentries_reserve) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+OASet *BLI_oaset_new(GSetHashFP hashfp,
+                     GSetCmpFP cmpfp,
+                     const char *info) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+OASet *BLI_oaset_copy(OASet *os, GSetKeyCopyFP keycopyfp) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+unsigned int BLI_oaset_len(OASet *os) ATTR_WARN_UNUSED_RESULT;
+void BLI_oaset_free(OASet *os, GSetKeyFreeFP keyfreefp);
+void BLI_oaset_reserve(OASet *os, const unsigned int nentries_reserve);
+void BLI_oaset_insert(OASet *os, void *key);
+bool BLI_oaset_add(OASet *os, void *key);
+bool BLI_oaset_ensure_p_ex(OASet *os, const void *key, void ***r_key);
+bool BLI_oaset_reinsert(OASet *os, void *key, GSetKeyFreeFP keyfreefp);
+void *BLI_oaset_replace_key(OASet *os, void *key);
+bool BLI_oaset_haskey(OASet *os, const void *key) ATTR_WARN_UNUSED_RESULT;
+bool BLI_oaset_pop(OASet *os, OASetIterState *state, void **r_key) ATTR_WARN_UNUSED_RESULT;
+bool BLI_oaset_remove(OASet *os, const void *key, GSetKeyFreeFP keyfreefp);
+void BLI_oaset_clear_ex(OASet *os, GSetKeyFreeFP keyfreefp, const unsigned int nentries_reserve);
+void BLI_oaset_clear(OASet *os, GSetKeyFreeFP keyfreefp);
+void *BLI_oaset_lookup(OASet *os, const void *key) ATTR_WARN_UNUSED_RESULT;
+void *BLI_oaset_pop_key(OASet *os, const void *key) ATTR_WARN_UNUSED_RESULT;
+
+/** \} */
+
+/** \name OASet Iterator
+ * \{ */
+
+/* so we can cast but compiler sees as different */
+typedef struct OASetIterator {
+  OAHashIterator _ohi
+#ifdef __GNUC__
+      __attribute__((deprecated))
+#endif
+      ;
+} OASetIterator;
+
+BLI_INLINE void BLI_oasetIterator_init(OASetIterator *osi, OASet *os)
+{
+  BLI_oahashIterator_init((OAHashIterator *)osi, (OAHash *)os);
+}
+BLI_INLINE void *BLI_oasetIterator_getKey(OASetIterator *osi)
+{
+  return BLI_oahashIterator_getKey((OAHashIterator *)osi);
+}
+BLI_INLINE void BLI_oasetIterator_step(OASetIterator *osi)
+{
+  BLI_oahashIterator_step((OAHashIterator *)osi);
+}
+BLI_INLINE bool BLI_oasetIterator_done(OASetIterator *osi)
+{
+  return BLI_oahashIterator_done((OAHashIterator *)osi);
+}
+
+#define OASET_ITER(os_iter_, oaset_) \
+  for (BLI_oasetIterator_init(&os_iter_, oaset_); BLI_oasetIterator_done(&os_iter_) == false; \
+       BLI_oasetIterator_step(&os_iter_))
+
+/** \} */
+
+/** \name Convenience OAHash/OASet Creation Functions
+ * \{ */
+
+OAHash *BLI_oahash_ptr_new_ex(const char *info, const unsigned int nentries_reserve)
+    ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+OAHash *BLI_oahash_ptr_new(const char *info) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+OAHash *BLI_oahash_str_new_ex(const char *info, const unsigned int nentries_reserve)
+    ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+OAHash *BLI_oahash_str_new(const char *info) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+OAHash *BLI_oahash_int_new_ex(const char *info, const unsigned int nentries_reserve)
+    ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+OAHash *BLI_oahash_int_new(const char *info) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+
+OASet *BLI_oaset_ptr_new_ex(const char *info,
+                            const unsigned int nentries_reserve) ATTR_MALLOC
+    ATTR_WARN_UNUSED_RESULT;
+OASet *BLI_oaset_ptr_new(const char *info) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+OASet *BLI_oaset_str_new_ex(const char *info,
+                            const unsigned int nentries_reserve) ATTR_MALLOC
+    ATTR_WARN_UNUSED_RESULT;
+OASet *BLI_oaset_str_new(const char *info) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+
+/** \} */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __BLI_OAHASH_H__ */
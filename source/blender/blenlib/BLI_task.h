@@ -166,6 +166,12 @@ typedef struct TaskParallelSettings {
    * having a global use_threading switch based on just range size.
    */
   int min_iter_per_thread;
+  /* Measure the time spent per iteration and use it to choose the chunk size,
+   * for ranges where iterations are expensive or have very uneven costs.
+   * The measurements are kept per range function (see #TaskParallelRangeStats),
+   * #min_iter_per_thread is still used as the minimum chunk size.
+   */
+  bool use_adaptive_grain_size;
 } TaskParallelSettings;
 
 BLI_INLINE void BLI_parallel_range_settings_defaults(TaskParallelSettings *settings);
@@ -176,6 +182,29 @@ void BLI_task_parallel_range(const int start,
                              TaskParallelRangeFunc func,
                              const TaskParallelSettings *settings);
 
+/* Statistics of #BLI_task_parallel_range per call site (identified by the range function).
+ * Always recorded for ranges using adaptive grain size, for other ranges only while profiling
+ * is enabled. Useful to find ranges which are under-parallelized (low `time_busy / time_wall`).
+ */
+typedef struct TaskParallelRangeStats {
+  TaskParallelRangeFunc func;
+  uint64_t calls;
+  uint64_t iterations;
+  /* Number of chunks the ranges were split into. */
+  uint64_t chunks;
+  /* Time spent in the range function summed over all threads, in seconds. */
+  double time_busy;
+  /* Time spent in #BLI_task_parallel_range, in seconds. */
+  double time_wall;
+  /* Chunk size used by the last call. */
+  int grain_size;
+} TaskParallelRangeStats;
+
+void BLI_task_parallel_range_profile_enable(const bool enable);
+int BLI_task_parallel_range_stats_get(TaskParallelRangeStats **r_stats);
+void BLI_task_parallel_range_stats_clear(void);
+void BLI_task_parallel_range_stats_print(void);
+
 /* This data is shared between all tasks, its access needs thread lock or similar protection.
  */
 typedef struct TaskParallelIteratorStateShared {
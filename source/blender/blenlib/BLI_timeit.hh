@@ -54,6 +54,38 @@ class ScopedTimer {
   }
 };
 
+/**
+ * Call the function multiple times and return the duration of the fastest run.
+ * The fastest run is the one least disturbed by other processes, which makes it the most stable
+ * value to compare between benchmark runs.
+ *
+ * \a setup and \a teardown are called before and after every run, without being timed.
+ */
+template<typename SetupT, typename FuncT, typename TeardownT>
+Nanoseconds measure_min(const SetupT &setup,
+                        const FuncT &func,
+                        const TeardownT &teardown,
+                        uint runs = 5)
+{
+  Nanoseconds duration_min = Nanoseconds::max();
+  for (uint i = 0; i < runs; i++) {
+    setup();
+    TimePoint start = Clock::now();
+    func();
+    TimePoint end = Clock::now();
+    teardown();
+    if (end - start < duration_min) {
+      duration_min = end - start;
+    }
+  }
+  return duration_min;
+}
+
+template<typename FuncT> Nanoseconds measure_min(const FuncT &func, uint runs = 5)
+{
+  return measure_min([]() {}, func, []() {}, runs);
+}
+
 }  // namespace Timeit
 }  // namespace BLI
 
@@ -36,10 +36,21 @@
  *   #BLI_bvhtree_overlap, #BVHOverlapData_Shared, #BVHOverlapData_Thread
  * - Range Query:
  *   #BLI_bvhtree_range_query
+ *
+ * Optionally (see #BLI_bvhtree_new_ex):
+ *
+ * - Surface area heuristic build:
+ *   #BVH_BUILD_SAH, #bvh_sah_div_nodes
+ * - Flattened wide nodes, used by ray-cast & find-nearest:
+ *   #BVH_BUILD_PACKED, #BVHPackedNode
  */
 
 #include <assert.h>
 
+#ifdef __SSE2__
+#  include <emmintrin.h>
+#endif
+
 #include "MEM_guardedalloc.h"
 
 #include "BLI_alloca.h"
@@ -72,6 +83,12 @@
 #  define KDOPBVH_THREAD_LEAF_THRESHOLD 1024
 #endif
 
+/* Number of bins per axis used to evaluate split candidates for #BVH_BUILD_SAH. */
+#define BVH_SAH_BINS 16
+
+/* Number of children stored in a #BVHPackedNode (processed 4 at a time with SSE). */
+#define BVH_PACKED_WIDTH 8
+
 /* -------------------------------------------------------------------- */
 /** \name Struct Definitions
  * \{ */
@@ -90,23 +107,51 @@ typedef struct BVHNode {
   char main_axis; /* Axis used to split this node */
 } BVHNode;
 
-/* keep under 26 bytes for speed purposes */
+/* Values for #BVHPackedNode.child that don't reference another packed node. */
+enum {
+  BVH_PACKED_LEAF = -1,
+  BVH_PACKED_EMPTY = -2,
+};
+
+/**
+ * Flattened copy of a branch and (some of) its descendants, see #BVH_BUILD_PACKED.
+ *
+ * Bounds are stored as struct-of-arrays so the x/y/z bounds of all children
+ * can be tested together, only the first 3 k-dop axes are stored (the AABB).
+ */
+typedef struct BVHPackedNode {
+  /** min/max of each child: `{min_x, max_x, min_y, max_y, min_z, max_z}`. */
+  float bv[6][BVH_PACKED_WIDTH];
+  /** Index of a child packed node, #BVH_PACKED_LEAF or #BVH_PACKED_EMPTY. */
+  int child[BVH_PACKED_WIDTH];
+  /** Leaf index (as passed to #BLI_bvhtree_insert), only used for #BVH_PACKED_LEAF. */
+  int index[BVH_PACKED_WIDTH];
+} BVHPackedNode;
+
+/* Keep whole cache-lines. */
+BLI_STATIC_ASSERT((sizeof(BVHPackedNode) % 64) == 0, "not a multiple of the cache-line size")
+
 struct BVHTree {
   BVHNode **nodes;
-  BVHNode *nodearray;  /* pre-alloc branch nodes */
-  BVHNode **nodechild; /* pre-alloc childs for nodes */
-  float *nodebv;       /* pre-alloc bounding-volumes for nodes */
-  float epsilon;       /* epslion is used for inflation of the k-dop      */
-  int totleaf;         /* leafs */
+  BVHNode *nodearray;    /* pre-alloc branch nodes */
+  BVHNode **nodechild;   /* pre-alloc childs for nodes */
+  float *nodebv;         /* pre-alloc bounding-volumes for nodes */
+  BVHPackedNode *packed; /* optional flattened nodes (#BVH_BUILD_PACKED) */
+  BVHNode **packed_src;  /* nodes each packed child is copied from, for refitting */
+  float epsilon;         /* epslion is used for inflation of the k-dop      */
+  int totleaf;           /* leafs */
   int totbranch;
+  int totpacked;
+  float build_cost;      /* #bvhtree_surface_cost when balanced, to measure refit quality */
   axis_t start_axis, stop_axis; /* bvhtree_kdop_axes array indices according to axis */
   axis_t axis;                  /* kdop type (6 => OBB, 7 => AABB, ...) */
   char tree_type;               /* type of tree (4 => quadtree) */
+  char flag;                    /* BVH_BUILD_* flags */
 };
 
 /* optimization, ensure we stay small */
-BLI_STATIC_ASSERT((sizeof(void *) == 8 && sizeof(BVHTree) <= 48) ||
-                      (sizeof(void *) == 4 && sizeof(BVHTree) <= 32),
+BLI_STATIC_ASSERT((sizeof(void *) == 8 && sizeof(BVHTree) <= 80) ||
+                      (sizeof(void *) == 4 && sizeof(BVHTree) <= 56),
                   "over sized")
 
 /* avoid duplicating vars in BVHOverlapData_Thread */
@@ -859,14 +904,599 @@ static void non_recursive_bvh_div_nodes(const BVHTree *tree,
 
 /** \} */
 
+/* -------------------------------------------------------------------- */
+/** \name Surface Area Heuristic Build
+ *
+ * Alternative to #non_recursive_bvh_div_nodes used for #BVH_BUILD_SAH.
+ *
+ * Instead of splitting the leafs evenly, split planes are chosen to minimize the
+ * surface area heuristic, evaluated over #BVH_SAH_BINS candidates per axis.
+ * The resulting tree is no longer implicit, so branches are allocated level by level,
+ * this keeps every child at a greater index than its parent
+ * (which #BLI_bvhtree_update_tree relies on) and lets each level be split in parallel.
+ * \{ */
+
+typedef struct BVHSAHBin {
+  float bv[6];
+  int count;
+} BVHSAHBin;
+
+static void bvh_aabb_init(float bv[6])
+{
+  bv[0] = bv[2] = bv[4] = FLT_MAX;
+  bv[1] = bv[3] = bv[5] = -FLT_MAX;
+}
+
+static void bvh_aabb_join(float bv[6], const float bv_other[6])
+{
+  for (int i = 0; i < 6; i += 2) {
+    if (bv_other[i] < bv[i]) {
+      bv[i] = bv_other[i];
+    }
+    if (bv_other[i + 1] > bv[i + 1]) {
+      bv[i + 1] = bv_other[i + 1];
+    }
+  }
+}
+
+/* Half the surface area, the scale doesn't matter when comparing costs. */
+static float bvh_aabb_half_area(const float bv[6])
+{
+  const float dx = bv[1] - bv[0];
+  const float dy = bv[3] - bv[2];
+  const float dz = bv[5] - bv[4];
+  return dx * dy + dy * dz + dz * dx;
+}
+
+BLI_INLINE float bvh_node_centroid(const BVHNode *node, const int axis)
+{
+  return (node->bv[2 * axis] + node->bv[2 * axis + 1]) * 0.5f;
+}
+
+BLI_INLINE int bvh_sah_bin_index(const BVHNode *node,
+                                 const int axis,
+                                 const float centroid_min,
+                                 const float bin_scale)
+{
+  const int bin = (int)((bvh_node_centroid(node, axis) - centroid_min) * bin_scale);
+  return min_ii(max_ii(bin, 0), BVH_SAH_BINS - 1);
+}
+
+/**
+ * Split the leafs in `[begin, end)` into two non-empty ranges (partitioning them in place).
+ *
+ * \return the first leaf of the second range.
+ */
+static int bvh_sah_split(BVHNode **leafs_array, const int begin, const int end, char *r_axis)
+{
+  float centroid_bv[6];
+  int best_axis = -1, best_bin = -1;
+  float best_cost = FLT_MAX;
+
+  bvh_aabb_init(centroid_bv);
+  for (int j = begin; j < end; j++) {
+    for (int axis = 0; axis < 3; axis++) {
+      const float centroid = bvh_node_centroid(leafs_array[j], axis);
+      CLAMP_MAX(centroid_bv[2 * axis], centroid);
+      CLAMP_MIN(centroid_bv[2 * axis + 1], centroid);
+    }
+  }
+
+  for (int axis = 0; axis < 3; axis++) {
+    const float extent = centroid_bv[2 * axis + 1] - centroid_bv[2 * axis];
+    if (!(extent > FLT_EPSILON)) {
+      continue;
+    }
+    const float bin_scale = (float)BVH_SAH_BINS / extent;
+
+    BVHSAHBin bins[BVH_SAH_BINS];
+    for (int b = 0; b < BVH_SAH_BINS; b++) {
+      bvh_aabb_init(bins[b].bv);
+      bins[b].count = 0;
+    }
+
+    for (int j = begin; j < end; j++) {
+      BVHSAHBin *bin = &bins[bvh_sah_bin_index(
+          leafs_array[j], axis, centroid_bv[2 * axis], bin_scale)];
+      bvh_aabb_join(bin->bv, leafs_array[j]->bv);
+      bin->count++;
+    }
+
+    /* Sweep from the right, storing the cost of everything right of each split plane. */
+    float right_cost[BVH_SAH_BINS];
+    int right_count[BVH_SAH_BINS];
+    {
+      float bv[6];
+      int count = 0;
+      bvh_aabb_init(bv);
+      for (int b = BVH_SAH_BINS - 1; b > 0; b--) {
+        if (bins[b].count) {
+          bvh_aabb_join(bv, bins[b].bv);
+          count += bins[b].count;
+        }
+        right_count[b] = count;
+        right_cost[b] = count ? bvh_aabb_half_area(bv) * (float)count : 0.0f;
+      }
+    }
+
+    /* Sweep from the left, evaluating the split after each bin. */
+    {
+      float bv[6];
+      int count = 0;
+      bvh_aabb_init(bv);
+      for (int b = 0; b < BVH_SAH_BINS - 1; b++) {
+        if (bins[b].count) {
+          bvh_aabb_join(bv, bins[b].bv);
+          count += bins[b].count;
+        }
+        if (count == 0 || right_count[b + 1] == 0) {
+          continue;
+        }
+        const float cost = bvh_aabb_half_area(bv) * (float)count + right_cost[b + 1];
+        if (cost < best_cost) {
+          best_cost = cost;
+          best_axis = axis;
+          best_bin = b;
+        }
+      }
+    }
+  }
+
+  if (best_axis == -1) {
+    /* All centroids are (nearly) the same, any split is as good as another. */
+    const int mid = (begin + end) / 2;
+    const char split_axis = get_largest_axis(centroid_bv);
+    partition_nth_element(leafs_array, begin, end, mid, split_axis);
+    *r_axis = split_axis / 2;
+    return mid;
+  }
+
+  const float centroid_min = centroid_bv[2 * best_axis];
+  const float bin_scale = (float)BVH_SAH_BINS /
+                          (centroid_bv[2 * best_axis + 1] - centroid_bv[2 * best_axis]);
+  int i = begin, j = end - 1;
+  while (i <= j) {
+    if (bvh_sah_bin_index(leafs_array[i], best_axis, centroid_min, bin_scale) <= best_bin) {
+      i++;
+    }
+    else {
+      SWAP(BVHNode *, leafs_array[i], leafs_array[j]);
+      j--;
+    }
+  }
+  BLI_assert(i > begin && i < end);
+
+  *r_axis = (char)best_axis;
+  return i;
+}
+
+typedef struct BVHSAHDivNodesData {
+  const BVHTree *tree;
+  BVHNode *branches_array;
+  BVHNode **leafs_array;
+
+  /** Range of leafs owned by each branch. */
+  const int (*branch_leafs)[2];
+  /** Bounds of the children of each branch on this level: `tree_type + 1` per branch. */
+  int *level_splits;
+  int level_begin;
+} BVHSAHDivNodesData;
+
+static void bvh_sah_div_nodes_task_cb(void *__restrict userdata,
+                                      const int j,
+                                      const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  BVHSAHDivNodesData *data = userdata;
+  const int tree_type = data->tree->tree_type;
+  BVHNode *parent = &data->branches_array[j];
+  int *splits = &data->level_splits[(j - data->level_begin) * (tree_type + 1)];
+  int splits_len = 2;
+
+  const int parent_leafs_begin = data->branch_leafs[j][0];
+  const int parent_leafs_end = data->branch_leafs[j][1];
+
+  refit_kdop_hull(data->tree, parent, parent_leafs_begin, parent_leafs_end);
+  parent->main_axis = get_largest_axis(parent->bv) / 2;
+
+  splits[0] = parent_leafs_begin;
+  splits[1] = parent_leafs_end;
+
+  /* Keep splitting the child with the most leafs until the node is full. */
+  while (splits_len <= tree_type) {
+    int split_index = -1;
+    int split_len = 1;
+    for (int k = 0; k < splits_len - 1; k++) {
+      if (splits[k + 1] - splits[k] > split_len) {
+        split_len = splits[k + 1] - splits[k];
+        split_index = k;
+      }
+    }
+    if (split_index == -1) {
+      break;
+    }
+
+    char split_axis;
+    const int mid = bvh_sah_split(
+        data->leafs_array, splits[split_index], splits[split_index + 1], &split_axis);
+    if (splits_len == 2) {
+      /* The first split is the most significant one, use it as a traversal hint. */
+      parent->main_axis = split_axis;
+    }
+
+    memmove(&splits[split_index + 2],
+            &splits[split_index + 1],
+            sizeof(*splits) * (size_t)(splits_len - (split_index + 1)));
+    splits[split_index + 1] = mid;
+    splits_len++;
+  }
+
+  /* Unused children are stored as empty ranges. */
+  for (int k = splits_len; k <= tree_type; k++) {
+    splits[k] = parent_leafs_end;
+  }
+}
+
+/**
+ * Build a tree from the given leafs using the surface area heuristic.
+ *
+ * \return the number of branches used (at most `num_leafs - 1`).
+ */
+static int bvh_sah_div_nodes(const BVHTree *tree,
+                             BVHNode *branches_array,
+                             BVHNode **leafs_array,
+                             int num_leafs)
+{
+  const int tree_type = tree->tree_type;
+  int(*branch_leafs)[2] = MEM_mallocN(sizeof(*branch_leafs) * (size_t)max_ii(1, num_leafs - 1),
+                                      __func__);
+  int *level_splits = NULL;
+  int level_splits_len = 0;
+
+  int level_begin = 0, level_end = 1;
+  int totbranch = 1;
+
+  BLI_assert(num_leafs > 1);
+
+  branches_array[0].parent = NULL;
+  branch_leafs[0][0] = 0;
+  branch_leafs[0][1] = num_leafs;
+
+  BVHSAHDivNodesData cb_data = {
+      .tree = tree,
+      .branches_array = branches_array,
+      .leafs_array = leafs_array,
+      .branch_leafs = (const int(*)[2])branch_leafs,
+  };
+
+  while (level_begin < level_end) {
+    const int level_len = level_end - level_begin;
+
+    if (level_len * (tree_type + 1) > level_splits_len) {
+      level_splits_len = level_len * (tree_type + 1);
+      MEM_SAFE_FREE(level_splits);
+      level_splits = MEM_mallocN(sizeof(*level_splits) * (size_t)level_splits_len, __func__);
+    }
+
+    cb_data.level_splits = level_splits;
+    cb_data.level_begin = level_begin;
+
+    TaskParallelSettings settings;
+    BLI_parallel_range_settings_defaults(&settings);
+    settings.use_threading = (num_leafs > KDOPBVH_THREAD_LEAF_THRESHOLD);
+    BLI_task_parallel_range(
+        level_begin, level_end, &cb_data, bvh_sah_div_nodes_task_cb, &settings);
+
+    /* Link the children, allocating branches for the next level. */
+    for (int j = level_begin; j < level_end; j++) {
+      BVHNode *parent = &branches_array[j];
+      const int *splits = &level_splits[(j - level_begin) * (tree_type + 1)];
+      int k;
+
+      for (k = 0; k < tree_type; k++) {
+        const int child_leafs_begin = splits[k];
+        const int child_leafs_end = splits[k + 1];
+
+        if (child_leafs_end - child_leafs_begin > 1) {
+          BLI_assert(totbranch < num_leafs - 1);
+          parent->children[k] = &branches_array[totbranch];
+          branch_leafs[totbranch][0] = child_leafs_begin;
+          branch_leafs[totbranch][1] = child_leafs_end;
+          totbranch++;
+        }
+        else if (child_leafs_end - child_leafs_begin == 1) {
+          parent->children[k] = leafs_array[child_leafs_begin];
+        }
+        else {
+          break;
+        }
+        parent->children[k]->parent = parent;
+      }
+      parent->totnode = (char)k;
+    }
+
+    level_begin = level_end;
+    level_end = totbranch;
+  }
+
+  MEM_SAFE_FREE(level_splits);
+  MEM_freeN(branch_leafs);
+
+  return totbranch;
+}
+
+static bool bvhtree_use_sah(const BVHTree *tree)
+{
+  /* The SAH only considers the AABB (first 3 axes),
+   * trees with a single leaf are handled by #non_recursive_bvh_div_nodes. */
+  return (tree->flag & BVH_BUILD_SAH) && (tree->start_axis == 0) && (tree->totleaf > 1);
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Packed Nodes
+ *
+ * Flattened copy of the tree used for #BVH_BUILD_PACKED.
+ *
+ * Each #BVHPackedNode collapses a branch (and as many levels of its descendants as fit)
+ * into #BVH_PACKED_WIDTH children, so binary and quad trees become wide trees
+ * where each visited node tests all of its children at once.
+ * \{ */
+
+static bool bvhtree_use_packed(const BVHTree *tree)
+{
+  /* Only the AABB is stored, trees with no leafs don't have a valid root. */
+  return (tree->flag & BVH_BUILD_PACKED) && (tree->start_axis == 0) &&
+         (tree->tree_type <= BVH_PACKED_WIDTH) && (tree->totleaf > 0);
+}
+
+/**
+ * Collect the children of a packed node,
+ * opening the largest branches as long as their children fit.
+ */
+static int bvhtree_packed_node_children(const BVHNode *node, BVHNode **r_children)
+{
+  int children_len = node->totnode;
+  memcpy(r_children, node->children, sizeof(*r_children) * (size_t)children_len);
+
+  while (true) {
+    int open_index = -1;
+    float open_area = -1.0f;
+    for (int k = 0; k < children_len; k++) {
+      const BVHNode *child = r_children[k];
+      if (child->totnode != 0 && (children_len - 1 + child->totnode <= BVH_PACKED_WIDTH)) {
+        const float area = bvh_aabb_half_area(child->bv);
+        if (area > open_area) {
+          open_area = area;
+          open_index = k;
+        }
+      }
+    }
+    if (open_index == -1) {
+      break;
+    }
+
+    const BVHNode *open = r_children[open_index];
+    r_children[open_index] = open->children[0];
+    for (int k = 1; k < open->totnode; k++) {
+      r_children[children_len++] = open->children[k];
+    }
+  }
+
+  return children_len;
+}
+
+/**
+ * Copy the bounds from the nodes each packed child was created from,
+ * call after the regular nodes have been updated.
+ */
+static void bvhtree_packed_refit(BVHTree *tree)
+{
+  for (int i = 0; i < tree->totpacked; i++) {
+    BVHPackedNode *pnode = &tree->packed[i];
+    BVHNode **src = &tree->packed_src[i * BVH_PACKED_WIDTH];
+    for (int k = 0; k < BVH_PACKED_WIDTH; k++) {
+      if (src[k]) {
+        for (int axis = 0; axis < 6; axis++) {
+          pnode->bv[axis][k] = src[k]->bv[axis];
+        }
+      }
+      else {
+        for (int axis = 0; axis < 6; axis++) {
+          pnode->bv[axis][k] = 0.0f;
+        }
+      }
+    }
+  }
+}
+
+static void bvhtree_packed_free(BVHTree *tree)
+{
+  MEM_SAFE_FREE(tree->packed);
+  MEM_SAFE_FREE(tree->packed_src);
+  tree->totpacked = 0;
+}
+
+static void bvhtree_packed_build(BVHTree *tree)
+{
+  bvhtree_packed_free(tree);
+
+  if (!bvhtree_use_packed(tree)) {
+    return;
+  }
+
+  /* Each packed node consumes at least one branch. */
+  const int packed_max = tree->totbranch;
+  BVHNode **queue = MEM_mallocN(sizeof(*queue) * (size_t)packed_max, __func__);
+  int queue_len = 0;
+
+  tree->packed = MEM_mallocN_aligned(sizeof(*tree->packed) * (size_t)packed_max, 64, __func__);
+  tree->packed_src = MEM_callocN(
+      sizeof(*tree->packed_src) * (size_t)(packed_max * BVH_PACKED_WIDTH), __func__);
+
+  queue[queue_len++] = tree->nodes[tree->totleaf];
+
+  for (int i = 0; i < queue_len; i++) {
+    BVHPackedNode *pnode = &tree->packed[i];
+    BVHNode **src = &tree->packed_src[i * BVH_PACKED_WIDTH];
+    const int src_len = bvhtree_packed_node_children(queue[i], src);
+
+    for (int k = 0; k < BVH_PACKED_WIDTH; k++) {
+      if (k >= src_len) {
+        pnode->child[k] = BVH_PACKED_EMPTY;
+        pnode->index[k] = -1;
+      }
+      else if (src[k]->totnode == 0) {
+        pnode->child[k] = BVH_PACKED_LEAF;
+        pnode->index[k] = src[k]->index;
+      }
+      else {
+        BLI_assert(queue_len < packed_max);
+        pnode->child[k] = queue_len;
+        pnode->index[k] = -1;
+        queue[queue_len++] = src[k];
+      }
+    }
+  }
+
+  tree->totpacked = queue_len;
+  MEM_freeN(queue);
+
+  bvhtree_packed_refit(tree);
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Refit
+ *
+ * Update the bounds of a balanced tree without changing its topology,
+ * see #BLI_bvhtree_refit.
+ * \{ */
+
+/**
+ * Sum of the products of neighboring k-dop extents,
+ * this is half the surface area when the axes are X/Y/Z.
+ */
+static float bvh_node_surface_cost(const BVHTree *tree, const BVHNode *node)
+{
+  const float(*bv)[2] = (const float(*)[2])node->bv;
+  float cost = 0.0f;
+
+  for (axis_t axis_iter = tree->start_axis; axis_iter < tree->stop_axis; axis_iter++) {
+    axis_t axis_next = (axis_t)(axis_iter + 1);
+    if (axis_next == tree->stop_axis) {
+      axis_next = tree->start_axis;
+    }
+    cost += (bv[axis_iter][1] - bv[axis_iter][0]) * (bv[axis_next][1] - bv[axis_next][0]);
+  }
+  return cost;
+}
+
+/**
+ * Surface area heuristic cost of all branches relative to the root,
+ * larger values mean more overlapping (and less useful) branches.
+ */
+static float bvhtree_surface_cost(const BVHTree *tree)
+{
+  if (tree->totbranch == 0) {
+    return 0.0f;
+  }
+
+  const float root_cost = bvh_node_surface_cost(tree, tree->nodes[tree->totleaf]);
+  if (root_cost <= 0.0f) {
+    return 0.0f;
+  }
+
+  float cost = 0.0f;
+  for (int i = 0; i < tree->totbranch; i++) {
+    cost += bvh_node_surface_cost(tree, tree->nodes[tree->totleaf + i]);
+  }
+  return cost / root_cost;
+}
+
+typedef struct BVHRefitData {
+  BVHTree *tree;
+  BVHTree_RefitLeafCallback callback;
+  void *userdata;
+} BVHRefitData;
+
+static void bvhtree_refit_leaf_task_cb(void *__restrict userdata,
+                                       const int i,
+                                       const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  BVHRefitData *data = userdata;
+  BVHTree *tree = data->tree;
+  BVHNode *node = &tree->nodearray[i];
+  float co[BVH_REFIT_LEAF_POINTS_MAX][3];
+
+  const int numpoints = data->callback(data->userdata, node->index, co);
+  BLI_assert(numpoints > 0 && numpoints <= BVH_REFIT_LEAF_POINTS_MAX);
+
+  create_kdop_hull(tree, node, co[0], numpoints, 0);
+
+  /* inflate the bv with some epsilon */
+  for (axis_t axis_iter = tree->start_axis; axis_iter < tree->stop_axis; axis_iter++) {
+    node->bv[(2 * axis_iter)] -= tree->epsilon;     /* minimum */
+    node->bv[(2 * axis_iter) + 1] += tree->epsilon; /* maximum */
+  }
+}
+
+static void bvhtree_refit_branch_task_cb(void *__restrict userdata,
+                                         const int i,
+                                         const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  BVHTree *tree = userdata;
+  node_join(tree, tree->nodes[tree->totleaf + i]);
+}
+
+/**
+ * Find the range of branches at each depth (relative to the first branch).
+ *
+ * Both #non_recursive_bvh_div_nodes and #bvh_sah_div_nodes store branches breadth-first,
+ * so each depth is a contiguous range and `r_level_start[depth + 1]` is the end of `depth`.
+ *
+ * \return the number of levels.
+ */
+static int bvhtree_branch_levels(const BVHTree *tree, int *r_level_start)
+{
+  const BVHNode *branch_first = &tree->nodearray[tree->totleaf];
+  int levels_len = 0;
+  int level_begin = 0, level_end = 1;
+
+  r_level_start[0] = 0;
+  while (level_begin < level_end) {
+    int next_begin = tree->totbranch, next_end = 0;
+    for (int i = level_begin; i < level_end; i++) {
+      const BVHNode *node = tree->nodes[tree->totleaf + i];
+      for (int j = 0; j < node->totnode; j++) {
+        if (node->children[j]->totnode != 0) {
+          const int child = (int)(node->children[j] - branch_first);
+          next_begin = min_ii(next_begin, child);
+          next_end = max_ii(next_end, child + 1);
+        }
+      }
+    }
+    r_level_start[++levels_len] = level_end;
+    BLI_assert((next_begin >= next_end) || (next_begin == level_end));
+    level_begin = level_end;
+    level_end = max_ii(level_end, next_end);
+  }
+  return levels_len;
+}
+
+/** \} */
+
 /* -------------------------------------------------------------------- */
 /** \name BLI_bvhtree API
  * \{ */
 
 /**
+ * \param flag: #BVH_BUILD_SAH, #BVH_BUILD_PACKED.
+ *
  * \note many callers don't check for ``NULL`` return.
  */
-BVHTree *BLI_bvhtree_new(int maxsize, float epsilon, char tree_type, char axis)
+BVHTree *BLI_bvhtree_new_ex(int maxsize, float epsilon, char tree_type, char axis, int flag)
 {
   BVHTree *tree;
   int numnodes, i;
@@ -885,6 +1515,7 @@ BVHTree *BLI_bvhtree_new(int maxsize, float epsilon, char tree_type, char axis)
     tree->epsilon = epsilon;
     tree->tree_type = tree_type;
     tree->axis = axis;
+    tree->flag = (char)flag;
 
     if (axis == 26) {
       tree->start_axis = 0;
@@ -914,7 +1545,13 @@ BVHTree *BLI_bvhtree_new(int maxsize, float epsilon, char tree_type, char axis)
     }
 
     /* Allocate arrays */
-    numnodes = maxsize + implicit_needed_branches(tree_type, maxsize) + tree_type;
+    if (flag & BVH_BUILD_SAH) {
+      /* Branches aren't necessarily full, every branch has at least 2 children. */
+      numnodes = maxsize + max_ii(1, maxsize - 1) + tree_type;
+    }
+    else {
+      numnodes = maxsize + implicit_needed_branches(tree_type, maxsize) + tree_type;
+    }
 
     tree->nodes = MEM_callocN(sizeof(BVHNode *) * (size_t)numnodes, "BVHNodes");
     tree->nodebv = MEM_callocN(sizeof(float) * (size_t)(axis * numnodes), "BVHNodeBV");
@@ -938,9 +1575,15 @@ fail:
   return NULL;
 }
 
+BVHTree *BLI_bvhtree_new(int maxsize, float epsilon, char tree_type, char axis)
+{
+  return BLI_bvhtree_new_ex(maxsize, epsilon, tree_type, axis, 0);
+}
+
 void BLI_bvhtree_free(BVHTree *tree)
 {
   if (tree) {
+    bvhtree_packed_free(tree);
     MEM_SAFE_FREE(tree->nodes);
     MEM_SAFE_FREE(tree->nodearray);
     MEM_SAFE_FREE(tree->nodebv);
@@ -957,13 +1600,19 @@ void BLI_bvhtree_balance(BVHTree *tree)
    * (some big bug goes here if its being called more than once per tree) */
   BLI_assert(tree->totbranch == 0);
 
-  /* Build the implicit tree */
-  non_recursive_bvh_div_nodes(
-      tree, tree->nodearray + (tree->totleaf - 1), leafs_array, tree->totleaf);
+  if (bvhtree_use_sah(tree)) {
+    tree->totbranch = bvh_sah_div_nodes(
+        tree, tree->nodearray + tree->totleaf, leafs_array, tree->totleaf);
+  }
+  else {
+    /* Build the implicit tree */
+    non_recursive_bvh_div_nodes(
+        tree, tree->nodearray + (tree->totleaf - 1), leafs_array, tree->totleaf);
+    tree->totbranch = implicit_needed_branches(tree->tree_type, tree->totleaf);
+  }
 
   /* current code expects the branches to be linked to the nodes array
    * we perform that linkage here */
-  tree->totbranch = implicit_needed_branches(tree->tree_type, tree->totleaf);
   for (int i = 0; i < tree->totbranch; i++) {
     tree->nodes[tree->totleaf + i] = &tree->nodearray[tree->totleaf + i];
   }
@@ -972,6 +1621,10 @@ void BLI_bvhtree_balance(BVHTree *tree)
   build_skip_links(tree, tree->nodes[tree->totleaf], NULL, NULL);
 #endif
 
+  bvhtree_packed_build(tree);
+
+  tree->build_cost = bvhtree_surface_cost(tree);
+
 #ifdef USE_VERIFY_TREE
   bvhtree_verify(tree);
 #endif
@@ -1045,7 +1698,72 @@ void BLI_bvhtree_update_tree(BVHTree *tree)
   for (; index >= root; index--) {
     node_join(tree, *index);
   }
+
+  if (tree->packed) {
+    bvhtree_packed_refit(tree);
+  }
+}
+
+/**
+ * Recalculate the bounds of a balanced tree in parallel, keeping its topology.
+ *
+ * Unlike #BLI_bvhtree_update_node the leafs are looked up by the index they were inserted with,
+ * so this works for trees built from a subset of elements.
+ * Use #BLI_bvhtree_get_refit_quality to check if the tree should be rebuilt instead.
+ *
+ * \param callback: Fills in the points of a leaf, must be thread-safe.
+ */
+void BLI_bvhtree_refit(BVHTree *tree, BVHTree_RefitLeafCallback callback, void *userdata)
+{
+  BVHRefitData data = {
+      .tree = tree,
+      .callback = callback,
+      .userdata = userdata,
+  };
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = (tree->totleaf > KDOPBVH_THREAD_LEAF_THRESHOLD);
+  BLI_task_parallel_range(0, tree->totleaf, &data, bvhtree_refit_leaf_task_cb, &settings);
+
+  if (tree->totbranch > 0) {
+    /* Update bottom=>top, one level at a time. */
+    int *level_start = MEM_mallocN(sizeof(*level_start) * (size_t)(tree->totbranch + 1), __func__);
+    const int levels_len = bvhtree_branch_levels(tree, level_start);
+
+    for (int level = levels_len - 1; level >= 0; level--) {
+      const int level_len = level_start[level + 1] - level_start[level];
+      settings.use_threading = (level_len * tree->tree_type > KDOPBVH_THREAD_LEAF_THRESHOLD);
+      BLI_task_parallel_range(level_start[level],
+                              level_start[level + 1],
+                              tree,
+                              bvhtree_refit_branch_task_cb,
+                              &settings);
+    }
+    MEM_freeN(level_start);
+  }
+
+  if (tree->packed) {
+    bvhtree_packed_refit(tree);
+  }
+}
+
+/**
+ * Ratio between the surface area heuristic cost of the tree as it was built
+ * and its current cost, where 1.0 means the tree is as good as when it was balanced.
+ *
+ * Refitting a tree after large deformations makes branches overlap,
+ * once the quality drops too far rebuilding the tree is faster than querying it.
+ */
+float BLI_bvhtree_get_refit_quality(const BVHTree *tree)
+{
+  const float cost = bvhtree_surface_cost(tree);
+  if (cost <= tree->build_cost) {
+    return 1.0f;
+  }
+  return tree->build_cost / cost;
 }
+
 /**
  * Number of times #BLI_bvhtree_insert has been called.
  * mainly useful for asserts functions to check we added the correct number.
@@ -1465,6 +2183,95 @@ static void dfs_find_nearest_begin(BVHNearestData *data, BVHNode *node)
   dfs_find_nearest_dfs(data, node);
 }
 
+/**
+ * Packed version of #dfs_find_nearest_dfs, testing all children of a node at once.
+ *
+ * \return the number of children in `r_order`, sorted by their distance (nearest first),
+ * children further away than `dist_sq_max` are skipped.
+ */
+static int bvh_packed_nearest_order(const BVHPackedNode *pnode,
+                                    const float co[3],
+                                    const float dist_sq_max,
+                                    float r_dist_sq[BVH_PACKED_WIDTH],
+                                    int r_order[BVH_PACKED_WIDTH])
+{
+  int order_len = 0;
+
+#ifdef __SSE2__
+  const __m128 co_x = _mm_set1_ps(co[0]);
+  const __m128 co_y = _mm_set1_ps(co[1]);
+  const __m128 co_z = _mm_set1_ps(co[2]);
+  for (int k = 0; k < BVH_PACKED_WIDTH && pnode->child[k] != BVH_PACKED_EMPTY; k += 4) {
+    const __m128 dx = _mm_sub_ps(co_x,
+                                 _mm_min_ps(_mm_max_ps(co_x, _mm_load_ps(&pnode->bv[0][k])),
+                                            _mm_load_ps(&pnode->bv[1][k])));
+    const __m128 dy = _mm_sub_ps(co_y,
+                                 _mm_min_ps(_mm_max_ps(co_y, _mm_load_ps(&pnode->bv[2][k])),
+                                            _mm_load_ps(&pnode->bv[3][k])));
+    const __m128 dz = _mm_sub_ps(co_z,
+                                 _mm_min_ps(_mm_max_ps(co_z, _mm_load_ps(&pnode->bv[4][k])),
+                                            _mm_load_ps(&pnode->bv[5][k])));
+    const __m128 dist_sq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)),
+                                      _mm_mul_ps(dz, dz));
+    _mm_storeu_ps(&r_dist_sq[k], dist_sq);
+  }
+#else
+  for (int k = 0; k < BVH_PACKED_WIDTH && pnode->child[k] != BVH_PACKED_EMPTY; k++) {
+    r_dist_sq[k] = 0.0f;
+    for (int axis = 0; axis < 3; axis++) {
+      const float d = co[axis] - min_ff(max_ff(co[axis], pnode->bv[2 * axis][k]),
+                                        pnode->bv[2 * axis + 1][k]);
+      r_dist_sq[k] += d * d;
+    }
+  }
+#endif
+
+  for (int k = 0; k < BVH_PACKED_WIDTH && pnode->child[k] != BVH_PACKED_EMPTY; k++) {
+    if (r_dist_sq[k] < dist_sq_max) {
+      /* Insertion sort, there are only a handful of children. */
+      int i = order_len++;
+      for (; i > 0 && r_dist_sq[r_order[i - 1]] > r_dist_sq[k]; i--) {
+        r_order[i] = r_order[i - 1];
+      }
+      r_order[i] = k;
+    }
+  }
+  return order_len;
+}
+
+static void bvh_packed_find_nearest(BVHNearestData *data, const BVHPackedNode *pnode)
+{
+  float dist_sq[BVH_PACKED_WIDTH];
+  int order[BVH_PACKED_WIDTH];
+  const int order_len = bvh_packed_nearest_order(
+      pnode, data->co, data->nearest.dist_sq, dist_sq, order);
+
+  for (int i = 0; i < order_len; i++) {
+    const int k = order[i];
+    if (dist_sq[k] >= data->nearest.dist_sq) {
+      /* Children are sorted, the remaining ones can't be any closer. */
+      break;
+    }
+
+    if (pnode->child[k] == BVH_PACKED_LEAF) {
+      if (data->callback) {
+        data->callback(data->userdata, pnode->index[k], data->co, &data->nearest);
+      }
+      else {
+        data->nearest.index = pnode->index[k];
+        data->nearest.dist_sq = dist_sq[k];
+        for (int axis = 0; axis < 3; axis++) {
+          data->nearest.co[axis] = min_ff(max_ff(data->co[axis], pnode->bv[2 * axis][k]),
+                                          pnode->bv[2 * axis + 1][k]);
+        }
+      }
+    }
+    else {
+      bvh_packed_find_nearest(data, &data->tree->packed[pnode->child[k]]);
+    }
+  }
+}
+
 /* Priority queue method */
 static void heap_find_nearest_inner(BVHNearestData *data, HeapSimple *heap, BVHNode *node)
 {
@@ -1490,13 +2297,16 @@ static void heap_find_nearest_inner(BVHNearestData *data, HeapSimple *heap, BVHN
   }
 }
 
-static void heap_find_nearest_begin(BVHNearestData *data, BVHNode *root)
+/**
+ * \param heap_reuse: Optional heap to use (and clear) instead of allocating one.
+ */
+static void heap_find_nearest_begin(BVHNearestData *data, BVHNode *root, HeapSimple *heap_reuse)
 {
   float nearest[3];
   float dist_sq = calc_nearest_point_squared(data->proj, root, nearest);
 
   if (dist_sq < data->nearest.dist_sq) {
-    HeapSimple *heap = BLI_heapsimple_new_ex(32);
+    HeapSimple *heap = heap_reuse ? heap_reuse : BLI_heapsimple_new_ex(32);
 
     heap_find_nearest_inner(data, heap, root);
 
@@ -1506,7 +2316,39 @@ static void heap_find_nearest_begin(BVHNearestData *data, BVHNode *root)
       heap_find_nearest_inner(data, heap, node);
     }
 
-    BLI_heapsimple_free(heap, NULL);
+    if (heap_reuse) {
+      BLI_heapsimple_clear(heap, NULL);
+    }
+    else {
+      BLI_heapsimple_free(heap, NULL);
+    }
+  }
+}
+
+/**
+ * Search for `data->co`, updating `data->nearest`.
+ */
+static void bvhtree_find_nearest_search(BVHNearestData *data, HeapSimple *heap, int flag)
+{
+  const BVHTree *tree = data->tree;
+  BVHNode *root = tree->nodes[tree->totleaf];
+  axis_t axis_iter;
+
+  for (axis_iter = tree->start_axis; axis_iter != tree->stop_axis; axis_iter++) {
+    data->proj[axis_iter] = dot_v3v3(data->co, bvhtree_kdop_axes[axis_iter]);
+  }
+
+  /* dfs search */
+  if (root) {
+    if (flag & BVH_NEAREST_OPTIMAL_ORDER) {
+      heap_find_nearest_begin(data, root, heap);
+    }
+    else if (tree->packed) {
+      bvh_packed_find_nearest(data, &tree->packed[0]);
+    }
+    else {
+      dfs_find_nearest_begin(data, root);
+    }
   }
 }
 
@@ -1517,10 +2359,7 @@ int BLI_bvhtree_find_nearest_ex(BVHTree *tree,
                                 void *userdata,
                                 int flag)
 {
-  axis_t axis_iter;
-
   BVHNearestData data;
-  BVHNode *root = tree->nodes[tree->totleaf];
 
   /* init data to search */
   data.tree = tree;
@@ -1529,10 +2368,6 @@ int BLI_bvhtree_find_nearest_ex(BVHTree *tree,
   data.callback = callback;
   data.userdata = userdata;
 
-  for (axis_iter = data.tree->start_axis; axis_iter != data.tree->stop_axis; axis_iter++) {
-    data.proj[axis_iter] = dot_v3v3(data.co, bvhtree_kdop_axes[axis_iter]);
-  }
-
   if (nearest) {
     memcpy(&data.nearest, nearest, sizeof(*nearest));
   }
@@ -1541,15 +2376,7 @@ int BLI_bvhtree_find_nearest_ex(BVHTree *tree,
     data.nearest.dist_sq = FLT_MAX;
   }
 
-  /* dfs search */
-  if (root) {
-    if (flag & BVH_NEAREST_OPTIMAL_ORDER) {
-      heap_find_nearest_begin(&data, root);
-    }
-    else {
-      dfs_find_nearest_begin(&data, root);
-    }
-  }
+  bvhtree_find_nearest_search(&data, NULL, flag);
 
   /* copy back results */
   if (nearest) {
@@ -1775,6 +2602,115 @@ static void dfs_raycast(BVHRayCastData *data, BVHNode *node)
   }
 }
 
+/**
+ * Packed version of #dfs_raycast, testing all children of a node at once.
+ *
+ * \return the number of children in `r_order`, sorted by the distance along the ray
+ * they're entered at (nearest first), children that aren't hit are skipped.
+ */
+static int bvh_packed_raycast_order(const BVHRayCastData *data,
+                                    const BVHPackedNode *pnode,
+                                    float r_dist[BVH_PACKED_WIDTH],
+                                    int r_order[BVH_PACKED_WIDTH])
+{
+  /* Near & far bounds along each axis (depending on the ray direction), these are expanded
+   * by the ray radius, which is folded into the origin to avoid adding it for every child. */
+  const int *index_near_far = data->index;
+  float origin_near[3], origin_far[3];
+  for (int axis = 0; axis < 3; axis++) {
+    const float radius = (index_near_far[2 * axis] & 1) ? -data->ray.radius : data->ray.radius;
+    origin_near[axis] = data->ray.origin[axis] + radius;
+    origin_far[axis] = data->ray.origin[axis] - radius;
+  }
+  /* Match #fast_ray_nearest_hit & #ray_nearest_hit when the origin is inside the bounds. */
+  const float dist_min = (data->ray.radius == 0.0f) ? -FLT_MAX : 0.0f;
+  const float dist_max = data->hit.dist;
+  int hit_mask = 0;
+
+#ifdef __SSE2__
+  for (int k = 0; k < BVH_PACKED_WIDTH && pnode->child[k] != BVH_PACKED_EMPTY; k += 4) {
+    __m128 dist_near = _mm_set1_ps(dist_min);
+    __m128 dist_far = _mm_set1_ps(dist_max);
+    for (int axis = 0; axis < 3; axis++) {
+      const __m128 idot = _mm_set1_ps(data->idot_axis[axis]);
+      const __m128 t_near = _mm_mul_ps(
+          _mm_sub_ps(_mm_load_ps(&pnode->bv[index_near_far[2 * axis]][k]),
+                     _mm_set1_ps(origin_near[axis])),
+          idot);
+      const __m128 t_far = _mm_mul_ps(
+          _mm_sub_ps(_mm_load_ps(&pnode->bv[index_near_far[2 * axis + 1]][k]),
+                     _mm_set1_ps(origin_far[axis])),
+          idot);
+      dist_near = _mm_max_ps(dist_near, t_near);
+      dist_far = _mm_min_ps(dist_far, t_far);
+    }
+    const __m128 hit = _mm_and_ps(_mm_cmple_ps(dist_near, dist_far),
+                                  _mm_cmpge_ps(dist_far, _mm_setzero_ps()));
+    _mm_storeu_ps(&r_dist[k], dist_near);
+    hit_mask |= _mm_movemask_ps(hit) << k;
+  }
+#else
+  for (int k = 0; k < BVH_PACKED_WIDTH && pnode->child[k] != BVH_PACKED_EMPTY; k++) {
+    float dist_near = dist_min;
+    float dist_far = dist_max;
+    for (int axis = 0; axis < 3; axis++) {
+      const float t_near = (pnode->bv[index_near_far[2 * axis]][k] - origin_near[axis]) *
+                           data->idot_axis[axis];
+      const float t_far = (pnode->bv[index_near_far[2 * axis + 1]][k] - origin_far[axis]) *
+                          data->idot_axis[axis];
+      dist_near = max_ff(dist_near, t_near);
+      dist_far = min_ff(dist_far, t_far);
+    }
+    r_dist[k] = dist_near;
+    if (dist_near <= dist_far && dist_far >= 0.0f) {
+      hit_mask |= 1 << k;
+    }
+  }
+#endif
+
+  int order_len = 0;
+  for (int k = 0; k < BVH_PACKED_WIDTH && pnode->child[k] != BVH_PACKED_EMPTY; k++) {
+    if (hit_mask & (1 << k)) {
+      /* Insertion sort, there are only a handful of children. */
+      int i = order_len++;
+      for (; i > 0 && r_dist[r_order[i - 1]] > r_dist[k]; i--) {
+        r_order[i] = r_order[i - 1];
+      }
+      r_order[i] = k;
+    }
+  }
+  return order_len;
+}
+
+static void bvh_packed_raycast(BVHRayCastData *data, const BVHPackedNode *pnode)
+{
+  float dist[BVH_PACKED_WIDTH];
+  int order[BVH_PACKED_WIDTH];
+  const int order_len = bvh_packed_raycast_order(data, pnode, dist, order);
+
+  for (int i = 0; i < order_len; i++) {
+    const int k = order[i];
+    if (dist[k] >= data->hit.dist) {
+      /* Children are sorted, the remaining ones are entered further along the ray. */
+      break;
+    }
+
+    if (pnode->child[k] == BVH_PACKED_LEAF) {
+      if (data->callback) {
+        data->callback(data->userdata, pnode->index[k], &data->ray, &data->hit);
+      }
+      else {
+        data->hit.index = pnode->index[k];
+        data->hit.dist = dist[k];
+        madd_v3_v3v3fl(data->hit.co, data->ray.origin, data->ray.direction, dist[k]);
+      }
+    }
+    else {
+      bvh_packed_raycast(data, &data->tree->packed[pnode->child[k]]);
+    }
+  }
+}
+
 /**
  * A version of #dfs_raycast with minor changes to reset the index & dist each ray cast.
  */
@@ -1848,6 +2784,24 @@ static void bvhtree_ray_cast_data_precalc(BVHRayCastData *data, int flag)
 #endif
 }
 
+/**
+ * Cast `data->ray`, updating `data->hit`.
+ */
+static void bvhtree_ray_cast_search(BVHRayCastData *data)
+{
+  const BVHTree *tree = data->tree;
+  BVHNode *root = tree->nodes[tree->totleaf];
+
+  if (root) {
+    if (tree->packed) {
+      bvh_packed_raycast(data, &tree->packed[0]);
+    }
+    else {
+      dfs_raycast(data, root);
+    }
+  }
+}
+
 int BLI_bvhtree_ray_cast_ex(BVHTree *tree,
                             const float co[3],
                             const float dir[3],
@@ -1858,7 +2812,6 @@ int BLI_bvhtree_ray_cast_ex(BVHTree *tree,
                             int flag)
 {
   BVHRayCastData data;
-  BVHNode *root = tree->nodes[tree->totleaf];
 
   BLI_ASSERT_UNIT_V3(dir);
 
@@ -1881,10 +2834,7 @@ int BLI_bvhtree_ray_cast_ex(BVHTree *tree,
     data.hit.dist = BVH_RAYCAST_DIST_MAX;
   }
 
-  if (root) {
-    dfs_raycast(&data, root);
-    //      iterative_raycast(&data, root);
-  }
+  bvhtree_ray_cast_search(&data);
 
   if (hit) {
     memcpy(hit, &data.hit, sizeof(*hit));
@@ -1989,6 +2939,314 @@ void BLI_bvhtree_ray_cast_all(BVHTree *tree,
 
 /** \} */
 
+/* -------------------------------------------------------------------- */
+/** \name BLI_bvhtree_find_nearest_batch / BLI_bvhtree_ray_cast_batch
+ *
+ * Run many queries at once.
+ *
+ * Queries are sorted along a Morton curve so consecutive queries mostly visit the same nodes,
+ * then processed in chunks of #BVH_BATCH_CHUNK_SIZE spread over threads,
+ * each thread reusing its traversal state between queries.
+ * \{ */
+
+#define BVH_BATCH_CHUNK_SIZE 256
+
+typedef struct BVHBatchOrder {
+  uint code;
+  int index;
+} BVHBatchOrder;
+
+/* Spread the lower 10 bits of `v`, leaving 2 zero bits between each. */
+static uint bvh_morton_expand_bits(uint v)
+{
+  v = (v * 0x00010001u) & 0xFF0000FFu;
+  v = (v * 0x00000101u) & 0x0F00F00Fu;
+  v = (v * 0x00000011u) & 0xC30C30C3u;
+  v = (v * 0x00000005u) & 0x49249249u;
+  return v;
+}
+
+/**
+ * Calculate the order to run queries in.
+ *
+ * \param dir: Optional ray directions, rays are grouped by direction octant first.
+ * \param r_mem: Memory to free once the order isn't needed anymore.
+ */
+static const BVHBatchOrder *bvh_batch_order_create(const float (*co)[3],
+                                                   const float (*dir)[3],
+                                                   const int len,
+                                                   void **r_mem)
+{
+  BVHBatchOrder *order = MEM_mallocN(sizeof(*order) * (size_t)(len * 2), __func__);
+  BVHBatchOrder *order_tmp = order + len;
+  float min[3], max[3], scale[3];
+
+  *r_mem = order;
+
+  INIT_MINMAX(min, max);
+  for (int i = 0; i < len; i++) {
+    minmax_v3v3_v3(min, max, co[i]);
+  }
+  for (int axis = 0; axis < 3; axis++) {
+    const float extent = max[axis] - min[axis];
+    scale[axis] = (extent > 0.0f) ? 1023.0f / extent : 0.0f;
+  }
+
+  for (int i = 0; i < len; i++) {
+    uint code = 0;
+    for (int axis = 0; axis < 3; axis++) {
+      const uint v = (uint)((co[i][axis] - min[axis]) * scale[axis]);
+      code |= bvh_morton_expand_bits(MIN2(v, 1023u)) << axis;
+    }
+    if (dir) {
+      /* Drop the lowest bits to make room for the direction octant. */
+      code >>= 3;
+      for (int axis = 0; axis < 3; axis++) {
+        if (dir[i][axis] < 0.0f) {
+          code |= 1u << (27 + axis);
+        }
+      }
+    }
+    order[i].code = code;
+    order[i].index = i;
+  }
+
+  /* Radix sort (8 bits at a time), the codes use at most 30 bits. */
+  for (uint shift = 0; shift < 32; shift += 8) {
+    int offset[257] = {0};
+    for (int i = 0; i < len; i++) {
+      offset[((order[i].code >> shift) & 0xff) + 1]++;
+    }
+    if (offset[((order[0].code >> shift) & 0xff) + 1] == len) {
+      /* All codes share this digit. */
+      continue;
+    }
+    for (int digit = 0; digit < 256; digit++) {
+      offset[digit + 1] += offset[digit];
+    }
+    for (int i = 0; i < len; i++) {
+      order_tmp[offset[(order[i].code >> shift) & 0xff]++] = order[i];
+    }
+    SWAP(BVHBatchOrder *, order, order_tmp);
+  }
+
+  return order;
+}
+
+typedef struct BVHBatchTLS {
+  /* Only used for #BVH_NEAREST_OPTIMAL_ORDER. */
+  HeapSimple *heap;
+} BVHBatchTLS;
+
+static void bvhtree_batch_free_cb(const void *__restrict UNUSED(userdata),
+                                  void *__restrict chunk)
+{
+  BVHBatchTLS *batch_tls = chunk;
+  if (batch_tls->heap) {
+    BLI_heapsimple_free(batch_tls->heap, NULL);
+    batch_tls->heap = NULL;
+  }
+}
+
+static void bvhtree_batch_settings(TaskParallelSettings *settings,
+                                   const int len,
+                                   BVHBatchTLS *batch_tls)
+{
+  BLI_parallel_range_settings_defaults(settings);
+  settings->use_threading = (len > KDOPBVH_THREAD_LEAF_THRESHOLD);
+  settings->userdata_chunk = batch_tls;
+  settings->userdata_chunk_size = sizeof(*batch_tls);
+  settings->func_free = bvhtree_batch_free_cb;
+}
+
+typedef struct BVHNearestBatchData {
+  const BVHTree *tree;
+  const float (*co)[3];
+  BVHTreeNearest *nearest;
+  const BVHBatchOrder *order;
+  int len;
+
+  BVHTree_NearestPointCallback callback;
+  void *userdata;
+  int flag;
+} BVHNearestBatchData;
+
+static void bvhtree_find_nearest_batch_cb(void *__restrict userdata,
+                                          const int chunk,
+                                          const TaskParallelTLS *__restrict tls)
+{
+  const BVHNearestBatchData *batch = userdata;
+  BVHBatchTLS *batch_tls = tls->userdata_chunk;
+  const BVHTreeNearest *nearest_prev = NULL;
+  const int i_end = min_ii((chunk + 1) * BVH_BATCH_CHUNK_SIZE, batch->len);
+
+  BVHNearestData data;
+  data.tree = batch->tree;
+  data.callback = batch->callback;
+  data.userdata = batch->userdata;
+
+  if ((batch->flag & BVH_NEAREST_OPTIMAL_ORDER) && (batch_tls->heap == NULL)) {
+    batch_tls->heap = BLI_heapsimple_new_ex(32);
+  }
+
+  for (int i = chunk * BVH_BATCH_CHUNK_SIZE; i < i_end; i++) {
+    BVHTreeNearest *nearest = &batch->nearest[batch->order[i].index];
+
+    data.co = batch->co[batch->order[i].index];
+    memcpy(&data.nearest, nearest, sizeof(*nearest));
+
+    if ((batch->flag & BVH_NEAREST_USE_PREVIOUS) && nearest_prev && nearest_prev->index != -1) {
+      /* The previous result is a point on the surface, so its distance is an upper bound. */
+      const float dist_sq = len_squared_v3v3(data.co, nearest_prev->co);
+      if (dist_sq < data.nearest.dist_sq) {
+        memcpy(&data.nearest, nearest_prev, sizeof(*nearest_prev));
+        data.nearest.dist_sq = dist_sq;
+      }
+    }
+
+    bvhtree_find_nearest_search(&data, batch_tls->heap, batch->flag);
+
+    memcpy(nearest, &data.nearest, sizeof(*nearest));
+    nearest_prev = nearest;
+  }
+}
+
+/**
+ * Batch version of #BLI_bvhtree_find_nearest_ex.
+ *
+ * \param nearest: Array of `co_len` items, used as input in the same way
+ * #BLI_bvhtree_find_nearest_ex uses it (a zero `dist_sq` skips the query).
+ * \param callback: Must be thread-safe, called from multiple threads at once.
+ * \param flag: #BVH_NEAREST_OPTIMAL_ORDER, #BVH_NEAREST_USE_PREVIOUS.
+ */
+void BLI_bvhtree_find_nearest_batch(BVHTree *tree,
+                                    const float (*co)[3],
+                                    const int co_len,
+                                    BVHTreeNearest *nearest,
+                                    BVHTree_NearestPointCallback callback,
+                                    void *userdata,
+                                    int flag)
+{
+  if (co_len == 0) {
+    return;
+  }
+
+  void *order_mem;
+  BVHNearestBatchData batch = {
+      .tree = tree,
+      .co = co,
+      .nearest = nearest,
+      .order = bvh_batch_order_create(co, NULL, co_len, &order_mem),
+      .len = co_len,
+      .callback = callback,
+      .userdata = userdata,
+      .flag = flag,
+  };
+  BVHBatchTLS batch_tls = {NULL};
+
+  TaskParallelSettings settings;
+  bvhtree_batch_settings(&settings, co_len, &batch_tls);
+  BLI_task_parallel_range(0,
+                          (co_len + BVH_BATCH_CHUNK_SIZE - 1) / BVH_BATCH_CHUNK_SIZE,
+                          &batch,
+                          bvhtree_find_nearest_batch_cb,
+                          &settings);
+
+  MEM_freeN(order_mem);
+}
+
+typedef struct BVHRayCastBatchData {
+  const BVHTree *tree;
+  const float (*co)[3];
+  const float (*dir)[3];
+  float radius;
+  BVHTreeRayHit *hit;
+  const BVHBatchOrder *order;
+  int len;
+
+  BVHTree_RayCastCallback callback;
+  void *userdata;
+  int flag;
+} BVHRayCastBatchData;
+
+static void bvhtree_ray_cast_batch_cb(void *__restrict userdata,
+                                      const int chunk,
+                                      const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const BVHRayCastBatchData *batch = userdata;
+  const int i_end = min_ii((chunk + 1) * BVH_BATCH_CHUNK_SIZE, batch->len);
+
+  BVHRayCastData data;
+  data.tree = batch->tree;
+  data.callback = batch->callback;
+  data.userdata = batch->userdata;
+  data.ray.radius = batch->radius;
+
+  for (int i = chunk * BVH_BATCH_CHUNK_SIZE; i < i_end; i++) {
+    const int index = batch->order[i].index;
+    BVHTreeRayHit *hit = &batch->hit[index];
+
+    BLI_ASSERT_UNIT_V3(batch->dir[index]);
+
+    copy_v3_v3(data.ray.origin, batch->co[index]);
+    copy_v3_v3(data.ray.direction, batch->dir[index]);
+    bvhtree_ray_cast_data_precalc(&data, batch->flag);
+
+    memcpy(&data.hit, hit, sizeof(*hit));
+    bvhtree_ray_cast_search(&data);
+    memcpy(hit, &data.hit, sizeof(*hit));
+  }
+}
+
+/**
+ * Batch version of #BLI_bvhtree_ray_cast_ex.
+ *
+ * \param hit: Array of `rays_len` items, used as input in the same way
+ * #BLI_bvhtree_ray_cast_ex uses it (a zero `dist` skips the ray).
+ * \param callback: Must be thread-safe, called from multiple threads at once.
+ */
+void BLI_bvhtree_ray_cast_batch(BVHTree *tree,
+                                const float (*co)[3],
+                                const float (*dir)[3],
+                                const int rays_len,
+                                float radius,
+                                BVHTreeRayHit *hit,
+                                BVHTree_RayCastCallback callback,
+                                void *userdata,
+                                int flag)
+{
+  if (rays_len == 0) {
+    return;
+  }
+
+  void *order_mem;
+  BVHRayCastBatchData batch = {
+      .tree = tree,
+      .co = co,
+      .dir = dir,
+      .radius = radius,
+      .hit = hit,
+      .order = bvh_batch_order_create(co, dir, rays_len, &order_mem),
+      .len = rays_len,
+      .callback = callback,
+      .userdata = userdata,
+      .flag = flag,
+  };
+  BVHBatchTLS batch_tls = {NULL};
+
+  TaskParallelSettings settings;
+  bvhtree_batch_settings(&settings, rays_len, &batch_tls);
+  BLI_task_parallel_range(0,
+                          (rays_len + BVH_BATCH_CHUNK_SIZE - 1) / BVH_BATCH_CHUNK_SIZE,
+                          &batch,
+                          bvhtree_ray_cast_batch_cb,
+                          &settings);
+
+  MEM_freeN(order_mem);
+}
+
+/** \} */
+
 /* -------------------------------------------------------------------- */
 /** \name BLI_bvhtree_range_query
  *
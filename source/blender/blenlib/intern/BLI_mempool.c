@@ -34,6 +34,7 @@
 
 #include "atomic_ops.h"
 
+#include "BLI_threads.h"
 #include "BLI_utildefines.h"
 
 #include "BLI_mempool.h" /* own include */
@@ -46,6 +47,24 @@
 #  include "valgrind/memcheck.h"
 #endif
 
+#ifdef _MSC_VER
+#  include <intrin.h>
+#endif
+
+/* Spin-lock hint for processors with hyperthreading. */
+#if defined(_MSC_VER)
+#  define MEMPOOL_CPU_PAUSE() _mm_pause()
+#elif defined(__i386__) || defined(__x86_64__)
+#  define MEMPOOL_CPU_PAUSE() __builtin_ia32_pause()
+#elif defined(__aarch64__)
+#  define MEMPOOL_CPU_PAUSE() __asm__ __volatile__("yield")
+#else
+#  define MEMPOOL_CPU_PAUSE() ((void)0)
+#endif
+
+/* Most pause hints between two attempts to take the lock of a concurrent pool. */
+#define MEMPOOL_LOCK_BACKOFF_MAX 64
+
 /* note: copied from BLO_blend_defs.h, don't use here because we're in BLI */
 #ifdef __BIG_ENDIAN__
 /* Big Endian */
@@ -135,8 +154,40 @@ struct BLI_mempool {
   /** Number of elements allocated in total. */
   uint totalloc;
 #endif
+  /** Only for #BLI_MEMPOOL_CONCURRENT pools, NULL otherwise. */
+  struct BLI_mempool_concurrent *concurrent;
 };
 
+/**
+ * Free elements owned by a single thread, see #BLI_mempool_alloc_threadsafe.
+ *
+ * Only ever accessed by the thread it belongs to (or by #BLI_mempool_threadsafe_sync
+ * once all threads are done), so none of this needs to be synchronized.
+ */
+typedef struct BLI_mempool_tcache {
+  /** Elements this thread allocates from. */
+  BLI_freenode *free;
+  /** Elements freed by this thread, handed back to the pool once there are enough of them. */
+  BLI_freenode *freed;
+  BLI_freenode *freed_tail;
+  uint freed_len;
+  /** Change of #BLI_mempool.totused, applied on sync. */
+  int totused_delta;
+} BLI_mempool_tcache;
+
+typedef struct BLI_mempool_concurrent {
+  /**
+   * Protects the chunk list and #BLI_mempool.free, never held while allocating memory.
+   * A plain atomic flag rather than a #SpinLock, since this file is also built into `makesdna`
+   * which doesn't link the threading API.
+   */
+  uint32_t lock;
+  /** Lock-free stack of elements returned by other threads, only ever popped as a whole. */
+  BLI_freenode *free_shared;
+  /** Per thread caches, indexed by thread ID, allocated on first use. */
+  BLI_mempool_tcache *tcache[BLENDER_MAX_THREADS];
+} BLI_mempool_concurrent;
+
 #define MEMPOOL_ELEM_SIZE_MIN (sizeof(void *) * 2)
 
 #define CHUNK_DATA(chunk) (CHECK_TYPE_INLINE(chunk, BLI_mempool_chunk *), (void *)((chunk) + 1))
@@ -316,6 +367,13 @@ BLI_mempool *BLI_mempool_create(uint esize, uint totelem, uint pchunk, uint flag
 #endif
   pool->totused = 0;
 
+  if (flag & BLI_MEMPOOL_CONCURRENT) {
+    pool->concurrent = MEM_callocN(sizeof(*pool->concurrent), "memory pool concurrent");
+  }
+  else {
+    pool->concurrent = NULL;
+  }
+
   if (totelem) {
     /* Allocate the actual chunks. */
     for (i = 0; i < maxchunks; i++) {
@@ -451,6 +509,338 @@ void BLI_mempool_free(BLI_mempool *pool, void *addr)
   }
 }
 
+/* -------------------------------------------------------------------- */
+/** \name Concurrent Access
+ *
+ * Pools created with #BLI_MEMPOOL_CONCURRENT can be allocated from and freed into by many
+ * threads at once. Each thread works on its own cache of free elements, taking whole batches
+ * from the pool when it runs out, so the common case doesn't touch any shared state.
+ * Elements freed by one thread are handed back in batches through a lock-free stack,
+ * where other threads can pick them up.
+ *
+ * Since elements keep being marked with #FREEWORD and chunks are still linked into
+ * #BLI_mempool.chunks, iteration works as usual once all threads are done.
+ * \{ */
+
+static void mempool_concurrent_lock(BLI_mempool_concurrent *mpc)
+{
+  uint backoff = 1;
+  while (atomic_cas_uint32(&mpc->lock, 0, 1) != 0) {
+    /* Only read the lock while it's taken, waiting longer after every failed attempt,
+     * so contending threads don't keep moving its cache line between them. */
+    do {
+      for (uint i = 0; i < backoff; i++) {
+        MEMPOOL_CPU_PAUSE();
+      }
+      if (backoff < MEMPOOL_LOCK_BACKOFF_MAX) {
+        backoff *= 2;
+      }
+    } while (atomic_load_acquire_uint32(&mpc->lock) != 0);
+  }
+}
+
+static void mempool_concurrent_unlock(BLI_mempool_concurrent *mpc)
+{
+  atomic_store_release_uint32(&mpc->lock, 0);
+}
+
+/**
+ * Push a linked list of free elements on the shared stack, without locking.
+ */
+static void mempool_free_shared_push(BLI_mempool_concurrent *mpc,
+                                     BLI_freenode *head,
+                                     BLI_freenode *tail)
+{
+  BLI_freenode *head_prev;
+  do {
+    head_prev = mpc->free_shared;
+    tail->next = head_prev;
+  } while (atomic_cas_ptr((void **)&mpc->free_shared, head_prev, head) != head_prev);
+}
+
+/**
+ * Take all elements from the shared stack.
+ *
+ * \note Only ever popping the whole stack at once avoids the ABA problem.
+ */
+static BLI_freenode *mempool_free_shared_pop_all(BLI_mempool_concurrent *mpc)
+{
+  BLI_freenode *head;
+  do {
+    head = mpc->free_shared;
+  } while (head && (atomic_cas_ptr((void **)&mpc->free_shared, head, NULL) != head));
+  return head;
+}
+
+/**
+ * Allocate and initialize a new chunk without holding the lock, then link it into the pool.
+ *
+ * \return The first free element of the chunk, \a r_tail is set to the last one.
+ */
+static BLI_freenode *mempool_concurrent_chunk_add(BLI_mempool *pool, BLI_freenode **r_tail)
+{
+  BLI_mempool_concurrent *mpc = pool->concurrent;
+  const uint esize = pool->esize;
+  BLI_mempool_chunk *mpchunk = mempool_chunk_alloc(pool);
+  BLI_freenode *curnode = CHUNK_DATA(mpchunk);
+  for (uint j = pool->pchunk; j--;) {
+    curnode->next = NODE_STEP_NEXT(curnode);
+    if (pool->flag & BLI_MEMPOOL_ALLOW_ITER) {
+      curnode->freeword = FREEWORD;
+    }
+    curnode = curnode->next;
+  }
+  curnode = NODE_STEP_PREV(curnode);
+  curnode->next = NULL;
+  *r_tail = curnode;
+
+  mpchunk->next = NULL;
+  mempool_concurrent_lock(mpc);
+  if (pool->chunk_tail) {
+    pool->chunk_tail->next = mpchunk;
+  }
+  else {
+    pool->chunks = mpchunk;
+  }
+  pool->chunk_tail = mpchunk;
+#ifdef USE_TOTALLOC
+  pool->totalloc += pool->pchunk;
+#endif
+  mempool_concurrent_unlock(mpc);
+
+  return CHUNK_DATA(mpchunk);
+}
+
+static BLI_mempool_tcache *mempool_tcache_ensure(BLI_mempool *pool, const int thread_id)
+{
+  BLI_assert(pool->concurrent != NULL);
+  BLI_assert(thread_id >= 0 && thread_id < BLENDER_MAX_THREADS);
+
+  /* Each slot is only written by its own thread. */
+  BLI_mempool_tcache **tc_p = &pool->concurrent->tcache[thread_id];
+  if (UNLIKELY(*tc_p == NULL)) {
+    *tc_p = MEM_callocN(sizeof(**tc_p), __func__);
+  }
+  return *tc_p;
+}
+
+/**
+ * Fill the empty free list of a thread cache, taking elements from (in order of preference):
+ * the elements this thread freed, those other threads handed back,
+ * the free list of the pool and finally a newly allocated chunk.
+ */
+static void mempool_tcache_refill(BLI_mempool *pool, BLI_mempool_tcache *tc)
+{
+  BLI_mempool_concurrent *mpc = pool->concurrent;
+  BLI_assert(tc->free == NULL);
+
+  if (tc->freed) {
+    tc->free = tc->freed;
+    tc->freed = NULL;
+    tc->freed_tail = NULL;
+    tc->freed_len = 0;
+    return;
+  }
+
+  if ((tc->free = mempool_free_shared_pop_all(mpc))) {
+    return;
+  }
+
+  mempool_concurrent_lock(mpc);
+  if (pool->free) {
+    /* Take at most a chunk worth of elements, leaving the rest to other threads. */
+    BLI_freenode *head = pool->free, *tail = head;
+    for (uint i = 1; (i < pool->pchunk) && tail->next; i++) {
+      tail = tail->next;
+    }
+    pool->free = tail->next;
+    tail->next = NULL;
+    mempool_concurrent_unlock(mpc);
+    tc->free = head;
+    return;
+  }
+  mempool_concurrent_unlock(mpc);
+
+  BLI_freenode *tail;
+  tc->free = mempool_concurrent_chunk_add(pool, &tail);
+}
+
+/**
+ * Allocate an element, may be called from multiple threads at once,
+ * the pool must be created with #BLI_MEMPOOL_CONCURRENT.
+ *
+ * \param thread_id: Unique ID of the calling thread (typically from
+ * #BLI_task_parallel_thread_id), or -1 to allocate directly from the pool (slower).
+ */
+void *BLI_mempool_alloc_threadsafe(BLI_mempool *pool, const int thread_id)
+{
+  BLI_mempool_concurrent *mpc = pool->concurrent;
+  BLI_freenode *free_pop;
+
+  if (thread_id == -1) {
+    mempool_concurrent_lock(mpc);
+    free_pop = pool->free;
+    if (LIKELY(free_pop)) {
+      pool->free = free_pop->next;
+    }
+    mempool_concurrent_unlock(mpc);
+
+    if (UNLIKELY(free_pop == NULL)) {
+      /* Keep the first element of a new chunk, the others go to the free list of the pool. */
+      BLI_freenode *tail;
+      free_pop = mempool_concurrent_chunk_add(pool, &tail);
+      if (free_pop != tail) {
+        mempool_concurrent_lock(mpc);
+        tail->next = pool->free;
+        pool->free = free_pop->next;
+        mempool_concurrent_unlock(mpc);
+      }
+    }
+    atomic_add_and_fetch_uint32(&pool->totused, 1);
+  }
+  else {
+    BLI_mempool_tcache *tc = mempool_tcache_ensure(pool, thread_id);
+    if (UNLIKELY(tc->free == NULL)) {
+      mempool_tcache_refill(pool, tc);
+    }
+    free_pop = tc->free;
+    tc->free = free_pop->next;
+    tc->totused_delta++;
+  }
+
+  if (pool->flag & BLI_MEMPOOL_ALLOW_ITER) {
+    free_pop->freeword = USEDWORD;
+  }
+
+#ifdef WITH_MEM_VALGRIND
+  VALGRIND_MEMPOOL_ALLOC(pool, free_pop, pool->esize);
+#endif
+
+  return (void *)free_pop;
+}
+
+void *BLI_mempool_calloc_threadsafe(BLI_mempool *pool, const int thread_id)
+{
+  void *retval = BLI_mempool_alloc_threadsafe(pool, thread_id);
+  memset(retval, 0, (size_t)pool->esize);
+  return retval;
+}
+
+/**
+ * Free an element, may be called from multiple threads at once, also for elements
+ * allocated by other threads. The pool must be created with #BLI_MEMPOOL_CONCURRENT.
+ *
+ * \param thread_id: Unique ID of the calling thread, or -1 to return the element
+ * to the pool directly.
+ */
+void BLI_mempool_free_threadsafe(BLI_mempool *pool, void *addr, const int thread_id)
+{
+  BLI_mempool_concurrent *mpc = pool->concurrent;
+  BLI_freenode *newhead = addr;
+
+#ifndef NDEBUG
+  if (UNLIKELY(mempool_debug_memset)) {
+    memset(addr, 255, pool->esize);
+  }
+#endif
+
+  if (pool->flag & BLI_MEMPOOL_ALLOW_ITER) {
+#ifndef NDEBUG
+    /* This will detect double free's. */
+    BLI_assert(newhead->freeword != FREEWORD);
+#endif
+    newhead->freeword = FREEWORD;
+  }
+
+  if (thread_id == -1) {
+    mempool_free_shared_push(mpc, newhead, newhead);
+    atomic_sub_and_fetch_uint32(&pool->totused, 1);
+  }
+  else {
+    BLI_mempool_tcache *tc = mempool_tcache_ensure(pool, thread_id);
+    newhead->next = tc->freed;
+    if (tc->freed == NULL) {
+      tc->freed_tail = newhead;
+    }
+    tc->freed = newhead;
+    tc->totused_delta--;
+
+    /* Hand a chunk worth of elements back, so threads which mostly free
+     * (elements allocated by other threads) don't hoard them. */
+    if (++tc->freed_len == pool->pchunk) {
+      mempool_free_shared_push(mpc, tc->freed, tc->freed_tail);
+      tc->freed = NULL;
+      tc->freed_tail = NULL;
+      tc->freed_len = 0;
+    }
+  }
+
+#ifdef WITH_MEM_VALGRIND
+  VALGRIND_MEMPOOL_FREE(pool, addr);
+#endif
+}
+
+static void mempool_free_prepend(BLI_mempool *pool, BLI_freenode *head)
+{
+  if (head == NULL) {
+    return;
+  }
+  BLI_freenode *tail = head;
+  while (tail->next) {
+    tail = tail->next;
+  }
+  tail->next = pool->free;
+  pool->free = head;
+}
+
+/**
+ * Move the elements cached by threads back into the pool and update its element count.
+ *
+ * Must be called once all threads are done with #BLI_mempool_alloc_threadsafe and
+ * #BLI_mempool_free_threadsafe, before the pool is used by any of the other functions
+ * (except for iteration, which doesn't depend on this).
+ */
+void BLI_mempool_threadsafe_sync(BLI_mempool *pool)
+{
+  BLI_mempool_concurrent *mpc = pool->concurrent;
+  BLI_assert(mpc != NULL);
+
+  for (int i = 0; i < BLENDER_MAX_THREADS; i++) {
+    BLI_mempool_tcache *tc = mpc->tcache[i];
+    if (tc == NULL) {
+      continue;
+    }
+    mempool_free_prepend(pool, tc->free);
+    mempool_free_prepend(pool, tc->freed);
+    pool->totused = (uint)((int)pool->totused + tc->totused_delta);
+    memset(tc, 0, sizeof(*tc));
+  }
+  mempool_free_prepend(pool, mempool_free_shared_pop_all(mpc));
+}
+
+/**
+ * Forget about all cached elements, for when the pool is re-initialized anyway.
+ */
+static void mempool_concurrent_reset(BLI_mempool_concurrent *mpc)
+{
+  for (int i = 0; i < BLENDER_MAX_THREADS; i++) {
+    if (mpc->tcache[i]) {
+      memset(mpc->tcache[i], 0, sizeof(*mpc->tcache[i]));
+    }
+  }
+  mpc->free_shared = NULL;
+}
+
+static void mempool_concurrent_free(BLI_mempool_concurrent *mpc)
+{
+  for (int i = 0; i < BLENDER_MAX_THREADS; i++) {
+    MEM_SAFE_FREE(mpc->tcache[i]);
+  }
+  MEM_freeN(mpc);
+}
+
+/** \} */
+
 int BLI_mempool_len(BLI_mempool *pool)
 {
   return (int)pool->totused;
@@ -726,6 +1116,10 @@ void BLI_mempool_clear_ex(BLI_mempool *pool, const int totelem_reserve)
     } while ((mpchunk = mpchunk_next));
   }
 
+  if (pool->concurrent) {
+    mempool_concurrent_reset(pool->concurrent);
+  }
+
   /* re-initialize */
   pool->free = NULL;
   pool->totused = 0;
@@ -758,6 +1152,10 @@ void BLI_mempool_destroy(BLI_mempool *pool)
 {
   mempool_chunk_free_all(pool->chunks);
 
+  if (pool->concurrent) {
+    mempool_concurrent_free(pool->concurrent);
+  }
+
 #ifdef WITH_MEM_VALGRIND
   VALGRIND_DESTROY_MEMPOOL(pool);
 #endif
@@ -0,0 +1,192 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup bli
+ */
+
+#include <string.h>
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_fileops.h"
+#include "BLI_mmap.h"
+
+#ifndef WIN32
+#  include <pthread.h>
+#  include <signal.h>
+#  include <stdint.h>
+#  include <sys/mman.h>
+#  include <unistd.h>
+#else
+#  include <io.h>
+#  include <windows.h>
+#endif
+
+struct BLI_mmap_file {
+  /* Address the file is mapped to. */
+  char *memory;
+  /* Length of the file, which is also the length of the mapped memory. */
+  size_t length;
+#ifdef WIN32
+  HANDLE handle;
+#else
+  /* Set by the SIGBUS handler when accessing the mapped memory failed. */
+  volatile bool io_error;
+#endif
+};
+
+#ifndef WIN32
+
+/* Accessing a page of the mapping which can not be read from the file raises SIGBUS.
+ * The handler replaces such pages with zeros so the interrupted copy can finish, and flags the
+ * file so BLI_mmap_read() reports the failure.
+ *
+ * The file being read is stored per thread, since the signal is delivered to the thread which
+ * caused it. Compiler TLS is used instead of ThreadLocal(), which uses POSIX thread keys on some
+ * platforms, and those are not safe to access from a signal handler. It is volatile so the
+ * stores around the copy are not optimized away. */
+static __thread BLI_mmap_file *volatile mmap_file_reading = NULL;
+
+static struct sigaction sigbus_action_prev;
+static size_t mmap_page_size;
+
+static void sigbus_handler(int sig, siginfo_t *siginfo, void *context)
+{
+  BLI_mmap_file *file = mmap_file_reading;
+  char *error_addr = (char *)siginfo->si_addr;
+
+  if (file != NULL && error_addr >= file->memory && error_addr < file->memory + file->length) {
+    char *page = (char *)((uintptr_t)error_addr & ~(uintptr_t)(mmap_page_size - 1));
+    file->io_error = true;
+    if (mmap(page,
+             mmap_page_size,
+             PROT_READ,
+             MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED,
+             -1,
+             0) != MAP_FAILED) {
+      return;
+    }
+  }
+
+  /* Not caused by reading a mapped file, let the previous handler deal with it. */
+  if (sigbus_action_prev.sa_flags & SA_SIGINFO) {
+    sigbus_action_prev.sa_sigaction(sig, siginfo, context);
+  }
+  else if (ELEM(sigbus_action_prev.sa_handler, SIG_DFL, SIG_IGN)) {
+    /* Returning re-executes the faulting instruction, which now crashes as usual. */
+    signal(SIGBUS, SIG_DFL);
+  }
+  else {
+    sigbus_action_prev.sa_handler(sig);
+  }
+}
+
+static void sigbus_handler_install(void)
+{
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  action.sa_sigaction = sigbus_handler;
+  action.sa_flags = SA_SIGINFO;
+  sigemptyset(&action.sa_mask);
+
+  mmap_page_size = (size_t)sysconf(_SC_PAGESIZE);
+  sigaction(SIGBUS, &action, &sigbus_action_prev);
+}
+
+static pthread_once_t sigbus_handler_once = PTHREAD_ONCE_INIT;
+
+#endif /* WIN32 */
+
+BLI_mmap_file *BLI_mmap_open(int fd)
+{
+  const size_t length = BLI_file_descriptor_size(fd);
+  if (ELEM(length, 0, (size_t)-1)) {
+    return NULL;
+  }
+
+#ifdef WIN32
+  HANDLE handle = CreateFileMapping((HANDLE)_get_osfhandle(fd), NULL, PAGE_READONLY, 0, 0, NULL);
+  if (handle == NULL) {
+    return NULL;
+  }
+  void *memory = MapViewOfFile(handle, FILE_MAP_READ, 0, 0, 0);
+  if (memory == NULL) {
+    CloseHandle(handle);
+    return NULL;
+  }
+#else
+  void *memory = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (memory == MAP_FAILED) {
+    return NULL;
+  }
+  pthread_once(&sigbus_handler_once, sigbus_handler_install);
+#endif
+
+  BLI_mmap_file *file = MEM_callocN(sizeof(BLI_mmap_file), __func__);
+  file->memory = memory;
+  file->length = length;
+#ifdef WIN32
+  file->handle = handle;
+#endif
+  return file;
+}
+
+bool BLI_mmap_read(BLI_mmap_file *file, void *dest, size_t offset, size_t length)
+{
+  if (offset > file->length || length > file->length - offset) {
+    return false;
+  }
+
+#ifdef WIN32
+#  ifdef _MSC_VER
+  __try {
+    memcpy(dest, file->memory + offset, length);
+  }
+  __except (GetExceptionCode() == EXCEPTION_IN_PAGE_ERROR ? EXCEPTION_EXECUTE_HANDLER :
+                                                            EXCEPTION_CONTINUE_SEARCH) {
+    return false;
+  }
+#  else
+  memcpy(dest, file->memory + offset, length);
+#  endif
+  return true;
+#else
+  if (file->io_error) {
+    return false;
+  }
+  mmap_file_reading = file;
+  memcpy(dest, file->memory + offset, length);
+  mmap_file_reading = NULL;
+  return !file->io_error;
+#endif
+}
+
+size_t BLI_mmap_get_length(const BLI_mmap_file *file)
+{
+  return file->length;
+}
+
+void BLI_mmap_free(BLI_mmap_file *file)
+{
+#ifdef WIN32
+  UnmapViewOfFile(file->memory);
+  CloseHandle(file->handle);
+#else
+  munmap(file->memory, file->length);
+#endif
+  MEM_freeN(file);
+}
@@ -0,0 +1,1068 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup bli
+ *
+ * Open addressing hash table behind the #OAHash and #OASet C API.
+ *
+ * Slots are grouped by 16, each group stores a control byte per slot followed by the slots
+ * themselves, a key and value next to each other. A control byte is either #CTRL_EMPTY,
+ * #CTRL_DUMMY or the 7 highest bits of the (mixed) hash of the key stored in the slot.
+ * Lookups compare the control bytes of a whole group at once and only call the comparison
+ * function for slots with matching bits, probing stops at the first group that has an empty
+ * slot. Since few slots are compared, the table can be filled up to #MAX_LOAD_NUMERATOR /
+ * #MAX_LOAD_DENOMINATOR (counting dummies) before it grows.
+ */
+
+#include <string.h>
+
+#ifdef __SSE2__
+#  include <emmintrin.h>
+#endif
+
+#if defined(__GNUC__)
+#  define OAHASH_PREFETCH(ptr) __builtin_prefetch(ptr)
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#  include <xmmintrin.h>
+#  define OAHASH_PREFETCH(ptr) _mm_prefetch((const char *)(ptr), _MM_HINT_T0)
+#else
+#  define OAHASH_PREFETCH(ptr) ((void)0)
+#endif
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_utildefines.h"
+
+#include "BLI_ghash.h"
+#include "BLI_math_base.h"
+#include "BLI_math_bits.h"
+#include "BLI_oahash.h" /* own include */
+
+namespace BLI {
+
+static constexpr uint8_t CTRL_EMPTY = 0x80;
+static constexpr uint8_t CTRL_DUMMY = 0xFE;
+
+static constexpr uint SLOTS_PER_GROUP = 16;
+static constexpr uint MAX_LOAD_NUMERATOR = 7;
+static constexpr uint MAX_LOAD_DENOMINATOR = 8;
+
+template<bool HasValues> struct OASlot {
+  void *key;
+  void *value;
+};
+
+template<> struct OASlot<false> {
+  void *key;
+};
+
+template<bool HasValues> struct OAGroup {
+  uint8_t ctrl[SLOTS_PER_GROUP];
+  OASlot<HasValues> slots[SLOTS_PER_GROUP];
+
+  /** Bit-mask of the slots which have \a tag as control byte. */
+  uint match(const uint8_t tag) const
+  {
+#ifdef __SSE2__
+    const __m128i group = _mm_loadu_si128((const __m128i *)ctrl);
+    return (uint)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char)tag)));
+#else
+    uint mask = 0;
+    for (uint i = 0; i < SLOTS_PER_GROUP; i++) {
+      mask |= (uint)(ctrl[i] == tag) << i;
+    }
+    return mask;
+#endif
+  }
+
+  /**
+   * Start loading the slots while the control bytes are compared, so a lookup in a large table
+   * waits for memory once instead of twice (the slots span multiple cache lines).
+   */
+  void prefetch_slots() const
+  {
+    for (size_t offset = 64; offset < sizeof(*this); offset += 64) {
+      OAHASH_PREFETCH((const char *)this + offset);
+    }
+  }
+
+  uint match_empty() const
+  {
+    return this->match(CTRL_EMPTY);
+  }
+
+  /** Both empty and dummy control bytes have the highest bit set, set slots don't. */
+  uint match_empty_or_dummy() const
+  {
+#ifdef __SSE2__
+    return (uint)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)ctrl));
+#else
+    uint mask = 0;
+    for (uint i = 0; i < SLOTS_PER_GROUP; i++) {
+      mask |= (uint)(ctrl[i] >> 7) << i;
+    }
+    return mask;
+#endif
+  }
+
+  uint match_set() const
+  {
+    return ~this->match_empty_or_dummy() & 0xFFFF;
+  }
+};
+
+}  // namespace BLI
+
+using BLI::CTRL_DUMMY;
+using BLI::CTRL_EMPTY;
+using BLI::SLOTS_PER_GROUP;
+
+/**
+ * Part shared by maps and sets, so iterators don't need to know which one they're used on.
+ */
+struct OAHash {
+  GHashHashFP hashfp;
+  GHashCmpFP cmpfp;
+  bool is_set;
+};
+
+template<bool HasValues> class OATable : public OAHash {
+ private:
+  using Group = BLI::OAGroup<HasValues>;
+
+  Group *m_groups;
+  /** The number of groups is a power of two. */
+  uint m_groups_mask;
+  uint m_slots_set;
+  uint m_slots_dummy;
+  /** Grow (or clean up dummies) once this many slots are set or dummy. */
+  uint m_slots_usable;
+
+  struct Hash {
+    uint group;
+    uint8_t tag;
+  };
+
+  Hash hash_key(const void *key) const
+  {
+    /* Many of the hash functions in use are weak (e.g. pointers with the low bits unset),
+     * mix the bits so both the group index and the tag are spread. */
+    const uint mixed = this->hashfp(key) * 0x9E3779B1u;
+    return {mixed ^ (mixed >> 15), (uint8_t)(mixed >> 25)};
+  }
+
+  /* Triangular probing visits every group when their number is a power of two. */
+#define PROBE_GROUPS_BEGIN(HASH, R_GROUP_INDEX) \
+  { \
+    const uint _mask = m_groups_mask; \
+    uint R_GROUP_INDEX = (HASH).group & _mask; \
+    for (uint _step = 1;; R_GROUP_INDEX = (R_GROUP_INDEX + _step++) & _mask) {
+#define PROBE_GROUPS_END \
+  } \
+  } \
+  ((void)0)
+
+ public:
+#ifdef WITH_CXX_GUARDEDALLOC
+  MEM_CXX_CLASS_ALLOC_FUNCS("OAHash")
+#endif
+
+  OATable(GHashHashFP hashfp_, GHashCmpFP cmpfp_, const uint nentries_reserve)
+  {
+    this->hashfp = hashfp_;
+    this->cmpfp = cmpfp_;
+    this->is_set = !HasValues;
+    this->init(nentries_reserve);
+  }
+
+  OATable(const OATable &other) : OAHash(other)
+  {
+    const size_t groups_size = sizeof(Group) * (other.m_groups_mask + 1);
+    m_groups = (Group *)MEM_mallocN(groups_size, "OAHash groups");
+    memcpy(m_groups, other.m_groups, groups_size);
+    m_groups_mask = other.m_groups_mask;
+    m_slots_set = other.m_slots_set;
+    m_slots_dummy = other.m_slots_dummy;
+    m_slots_usable = other.m_slots_usable;
+  }
+
+  OATable &operator=(const OATable &other) = delete;
+
+  ~OATable()
+  {
+    MEM_freeN(m_groups);
+  }
+
+  uint len() const
+  {
+    return m_slots_set;
+  }
+
+  uint slots_total() const
+  {
+    return (m_groups_mask + 1) * SLOTS_PER_GROUP;
+  }
+
+  bool slot_is_set(const uint slot) const
+  {
+    return (m_groups[slot >> 4].ctrl[slot & 15] & 0x80) == 0;
+  }
+
+  void **slot_key(const uint slot)
+  {
+    return &m_groups[slot >> 4].slots[slot & 15].key;
+  }
+
+  void **slot_value(const uint slot)
+  {
+    BLI_assert(HasValues);
+    /* Sets never get here, the cast only keeps them compiling. */
+    return &reinterpret_cast<BLI::OASlot<true> *>(&m_groups[slot >> 4].slots[slot & 15])->value;
+  }
+
+  /** \return the slot of \a key or -1 when it isn't in the table. */
+  int find(const void *key) const
+  {
+    const Hash hash = this->hash_key(key);
+    PROBE_GROUPS_BEGIN (hash, group_index) {
+      const Group &group = m_groups[group_index];
+      group.prefetch_slots();
+      for (uint mask = group.match(hash.tag); mask; mask &= mask - 1) {
+        const uint offset = bitscan_forward_uint(mask);
+        if (!this->cmpfp(key, group.slots[offset].key)) {
+          return (int)((group_index << 4) | offset);
+        }
+      }
+      if (group.match_empty()) {
+        return -1;
+      }
+    }
+    PROBE_GROUPS_END;
+  }
+
+  /**
+   * \return the slot of \a key, when it isn't in the table yet a slot is claimed for it
+   * (with its key and value left uninitialized) and \a r_added is set.
+   */
+  uint find_or_add(const void *key, bool *r_added)
+  {
+    this->ensure_can_add();
+    const Hash hash = this->hash_key(key);
+    int slot_free = -1;
+    PROBE_GROUPS_BEGIN (hash, group_index) {
+      const Group &group = m_groups[group_index];
+      group.prefetch_slots();
+      for (uint mask = group.match(hash.tag); mask; mask &= mask - 1) {
+        const uint offset = bitscan_forward_uint(mask);
+        if (!this->cmpfp(key, group.slots[offset].key)) {
+          *r_added = false;
+          return (group_index << 4) | offset;
+        }
+      }
+      if (slot_free == -1) {
+        const uint mask = group.match_empty_or_dummy();
+        if (mask) {
+          slot_free = (int)((group_index << 4) | bitscan_forward_uint(mask));
+        }
+      }
+      if (group.match_empty()) {
+        break;
+      }
+    }
+    PROBE_GROUPS_END;
+
+    *r_added = true;
+    this->claim((uint)slot_free, hash.tag);
+    return (uint)slot_free;
+  }
+
+  /** Claim a slot for a key which isn't in the table, without any comparisons. */
+  uint add_new(const void *key)
+  {
+    BLI_assert(this->find(key) == -1);
+    this->ensure_can_add();
+    const Hash hash = this->hash_key(key);
+    const uint slot = this->find_free_slot(hash);
+    this->claim(slot, hash.tag);
+    return slot;
+  }
+
+  void remove_slot(const uint slot)
+  {
+    BLI_assert(this->slot_is_set(slot));
+    Group &group = m_groups[slot >> 4];
+    /* Probing never continues past a group with an empty slot,
+     * so the slot doesn't have to be kept as a dummy in that case. */
+    if (group.match_empty()) {
+      group.ctrl[slot & 15] = CTRL_EMPTY;
+    }
+    else {
+      group.ctrl[slot & 15] = CTRL_DUMMY;
+      m_slots_dummy++;
+    }
+    m_slots_set--;
+  }
+
+  void reserve(const uint nentries_reserve)
+  {
+    if (m_slots_usable < nentries_reserve) {
+      this->rehash(nentries_reserve);
+    }
+  }
+
+  void free_items(GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp)
+  {
+    if (keyfreefp == NULL && valfreefp == NULL) {
+      return;
+    }
+    for (uint group_index = 0; group_index <= m_groups_mask; group_index++) {
+      Group &group = m_groups[group_index];
+      for (uint mask = group.match_set(); mask; mask &= mask - 1) {
+        const uint offset = bitscan_forward_uint(mask);
+        if (keyfreefp) {
+          keyfreefp(group.slots[offset].key);
+        }
+        if (HasValues && valfreefp) {
+          valfreefp(*this->slot_value((group_index << 4) | offset));
+        }
+      }
+    }
+  }
+
+  void clear(const uint nentries_reserve)
+  {
+    MEM_freeN(m_groups);
+    this->init(nentries_reserve);
+  }
+
+ private:
+  static uint groups_len_for_reserve(const uint nentries_reserve)
+  {
+    const uint64_t slots_min = ((uint64_t)nentries_reserve * BLI::MAX_LOAD_DENOMINATOR +
+                                BLI::MAX_LOAD_NUMERATOR - 1) /
+                               BLI::MAX_LOAD_NUMERATOR;
+    return power_of_2_max_u(MAX2((uint)((slots_min + SLOTS_PER_GROUP - 1) / SLOTS_PER_GROUP), 1));
+  }
+
+  void init(const uint nentries_reserve)
+  {
+    const uint groups_len = groups_len_for_reserve(nentries_reserve);
+    m_groups = (Group *)MEM_mallocN(sizeof(Group) * groups_len, "OAHash groups");
+    for (uint i = 0; i < groups_len; i++) {
+      memset(m_groups[i].ctrl, CTRL_EMPTY, sizeof(m_groups[i].ctrl));
+    }
+    m_groups_mask = groups_len - 1;
+    m_slots_set = 0;
+    m_slots_dummy = 0;
+    m_slots_usable = groups_len * SLOTS_PER_GROUP / BLI::MAX_LOAD_DENOMINATOR *
+                     BLI::MAX_LOAD_NUMERATOR;
+  }
+
+  uint find_free_slot(const Hash &hash) const
+  {
+    PROBE_GROUPS_BEGIN (hash, group_index) {
+      const uint mask = m_groups[group_index].match_empty_or_dummy();
+      if (mask) {
+        return (group_index << 4) | bitscan_forward_uint(mask);
+      }
+    }
+    PROBE_GROUPS_END;
+  }
+
+  void claim(const uint slot, const uint8_t tag)
+  {
+    uint8_t &ctrl = m_groups[slot >> 4].ctrl[slot & 15];
+    if (ctrl == CTRL_DUMMY) {
+      m_slots_dummy--;
+    }
+    else {
+      BLI_assert(ctrl == CTRL_EMPTY);
+    }
+    m_slots_set++;
+    ctrl = tag;
+  }
+
+  void ensure_can_add()
+  {
+    if (UNLIKELY(m_slots_set + m_slots_dummy >= m_slots_usable)) {
+      /* When there are many dummies this may not grow at all, only clean them up. */
+      this->rehash(MAX2(m_slots_set * 2, m_slots_set + 1));
+    }
+  }
+
+  /** Move all items to a new array of groups, which has at least \a min_usable_slots. */
+  void rehash(const uint min_usable_slots)
+  {
+    Group *old_groups = m_groups;
+    const uint old_groups_len = m_groups_mask + 1;
+    const uint slots_set = m_slots_set;
+    this->init(MAX2(min_usable_slots, slots_set));
+
+    for (uint old_group_index = 0; old_group_index < old_groups_len; old_group_index++) {
+      const Group &old_group = old_groups[old_group_index];
+      for (uint mask = old_group.match_set(); mask; mask &= mask - 1) {
+        const uint offset = bitscan_forward_uint(mask);
+        /* The new table only has empty slots, no comparisons are needed. */
+        const Hash hash = this->hash_key(old_group.slots[offset].key);
+        PROBE_GROUPS_BEGIN (hash, group_index) {
+          Group &group = m_groups[group_index];
+          const uint free_mask = group.match_empty();
+          if (free_mask) {
+            const uint new_offset = bitscan_forward_uint(free_mask);
+            group.ctrl[new_offset] = hash.tag;
+            group.slots[new_offset] = old_group.slots[offset];
+            break;
+          }
+        }
+        PROBE_GROUPS_END;
+      }
+    }
+    m_slots_set = slots_set;
+    MEM_freeN(old_groups);
+  }
+
+#undef PROBE_GROUPS_BEGIN
+#undef PROBE_GROUPS_END
+};
+
+using OAMap = OATable<true>;
+using OASetImpl = OATable<false>;
+
+BLI_INLINE OAMap *oahash_impl(OAHash *oh)
+{
+  BLI_assert(!oh->is_set);
+  return static_cast<OAMap *>(oh);
+}
+
+BLI_INLINE OASetImpl *oaset_impl(OASet *os)
+{
+  return reinterpret_cast<OASetImpl *>(os);
+}
+
+BLI_INLINE OASet *oaset_wrap(OASetImpl *impl)
+{
+  return reinterpret_cast<OASet *>(impl);
+}
+
+/* -------------------------------------------------------------------- */
+/** \name OAHash Public API
+ * \{ */
+
+OAHash *BLI_oahash_new_ex(GHashHashFP hashfp,
+                          GHashCmpFP cmpfp,
+                          const char *UNUSED(info),
+                          const unsigned int nentries_reserve)
+{
+  return new OAMap(hashfp, cmpfp, nentries_reserve);
+}
+
+OAHash *BLI_oahash_new(GHashHashFP hashfp, GHashCmpFP cmpfp, const char *info)
+{
+  return BLI_oahash_new_ex(hashfp, cmpfp, info, 0);
+}
+
+/**
+ * Copy given OAHash. Keys and values are also copied if relevant callback is provided,
+ * else pointers remain the same.
+ */
+OAHash *BLI_oahash_copy(OAHash *oh, GHashKeyCopyFP keycopyfp, GHashValCopyFP valcopyfp)
+{
+  OAMap *map = oahash_impl(oh);
+  OAMap *map_copy = new OAMap(*map);
+  if (keycopyfp || valcopyfp) {
+    for (uint slot = 0; slot < map_copy->slots_total(); slot++) {
+      if (map_copy->slot_is_set(slot)) {
+        if (keycopyfp) {
+          void **key = map_copy->slot_key(slot);
+          *key = keycopyfp(*key);
+        }
+        if (valcopyfp) {
+          void **val = map_copy->slot_value(slot);
+          *val = valcopyfp(*val);
+        }
+      }
+    }
+  }
+  return map_copy;
+}
+
+void BLI_oahash_free(OAHash *oh, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp)
+{
+  OAMap *map = oahash_impl(oh);
+  map->free_items(keyfreefp, valfreefp);
+  delete map;
+}
+
+void BLI_oahash_reserve(OAHash *oh, const unsigned int nentries_reserve)
+{
+  oahash_impl(oh)->reserve(nentries_reserve);
+}
+
+/**
+ * Insert a key/value pair into the \a oh.
+ *
+ * \note Duplicates are not checked,
+ * the caller is expected to ensure elements are unique.
+ */
+void BLI_oahash_insert(OAHash *oh, void *key, void *val)
+{
+  OAMap *map = oahash_impl(oh);
+  const uint slot = map->add_new(key);
+  *map->slot_key(slot) = key;
+  *map->slot_value(slot) = val;
+}
+
+/**
+ * Inserts a new value to a key that may already be in ghash.
+ *
+ * Avoids #BLI_oahash_remove, #BLI_oahash_insert calls (double lookups)
+ *
+ * \returns true if a new key has been added.
+ */
+bool BLI_oahash_reinsert(
+    OAHash *oh, void *key, void *val, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp)
+{
+  OAMap *map = oahash_impl(oh);
+  bool added;
+  const uint slot = map->find_or_add(key, &added);
+  void **key_p = map->slot_key(slot);
+  void **val_p = map->slot_value(slot);
+  if (!added) {
+    if (keyfreefp) {
+      keyfreefp(*key_p);
+    }
+    if (valfreefp) {
+      valfreefp(*val_p);
+    }
+  }
+  *key_p = key;
+  *val_p = val;
+  return added;
+}
+
+/**
+ * Replaces the key of an item in the \a oh.
+ *
+ * \returns Previous key or NULL if not found.
+ */
+void *BLI_oahash_replace_key(OAHash *oh, void *key)
+{
+  OAMap *map = oahash_impl(oh);
+  const int slot = map->find(key);
+  if (slot == -1) {
+    return NULL;
+  }
+  void **key_p = map->slot_key((uint)slot);
+  void *key_prev = *key_p;
+  *key_p = key;
+  return key_prev;
+}
+
+/**
+ * Lookup the value of \a key in \a oh.
+ *
+ * \note When NULL is a valid value, use #BLI_oahash_lookup_p to differentiate a missing key
+ * from a key with a NULL value. (Avoids calling #BLI_oahash_haskey before #BLI_oahash_lookup)
+ */
+void *BLI_oahash_lookup(OAHash *oh, const void *key)
+{
+  OAMap *map = oahash_impl(oh);
+  const int slot = map->find(key);
+  return (slot != -1) ? *map->slot_value((uint)slot) : NULL;
+}
+
+/**
+ * A version of #BLI_oahash_lookup which accepts a fallback argument.
+ */
+void *BLI_oahash_lookup_default(OAHash *oh, const void *key, void *val_default)
+{
+  OAMap *map = oahash_impl(oh);
+  const int slot = map->find(key);
+  return (slot != -1) ? *map->slot_value((uint)slot) : val_default;
+}
+
+/**
+ * Lookup a pointer to the value of \a key in \a oh.
+ *
+ * \returns the pointer to value for \a key or NULL.
+ *
+ * \note The pointer is only valid until the next insertion.
+ */
+void **BLI_oahash_lookup_p(OAHash *oh, const void *key)
+{
+  OAMap *map = oahash_impl(oh);
+  const int slot = map->find(key);
+  return (slot != -1) ? map->slot_value((uint)slot) : NULL;
+}
+
+/**
+ * Ensure \a key is exists in \a oh, see #BLI_ghash_ensure_p.
+ *
+ * \returns true when the value didn't need to be added.
+ * (when false, the caller _must_ initialize the value).
+ */
+bool BLI_oahash_ensure_p(OAHash *oh, void *key, void ***r_val)
+{
+  OAMap *map = oahash_impl(oh);
+  bool added;
+  const uint slot = map->find_or_add(key, &added);
+  if (added) {
+    *map->slot_key(slot) = key;
+  }
+  *r_val = map->slot_value(slot);
+  return !added;
+}
+
+/**
+ * A version of #BLI_oahash_ensure_p that allows caller to re-assign the key.
+ * Typically used when the key is to be duplicated.
+ *
+ * \warning Caller _must_ write to \a r_key when returning false.
+ */
+bool BLI_oahash_ensure_p_ex(OAHash *oh, const void *key, void ***r_key, void ***r_val)
+{
+  OAMap *map = oahash_impl(oh);
+  bool added;
+  const uint slot = map->find_or_add(key, &added);
+  void **key_p = map->slot_key(slot);
+  if (added) {
+    /* Unlike #GHash the key is hashed again when growing, so it must be valid right away. */
+    *key_p = (void *)key;
+  }
+  *r_key = key_p;
+  *r_val = map->slot_value(slot);
+  return !added;
+}
+
+/**
+ * Remove \a key from \a oh, or return false if the key wasn't found.
+ */
+bool BLI_oahash_remove(OAHash *oh,
+                       const void *key,
+                       GHashKeyFreeFP keyfreefp,
+                       GHashValFreeFP valfreefp)
+{
+  OAMap *map = oahash_impl(oh);
+  const int slot = map->find(key);
+  if (slot == -1) {
+    return false;
+  }
+  if (keyfreefp) {
+    keyfreefp(*map->slot_key((uint)slot));
+  }
+  if (valfreefp) {
+    valfreefp(*map->slot_value((uint)slot));
+  }
+  map->remove_slot((uint)slot);
+  return true;
+}
+
+/**
+ * Reset \a oh clearing all entries.
+ */
+void BLI_oahash_clear_ex(OAHash *oh,
+                         GHashKeyFreeFP keyfreefp,
+                         GHashValFreeFP valfreefp,
+                         const unsigned int nentries_reserve)
+{
+  OAMap *map = oahash_impl(oh);
+  map->free_items(keyfreefp, valfreefp);
+  map->clear(nentries_reserve);
+}
+
+void BLI_oahash_clear(OAHash *oh, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp)
+{
+  BLI_oahash_clear_ex(oh, keyfreefp, valfreefp, 0);
+}
+
+/**
+ * Remove \a key from \a oh, returning the value or NULL if the key wasn't found.
+ */
+void *BLI_oahash_popkey(OAHash *oh, const void *key, GHashKeyFreeFP keyfreefp)
+{
+  OAMap *map = oahash_impl(oh);
+  const int slot = map->find(key);
+  if (slot == -1) {
+    return NULL;
+  }
+  if (keyfreefp) {
+    keyfreefp(*map->slot_key((uint)slot));
+  }
+  void *val = *map->slot_value((uint)slot);
+  map->remove_slot((uint)slot);
+  return val;
+}
+
+bool BLI_oahash_haskey(OAHash *oh, const void *key)
+{
+  return oahash_impl(oh)->find(key) != -1;
+}
+
+/**
+ * Remove a random entry from \a oh, returning true
+ * if a key/value pair could be removed, false otherwise.
+ *
+ * \param r_key: The removed key.
+ * \param r_val: The removed value.
+ * \param state: Used for efficient removal.
+ * \return true if there was something to pop, false if oahash was already empty.
+ */
+bool BLI_oahash_pop(OAHash *oh, OAHashIterState *state, void **r_key, void **r_val)
+{
+  OAMap *map = oahash_impl(oh);
+  for (; state->slot < map->slots_total(); state->slot++) {
+    if (map->slot_is_set(state->slot)) {
+      *r_key = *map->slot_key(state->slot);
+      *r_val = *map->slot_value(state->slot);
+      map->remove_slot(state->slot);
+      return true;
+    }
+  }
+  *r_key = *r_val = NULL;
+  return false;
+}
+
+unsigned int BLI_oahash_len(OAHash *oh)
+{
+  return oahash_impl(oh)->len();
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name OAHash Iterator API
+ * \{ */
+
+/* The iterator is shared by maps and sets, keys are at the same place in both. */
+BLI_INLINE void **oahash_iter_key_p(OAHashIterator *ohi)
+{
+  return ohi->oh->is_set ? static_cast<OASetImpl *>(ohi->oh)->slot_key(ohi->slot) :
+                           static_cast<OAMap *>(ohi->oh)->slot_key(ohi->slot);
+}
+
+static void oahash_iter_skip_unset(OAHashIterator *ohi)
+{
+  if (ohi->oh->is_set) {
+    OASetImpl *set = static_cast<OASetImpl *>(ohi->oh);
+    while ((ohi->slot != ohi->slots_len) && !set->slot_is_set(ohi->slot)) {
+      ohi->slot++;
+    }
+  }
+  else {
+    OAMap *map = static_cast<OAMap *>(ohi->oh);
+    while ((ohi->slot != ohi->slots_len) && !map->slot_is_set(ohi->slot)) {
+      ohi->slot++;
+    }
+  }
+}
+
+/**
+ * Init an already allocated OAHashIterator. The hash table must not be mutated
+ * (other than removing the current item) until the iterator is done.
+ */
+void BLI_oahashIterator_init(OAHashIterator *ohi, OAHash *oh)
+{
+  ohi->oh = oh;
+  ohi->slot = 0;
+  ohi->slots_len = oh->is_set ? static_cast<OASetImpl *>(oh)->slots_total() :
+                                static_cast<OAMap *>(oh)->slots_total();
+  oahash_iter_skip_unset(ohi);
+}
+
+void BLI_oahashIterator_step(OAHashIterator *ohi)
+{
+  BLI_assert(!BLI_oahashIterator_done(ohi));
+  ohi->slot++;
+  oahash_iter_skip_unset(ohi);
+}
+
+void *BLI_oahashIterator_getKey(OAHashIterator *ohi)
+{
+  return *oahash_iter_key_p(ohi);
+}
+
+void *BLI_oahashIterator_getValue(OAHashIterator *ohi)
+{
+  return *oahash_impl(ohi->oh)->slot_value(ohi->slot);
+}
+
+void **BLI_oahashIterator_getValue_p(OAHashIterator *ohi)
+{
+  return oahash_impl(ohi->oh)->slot_value(ohi->slot);
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name OASet Public API
+ * \{ */
+
+OASet *BLI_oaset_new_ex(GSetHashFP hashfp,
+                        GSetCmpFP cmpfp,
+                        const char *UNUSED(info),
+                        const unsigned int nentries_reserve)
+{
+  return oaset_wrap(new OASetImpl(hashfp, cmpfp, nentries_reserve));
+}
+
+OASet *BLI_oaset_new(GSetHashFP hashfp, GSetCmpFP cmpfp, const char *info)
+{
+  return BLI_oaset_new_ex(hashfp, cmpfp, info, 0);
+}
+
+/**
+ * Copy given OASet. Keys are also copied if callback is provided, else pointers remain the same.
+ */
+OASet *BLI_oaset_copy(OASet *os, GSetKeyCopyFP keycopyfp)
+{
+  OASetImpl *set_copy = new OASetImpl(*oaset_impl(os));
+  if (keycopyfp) {
+    for (uint slot = 0; slot < set_copy->slots_total(); slot++) {
+      if (set_copy->slot_is_set(slot)) {
+        void **key = set_copy->slot_key(slot);
+        *key = keycopyfp(*key);
+      }
+    }
+  }
+  return oaset_wrap(set_copy);
+}
+
+unsigned int BLI_oaset_len(OASet *os)
+{
+  return oaset_impl(os)->len();
+}
+
+void BLI_oaset_free(OASet *os, GSetKeyFreeFP keyfreefp)
+{
+  OASetImpl *set = oaset_impl(os);
+  set->free_items(keyfreefp, NULL);
+  delete set;
+}
+
+void BLI_oaset_reserve(OASet *os, const unsigned int nentries_reserve)
+{
+  oaset_impl(os)->reserve(nentries_reserve);
+}
+
+/**
+ * Adds the key to the set (no checks for unique keys!).
+ * Matching #BLI_oahash_insert
+ */
+void BLI_oaset_insert(OASet *os, void *key)
+{
+  OASetImpl *set = oaset_impl(os);
+  *set->slot_key(set->add_new(key)) = key;
+}
+
+/**
+ * A version of BLI_oaset_insert which checks first if the key is in the set.
+ * \returns true if a new key has been added.
+ */
+bool BLI_oaset_add(OASet *os, void *key)
+{
+  OASetImpl *set = oaset_impl(os);
+  bool added;
+  const uint slot = set->find_or_add(key, &added);
+  if (added) {
+    *set->slot_key(slot) = key;
+  }
+  return added;
+}
+
+/**
+ * Set counterpart to #BLI_oahash_ensure_p_ex.
+ * similar to BLI_oaset_add, except it returns the key pointer.
+ *
+ * \warning Caller _must_ write to \a r_key when returning false.
+ */
+bool BLI_oaset_ensure_p_ex(OASet *os, const void *key, void ***r_key)
+{
+  OASetImpl *set = oaset_impl(os);
+  bool added;
+  const uint slot = set->find_or_add(key, &added);
+  void **key_p = set->slot_key(slot);
+  if (added) {
+    *key_p = (void *)key;
+  }
+  *r_key = key_p;
+  return !added;
+}
+
+/**
+ * Adds the key to the set (duplicates are managed).
+ * Matching #BLI_oahash_reinsert
+ *
+ * \returns true if a new key has been added.
+ */
+bool BLI_oaset_reinsert(OASet *os, void *key, GSetKeyFreeFP keyfreefp)
+{
+  OASetImpl *set = oaset_impl(os);
+  bool added;
+  const uint slot = set->find_or_add(key, &added);
+  void **key_p = set->slot_key(slot);
+  if (!added && keyfreefp) {
+    keyfreefp(*key_p);
+  }
+  *key_p = key;
+  return added;
+}
+
+/**
+ * Replaces the key to the set if it's found.
+ * Matching #BLI_oahash_replace_key
+ *
+ * \returns Previous key or NULL if not found.
+ */
+void *BLI_oaset_replace_key(OASet *os, void *key)
+{
+  OASetImpl *set = oaset_impl(os);
+  const int slot = set->find(key);
+  if (slot == -1) {
+    return NULL;
+  }
+  void **key_p = set->slot_key((uint)slot);
+  void *key_prev = *key_p;
+  *key_p = key;
+  return key_prev;
+}
+
+bool BLI_oaset_haskey(OASet *os, const void *key)
+{
+  return oaset_impl(os)->find(key) != -1;
+}
+
+/**
+ * Remove a random entry from \a os, returning true if a key could be removed, false otherwise.
+ */
+bool BLI_oaset_pop(OASet *os, OASetIterState *state, void **r_key)
+{
+  OASetImpl *set = oaset_impl(os);
+  for (; state->slot < set->slots_total(); state->slot++) {
+    if (set->slot_is_set(state->slot)) {
+      *r_key = *set->slot_key(state->slot);
+      set->remove_slot(state->slot);
+      return true;
+    }
+  }
+  *r_key = NULL;
+  return false;
+}
+
+bool BLI_oaset_remove(OASet *os, const void *key, GSetKeyFreeFP keyfreefp)
+{
+  OASetImpl *set = oaset_impl(os);
+  const int slot = set->find(key);
+  if (slot == -1) {
+    return false;
+  }
+  if (keyfreefp) {
+    keyfreefp(*set->slot_key((uint)slot));
+  }
+  set->remove_slot((uint)slot);
+  return true;
+}
+
+void BLI_oaset_clear_ex(OASet *os, GSetKeyFreeFP keyfreefp, const unsigned int nentries_reserve)
+{
+  OASetImpl *set = oaset_impl(os);
+  set->free_items(keyfreefp, NULL);
+  set->clear(nentries_reserve);
+}
+
+void BLI_oaset_clear(OASet *os, GSetKeyFreeFP keyfreefp)
+{
+  BLI_oaset_clear_ex(os, keyfreefp, 0);
+}
+
+/**
+ * Returns the pointer to the key if it's found.
+ */
+void *BLI_oaset_lookup(OASet *os, const void *key)
+{
+  OASetImpl *set = oaset_impl(os);
+  const int slot = set->find(key);
+  return (slot != -1) ? *set->slot_key((uint)slot) : NULL;
+}
+
+/**
+ * Returns the pointer to the key if it's found, removing it from the OASet.
+ * \note Caller must handle freeing.
+ */
+void *BLI_oaset_pop_key(OASet *os, const void *key)
+{
+  OASetImpl *set = oaset_impl(os);
+  const int slot = set->find(key);
+  if (slot == -1) {
+    return NULL;
+  }
+  void *key_found = *set->slot_key((uint)slot);
+  set->remove_slot((uint)slot);
+  return key_found;
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Convenience OAHash/OASet Creation Functions
+ * \{ */
+
+OAHash *BLI_oahash_ptr_new_ex(const char *info, const unsigned int nentries_reserve)
+{
+  return BLI_oahash_new_ex(BLI_ghashutil_ptrhash, BLI_ghashutil_ptrcmp, info, nentries_reserve);
+}
+OAHash *BLI_oahash_ptr_new(const char *info)
+{
+  return BLI_oahash_ptr_new_ex(info, 0);
+}
+
+OAHash *BLI_oahash_str_new_ex(const char *info, const unsigned int nentries_reserve)
+{
+  return BLI_oahash_new_ex(BLI_ghashutil_strhash_p, BLI_ghashutil_strcmp, info, nentries_reserve);
+}
+OAHash *BLI_oahash_str_new(const char *info)
+{
+  return BLI_oahash_str_new_ex(info, 0);
+}
+
+OAHash *BLI_oahash_int_new_ex(const char *info, const unsigned int nentries_reserve)
+{
+  return BLI_oahash_new_ex(BLI_ghashutil_inthash_p, BLI_ghashutil_intcmp, info, nentries_reserve);
+}
+OAHash *BLI_oahash_int_new(const char *info)
+{
+  return BLI_oahash_int_new_ex(info, 0);
+}
+
+OASet *BLI_oaset_ptr_new_ex(const char *info, const unsigned int nentries_reserve)
+{
+  return BLI_oaset_new_ex(BLI_ghashutil_ptrhash, BLI_ghashutil_ptrcmp, info, nentries_reserve);
+}
+OASet *BLI_oaset_ptr_new(const char *info)
+{
+  return BLI_oaset_ptr_new_ex(info, 0);
+}
+
+OASet *BLI_oaset_str_new_ex(const char *info, const unsigned int nentries_reserve)
+{
+  return BLI_oaset_new_ex(BLI_ghashutil_strhash_p, BLI_ghashutil_strcmp, info, nentries_reserve);
+}
+OASet *BLI_oaset_str_new(const char *info)
+{
+  return BLI_oaset_str_new_ex(info, 0);
+}
+
+/** \} */
@@ -0,0 +1,482 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup bli
+ */
+
+#include <string.h>
+
+#include "zlib.h"
+
+#ifdef WIN32
+#  include <io.h>
+#else
+#  include <unistd.h>
+#endif
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_gzip_frames.h"
+#include "BLI_mmap.h"
+#include "BLI_task.h"
+
+/* Uncompressed size of a frame. Large enough for the compression ratio to be on par with a single
+ * gzip stream, small enough to keep all threads busy on files of a few megabytes. Readers only
+ * decompressing the start of the file (e.g. for the thumbnail) expect it to be at least 70kb. */
+#define GZIP_FRAME_SIZE (1 << 20)
+
+/* Gzip member header with an extra field storing the sizes of the frame:
+ * - 10 bytes of fixed header, the FEXTRA flag set.
+ * - 2 bytes extra field length (12).
+ * - 2 bytes subfield ID ('B', 'L') and 2 bytes subfield length (8).
+ * - 4 bytes size of the whole gzip member and 4 bytes uncompressed size, little endian. */
+#define GZIP_FRAME_HEADER_SIZE 24
+/* CRC32 and uncompressed size. */
+#define GZIP_FRAME_TRAILER_SIZE 8
+
+#define GZIP_FLAG_EXTRA 0x04
+#define GZIP_OS_UNKNOWN 0xff
+
+static void gzip_uint32_encode(uchar *dst, const uint value)
+{
+  dst[0] = (uchar)(value & 0xff);
+  dst[1] = (uchar)((value >> 8) & 0xff);
+  dst[2] = (uchar)((value >> 16) & 0xff);
+  dst[3] = (uchar)((value >> 24) & 0xff);
+}
+
+static uint gzip_uint32_decode(const uchar *src)
+{
+  return (uint)src[0] | ((uint)src[1] << 8) | ((uint)src[2] << 16) | ((uint)src[3] << 24);
+}
+
+static void gzip_frame_header_encode(uchar header[GZIP_FRAME_HEADER_SIZE],
+                                     const size_t member_len,
+                                     const size_t data_len)
+{
+  memset(header, 0, GZIP_FRAME_HEADER_SIZE);
+  header[0] = 0x1f;
+  header[1] = 0x8b;
+  header[2] = Z_DEFLATED;
+  header[3] = GZIP_FLAG_EXTRA;
+  /* Modification time and extra flags are left zero. */
+  header[9] = GZIP_OS_UNKNOWN;
+  header[10] = 12;
+  header[12] = 'B';
+  header[13] = 'L';
+  header[14] = 8;
+  gzip_uint32_encode(&header[16], (uint)member_len);
+  gzip_uint32_encode(&header[20], (uint)data_len);
+}
+
+static bool gzip_frame_header_decode(const uchar header[GZIP_FRAME_HEADER_SIZE],
+                                     size_t *r_member_len,
+                                     size_t *r_data_len)
+{
+  if (header[0] != 0x1f || header[1] != 0x8b || header[2] != Z_DEFLATED ||
+      header[3] != GZIP_FLAG_EXTRA || header[10] != 12 || header[11] != 0 ||
+      header[12] != 'B' || header[13] != 'L' || header[14] != 8 || header[15] != 0) {
+    return false;
+  }
+  *r_member_len = gzip_uint32_decode(&header[16]);
+  *r_data_len = gzip_uint32_decode(&header[20]);
+  return (*r_member_len >= GZIP_FRAME_HEADER_SIZE + GZIP_FRAME_TRAILER_SIZE) &&
+         (*r_data_len <= GZIP_FRAME_SIZE);
+}
+
+/* -------------------------------------------------------------------- */
+/** \name Writing
+ * \{ */
+
+typedef struct GzipFrame {
+  /* Uncompressed data, with room for #GZIP_FRAME_SIZE bytes. */
+  char *data;
+  size_t data_len;
+  /* The gzip member, with room for #GzipFramesWriter.member_alloc_len bytes. */
+  uchar *member;
+  size_t member_len;
+  bool error;
+} GzipFrame;
+
+struct GzipFramesWriter {
+  int fd;
+  int level;
+  size_t member_alloc_len;
+
+  /* Frames are compressed in batches, one frame per thread. Frames before the active one are
+   * full, the active one is being filled. */
+  GzipFrame *frames;
+  int frames_len;
+  int frame_active;
+
+  bool has_written;
+  bool error;
+};
+
+static void gzip_frame_compress(GzipFrame *frame, const int level, const size_t member_alloc_len)
+{
+  z_stream strm;
+  memset(&strm, 0, sizeof(strm));
+
+  /* Raw deflate, the gzip header and trailer are written here since the header contains the
+   * size of the compressed data. */
+  if (deflateInit2(&strm, level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+    frame->error = true;
+    return;
+  }
+  strm.next_in = (Bytef *)frame->data;
+  strm.avail_in = (uInt)frame->data_len;
+  strm.next_out = frame->member + GZIP_FRAME_HEADER_SIZE;
+  strm.avail_out = (uInt)(member_alloc_len - GZIP_FRAME_HEADER_SIZE - GZIP_FRAME_TRAILER_SIZE);
+
+  const int ret = deflate(&strm, Z_FINISH);
+  const size_t compressed_len = strm.total_out;
+  deflateEnd(&strm);
+
+  if (ret != Z_STREAM_END) {
+    frame->error = true;
+    return;
+  }
+
+  frame->member_len = GZIP_FRAME_HEADER_SIZE + compressed_len + GZIP_FRAME_TRAILER_SIZE;
+  gzip_frame_header_encode(frame->member, frame->member_len, frame->data_len);
+
+  const uLong crc = crc32(0, (const Bytef *)frame->data, (uInt)frame->data_len);
+  uchar *trailer = frame->member + GZIP_FRAME_HEADER_SIZE + compressed_len;
+  gzip_uint32_encode(&trailer[0], (uint)crc);
+  gzip_uint32_encode(&trailer[4], (uint)frame->data_len);
+}
+
+static void gzip_frames_compress_cb(void *__restrict userdata,
+                                    const int index,
+                                    const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  GzipFramesWriter *writer = userdata;
+  gzip_frame_compress(&writer->frames[index], writer->level, writer->member_alloc_len);
+}
+
+static bool gzip_write_all(int fd, const uchar *data, size_t length)
+{
+  while (length > 0) {
+    const int written = (int)write(fd, data, (uint)length);
+    if (written <= 0) {
+      return false;
+    }
+    data += written;
+    length -= (size_t)written;
+  }
+  return true;
+}
+
+/* Compress and write the full frames, and the partially filled one if it's the last. */
+static void gzip_frames_writer_flush(GzipFramesWriter *writer, const bool is_last)
+{
+  int frames_len = writer->frame_active;
+  if (is_last && writer->frames[frames_len].data_len != 0) {
+    frames_len++;
+  }
+  /* An empty file is still written as a single empty frame, to be valid gzip. */
+  if (is_last && frames_len == 0 && !writer->has_written) {
+    frames_len = 1;
+  }
+  if (frames_len == 0) {
+    return;
+  }
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = (frames_len > 1);
+  settings.min_iter_per_thread = 1;
+  BLI_task_parallel_range(0, frames_len, writer, gzip_frames_compress_cb, &settings);
+
+  for (int i = 0; i < frames_len; i++) {
+    GzipFrame *frame = &writer->frames[i];
+    if (frame->error || !gzip_write_all(writer->fd, frame->member, frame->member_len)) {
+      writer->error = true;
+    }
+    frame->data_len = 0;
+    frame->error = false;
+  }
+  writer->frame_active = 0;
+  writer->has_written = true;
+}
+
+GzipFramesWriter *BLI_gzip_frames_writer_new(int fd, int level)
+{
+  GzipFramesWriter *writer = MEM_callocN(sizeof(*writer), __func__);
+  writer->fd = fd;
+  writer->level = level;
+  writer->member_alloc_len = GZIP_FRAME_HEADER_SIZE + compressBound(GZIP_FRAME_SIZE) +
+                             GZIP_FRAME_TRAILER_SIZE;
+
+  writer->frames_len = MAX2(BLI_task_scheduler_num_threads(), 1);
+  writer->frames = MEM_calloc_arrayN(writer->frames_len, sizeof(*writer->frames), __func__);
+  for (int i = 0; i < writer->frames_len; i++) {
+    writer->frames[i].data = MEM_mallocN(GZIP_FRAME_SIZE, __func__);
+    writer->frames[i].member = MEM_mallocN(writer->member_alloc_len, __func__);
+  }
+  return writer;
+}
+
+bool BLI_gzip_frames_writer_write(GzipFramesWriter *writer, const void *data, size_t length)
+{
+  const char *data_iter = data;
+  while (length > 0) {
+    GzipFrame *frame = &writer->frames[writer->frame_active];
+    const size_t copy_len = MIN2(length, GZIP_FRAME_SIZE - frame->data_len);
+    memcpy(frame->data + frame->data_len, data_iter, copy_len);
+    frame->data_len += copy_len;
+    data_iter += copy_len;
+    length -= copy_len;
+
+    if (frame->data_len == GZIP_FRAME_SIZE) {
+      writer->frame_active++;
+      if (writer->frame_active == writer->frames_len) {
+        gzip_frames_writer_flush(writer, false);
+      }
+    }
+  }
+  return !writer->error;
+}
+
+bool BLI_gzip_frames_writer_free(GzipFramesWriter *writer)
+{
+  gzip_frames_writer_flush(writer, true);
+  const bool ok = !writer->error;
+
+  for (int i = 0; i < writer->frames_len; i++) {
+    MEM_freeN(writer->frames[i].data);
+    MEM_freeN(writer->frames[i].member);
+  }
+  MEM_freeN(writer->frames);
+  MEM_freeN(writer);
+  return ok;
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Reading
+ * \{ */
+
+typedef struct GzipFrameInfo {
+  /* Location of the gzip member in the file. */
+  size_t member_offset;
+  size_t member_len;
+  /* Location of the frame in the decompressed data. */
+  size_t data_offset;
+  size_t data_len;
+} GzipFrameInfo;
+
+struct GzipFramesReader {
+  struct BLI_mmap_file *file;
+
+  GzipFrameInfo *frames;
+  int frames_len;
+  /* Total decompressed length. */
+  size_t length;
+  size_t member_len_max;
+
+  /* Frames are decompressed in batches, one frame per thread, which stay available for reading
+   * until a frame outside of the batch is needed. For sequential reading this means the frames
+   * after the one being read are decompressed in parallel. */
+  int batch_start;
+  int batch_len;
+  int batch_len_max;
+  uchar *batch_members;
+  char *batch_data;
+  bool batch_error;
+};
+
+static int gzip_frames_reader_find(const GzipFramesReader *reader, const size_t offset)
+{
+  /* Last frame starting at or before the offset, skipping empty frames. */
+  int low = 0;
+  int high = reader->frames_len - 1;
+  while (low < high) {
+    const int mid = (low + high + 1) / 2;
+    if (reader->frames[mid].data_offset <= offset) {
+      low = mid;
+    }
+    else {
+      high = mid - 1;
+    }
+  }
+  return low;
+}
+
+static void gzip_frames_decompress_cb(void *__restrict userdata,
+                                      const int index,
+                                      const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  GzipFramesReader *reader = userdata;
+  const GzipFrameInfo *frame = &reader->frames[reader->batch_start + index];
+
+  z_stream strm;
+  memset(&strm, 0, sizeof(strm));
+  /* Decode the complete gzip member, this also verifies the CRC and size. */
+  if (inflateInit2(&strm, 16 + MAX_WBITS) != Z_OK) {
+    reader->batch_error = true;
+    return;
+  }
+  strm.next_in = reader->batch_members + (size_t)index * reader->member_len_max;
+  strm.avail_in = (uInt)frame->member_len;
+  strm.next_out = (Bytef *)(reader->batch_data + (size_t)index * GZIP_FRAME_SIZE);
+  strm.avail_out = (uInt)frame->data_len;
+
+  const int ret = inflate(&strm, Z_FINISH);
+  if (ret != Z_STREAM_END || strm.total_out != frame->data_len || strm.avail_in != 0) {
+    reader->batch_error = true;
+  }
+  inflateEnd(&strm);
+}
+
+static bool gzip_frames_reader_batch_load(GzipFramesReader *reader, const int frame_start)
+{
+  const int batch_len = MIN2(reader->batch_len_max, reader->frames_len - frame_start);
+
+  reader->batch_start = frame_start;
+  reader->batch_len = 0;
+  reader->batch_error = false;
+
+  /* Read the compressed data from the calling thread, I/O errors of the mapping are only caught
+   * for the thread reading it. */
+  for (int i = 0; i < batch_len; i++) {
+    const GzipFrameInfo *frame = &reader->frames[frame_start + i];
+    if (!BLI_mmap_read(reader->file,
+                       reader->batch_members + (size_t)i * reader->member_len_max,
+                       frame->member_offset,
+                       frame->member_len)) {
+      return false;
+    }
+  }
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = (batch_len > 1);
+  settings.min_iter_per_thread = 1;
+  BLI_task_parallel_range(0, batch_len, reader, gzip_frames_decompress_cb, &settings);
+
+  if (reader->batch_error) {
+    return false;
+  }
+  reader->batch_len = batch_len;
+  return true;
+}
+
+GzipFramesReader *BLI_gzip_frames_reader_new(struct BLI_mmap_file *file)
+{
+  const size_t file_len = BLI_mmap_get_length(file);
+
+  GzipFrameInfo *frames = NULL;
+  int frames_len = 0;
+  int frames_alloc_len = 0;
+  size_t member_offset = 0;
+  size_t data_offset = 0;
+  size_t member_len_max = 0;
+
+  /* Build the frame index from the member headers. */
+  while (member_offset < file_len) {
+    uchar header[GZIP_FRAME_HEADER_SIZE];
+    size_t member_len, data_len;
+    if (!BLI_mmap_read(file, header, member_offset, sizeof(header)) ||
+        !gzip_frame_header_decode(header, &member_len, &data_len) ||
+        member_len > file_len - member_offset) {
+      MEM_SAFE_FREE(frames);
+      return NULL;
+    }
+
+    if (frames_len == frames_alloc_len) {
+      frames_alloc_len = MAX2(frames_alloc_len * 2, 64);
+      frames = MEM_reallocN_id(frames, sizeof(*frames) * (size_t)frames_alloc_len, __func__);
+    }
+    GzipFrameInfo *frame = &frames[frames_len++];
+    frame->member_offset = member_offset;
+    frame->member_len = member_len;
+    frame->data_offset = data_offset;
+    frame->data_len = data_len;
+
+    member_offset += member_len;
+    data_offset += data_len;
+    member_len_max = MAX2(member_len_max, member_len);
+  }
+
+  if (frames_len == 0) {
+    return NULL;
+  }
+
+  GzipFramesReader *reader = MEM_callocN(sizeof(*reader), __func__);
+  reader->file = file;
+  reader->frames = frames;
+  reader->frames_len = frames_len;
+  reader->length = data_offset;
+  reader->member_len_max = member_len_max;
+
+  const int num_threads = MAX2(BLI_task_scheduler_num_threads(), 1);
+  reader->batch_len_max = MIN2(num_threads, frames_len);
+  reader->batch_members = MEM_mallocN((size_t)reader->batch_len_max * member_len_max, __func__);
+  reader->batch_data = MEM_mallocN((size_t)reader->batch_len_max * GZIP_FRAME_SIZE, __func__);
+  return reader;
+}
+
+bool BLI_gzip_frames_reader_read(GzipFramesReader *reader,
+                                 void *dest,
+                                 size_t offset,
+                                 size_t length)
+{
+  if (offset > reader->length || length > reader->length - offset) {
+    return false;
+  }
+
+  char *dest_iter = dest;
+  while (length > 0) {
+    const int frame_index = gzip_frames_reader_find(reader, offset);
+    if (frame_index < reader->batch_start ||
+        frame_index >= reader->batch_start + reader->batch_len) {
+      if (!gzip_frames_reader_batch_load(reader, frame_index)) {
+        return false;
+      }
+    }
+
+    const GzipFrameInfo *frame = &reader->frames[frame_index];
+    const char *data = reader->batch_data +
+                       (size_t)(frame_index - reader->batch_start) * GZIP_FRAME_SIZE;
+    const size_t frame_offset = offset - frame->data_offset;
+    const size_t copy_len = MIN2(length, frame->data_len - frame_offset);
+
+    memcpy(dest_iter, data + frame_offset, copy_len);
+    dest_iter += copy_len;
+    offset += copy_len;
+    length -= copy_len;
+  }
+  return true;
+}
+
+size_t BLI_gzip_frames_reader_length(const GzipFramesReader *reader)
+{
+  return reader->length;
+}
+
+void BLI_gzip_frames_reader_free(GzipFramesReader *reader)
+{
+  MEM_freeN(reader->frames);
+  MEM_freeN(reader->batch_members);
+  MEM_freeN(reader->batch_data);
+  MEM_freeN(reader);
+}
+
+/** \} */
@@ -22,6 +22,7 @@
 
 #include "BLI_kdtree_impl.h"
 #include "BLI_math.h"
+#include "BLI_task.h"
 #include "BLI_strict_flags.h"
 #include "BLI_utildefines.h"
 
@@ -58,6 +59,11 @@ struct KDTree {
 
 #define KD_NODE_UNSET ((uint)-1)
 
+/** Sub-trees with fewer nodes are balanced on a single thread. */
+#define KD_BALANCE_PARALLEL_THRESHOLD 8192
+/** Number of queries per task for batched queries. */
+#define KD_BATCH_CHUNK_SIZE 256
+
 /**
  * When set we know all values are unbalanced,
  * otherwise clear them when re-balancing: see T62210.
@@ -145,19 +151,15 @@ void BLI_kdtree_nd_(insert)(KDTree *tree, int index, const float co[KD_DIMS])
 #endif
 }
 
-static uint kdtree_balance(KDTreeNode *nodes, uint nodes_len, uint axis, const uint ofs)
+/**
+ * Partition \a nodes around the median on \a axis (quick-select).
+ * \return the index of the median node.
+ */
+static uint kdtree_balance_median(KDTreeNode *nodes, uint nodes_len, uint axis)
 {
-  KDTreeNode *node;
   float co;
   uint left, right, median, i, j;
 
-  if (nodes_len <= 0) {
-    return KD_NODE_UNSET;
-  }
-  else if (nodes_len == 1) {
-    return 0 + ofs;
-  }
-
   /* quicksort style sorting around median */
   left = 0;
   right = nodes_len - 1;
@@ -190,6 +192,23 @@ static uint kdtree_balance(KDTreeNode *nodes, uint nodes_len, uint axis, const u
     }
   }
 
+  return median;
+}
+
+static uint kdtree_balance(KDTreeNode *nodes, uint nodes_len, uint axis, const uint ofs)
+{
+  KDTreeNode *node;
+  uint median;
+
+  if (nodes_len <= 0) {
+    return KD_NODE_UNSET;
+  }
+  else if (nodes_len == 1) {
+    return 0 + ofs;
+  }
+
+  median = kdtree_balance_median(nodes, nodes_len, axis);
+
   /* set node and sort subnodes */
   node = &nodes[median];
   node->d = axis;
@@ -201,6 +220,63 @@ static uint kdtree_balance(KDTreeNode *nodes, uint nodes_len, uint axis, const u
   return median + ofs;
 }
 
+typedef struct KDTreeBalanceTask {
+  KDTreeNode *nodes;
+  uint nodes_len;
+  uint axis;
+  uint ofs;
+  /** Where to store the root of the sub-tree. */
+  uint *r_root;
+} KDTreeBalanceTask;
+
+static void kdtree_balance_task(TaskPool *__restrict pool, void *taskdata);
+
+/**
+ * Version of #kdtree_balance which balances the left sub-trees in tasks,
+ * both halves only ever touch their own range of \a nodes.
+ */
+static void kdtree_balance_parallel(
+    TaskPool *pool, KDTreeNode *nodes, uint nodes_len, uint axis, const uint ofs, uint *r_root)
+{
+  KDTreeNode *node;
+  uint median;
+
+  if (nodes_len < KD_BALANCE_PARALLEL_THRESHOLD) {
+    *r_root = kdtree_balance(nodes, nodes_len, axis, ofs);
+    return;
+  }
+
+  median = kdtree_balance_median(nodes, nodes_len, axis);
+
+  node = &nodes[median];
+  node->d = axis;
+  axis = (axis + 1) % KD_DIMS;
+
+  KDTreeBalanceTask *task = MEM_mallocN(sizeof(*task), __func__);
+  task->nodes = nodes;
+  task->nodes_len = median;
+  task->axis = axis;
+  task->ofs = ofs;
+  task->r_root = &node->left;
+  BLI_task_pool_push(pool, kdtree_balance_task, task, true, NULL);
+
+  kdtree_balance_parallel(pool,
+                          nodes + median + 1,
+                          (nodes_len - (median + 1)),
+                          axis,
+                          (median + 1) + ofs,
+                          &node->right);
+
+  *r_root = median + ofs;
+}
+
+static void kdtree_balance_task(TaskPool *__restrict pool, void *taskdata)
+{
+  KDTreeBalanceTask *task = taskdata;
+  kdtree_balance_parallel(
+      pool, task->nodes, task->nodes_len, task->axis, task->ofs, task->r_root);
+}
+
 void BLI_kdtree_nd_(balance)(KDTree *tree)
 {
   if (tree->root != KD_NODE_ROOT_IS_INIT) {
@@ -210,7 +286,15 @@ void BLI_kdtree_nd_(balance)(KDTree *tree)
     }
   }
 
-  tree->root = kdtree_balance(tree->nodes, tree->nodes_len, 0, 0);
+  if (tree->nodes_len < KD_BALANCE_PARALLEL_THRESHOLD) {
+    tree->root = kdtree_balance(tree->nodes, tree->nodes_len, 0, 0);
+  }
+  else {
+    TaskPool *pool = BLI_task_pool_create(NULL, TASK_PRIORITY_HIGH);
+    kdtree_balance_parallel(pool, tree->nodes, tree->nodes_len, 0, 0, &tree->root);
+    BLI_task_pool_work_and_wait(pool);
+    BLI_task_pool_free(pool);
+  }
 
 #ifdef DEBUG
   tree->is_balanced = true;
@@ -230,6 +314,22 @@ static uint *realloc_nodes(uint *stack, uint *stack_len_capacity, const bool is_
   return stack_new;
 }
 
+/**
+ * Traversal stack that can outlive a single query, so batched queries don't re-allocate it.
+ */
+typedef struct KDTreeStack {
+  uint *data;
+  uint len_capacity;
+  /** When false \a data points to memory on the stack of the caller. */
+  bool is_alloc;
+} KDTreeStack;
+
+static void kdtree_stack_grow(KDTreeStack *stack)
+{
+  stack->data = realloc_nodes(stack->data, &stack->len_capacity, stack->is_alloc);
+  stack->is_alloc = true;
+}
+
 /**
  * Find nearest returns index, and -1 if no node is found.
  */
@@ -477,21 +577,21 @@ static void nearest_ordered_insert(KDTreeNearest *nearest,
  *
  * \param r_nearest: An array of nearest, sized at least \a nearest_len_capacity.
  */
-int BLI_kdtree_nd_(find_nearest_n_with_len_squared_cb)(
-    const KDTree *tree,
-    const float co[KD_DIMS],
-    KDTreeNearest r_nearest[],
-    const uint nearest_len_capacity,
-    float (*len_sq_fn)(const float co_search[KD_DIMS],
-                       const float co_test[KD_DIMS],
-                       const void *user_data),
-    const void *user_data)
+static int kdtree_find_nearest_n_impl(const KDTree *tree,
+                                      const float co[KD_DIMS],
+                                      KDTreeNearest r_nearest[],
+                                      const uint nearest_len_capacity,
+                                      float (*len_sq_fn)(const float co_search[KD_DIMS],
+                                                         const float co_test[KD_DIMS],
+                                                         const void *user_data),
+                                      const void *user_data,
+                                      KDTreeStack *kd_stack)
 {
   const KDTreeNode *nodes = tree->nodes;
   const KDTreeNode *root;
-  uint *stack, stack_default[KD_STACK_INIT];
+  uint *stack = kd_stack->data;
   float cur_dist;
-  uint stack_len_capacity, cur = 0;
+  uint cur = 0;
   uint i, nearest_len = 0;
 
 #ifdef DEBUG
@@ -507,9 +607,6 @@ int BLI_kdtree_nd_(find_nearest_n_with_len_squared_cb)(
     BLI_assert(user_data == NULL);
   }
 
-  stack = stack_default;
-  stack_len_capacity = ARRAY_SIZE(stack_default);
-
   root = &nodes[tree->root];
 
   cur_dist = len_sq_fn(co, root->co, user_data);
@@ -575,8 +672,9 @@ int BLI_kdtree_nd_(find_nearest_n_with_len_squared_cb)(
         stack[cur++] = node->left;
       }
     }
-    if (UNLIKELY(cur + KD_DIMS > stack_len_capacity)) {
-      stack = realloc_nodes(stack, &stack_len_capacity, stack_default != stack);
+    if (UNLIKELY(cur + KD_DIMS > kd_stack->len_capacity)) {
+      kdtree_stack_grow(kd_stack);
+      stack = kd_stack->data;
     }
   }
 
@@ -584,11 +682,30 @@ int BLI_kdtree_nd_(find_nearest_n_with_len_squared_cb)(
     r_nearest[i].dist = sqrtf(r_nearest[i].dist);
   }
 
-  if (stack != stack_default) {
-    MEM_freeN(stack);
+  return (int)nearest_len;
+}
+
+int BLI_kdtree_nd_(find_nearest_n_with_len_squared_cb)(
+    const KDTree *tree,
+    const float co[KD_DIMS],
+    KDTreeNearest r_nearest[],
+    const uint nearest_len_capacity,
+    float (*len_sq_fn)(const float co_search[KD_DIMS],
+                       const float co_test[KD_DIMS],
+                       const void *user_data),
+    const void *user_data)
+{
+  uint stack_default[KD_STACK_INIT];
+  KDTreeStack stack = {stack_default, ARRAY_SIZE(stack_default), false};
+
+  const int nearest_len = kdtree_find_nearest_n_impl(
+      tree, co, r_nearest, nearest_len_capacity, len_sq_fn, user_data, &stack);
+
+  if (stack.is_alloc) {
+    MEM_freeN(stack.data);
   }
 
-  return (int)nearest_len;
+  return nearest_len;
 }
 
 int BLI_kdtree_nd_(find_nearest_n)(const KDTree *tree,
@@ -732,38 +849,30 @@ int BLI_kdtree_nd_(range_search)(const KDTree *tree,
 }
 
 /**
- * A version of #BLI_kdtree_3d_range_search which runs a callback
- * instead of allocating an array.
- *
- * \param search_cb: Called for every node found in \a range,
- * false return value performs an early exit.
- *
- * \note the order of calls isn't sorted based on distance.
+ * \return false when \a search_cb requested an early exit.
  */
-void BLI_kdtree_nd_(range_search_cb)(
+static bool kdtree_range_search_cb_impl(
     const KDTree *tree,
     const float co[KD_DIMS],
     float range,
     bool (*search_cb)(void *user_data, int index, const float co[KD_DIMS], float dist_sq),
-    void *user_data)
+    void *user_data,
+    KDTreeStack *kd_stack)
 {
   const KDTreeNode *nodes = tree->nodes;
 
-  uint *stack, stack_default[KD_STACK_INIT];
+  uint *stack = kd_stack->data;
   float range_sq = range * range, dist_sq;
-  uint stack_len_capacity, cur = 0;
+  uint cur = 0;
 
 #ifdef DEBUG
   BLI_assert(tree->is_balanced == true);
 #endif
 
   if (UNLIKELY(tree->root == KD_NODE_UNSET)) {
-    return;
+    return true;
   }
 
-  stack = stack_default;
-  stack_len_capacity = ARRAY_SIZE(stack_default);
-
   stack[cur++] = tree->root;
 
   while (cur--) {
@@ -783,7 +892,7 @@ void BLI_kdtree_nd_(range_search_cb)(
       dist_sq = len_squared_vnvn(node->co, co);
       if (dist_sq <= range_sq) {
         if (search_cb(user_data, node->index, node->co, dist_sq) == false) {
-          goto finally;
+          return false;
         }
       }
 
@@ -795,17 +904,217 @@ void BLI_kdtree_nd_(range_search_cb)(
       }
     }
 
-    if (UNLIKELY(cur + KD_DIMS > stack_len_capacity)) {
-      stack = realloc_nodes(stack, &stack_len_capacity, stack_default != stack);
+    if (UNLIKELY(cur + KD_DIMS > kd_stack->len_capacity)) {
+      kdtree_stack_grow(kd_stack);
+      stack = kd_stack->data;
     }
   }
 
-finally:
-  if (stack != stack_default) {
-    MEM_freeN(stack);
+  return true;
+}
+
+/**
+ * A version of #BLI_kdtree_3d_range_search which runs a callback
+ * instead of allocating an array.
+ *
+ * \param search_cb: Called for every node found in \a range,
+ * false return value performs an early exit.
+ *
+ * \note the order of calls isn't sorted based on distance.
+ */
+void BLI_kdtree_nd_(range_search_cb)(
+    const KDTree *tree,
+    const float co[KD_DIMS],
+    float range,
+    bool (*search_cb)(void *user_data, int index, const float co[KD_DIMS], float dist_sq),
+    void *user_data)
+{
+  uint stack_default[KD_STACK_INIT];
+  KDTreeStack stack = {stack_default, ARRAY_SIZE(stack_default), false};
+
+  kdtree_range_search_cb_impl(tree, co, range, search_cb, user_data, &stack);
+
+  if (stack.is_alloc) {
+    MEM_freeN(stack.data);
+  }
+}
+
+/* -------------------------------------------------------------------- */
+/** \name Batched Queries
+ *
+ * Run many queries against the same tree, split over threads.
+ * Each thread keeps its own traversal stack for all the queries it runs,
+ * so deep trees don't re-allocate it for every query.
+ * \{ */
+
+typedef struct KDTreeBatchTLS {
+  KDTreeStack stack;
+} KDTreeBatchTLS;
+
+static uint *kdtree_batch_tls_stack_ensure(KDTreeBatchTLS *tls)
+{
+  if (tls->stack.data == NULL) {
+    tls->stack.len_capacity = KD_STACK_INIT;
+    tls->stack.data = MEM_mallocN(sizeof(uint) * tls->stack.len_capacity, __func__);
+    tls->stack.is_alloc = true;
+  }
+  return tls->stack.data;
+}
+
+static void kdtree_batch_tls_free(const void *__restrict UNUSED(userdata),
+                                  void *__restrict chunk)
+{
+  KDTreeBatchTLS *tls = chunk;
+  if (tls->stack.data != NULL) {
+    MEM_freeN(tls->stack.data);
   }
 }
 
+static void kdtree_batch_settings_init(TaskParallelSettings *settings,
+                                       KDTreeBatchTLS *tls,
+                                       const uint co_len)
+{
+  BLI_parallel_range_settings_defaults(settings);
+  settings->use_threading = (co_len >= KD_BATCH_CHUNK_SIZE);
+  settings->min_iter_per_thread = KD_BATCH_CHUNK_SIZE;
+  settings->userdata_chunk = tls;
+  settings->userdata_chunk_size = sizeof(*tls);
+  settings->func_free = kdtree_batch_tls_free;
+}
+
+typedef struct KDTreeFindNearestNBatchData {
+  const KDTree *tree;
+  const float (*co)[KD_DIMS];
+  KDTreeNearest *r_nearest;
+  uint nearest_len_capacity;
+  int *r_nearest_len;
+} KDTreeFindNearestNBatchData;
+
+static void kdtree_find_nearest_n_batch_fn(void *__restrict userdata,
+                                           const int i,
+                                           const TaskParallelTLS *__restrict tls)
+{
+  const KDTreeFindNearestNBatchData *data = userdata;
+  KDTreeBatchTLS *batch_tls = tls->userdata_chunk;
+  kdtree_batch_tls_stack_ensure(batch_tls);
+
+  const int nearest_len = kdtree_find_nearest_n_impl(
+      data->tree,
+      data->co[i],
+      &data->r_nearest[(size_t)i * data->nearest_len_capacity],
+      data->nearest_len_capacity,
+      NULL,
+      NULL,
+      &batch_tls->stack);
+
+  if (data->r_nearest_len) {
+    data->r_nearest_len[i] = nearest_len;
+  }
+}
+
+/**
+ * Run #BLI_kdtree_3d_find_nearest_n for every coordinate in \a co (in parallel).
+ *
+ * \param r_nearest: Array of `co_len * nearest_len_capacity` items,
+ * results for `co[i]` start at `r_nearest[i * nearest_len_capacity]`.
+ * \param r_nearest_len: Optional array of \a co_len items,
+ * the number of results found for each coordinate.
+ */
+void BLI_kdtree_nd_(find_nearest_n_batch)(const KDTree *tree,
+                                          const float (*co)[KD_DIMS],
+                                          const uint co_len,
+                                          KDTreeNearest *r_nearest,
+                                          const uint nearest_len_capacity,
+                                          int *r_nearest_len)
+{
+  KDTreeFindNearestNBatchData data = {
+      .tree = tree,
+      .co = co,
+      .r_nearest = r_nearest,
+      .nearest_len_capacity = nearest_len_capacity,
+      .r_nearest_len = r_nearest_len,
+  };
+  KDTreeBatchTLS tls = {{NULL}};
+
+  TaskParallelSettings settings;
+  kdtree_batch_settings_init(&settings, &tls, co_len);
+  BLI_task_parallel_range(0, (int)co_len, &data, kdtree_find_nearest_n_batch_fn, &settings);
+}
+
+typedef struct KDTreeRangeSearchBatchData {
+  const KDTree *tree;
+  const float (*co)[KD_DIMS];
+  float range;
+  bool (*search_cb)(
+      void *user_data, int co_index, int index, const float co[KD_DIMS], float dist_sq);
+  void *user_data;
+} KDTreeRangeSearchBatchData;
+
+typedef struct KDTreeRangeSearchBatchQuery {
+  const KDTreeRangeSearchBatchData *data;
+  int co_index;
+} KDTreeRangeSearchBatchQuery;
+
+static bool kdtree_range_search_batch_cb(void *user_data,
+                                         int index,
+                                         const float co[KD_DIMS],
+                                         float dist_sq)
+{
+  const KDTreeRangeSearchBatchQuery *query = user_data;
+  return query->data->search_cb(query->data->user_data, query->co_index, index, co, dist_sq);
+}
+
+static void kdtree_range_search_batch_fn(void *__restrict userdata,
+                                         const int i,
+                                         const TaskParallelTLS *__restrict tls)
+{
+  const KDTreeRangeSearchBatchData *data = userdata;
+  KDTreeBatchTLS *batch_tls = tls->userdata_chunk;
+  kdtree_batch_tls_stack_ensure(batch_tls);
+
+  KDTreeRangeSearchBatchQuery query = {data, i};
+  kdtree_range_search_cb_impl(data->tree,
+                              data->co[i],
+                              data->range,
+                              kdtree_range_search_batch_cb,
+                              &query,
+                              &batch_tls->stack);
+}
+
+/**
+ * Run #BLI_kdtree_3d_range_search_cb for every coordinate in \a co (in parallel).
+ *
+ * \param search_cb: Called for every node found in \a range of `co[co_index]`,
+ * false return value ends the search for that coordinate only.
+ *
+ * \note \a search_cb runs from multiple threads, it must not write to shared data
+ * without synchronization (writing to data indexed by \a co_index is fine).
+ */
+void BLI_kdtree_nd_(range_search_batch_cb)(
+    const KDTree *tree,
+    const float (*co)[KD_DIMS],
+    const uint co_len,
+    float range,
+    bool (*search_cb)(
+        void *user_data, int co_index, int index, const float co[KD_DIMS], float dist_sq),
+    void *user_data)
+{
+  KDTreeRangeSearchBatchData data = {
+      .tree = tree,
+      .co = co,
+      .range = range,
+      .search_cb = search_cb,
+      .user_data = user_data,
+  };
+  KDTreeBatchTLS tls = {{NULL}};
+
+  TaskParallelSettings settings;
+  kdtree_batch_settings_init(&settings, &tls, co_len);
+  BLI_task_parallel_range(0, (int)co_len, &data, kdtree_range_search_batch_fn, &settings);
+}
+
+/** \} */
+
 /**
  * Use when we want to loop over nodes ordered by index.
  * Requires indices to be aligned with nodes.
@@ -20,6 +20,9 @@
  * Task parallel range functions.
  */
 
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
 #include <stdlib.h>
 
 #include "MEM_guardedalloc.h"
@@ -37,6 +40,99 @@
 #  include <tbb/tbb.h>
 #endif
 
+/* -------------------------------------------------------------------- */
+/** \name Call Site Statistics
+ *
+ * Statistics are stored in a fixed size table indexed by the range function,
+ * slots are claimed with an atomic compare-and-swap and never released,
+ * so looking up a call site doesn't need a lock.
+ * \{ */
+
+/* Must be a power of two. */
+#define RANGE_SITES_MAX 1024
+
+/* Aim for chunks taking this long, long enough to hide the scheduling overhead
+ * while leaving enough chunks to balance uneven iteration costs between threads. */
+#define RANGE_GRAIN_TARGET_NS 50000
+/* Minimum number of chunks per thread for adaptive ranges. */
+#define RANGE_CHUNKS_PER_THREAD_MIN 8
+
+struct RangeSite {
+  void *func;
+  uint64_t calls;
+  uint64_t iterations;
+  uint64_t chunks;
+  uint64_t busy_ns;
+  uint64_t wall_ns;
+  int grain_size;
+};
+
+static RangeSite range_sites[RANGE_SITES_MAX];
+static bool range_profile_enabled = false;
+
+static uint64_t range_time_ns()
+{
+  return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+/* Returns NULL when the table is full, in that case nothing is recorded. */
+static RangeSite *range_site_ensure(TaskParallelRangeFunc func)
+{
+  void *key = (void *)func;
+  const uintptr_t hash = ((uintptr_t)key >> 4) * 2654435761u;
+
+  for (uintptr_t probe = 0; probe < RANGE_SITES_MAX; probe++) {
+    RangeSite *site = &range_sites[(hash + probe) & (RANGE_SITES_MAX - 1)];
+    void *site_func = site->func;
+    if (site_func == NULL) {
+      site_func = atomic_cas_ptr(&site->func, NULL, key);
+      if (site_func == NULL) {
+        return site;
+      }
+    }
+    if (site_func == key) {
+      return site;
+    }
+  }
+  return NULL;
+}
+
+static void range_site_add_chunk(RangeSite *site, const int iterations, const uint64_t busy_ns)
+{
+  atomic_add_and_fetch_uint64(&site->iterations, (uint64_t)iterations);
+  atomic_add_and_fetch_uint64(&site->busy_ns, busy_ns);
+  atomic_add_and_fetch_uint64(&site->chunks, 1);
+}
+
+#ifdef WITH_TBB
+/**
+ * Choose the chunk size from the average time per iteration of previous calls,
+ * capped so each thread gets a few chunks to steal from others.
+ */
+static int range_site_grain_size(const RangeSite *site,
+                                 const TaskParallelSettings *settings,
+                                 const int range_len,
+                                 const int num_threads)
+{
+  const int grain_min = MAX2(settings->min_iter_per_thread, 1);
+  const int grain_max = MAX2(range_len / (num_threads * RANGE_CHUNKS_PER_THREAD_MIN), 1);
+  const uint64_t iterations = site->iterations;
+  const uint64_t busy_ns = site->busy_ns;
+
+  int grain_size = grain_max;
+  if (iterations != 0 && busy_ns != 0) {
+    const double ns_per_iter = (double)busy_ns / (double)iterations;
+    const double grain_target = (double)RANGE_GRAIN_TARGET_NS / ns_per_iter;
+    grain_size = (grain_target < (double)grain_max) ? (int)grain_target : grain_max;
+  }
+  return MAX2(grain_size, grain_min);
+}
+#endif
+
+/** \} */
+
 #ifdef WITH_TBB
 
 /* Functor for running TBB parallel_for and parallel_reduce. */
@@ -44,26 +140,31 @@ struct RangeTask {
   TaskParallelRangeFunc func;
   void *userdata;
   const TaskParallelSettings *settings;
+  /* Optional, to record the time spent per chunk. */
+  RangeSite *site;
 
   void *userdata_chunk;
 
   /* Root constructor. */
-  RangeTask(TaskParallelRangeFunc func, void *userdata, const TaskParallelSettings *settings)
-      : func(func), userdata(userdata), settings(settings)
+  RangeTask(TaskParallelRangeFunc func,
+            void *userdata,
+            const TaskParallelSettings *settings,
+            RangeSite *site)
+      : func(func), userdata(userdata), settings(settings), site(site)
   {
     init_chunk(settings->userdata_chunk);
   }
 
   /* Copy constructor. */
   RangeTask(const RangeTask &other)
-      : func(other.func), userdata(other.userdata), settings(other.settings)
+      : func(other.func), userdata(other.userdata), settings(other.settings), site(other.site)
   {
     init_chunk(settings->userdata_chunk);
   }
 
   /* Splitting constructor for parallel reduce. */
   RangeTask(RangeTask &other, tbb::split)
-      : func(other.func), userdata(other.userdata), settings(other.settings)
+      : func(other.func), userdata(other.userdata), settings(other.settings), site(other.site)
   {
     init_chunk(settings->userdata_chunk);
   }
@@ -92,9 +193,13 @@ struct RangeTask {
     tbb::this_task_arena::isolate([this, r] {
       TaskParallelTLS tls;
       tls.userdata_chunk = userdata_chunk;
+      const uint64_t time_start = site ? range_time_ns() : 0;
       for (int i = r.begin(); i != r.end(); ++i) {
         func(userdata, i, &tls);
       }
+      if (site) {
+        range_site_add_chunk(site, r.end() - r.begin(), range_time_ns() - time_start);
+      }
     });
   }
 
@@ -112,21 +217,50 @@ void BLI_task_parallel_range(const int start,
                              TaskParallelRangeFunc func,
                              const TaskParallelSettings *settings)
 {
+  RangeSite *site = NULL;
+  uint64_t time_start = 0;
+  if (settings->use_adaptive_grain_size || range_profile_enabled) {
+    site = range_site_ensure(func);
+    time_start = range_time_ns();
+  }
+
 #ifdef WITH_TBB
   /* Multithreading. */
-  if (settings->use_threading && BLI_task_scheduler_num_threads() > 1) {
-    RangeTask task(func, userdata, settings);
-    const size_t grainsize = MAX2(settings->min_iter_per_thread, 1);
-    const tbb::blocked_range<int> range(start, stop, grainsize);
+  const int num_threads = BLI_task_scheduler_num_threads();
+  if (settings->use_threading && num_threads > 1) {
+    RangeTask task(func, userdata, settings, site);
+    const bool use_adaptive = settings->use_adaptive_grain_size && (site != NULL);
+    const int grainsize = use_adaptive ?
+                              range_site_grain_size(site, settings, stop - start, num_threads) :
+                              MAX2(settings->min_iter_per_thread, 1);
+    const tbb::blocked_range<int> range(start, stop, (size_t)grainsize);
 
+    /* The simple partitioner splits down to the grain size,
+     * the default partitioner may use fewer (larger) chunks. */
     if (settings->func_reduce) {
-      parallel_reduce(range, task);
+      if (use_adaptive) {
+        parallel_reduce(range, task, tbb::simple_partitioner());
+      }
+      else {
+        parallel_reduce(range, task);
+      }
       if (settings->userdata_chunk) {
         memcpy(settings->userdata_chunk, task.userdata_chunk, settings->userdata_chunk_size);
       }
     }
     else {
-      parallel_for(range, task);
+      if (use_adaptive) {
+        parallel_for(range, task, tbb::simple_partitioner());
+      }
+      else {
+        parallel_for(range, task);
+      }
+    }
+
+    if (site) {
+      site->grain_size = grainsize;
+      atomic_add_and_fetch_uint64(&site->wall_ns, range_time_ns() - time_start);
+      atomic_add_and_fetch_uint64(&site->calls, 1);
     }
     return;
   }
@@ -142,6 +276,116 @@ void BLI_task_parallel_range(const int start,
   if (settings->func_free != NULL) {
     settings->func_free(userdata, settings->userdata_chunk);
   }
+
+  if (site) {
+    const uint64_t time_ns = range_time_ns() - time_start;
+    range_site_add_chunk(site, stop - start, time_ns);
+    site->grain_size = stop - start;
+    atomic_add_and_fetch_uint64(&site->wall_ns, time_ns);
+    atomic_add_and_fetch_uint64(&site->calls, 1);
+  }
+}
+
+/**
+ * Record statistics for all calls to #BLI_task_parallel_range, not only adaptive ones.
+ */
+void BLI_task_parallel_range_profile_enable(const bool enable)
+{
+  range_profile_enabled = enable;
+}
+
+/**
+ * Copy the statistics of all call sites.
+ *
+ * \param r_stats: Array allocated with MEM_mallocN, sorted by wall time (largest first),
+ * NULL when there are no statistics.
+ * \return the number of call sites.
+ */
+int BLI_task_parallel_range_stats_get(TaskParallelRangeStats **r_stats)
+{
+  TaskParallelRangeStats *stats = (TaskParallelRangeStats *)MEM_mallocN(
+      sizeof(*stats) * RANGE_SITES_MAX, __func__);
+  int stats_len = 0;
+
+  for (int i = 0; i < RANGE_SITES_MAX; i++) {
+    const RangeSite *site = &range_sites[i];
+    if (site->func == NULL || site->calls == 0) {
+      continue;
+    }
+    TaskParallelRangeStats *site_stats = &stats[stats_len++];
+    site_stats->func = (TaskParallelRangeFunc)site->func;
+    site_stats->calls = site->calls;
+    site_stats->iterations = site->iterations;
+    site_stats->chunks = site->chunks;
+    site_stats->time_busy = (double)site->busy_ns * 1e-9;
+    site_stats->time_wall = (double)site->wall_ns * 1e-9;
+    site_stats->grain_size = site->grain_size;
+  }
+
+  if (stats_len == 0) {
+    MEM_freeN(stats);
+    *r_stats = NULL;
+    return 0;
+  }
+
+  std::sort(stats,
+            stats + stats_len,
+            [](const TaskParallelRangeStats &a, const TaskParallelRangeStats &b) {
+              return a.time_wall > b.time_wall;
+            });
+  *r_stats = stats;
+  return stats_len;
+}
+
+/**
+ * Reset the statistics, this isn't thread-safe with ranges that are being executed.
+ */
+void BLI_task_parallel_range_stats_clear(void)
+{
+  for (int i = 0; i < RANGE_SITES_MAX; i++) {
+    RangeSite *site = &range_sites[i];
+    site->calls = 0;
+    site->iterations = 0;
+    site->chunks = 0;
+    site->busy_ns = 0;
+    site->wall_ns = 0;
+    site->grain_size = 0;
+  }
+}
+
+/**
+ * Print the statistics of all call sites, the range functions can be looked up with a
+ * debugger (or `addr2line`). A parallelism close to 1.0 means a range isn't using threads.
+ */
+void BLI_task_parallel_range_stats_print(void)
+{
+  TaskParallelRangeStats *stats;
+  const int stats_len = BLI_task_parallel_range_stats_get(&stats);
+
+  printf("Parallel range statistics (%d threads):\n", BLI_task_scheduler_num_threads());
+  printf("%18s %10s %12s %10s %8s %10s %12s\n",
+         "function",
+         "calls",
+         "iterations",
+         "chunks",
+         "grain",
+         "wall (s)",
+         "parallelism");
+  for (int i = 0; i < stats_len; i++) {
+    const TaskParallelRangeStats *site_stats = &stats[i];
+    printf("%18p %10llu %12llu %10llu %8d %10.4f %12.2f\n",
+           (void *)site_stats->func,
+           (unsigned long long)site_stats->calls,
+           (unsigned long long)site_stats->iterations,
+           (unsigned long long)site_stats->chunks,
+           site_stats->grain_size,
+           site_stats->time_wall,
+           (site_stats->time_wall > 0.0) ? site_stats->time_busy / site_stats->time_wall : 0.0);
+  }
+
+  if (stats != NULL) {
+    MEM_freeN(stats);
+  }
 }
 
 int BLI_task_parallel_thread_id(const TaskParallelTLS *UNUSED(tls))
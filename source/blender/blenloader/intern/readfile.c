@@ -102,9 +102,11 @@
 #include "BLI_blenlib.h"
 #include "BLI_endian_switch.h"
 #include "BLI_ghash.h"
+#include "BLI_gzip_frames.h"
 #include "BLI_linklist.h"
 #include "BLI_math.h"
 #include "BLI_mempool.h"
+#include "BLI_mmap.h"
 #include "BLI_threads.h"
 
 #include "BLT_translation.h"
@@ -1192,6 +1194,85 @@ static off64_t fd_seek_data_from_file(FileData *filedata, off64_t offset, int wh
   return filedata->file_offset;
 }
 
+/* Seek within data of known length, for readers which track the position in #file_offset. */
+static off64_t fd_seek_with_length(FileData *filedata, off64_t offset, int whence, size_t length)
+{
+  off64_t new_pos;
+  if (whence == SEEK_CUR) {
+    new_pos = filedata->file_offset + offset;
+  }
+  else if (whence == SEEK_SET) {
+    new_pos = offset;
+  }
+  else if (whence == SEEK_END) {
+    new_pos = (off64_t)length + offset;
+  }
+  else {
+    return -1;
+  }
+
+  if (new_pos < 0 || new_pos > (off64_t)length) {
+    return -1;
+  }
+
+  filedata->file_offset = new_pos;
+  return filedata->file_offset;
+}
+
+/* Memory-mapped file reading.
+ * Avoids a system call for every block, pages of blocks which are never read (e.g. when linking
+ * from a library) are never loaded from disk. */
+
+static int fd_read_from_mmap(FileData *filedata,
+                             void *buffer,
+                             uint size,
+                             bool *UNUSED(r_is_memchunck_identical))
+{
+  /* Don't read more bytes than there are available in the file. */
+  const size_t length = BLI_mmap_get_length(filedata->mmap_file);
+  const size_t readsize = MIN2(size, length - (size_t)filedata->file_offset);
+
+  if (!BLI_mmap_read(filedata->mmap_file, buffer, (size_t)filedata->file_offset, readsize)) {
+    return 0;
+  }
+  filedata->file_offset += readsize;
+
+  return (int)readsize;
+}
+
+static off64_t fd_seek_from_mmap(FileData *filedata, off64_t offset, int whence)
+{
+  return fd_seek_with_length(filedata, offset, whence, BLI_mmap_get_length(filedata->mmap_file));
+}
+
+/* Gzip frames file reading (compressed files written by Blender, see: BLI_gzip_frames.h).
+ * Frames are decompressed in parallel, and unlike other gzip files these support seeking,
+ * so blocks can be read on demand. */
+
+static int fd_read_from_gzip_frames(FileData *filedata,
+                                    void *buffer,
+                                    uint size,
+                                    bool *UNUSED(r_is_memchunck_identical))
+{
+  /* Don't read more bytes than there are available in the file. */
+  const size_t length = BLI_gzip_frames_reader_length(filedata->gzip_frames);
+  const size_t readsize = MIN2(size, length - (size_t)filedata->file_offset);
+
+  if (!BLI_gzip_frames_reader_read(
+          filedata->gzip_frames, buffer, (size_t)filedata->file_offset, readsize)) {
+    return 0;
+  }
+  filedata->file_offset += readsize;
+
+  return (int)readsize;
+}
+
+static off64_t fd_seek_from_gzip_frames(FileData *filedata, off64_t offset, int whence)
+{
+  return fd_seek_with_length(
+      filedata, offset, whence, BLI_gzip_frames_reader_length(filedata->gzip_frames));
+}
+
 /* GZip file reading. */
 
 static int fd_read_gzip_from_file(FileData *filedata,
@@ -1354,6 +1435,8 @@ static FileData *blo_filedata_from_file_descriptor(const char *filepath,
 {
   FileDataReadFn *read_fn = NULL;
   FileDataSeekFn *seek_fn = NULL; /* Optional. */
+  BLI_mmap_file *mmap_file = NULL;
+  GzipFramesReader *gzip_frames = NULL;
 
   gzFile gzfile = (gzFile)Z_NULL;
 
@@ -1375,8 +1458,33 @@ static FileData *blo_filedata_from_file_descriptor(const char *filepath,
 
   /* Regular file. */
   if (memcmp(header, "BLENDER", sizeof(header)) == 0) {
-    read_fn = fd_read_data_from_file;
-    seek_fn = fd_seek_data_from_file;
+    mmap_file = BLI_mmap_open(file);
+    if (mmap_file != NULL) {
+      read_fn = fd_read_from_mmap;
+      seek_fn = fd_seek_from_mmap;
+    }
+    else {
+      read_fn = fd_read_data_from_file;
+      seek_fn = fd_seek_data_from_file;
+    }
+  }
+
+  /* Gzip file written as frames. */
+  if ((read_fn == NULL) &&
+      /* Check header magic. */
+      (header[0] == 0x1f && header[1] == 0x8b)) {
+    mmap_file = BLI_mmap_open(file);
+    if (mmap_file != NULL) {
+      gzip_frames = BLI_gzip_frames_reader_new(mmap_file);
+      if (gzip_frames != NULL) {
+        read_fn = fd_read_from_gzip_frames;
+        seek_fn = fd_seek_from_gzip_frames;
+      }
+      else {
+        BLI_mmap_free(mmap_file);
+        mmap_file = NULL;
+      }
+    }
   }
 
   /* Gzip file. */
@@ -1410,6 +1518,8 @@ static FileData *blo_filedata_from_file_descriptor(const char *filepath,
 
   fd->filedes = file;
   fd->gzfiledes = gzfile;
+  fd->mmap_file = mmap_file;
+  fd->gzip_frames = gzip_frames;
 
   fd->read = read_fn;
   fd->seek = seek_fn;
@@ -1477,20 +1587,31 @@ static int fd_read_gzip_from_memory(FileData *filedata,
   filedata->strm.next_out = (Bytef *)buffer;
   filedata->strm.avail_out = size;
 
-  // Inflate another chunk.
-  err = inflate(&filedata->strm, Z_SYNC_FLUSH);
+  while (filedata->strm.avail_out != 0) {
+    // Inflate another chunk.
+    err = inflate(&filedata->strm, Z_SYNC_FLUSH);
 
-  if (err == Z_STREAM_END) {
-    return 0;
-  }
-  else if (err != Z_OK) {
-    printf("fd_read_gzip_from_memory: zlib error\n");
-    return 0;
+    if (err == Z_STREAM_END) {
+      if (filedata->strm.avail_in == 0) {
+        break;
+      }
+      /* Compressed files are written as multiple gzip members (see: BLI_gzip_frames.h),
+       * continue with the next one. */
+      if (inflateReset(&filedata->strm) != Z_OK) {
+        printf("fd_read_gzip_from_memory: zlib error\n");
+        return 0;
+      }
+    }
+    else if (err != Z_OK) {
+      printf("fd_read_gzip_from_memory: zlib error\n");
+      return 0;
+    }
   }
 
-  filedata->file_offset += size;
+  const uint readsize = size - filedata->strm.avail_out;
+  filedata->file_offset += readsize;
 
-  return (size);
+  return (int)readsize;
 }
 
 static int fd_read_gzip_from_memory_init(FileData *fd)
@@ -1564,6 +1685,14 @@ FileData *blo_filedata_from_memfile(MemFile *memfile,
 void blo_filedata_free(FileData *fd)
 {
   if (fd) {
+    if (fd->gzip_frames != NULL) {
+      BLI_gzip_frames_reader_free(fd->gzip_frames);
+    }
+
+    if (fd->mmap_file != NULL) {
+      BLI_mmap_free(fd->mmap_file);
+    }
+
     if (fd->filedes != -1) {
       close(fd->filedes);
     }
@@ -5082,6 +5211,7 @@ static void direct_link_customdata(FileData *fd, CustomData *data, int count)
     }
 
     layer->flag &= ~CD_FLAG_NOFREE;
+    layer->sharing = NULL;
 
     if (CustomData_verify_versions(data, i)) {
       layer->data = newdataadr(fd, layer->data);
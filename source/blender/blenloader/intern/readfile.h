@@ -80,6 +80,10 @@ typedef struct FileData {
 
   /** Regular file reading. */
   int filedes;
+  /** Mapping of the file into memory, used instead of reading when available. */
+  struct BLI_mmap_file *mmap_file;
+  /** Compressed file made of independent frames, read from #mmap_file. */
+  struct GzipFramesReader *gzip_frames;
 
   /** Variables needed for reading from memory / stream. */
   const char *buffer;
@@ -147,6 +147,7 @@
 
 #include "BLI_bitmap.h"
 #include "BLI_blenlib.h"
+#include "BLI_gzip_frames.h"
 #include "BLI_mempool.h"
 #include "MEM_guardedalloc.h"  // MEM_freeN
 
@@ -220,7 +221,10 @@ struct WriteWrap {
   /* internal */
   union {
     int file_handle;
-    gzFile gz_handle;
+    struct {
+      int file_handle;
+      GzipFramesWriter *writer;
+    } gzip_frames;
   } _user_data;
 };
 
@@ -251,17 +255,20 @@ static size_t ww_write_none(WriteWrap *ww, const char *buf, size_t buf_len)
 }
 #undef FILE_HANDLE
 
-/* zlib */
-#define FILE_HANDLE(ww) (ww)->_user_data.gz_handle
+/* zlib, written as independent frames so they can be compressed and read in parallel,
+ * see: BLI_gzip_frames.h */
+#define FILE_HANDLE(ww) (ww)->_user_data.gzip_frames.file_handle
+#define FRAMES_WRITER(ww) (ww)->_user_data.gzip_frames.writer
 
 static bool ww_open_zlib(WriteWrap *ww, const char *filepath)
 {
-  gzFile file;
+  int file;
 
-  file = BLI_gzopen(filepath, "wb1");
+  file = BLI_open(filepath, O_BINARY + O_WRONLY + O_CREAT + O_TRUNC, 0666);
 
-  if (file != Z_NULL) {
+  if (file != -1) {
     FILE_HANDLE(ww) = file;
+    FRAMES_WRITER(ww) = BLI_gzip_frames_writer_new(file, 1);
     return true;
   }
   else {
@@ -270,13 +277,15 @@ static bool ww_open_zlib(WriteWrap *ww, const char *filepath)
 }
 static bool ww_close_zlib(WriteWrap *ww)
 {
-  return (gzclose(FILE_HANDLE(ww)) == Z_OK);
+  const bool ok = BLI_gzip_frames_writer_free(FRAMES_WRITER(ww));
+  return (close(FILE_HANDLE(ww)) != -1) && ok;
 }
 static size_t ww_write_zlib(WriteWrap *ww, const char *buf, size_t buf_len)
 {
-  return gzwrite(FILE_HANDLE(ww), buf, buf_len);
+  return BLI_gzip_frames_writer_write(FRAMES_WRITER(ww), buf, buf_len) ? buf_len : 0;
 }
 #undef FILE_HANDLE
+#undef FRAMES_WRITER
 
 /* --- end compression types --- */
 
@@ -4465,9 +4474,12 @@ bool BLO_write_file(Main *mainvar,
   }
 
   /* actual file writing */
-  const bool err = write_file_handle(mainvar, &ww, NULL, NULL, write_flags, thumb);
+  bool err = write_file_handle(mainvar, &ww, NULL, NULL, write_flags, thumb);
 
-  ww.close(&ww);
+  /* Compressed data may still be written on close. */
+  if (ww.close(&ww) == false) {
+    err = true;
+  }
 
   if (UNLIKELY(path_list_backup)) {
     BKE_bpath_list_restore(mainvar, path_list_flag, path_list_backup);
@@ -60,6 +60,7 @@ namespace DEG {
 Depsgraph::Depsgraph(Main *bmain, Scene *scene, ViewLayer *view_layer, eEvaluationMode mode)
     : time_source(nullptr),
       need_update(true),
+      need_update_critical_paths(false),
       need_update_time(false),
       bmain(bmain),
       scene(scene),
@@ -108,6 +108,10 @@ struct Depsgraph {
   /* Indicates whether relations needs to be updated. */
   bool need_update;
 
+  /* Indicates whether critical path times of operations are to be calculated after the next
+   * evaluation. Set when relations are built, so timings are only gathered once per build. */
+  bool need_update_critical_paths;
+
   /* Indicates which ID types were updated. */
   char id_type_updated[MAX_LIBARRAY];
 
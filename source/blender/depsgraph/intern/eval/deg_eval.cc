@@ -25,10 +25,13 @@
 
 #include "intern/eval/deg_eval.h"
 
+#include <algorithm>
+
 #include "PIL_time.h"
 
 #include "BLI_compiler_attrs.h"
 #include "BLI_gsqueue.h"
+#include "BLI_math_base.h"
 #include "BLI_task.h"
 #include "BLI_utildefines.h"
 
@@ -58,6 +61,10 @@ namespace DEG {
 
 namespace {
 
+/* Evaluation time which is assumed for operations which were not timed. Makes it so the
+ * longest chain of operations is preferred when there are no timings. */
+const float EVAL_TIME_DEFAULT = 1e-5f;
+
 struct DepsgraphEvalState;
 
 void deg_task_run_func(TaskPool *pool, void *taskdata);
@@ -93,6 +100,8 @@ enum class EvaluationStage {
 struct DepsgraphEvalState {
   Depsgraph *graph;
   bool do_stats;
+  /* Measure evaluation time of operations, for the critical path calculation. */
+  bool do_timing;
   EvaluationStage stage;
   bool need_single_thread_pass;
 };
@@ -104,10 +113,16 @@ void evaluate_node(const DepsgraphEvalState *state, OperationNode *operation_nod
   /* Sanity checks. */
   BLI_assert(!operation_node->is_noop() && "NOOP nodes should not actually be scheduled");
   /* Perform operation. */
-  if (state->do_stats) {
+  if (state->do_stats || state->do_timing) {
     const double start_time = PIL_check_seconds_timer();
     operation_node->evaluate(depsgraph);
-    operation_node->stats.current_time += PIL_check_seconds_timer() - start_time;
+    const float eval_time = (float)(PIL_check_seconds_timer() - start_time);
+    if (state->do_stats) {
+      operation_node->stats.current_time += eval_time;
+    }
+    if (state->do_timing) {
+      operation_node->eval_time = eval_time;
+    }
   }
   else {
     operation_node->evaluate(depsgraph);
@@ -177,6 +192,81 @@ void calculate_pending_parents(Depsgraph *graph)
   }
 }
 
+/* Parent operation of the relation which is followed by the critical path calculation. */
+OperationNode *critical_path_relation_from_operation(const Relation *rel)
+{
+  if (rel->from->type != NodeType::OPERATION || (rel->flag & RELATION_FLAG_CYCLIC)) {
+    return nullptr;
+  }
+  return (OperationNode *)rel->from;
+}
+
+bool operation_critical_path_greater(const OperationNode *a, const OperationNode *b)
+{
+  return a->critical_path_time > b->critical_path_time;
+}
+
+bool relation_critical_path_greater(const Relation *a, const Relation *b)
+{
+  return operation_critical_path_greater((const OperationNode *)a->to,
+                                         (const OperationNode *)b->to);
+}
+
+/* Calculate critical path time of all operations, by going from the operations without children
+ * towards their parents, and order operations and their children by it so the scheduler pushes
+ * the most critical ones first.
+ *
+ * This is done once after relations are built, using timings of the first evaluation, so the
+ * regular evaluation does not pay for anything but the pushing order.
+ *
+ * NOTE: custom_flags is used as a counter of children which are not handled yet. */
+void calculate_critical_path_times(Depsgraph *graph)
+{
+  vector<OperationNode *> queue;
+  for (OperationNode *node : graph->operations) {
+    node->custom_flags = 0;
+    node->critical_path_time = 0.0f;
+  }
+  for (OperationNode *node : graph->operations) {
+    for (Relation *rel : node->inlinks) {
+      OperationNode *from = critical_path_relation_from_operation(rel);
+      if (from != nullptr) {
+        ++from->custom_flags;
+      }
+    }
+  }
+  for (OperationNode *node : graph->operations) {
+    if (node->custom_flags == 0) {
+      queue.push_back(node);
+    }
+  }
+  while (!queue.empty()) {
+    OperationNode *node = queue.back();
+    queue.pop_back();
+    /* All children are handled, critical_path_time is the longest path of them. */
+    if (!node->is_noop()) {
+      node->critical_path_time += (node->eval_time != 0.0f) ? node->eval_time : EVAL_TIME_DEFAULT;
+    }
+    for (Relation *rel : node->inlinks) {
+      OperationNode *from = critical_path_relation_from_operation(rel);
+      if (from == nullptr) {
+        continue;
+      }
+      from->critical_path_time = max_ff(from->critical_path_time, node->critical_path_time);
+      if (--from->custom_flags == 0) {
+        queue.push_back(from);
+      }
+    }
+  }
+  /* Operations are scheduled in the order of this array, and children in the order of outgoing
+   * relations. Stable sort keeps the build order for operations with equal times. */
+  std::stable_sort(
+      graph->operations.begin(), graph->operations.end(), operation_critical_path_greater);
+  for (OperationNode *node : graph->operations) {
+    std::stable_sort(node->outlinks.begin(), node->outlinks.end(), relation_critical_path_greater);
+  }
+}
+
 void initialize_execution(DepsgraphEvalState *state, Depsgraph *graph)
 {
   const bool do_stats = state->do_stats;
@@ -379,6 +469,7 @@ void deg_evaluate_on_refresh(Depsgraph *graph)
   DepsgraphEvalState state;
   state.graph = graph;
   state.do_stats = graph->debug.do_time_debug();
+  state.do_timing = graph->need_update_critical_paths;
   state.need_single_thread_pass = false;
   /* Prepare all nodes for evaluation. */
   initialize_execution(&state, graph);
@@ -403,6 +494,11 @@ void deg_evaluate_on_refresh(Depsgraph *graph)
     evaluate_graph_single_threaded(&state);
   }
 
+  if (state.do_timing) {
+    calculate_critical_path_times(graph);
+    graph->need_update_critical_paths = false;
+  }
+
   /* Finalize statistics gathering. This is because we only gather single
    * operation timing here, without aggregating anything to avoid any extra
    * synchronization. */
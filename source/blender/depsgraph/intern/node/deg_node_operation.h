@@ -269,6 +269,13 @@ struct OperationNode : public Node {
   /* (OperationFlag) extra settings affecting evaluation. */
   int flag;
 
+  /* Time in seconds spent on evaluating this operation, measured during the first evaluation
+   * after relations were built. Zero when operation was not evaluated then. */
+  float eval_time;
+  /* Estimated time needed to evaluate the longest chain of operations starting with this one.
+   * Evaluation schedules operations with the highest value first, see deg_eval.cc. */
+  float critical_path_time;
+
   DEG_DEPSNODE_DECLARE;
 };
 
@@ -89,7 +89,8 @@ typedef struct Mesh_Runtime {
   void *batch_cache;
 
   struct SubdivCCG *subdiv_ccg;
-  void *_pad1;
+  /** Smooth fans of loop normals, shared with copies of this mesh, see 'mesh_evaluate.c'. */
+  struct MeshLoopFanCache *loop_fan_cache;
   int subdiv_ccg_tot_level;
   char _pad2[4];
 
@@ -133,6 +133,8 @@ typedef enum {
   eModifierFlag_OverrideLibrary_Local = (1 << 0),
   /* This modifier does not own its caches, but instead shares them with another modifier. */
   eModifierFlag_SharedCaches = (1 << 1),
+  /* Keep results in memory, to reuse them when evaluating the same input again. */
+  eModifierFlag_UseResultCache = (1 << 2),
 } ModifierFlag;
 
 /* not a real modifier */
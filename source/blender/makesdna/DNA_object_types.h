@@ -38,6 +38,7 @@ extern "C" {
 #endif
 
 struct AnimData;
+struct ArmatureDeformWeights;
 struct BoundBox;
 struct DerivedMesh;
 struct FluidsimSettings;
@@ -165,6 +166,11 @@ typedef struct Object_Runtime {
    * It has deformation only modifiers applied on it.
    */
   struct Mesh *mesh_deform_eval;
+  /**
+   * Mesh shared by deform only modifiers, only set while one of them is evaluated.
+   * See #MOD_deform_mesh_eval_get.
+   */
+  struct MeshDeformShared *mesh_deform_shared;
 
   /**
    * Original grease pencil bGPdata pointer, before object->data was changed to point
@@ -187,6 +193,12 @@ typedef struct Object_Runtime {
   /** Runtime evaluated curve-specific data, not stored in the file. */
   struct CurveCache *curve_cache;
 
+  /**
+   * Vertex weights of armature modifiers, resolved to their bones.
+   * Kept across evaluations while the weights remain unchanged, see 'armature.c'.
+   */
+  struct ArmatureDeformWeights *armature_deform_weights;
+
   unsigned short local_collections_bits;
   short _pad2[3];
 } Object_Runtime;
@@ -6876,6 +6876,15 @@ void RNA_def_modifier(BlenderRNA *brna)
   RNA_def_property_ui_icon(prop, ICON_SURFACE_DATA, 0);
   RNA_def_property_update(prop, 0, "rna_Modifier_update");
 
+  prop = RNA_def_property(srna, "use_result_cache", PROP_BOOLEAN, PROP_NONE);
+  RNA_def_property_boolean_sdna(prop, NULL, "flag", eModifierFlag_UseResultCache);
+  RNA_def_property_ui_text(
+      prop,
+      "Cache Result",
+      "Keep results of this modifier in memory, to reuse them when the input is the same as in "
+      "an earlier evaluation (only for modifiers not depending on time or other objects)");
+  RNA_def_property_update(prop, 0, "rna_Modifier_update");
+
   /* types */
   rna_def_modifier_subsurf(brna);
   rna_def_modifier_lattice(brna);
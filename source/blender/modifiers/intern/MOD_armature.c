@@ -197,9 +197,7 @@ static void deformVertsEM(ModifierData *md,
     amd->prevCos = NULL;
   }
 
-  if (mesh_src != mesh) {
-    BKE_id_free(NULL, mesh_src);
-  }
+  MOD_deform_mesh_eval_free(ctx->object, mesh, mesh_src);
 }
 
 static void deformMatricesEM(ModifierData *md,
@@ -224,9 +222,7 @@ static void deformMatricesEM(ModifierData *md,
                         amd->defgrp_name,
                         NULL);
 
-  if (mesh_src != mesh) {
-    BKE_id_free(NULL, mesh_src);
-  }
+  MOD_deform_mesh_eval_free(ctx->object, mesh, mesh_src);
 }
 
 static void deformMatrices(ModifierData *md,
@@ -250,9 +246,7 @@ static void deformMatrices(ModifierData *md,
                         amd->defgrp_name,
                         NULL);
 
-  if (!ELEM(mesh_src, NULL, mesh)) {
-    BKE_id_free(NULL, mesh_src);
-  }
+  MOD_deform_mesh_eval_free(ctx->object, mesh, mesh_src);
 }
 
 static void panel_draw(const bContext *C, Panel *panel)
@@ -494,9 +494,7 @@ static void deformVerts(ModifierData *md,
     sphere_do(cmd, ctx, ctx->object, mesh_src, vertexCos, numVerts);
   }
 
-  if (!ELEM(mesh_src, NULL, mesh)) {
-    BKE_id_free(NULL, mesh_src);
-  }
+  MOD_deform_mesh_eval_free(ctx->object, mesh, mesh_src);
 }
 
 static void deformVertsEM(ModifierData *md,
@@ -529,9 +527,7 @@ static void deformVertsEM(ModifierData *md,
     sphere_do(cmd, ctx, ctx->object, mesh_src, vertexCos, numVerts);
   }
 
-  if (!ELEM(mesh_src, NULL, mesh)) {
-    BKE_id_free(NULL, mesh_src);
-  }
+  MOD_deform_mesh_eval_free(ctx->object, mesh, mesh_src);
 }
 
 static void panel_draw(const bContext *C, Panel *panel)
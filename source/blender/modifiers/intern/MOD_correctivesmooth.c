@@ -752,9 +752,7 @@ static void deformVerts(ModifierData *md,
   correctivesmooth_modifier_do(
       md, ctx->depsgraph, ctx->object, mesh_src, vertexCos, (uint)numVerts, NULL);
 
-  if (!ELEM(mesh_src, NULL, mesh)) {
-    BKE_id_free(NULL, mesh_src);
-  }
+  MOD_deform_mesh_eval_free(ctx->object, mesh, mesh_src);
 }
 
 static void deformVertsEM(ModifierData *md,
@@ -775,9 +773,7 @@ static void deformVertsEM(ModifierData *md,
   correctivesmooth_modifier_do(
       md, ctx->depsgraph, ctx->object, mesh_src, vertexCos, (uint)numVerts, editData);
 
-  if (!ELEM(mesh_src, NULL, mesh)) {
-    BKE_id_free(NULL, mesh_src);
-  }
+  MOD_deform_mesh_eval_free(ctx->object, mesh, mesh_src);
 }
 
 static void panel_draw(const bContext *C, Panel *panel)
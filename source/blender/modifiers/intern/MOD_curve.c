@@ -139,9 +139,7 @@ static void deformVerts(ModifierData *md,
                      cmd->flag,
                      cmd->defaxis - 1);
 
-  if (!ELEM(mesh_src, NULL, mesh)) {
-    BKE_id_free(NULL, mesh_src);
-  }
+  MOD_deform_mesh_eval_free(ctx->object, mesh, mesh_src);
 }
 
 static void deformVertsEM(ModifierData *md,
@@ -160,9 +158,7 @@ static void deformVertsEM(ModifierData *md,
 
   deformVerts(md, ctx, mesh_src, vertexCos, numVerts);
 
-  if (!ELEM(mesh_src, NULL, mesh)) {
-    BKE_id_free(NULL, mesh_src);
-  }
+  MOD_deform_mesh_eval_free(ctx->object, mesh, mesh_src);
 }
 
 static void panel_draw(const bContext *C, Panel *panel)
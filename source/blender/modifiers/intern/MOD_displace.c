@@ -403,9 +403,7 @@ static void deformVerts(ModifierData *md,
 
   displaceModifier_do((DisplaceModifierData *)md, ctx, mesh_src, vertexCos, numVerts);
 
-  if (!ELEM(mesh_src, NULL, mesh)) {
-    BKE_id_free(NULL, mesh_src);
-  }
+  MOD_deform_mesh_eval_free(ctx->object, mesh, mesh_src);
 }
 
 static void deformVertsEM(ModifierData *md,
@@ -425,9 +423,7 @@ static void deformVertsEM(ModifierData *md,
 
   displaceModifier_do((DisplaceModifierData *)md, ctx, mesh_src, vertexCos, numVerts);
 
-  if (!ELEM(mesh_src, NULL, mesh)) {
-    BKE_id_free(NULL, mesh_src);
-  }
+  MOD_deform_mesh_eval_free(ctx->object, mesh, mesh_src);
 }
 
 static void panel_draw(const bContext *C, Panel *panel)
@@ -376,9 +376,7 @@ static void deformVerts(struct ModifierData *md,
 
   deformVerts_do(hmd, ctx, ctx->object, mesh_src, vertexCos, numVerts);
 
-  if (!ELEM(mesh_src, NULL, mesh)) {
-    BKE_id_free(NULL, mesh_src);
-  }
+  MOD_deform_mesh_eval_free(ctx->object, mesh, mesh_src);
 }
 
 static void deformVertsEM(struct ModifierData *md,
@@ -394,9 +392,7 @@ static void deformVertsEM(struct ModifierData *md,
 
   deformVerts_do(hmd, ctx, ctx->object, mesh_src, vertexCos, numVerts);
 
-  if (!ELEM(mesh_src, NULL, mesh)) {
-    BKE_id_free(NULL, mesh_src);
-  }
+  MOD_deform_mesh_eval_free(ctx->object, mesh, mesh_src);
 }
 
 static void panel_draw(const bContext *C, Panel *panel)
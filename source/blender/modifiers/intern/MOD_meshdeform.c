@@ -475,9 +475,7 @@ static void deformVerts(ModifierData *md,
 
   meshdeformModifier_do(md, ctx, mesh_src, vertexCos, numVerts);
 
-  if (!ELEM(mesh_src, NULL, mesh)) {
-    BKE_id_free(NULL, mesh_src);
-  }
+  MOD_deform_mesh_eval_free(ctx->object, mesh, mesh_src);
 }
 
 static void deformVertsEM(ModifierData *md,
@@ -497,9 +495,7 @@ static void deformVertsEM(ModifierData *md,
 
   meshdeformModifier_do(md, ctx, mesh_src, vertexCos, numVerts);
 
-  if (!ELEM(mesh_src, NULL, mesh)) {
-    BKE_id_free(NULL, mesh_src);
-  }
+  MOD_deform_mesh_eval_free(ctx->object, mesh, mesh_src);
 }
 
 #define MESHDEFORM_MIN_INFLUENCE 0.00001f
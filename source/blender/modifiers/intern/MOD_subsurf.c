@@ -34,6 +34,7 @@
 #include "DNA_object_types.h"
 #include "DNA_scene_types.h"
 #include "DNA_screen_types.h"
+#include "DNA_userdef_types.h"
 
 #include "BKE_context.h"
 #include "BKE_scene.h"
@@ -140,6 +141,8 @@ static void subdiv_settings_init(SubdivSettings *settings, const SubsurfModifier
   settings->vtx_boundary_interpolation = SUBDIV_VTX_BOUNDARY_EDGE_ONLY;
   settings->fvar_linear_interpolation = BKE_subdiv_fvar_interpolation_from_uv_smooth(
       smd->uv_smooth);
+  settings->evaluator_type = BKE_subdiv_evaluator_type_from_compute_type(
+      U.opensubdiv_compute_type);
 }
 
 /* Main goal of this function is to give usable subdivision surface descriptor
@@ -1355,9 +1355,7 @@ static void deformVerts(ModifierData *md,
 
   surfacedeformModifier_do(md, ctx, vertexCos, numVerts, ctx->object, mesh_src);
 
-  if (!ELEM(mesh_src, NULL, mesh)) {
-    BKE_id_free(NULL, mesh_src);
-  }
+  MOD_deform_mesh_eval_free(ctx->object, mesh, mesh_src);
 }
 
 static void deformVertsEM(ModifierData *md,
@@ -1377,9 +1375,7 @@ static void deformVertsEM(ModifierData *md,
 
   surfacedeformModifier_do(md, ctx, vertexCos, numVerts, ctx->object, mesh_src);
 
-  if (!ELEM(mesh_src, NULL, mesh)) {
-    BKE_id_free(NULL, mesh_src);
-  }
+  MOD_deform_mesh_eval_free(ctx->object, mesh, mesh_src);
 }
 
 static bool isDisabled(const Scene *UNUSED(scene), ModifierData *md, bool UNUSED(useRenderParams))
@@ -43,6 +43,7 @@
 #include "BKE_lattice.h"
 #include "BKE_lib_id.h"
 #include "BKE_mesh.h"
+#include "BKE_mesh_runtime.h"
 #include "BKE_object.h"
 
 #include "BKE_modifier.h"
@@ -194,6 +195,15 @@ Mesh *MOD_deform_mesh_eval_get(Object *ob,
   if (mesh != NULL) {
     /* pass */
   }
+  else if (ob->runtime.mesh_deform_shared != NULL) {
+    /* Deform only modifier without final mesh, it gets the mesh shared with the other ones. */
+    BLI_assert(em == NULL && !use_orco);
+    mesh = BKE_mesh_deform_shared_ensure(ob->runtime.mesh_deform_shared);
+    if (vertexCos) {
+      BKE_mesh_vert_coords_apply(mesh, vertexCos);
+      mesh->runtime.cd_dirty_vert |= CD_MASK_NORMAL;
+    }
+  }
   else if (ob->type == OB_MESH) {
     if (em) {
       mesh = BKE_mesh_wrapper_from_editmesh_with_coords(em, NULL, vertexCos, ob->data);
@@ -251,6 +261,21 @@ Mesh *MOD_deform_mesh_eval_get(Object *ob,
   return mesh;
 }
 
+/**
+ * Free a mesh returned by #MOD_deform_mesh_eval_get, unless it's the \a mesh passed to the
+ * modifier or the mesh shared by the deform only modifiers of \a ob.
+ */
+void MOD_deform_mesh_eval_free(Object *ob, Mesh *mesh, Mesh *mesh_src)
+{
+  if (ELEM(mesh_src, NULL, mesh)) {
+    return;
+  }
+  if (ob->runtime.mesh_deform_shared != NULL && mesh_src == ob->runtime.mesh_deform_shared->mesh) {
+    return;
+  }
+  BKE_id_free(NULL, mesh_src);
+}
+
 void MOD_get_vgroup(
     Object *ob, struct Mesh *mesh, const char *name, MDeformVert **dvert, int *defgrp_index)
 {
@@ -49,6 +49,7 @@ struct Mesh *MOD_deform_mesh_eval_get(struct Object *ob,
                                       const int num_verts,
                                       const bool use_normals,
                                       const bool use_orco);
+void MOD_deform_mesh_eval_free(struct Object *ob, struct Mesh *mesh, struct Mesh *mesh_src);
 
 void MOD_get_vgroup(struct Object *ob,
                     struct Mesh *mesh,
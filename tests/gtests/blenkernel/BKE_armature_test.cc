@@ -19,7 +19,24 @@
 
 #include "BKE_armature.h"
 
+#include "MEM_guardedalloc.h"
+
+#include "DNA_armature_types.h"
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+#include "DNA_object_types.h"
+
+#include "BKE_action.h"
+#include "BKE_customdata.h"
+#include "BKE_deform.h"
+#include "BKE_idtype.h"
+#include "BKE_lattice.h"
+#include "BKE_lib_id.h"
+#include "BKE_mesh.h"
+
+#include "BLI_listbase.h"
 #include "BLI_math.h"
+#include "BLI_string.h"
 
 #include "testing/testing.h"
 
@@ -87,3 +104,105 @@ TEST(mat3_vec_to_roll, Rotationmatrix)
     EXPECT_NEAR(0.57158958f, roll, FLOAT_EPSILON);
   }
 }
+
+static void test_deform_coords_expect(float coords[3][3], const float expected[3][3])
+{
+  for (int i = 0; i < 3; i++) {
+    EXPECT_V3_NEAR(coords[i], expected[i], FLOAT_EPSILON);
+    zero_v3(coords[i]);
+  }
+}
+
+TEST(armature_deform_verts, WeightsCache)
+{
+  BKE_idtype_init();
+
+  /* Bone A moves along X, bone B along Y. */
+  bArmature *arm = (bArmature *)BKE_id_new_nomain(ID_AR, "Armature");
+  Object *ob_arm = (Object *)BKE_id_new_nomain(ID_OB, "ArmatureObject");
+  ob_arm->type = OB_ARMATURE;
+  ob_arm->data = arm;
+  for (const char *name : {"A", "B"}) {
+    Bone *bone = (Bone *)MEM_callocN(sizeof(Bone), __func__);
+    STRNCPY(bone->name, name);
+    BLI_addtail(&arm->bonebase, bone);
+  }
+  BKE_pose_rebuild(NULL, ob_arm, arm, false);
+  bPoseChannel *pchan_a = BKE_pose_channel_find_name(ob_arm->pose, "A");
+  bPoseChannel *pchan_b = BKE_pose_channel_find_name(ob_arm->pose, "B");
+  unit_m4(pchan_a->chan_mat);
+  unit_m4(pchan_b->chan_mat);
+  pchan_a->chan_mat[3][0] = 1.0f;
+  pchan_b->chan_mat[3][1] = 2.0f;
+
+  /* The last vertex is only in a group without bone. */
+  Mesh *me = BKE_mesh_new_nomain(3, 0, 0, 0, 0);
+  MDeformVert *dverts = (MDeformVert *)CustomData_add_layer(
+      &me->vdata, CD_MDEFORMVERT, CD_CALLOC, NULL, me->totvert);
+  BKE_mesh_update_customdata_pointers(me, false);
+  BKE_defvert_add_index_notest(&dverts[0], 0, 1.0f);
+  BKE_defvert_add_index_notest(&dverts[1], 0, 0.5f);
+  BKE_defvert_add_index_notest(&dverts[1], 1, 0.5f);
+  BKE_defvert_add_index_notest(&dverts[2], 2, 1.0f);
+
+  Object *ob = (Object *)BKE_id_new_nomain(ID_OB, "Target");
+  ob->type = OB_MESH;
+  ob->data = me;
+  for (const char *name : {"A", "B", "C"}) {
+    bDeformGroup *dg = (bDeformGroup *)MEM_callocN(sizeof(bDeformGroup), __func__);
+    STRNCPY(dg->name, name);
+    BLI_addtail(&ob->defbase, dg);
+  }
+  /* Only evaluated objects keep the weights. */
+  ob->id.tag |= LIB_TAG_COPIED_ON_WRITE;
+
+  float coords[3][3] = {{0.0f}};
+  const float expected[3][3] = {{1.0f, 0.0f, 0.0f}, {0.5f, 1.0f, 0.0f}, {0.0f, 0.0f, 0.0f}};
+
+  armature_deform_verts(ob_arm, ob, me, coords, NULL, 3, ARM_DEF_VGROUP, NULL, "", NULL);
+  test_deform_coords_expect(coords, expected);
+  EXPECT_NE(ob->runtime.armature_deform_weights, nullptr);
+
+  /* Deforming again re-uses the weights. */
+  armature_deform_verts(ob_arm, ob, me, coords, NULL, 3, ARM_DEF_VGROUP, NULL, "", NULL);
+  test_deform_coords_expect(coords, expected);
+
+  /* A geometry update flushed to the mesh (from shape keys or drivers) keeps the weights,
+   * edits come with new arrays. Here they are edited in place, so the old weights show the
+   * table was re-used. */
+  const void *weights_prev = ob->runtime.armature_deform_weights;
+  dverts[1].dw[0].weight = 0.25f;
+  dverts[1].dw[1].weight = 0.75f;
+  me->id.recalc |= ID_RECALC_GEOMETRY;
+
+  armature_deform_verts(ob_arm, ob, me, coords, NULL, 3, ARM_DEF_VGROUP, NULL, "", NULL);
+  test_deform_coords_expect(coords, expected);
+  EXPECT_EQ(ob->runtime.armature_deform_weights, weights_prev);
+  me->id.recalc = 0;
+
+  /* Weights edited in place are picked up once the table is freed. */
+  BKE_armature_deform_weights_free(ob);
+  const float expected_in_place[3][3] = {
+      {1.0f, 0.0f, 0.0f}, {0.25f, 1.5f, 0.0f}, {0.0f, 0.0f, 0.0f}};
+
+  armature_deform_verts(ob_arm, ob, me, coords, NULL, 3, ARM_DEF_VGROUP, NULL, "", NULL);
+  test_deform_coords_expect(coords, expected_in_place);
+
+  /* A copy-on-write update with edited weights rebuilds them. */
+  Mesh *me_edit = BKE_mesh_copy_for_eval(me, true);
+  MDeformVert *dverts_edit = (MDeformVert *)CustomData_duplicate_referenced_layer(
+      &me_edit->vdata, CD_MDEFORMVERT, me_edit->totvert);
+  BKE_mesh_update_customdata_pointers(me_edit, false);
+  EXPECT_NE(dverts_edit, dverts);
+  dverts_edit[0].dw[0].def_nr = 1;
+  const float expected_edit[3][3] = {{0.0f, 2.0f, 0.0f}, {0.25f, 1.5f, 0.0f}, {0.0f, 0.0f, 0.0f}};
+
+  armature_deform_verts(ob_arm, ob, me_edit, coords, NULL, 3, ARM_DEF_VGROUP, NULL, "", NULL);
+  test_deform_coords_expect(coords, expected_edit);
+
+  BKE_id_free(NULL, ob);
+  BKE_id_free(NULL, me_edit);
+  BKE_id_free(NULL, me);
+  BKE_id_free(NULL, ob_arm);
+  BKE_id_free(NULL, arm);
+}
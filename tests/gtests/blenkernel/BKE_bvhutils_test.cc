@@ -0,0 +1,120 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2020 Blender Foundation
+ * All rights reserved.
+ */
+
+#include "testing/testing.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+
+#include "BKE_bvhutils.h"
+#include "BKE_customdata.h"
+#include "BKE_idtype.h"
+#include "BKE_lib_id.h"
+#include "BKE_mesh.h"
+
+#include "BLI_math.h"
+#include "BLI_threads.h"
+
+/** A single quad in the XY plane. */
+static Mesh *test_mesh_quad()
+{
+  Mesh *me = BKE_mesh_new_nomain(4, 0, 0, 4, 1);
+  const float cos[4][3] = {{0, 0, 0}, {1, 0, 0}, {1, 1, 0}, {0, 1, 0}};
+  for (int i = 0; i < 4; i++) {
+    copy_v3_v3(me->mvert[i].co, cos[i]);
+    me->mloop[i].v = (uint)i;
+  }
+  me->mpoly[0].loopstart = 0;
+  me->mpoly[0].totloop = 4;
+  BKE_mesh_calc_edges(me, false, false);
+  return me;
+}
+
+static BVHTree *test_bvhtree_get(Mesh *me)
+{
+  BVHTreeFromMesh data;
+  BVHTree *tree = BKE_bvhtree_from_mesh_get(&data, me, BVHTREE_FROM_LOOPTRI, 2);
+  free_bvhtree_from_mesh(&data);
+  return tree;
+}
+
+static Mesh *test_mesh_copy_with_layer(Mesh *me, const int type, const int totelem)
+{
+  Mesh *me_copy = BKE_mesh_copy_for_eval(me, true);
+  CustomData *data = (type == CD_MVERT) ? &me_copy->vdata : &me_copy->ldata;
+  CustomData_duplicate_referenced_layer(data, type, totelem);
+  BKE_mesh_update_customdata_pointers(me_copy, false);
+  return me_copy;
+}
+
+TEST(bvhcache, AttachSameTopology)
+{
+  BLI_threadapi_init();
+  BKE_idtype_init();
+
+  Mesh *me = test_mesh_quad();
+  BVHTree *tree = test_bvhtree_get(me);
+  ASSERT_NE(tree, nullptr);
+
+  /* Moved vertices, the topology is shared with the previous mesh. */
+  Mesh *me_moved = test_mesh_copy_with_layer(me, CD_MVERT, me->totvert);
+  me_moved->mvert[2].co[2] = 0.5f;
+  BVHCache *bvh_cache = bvhcache_detach(me);
+  ASSERT_NE(bvh_cache, nullptr);
+  bvhcache_attach(bvh_cache, me_moved);
+  EXPECT_EQ(me_moved->runtime.bvh_cache, bvh_cache);
+  EXPECT_EQ(test_bvhtree_get(me_moved), tree);
+
+  /* Equal topology in arrays of its own. */
+  Mesh *me_equal = test_mesh_copy_with_layer(me_moved, CD_MLOOP, me_moved->totloop);
+  EXPECT_NE(me_equal->mloop, me_moved->mloop);
+  bvh_cache = bvhcache_detach(me_moved);
+  ASSERT_NE(bvh_cache, nullptr);
+  bvhcache_attach(bvh_cache, me_equal);
+  EXPECT_EQ(me_equal->runtime.bvh_cache, bvh_cache);
+  EXPECT_EQ(test_bvhtree_get(me_equal), tree);
+
+  BKE_id_free(NULL, me_equal);
+  BKE_id_free(NULL, me_moved);
+  BKE_id_free(NULL, me);
+  BLI_threadapi_exit();
+}
+
+TEST(bvhcache, AttachChangedTopology)
+{
+  BLI_threadapi_init();
+  BKE_idtype_init();
+
+  Mesh *me = test_mesh_quad();
+  ASSERT_NE(test_bvhtree_get(me), nullptr);
+
+  /* Same element counts, but the loops use other vertices. */
+  Mesh *me_changed = test_mesh_copy_with_layer(me, CD_MLOOP, me->totloop);
+  SWAP(uint, me_changed->mloop[1].v, me_changed->mloop[3].v);
+  BVHCache *bvh_cache = bvhcache_detach(me);
+  ASSERT_NE(bvh_cache, nullptr);
+  bvhcache_attach(bvh_cache, me_changed);
+  EXPECT_EQ(me_changed->runtime.bvh_cache, nullptr);
+
+  BKE_id_free(NULL, me_changed);
+  BKE_id_free(NULL, me);
+  BLI_threadapi_exit();
+}
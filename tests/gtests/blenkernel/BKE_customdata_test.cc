@@ -0,0 +1,153 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "testing/testing.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "DNA_customdata_types.h"
+#include "DNA_meshdata_types.h"
+
+#include "BKE_customdata.h"
+#include "BKE_deform.h"
+
+#include "BLI_utildefines.h"
+
+static const int test_totelem = 64;
+
+static int *test_int_layer_add(CustomData *data)
+{
+  CustomData_reset(data);
+  int *values = (int *)CustomData_add_layer(data, CD_PROP_INT, CD_CALLOC, NULL, test_totelem);
+  for (int i = 0; i < test_totelem; i++) {
+    values[i] = i * 3;
+  }
+  return values;
+}
+
+static void test_int_layer_expect(const CustomData *data)
+{
+  const int *values = (const int *)CustomData_get_layer(data, CD_PROP_INT);
+  ASSERT_NE(values, nullptr);
+  for (int i = 0; i < test_totelem; i++) {
+    EXPECT_EQ(values[i], i * 3);
+  }
+}
+
+TEST(customdata_sharing, ReferenceOutlivesSource)
+{
+  const uint blocks_in_use = MEM_get_memory_blocks_in_use();
+  {
+    CustomData src, dst;
+    int *src_values = test_int_layer_add(&src);
+    CustomData_copy(&src, &dst, CD_MASK_PROP_INT, CD_REFERENCE, test_totelem);
+    EXPECT_EQ(CustomData_get_layer(&dst, CD_PROP_INT), src_values);
+    EXPECT_TRUE(CustomData_is_referenced_layer(&dst, CD_PROP_INT));
+
+    CustomData_free(&src, test_totelem);
+    test_int_layer_expect(&dst);
+
+    /* Last user of the data, it's taken over without a copy. */
+    EXPECT_EQ(CustomData_duplicate_referenced_layer(&dst, CD_PROP_INT, test_totelem), src_values);
+    EXPECT_FALSE(CustomData_is_referenced_layer(&dst, CD_PROP_INT));
+    CustomData_free(&dst, test_totelem);
+  }
+  EXPECT_EQ(MEM_get_memory_blocks_in_use(), blocks_in_use);
+}
+
+TEST(customdata_sharing, DuplicateWhileShared)
+{
+  const uint blocks_in_use = MEM_get_memory_blocks_in_use();
+  {
+    CustomData src, dst;
+    int *src_values = test_int_layer_add(&src);
+    CustomData_copy(&src, &dst, CD_MASK_PROP_INT, CD_REFERENCE, test_totelem);
+
+    int *dst_values = (int *)CustomData_duplicate_referenced_layer(
+        &dst, CD_PROP_INT, test_totelem);
+    EXPECT_NE(dst_values, src_values);
+    EXPECT_FALSE(CustomData_is_referenced_layer(&dst, CD_PROP_INT));
+    dst_values[0] = -1;
+    EXPECT_EQ(src_values[0], 0);
+
+    CustomData_free(&dst, test_totelem);
+    test_int_layer_expect(&src);
+    CustomData_free(&src, test_totelem);
+  }
+  EXPECT_EQ(MEM_get_memory_blocks_in_use(), blocks_in_use);
+}
+
+TEST(customdata_sharing, ReferenceOfReference)
+{
+  const uint blocks_in_use = MEM_get_memory_blocks_in_use();
+  {
+    CustomData src, dst_a, dst_b;
+    test_int_layer_add(&src);
+    CustomData_copy(&src, &dst_a, CD_MASK_PROP_INT, CD_REFERENCE, test_totelem);
+    CustomData_copy(&dst_a, &dst_b, CD_MASK_PROP_INT, CD_REFERENCE, test_totelem);
+
+    CustomData_free(&src, test_totelem);
+    CustomData_free(&dst_a, test_totelem);
+    test_int_layer_expect(&dst_b);
+    CustomData_free(&dst_b, test_totelem);
+  }
+  EXPECT_EQ(MEM_get_memory_blocks_in_use(), blocks_in_use);
+}
+
+TEST(customdata_sharing, SetLayerOnOwner)
+{
+  const uint blocks_in_use = MEM_get_memory_blocks_in_use();
+  {
+    CustomData src, dst;
+    int *src_values = test_int_layer_add(&src);
+    CustomData_copy(&src, &dst, CD_MASK_PROP_INT, CD_REFERENCE, test_totelem);
+
+    /* The owner takes its data back, the reference must not free it anymore. */
+    int *new_values = (int *)MEM_calloc_arrayN(test_totelem, sizeof(int), __func__);
+    CustomData_set_layer(&src, CD_PROP_INT, new_values);
+    CustomData_free(&dst, test_totelem);
+    EXPECT_EQ(CustomData_get_layer(&src, CD_PROP_INT), new_values);
+    EXPECT_EQ(src_values[5], 15);
+
+    MEM_freeN(src_values);
+    CustomData_free(&src, test_totelem);
+  }
+  EXPECT_EQ(MEM_get_memory_blocks_in_use(), blocks_in_use);
+}
+
+TEST(customdata_sharing, FreeCallback)
+{
+  const uint blocks_in_use = MEM_get_memory_blocks_in_use();
+  {
+    CustomData src, dst;
+    CustomData_reset(&src);
+    MDeformVert *dverts = (MDeformVert *)CustomData_add_layer(
+        &src, CD_MDEFORMVERT, CD_CALLOC, NULL, test_totelem);
+    for (int i = 0; i < test_totelem; i++) {
+      BKE_defvert_add_index_notest(&dverts[i], i % 4, 0.5f);
+    }
+    CustomData_copy(&src, &dst, CD_MASK_MDEFORMVERT, CD_REFERENCE, test_totelem);
+
+    /* The weights are freed with the last user. */
+    CustomData_free(&src, test_totelem);
+    const MDeformVert *dst_dverts = (const MDeformVert *)CustomData_get_layer(&dst,
+                                                                             CD_MDEFORMVERT);
+    EXPECT_EQ(dst_dverts[5].totweight, 1);
+    EXPECT_EQ(dst_dverts[5].dw[0].def_nr, 1);
+    CustomData_free(&dst, test_totelem);
+  }
+  EXPECT_EQ(MEM_get_memory_blocks_in_use(), blocks_in_use);
+}
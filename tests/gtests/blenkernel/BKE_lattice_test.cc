@@ -0,0 +1,104 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "testing/testing.h"
+
+#include <string.h>
+
+#include "MEM_guardedalloc.h"
+
+#include "DNA_curve_types.h"
+#include "DNA_lattice_types.h"
+#include "DNA_object_types.h"
+
+#include "BKE_idtype.h"
+#include "BKE_lattice.h"
+#include "BKE_lib_id.h"
+
+#include "BLI_math.h"
+#include "BLI_rand.h"
+
+static const int test_verts_num = 1000;
+
+static void test_lattice_deform(Object *ob_lattice,
+                                const float (*rest_coords)[3],
+                                const float (*expected)[3],
+                                struct LatticeDeformWeights **weights_cache)
+{
+  float(*coords)[3] = (float(*)[3])MEM_dupallocN(rest_coords);
+  lattice_deform_verts(
+      ob_lattice, NULL, NULL, coords, test_verts_num, 0, NULL, 1.0f, weights_cache);
+  for (int i = 0; i < test_verts_num; i++) {
+    EXPECT_V3_NEAR(coords[i], expected[i], 1e-6f);
+  }
+  MEM_freeN(coords);
+}
+
+TEST(lattice_deform_verts, WeightsCache)
+{
+  BKE_idtype_init();
+
+  Lattice *lt = (Lattice *)BKE_id_new_nomain(ID_LT, "Lattice");
+  BKE_lattice_resize(lt, 3, 4, 5, NULL);
+  Object *ob_lattice = (Object *)BKE_id_new_nomain(ID_OB, "LatticeObject");
+  ob_lattice->type = OB_LATTICE;
+  ob_lattice->data = lt;
+  for (int i = 0; i < lt->pntsu * lt->pntsv * lt->pntsw; i++) {
+    lt->def[i].vec[0] += 0.1f * (float)(i % 3);
+    lt->def[i].vec[2] -= 0.05f * (float)(i % 7);
+  }
+
+  /* Some coordinates are outside of the lattice. */
+  RNG *rng = BLI_rng_new(0);
+  float(*rest_coords)[3] = (float(*)[3])MEM_malloc_arrayN(
+      test_verts_num, sizeof(*rest_coords), __func__);
+  for (int i = 0; i < test_verts_num; i++) {
+    for (int j = 0; j < 3; j++) {
+      rest_coords[i][j] = BLI_rng_get_float(rng) * 1.5f - 0.75f;
+    }
+  }
+
+  float(*expected)[3] = (float(*)[3])MEM_dupallocN(rest_coords);
+  lattice_deform_verts(ob_lattice, NULL, NULL, expected, test_verts_num, 0, NULL, 1.0f, NULL);
+  EXPECT_NE(memcmp(expected, rest_coords, sizeof(*rest_coords) * test_verts_num), 0);
+
+  /* The basis is cached the second time the same coordinates are deformed. */
+  struct LatticeDeformWeights *weights_cache = NULL;
+  for (int i = 0; i < 3; i++) {
+    test_lattice_deform(ob_lattice, rest_coords, expected, &weights_cache);
+    EXPECT_NE(weights_cache, nullptr);
+  }
+
+  /* Moving the lattice points doesn't change the basis. */
+  lt->def[7].vec[1] += 0.3f;
+  memcpy(expected, rest_coords, sizeof(*rest_coords) * test_verts_num);
+  lattice_deform_verts(ob_lattice, NULL, NULL, expected, test_verts_num, 0, NULL, 1.0f, NULL);
+  test_lattice_deform(ob_lattice, rest_coords, expected, &weights_cache);
+
+  /* Different coordinates do. */
+  rest_coords[0][0] += 0.1f;
+  memcpy(expected, rest_coords, sizeof(*rest_coords) * test_verts_num);
+  lattice_deform_verts(ob_lattice, NULL, NULL, expected, test_verts_num, 0, NULL, 1.0f, NULL);
+  test_lattice_deform(ob_lattice, rest_coords, expected, &weights_cache);
+  test_lattice_deform(ob_lattice, rest_coords, expected, &weights_cache);
+
+  BKE_lattice_deform_weights_free(weights_cache);
+  MEM_freeN(expected);
+  MEM_freeN(rest_coords);
+  BLI_rng_free(rng);
+  BKE_id_free(NULL, ob_lattice);
+  BKE_id_free(NULL, lt);
+}
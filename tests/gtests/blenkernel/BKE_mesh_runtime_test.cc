@@ -0,0 +1,141 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "testing/testing.h"
+
+#include "MEM_guardedalloc.h"
+
+extern "C" {
+#include "DNA_genfile.h"
+}
+
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+#include "DNA_modifier_types.h"
+#include "DNA_object_types.h"
+
+#include "BKE_idtype.h"
+#include "BKE_lib_id.h"
+#include "BKE_mesh.h"
+#include "BKE_mesh_runtime.h"
+#include "BKE_modifier.h"
+
+#include "BLI_math.h"
+
+class MeshDeformSharedTest : public testing::Test {
+ protected:
+  Object ob;
+  Mesh *me;
+  ModifierEvalContext ctx;
+  float (*vert_coords)[3];
+
+  static void SetUpTestCase()
+  {
+    DNA_sdna_current_init();
+    BKE_idtype_init();
+    BKE_modifier_init();
+  }
+
+  static void TearDownTestCase()
+  {
+    DNA_sdna_current_free();
+  }
+
+  void SetUp() override
+  {
+    /* A strip of two quads. */
+    me = BKE_mesh_new_nomain(6, 0, 0, 8, 2);
+    for (int i = 0; i < 6; i++) {
+      me->mvert[i].co[0] = (float)(i % 3);
+      me->mvert[i].co[1] = (float)(i / 3);
+    }
+    for (int i = 0; i < 2; i++) {
+      me->mpoly[i].loopstart = i * 4;
+      me->mpoly[i].totloop = 4;
+      me->mloop[i * 4 + 0].v = i;
+      me->mloop[i * 4 + 1].v = i + 1;
+      me->mloop[i * 4 + 2].v = i + 4;
+      me->mloop[i * 4 + 3].v = i + 3;
+    }
+    BKE_mesh_calc_edges(me, false, false);
+    /* Referenced layers get a sharing state that is kept until the input is freed,
+     * create it now so it isn't counted as memory left by the tests. */
+    BKE_id_free(NULL, BKE_mesh_copy_for_eval(me, true));
+
+    memset(&ob, 0, sizeof(ob));
+    ob.type = OB_MESH;
+    ob.data = me;
+    ctx = {NULL, &ob, (ModifierApplyFlag)0};
+    vert_coords = BKE_mesh_vert_coords_alloc(me, NULL);
+  }
+
+  void TearDown() override
+  {
+    MEM_freeN(vert_coords);
+    BKE_id_free(NULL, me);
+  }
+
+  void deform(ModifierData *md, MeshDeformShared *shared)
+  {
+    ob.runtime.mesh_deform_shared = shared;
+    BKE_modifier_deform_verts(md, &ctx, NULL, vert_coords, me->totvert);
+    ob.runtime.mesh_deform_shared = NULL;
+  }
+};
+
+TEST_F(MeshDeformSharedTest, CreatedOnRequest)
+{
+  const uint blocks_in_use = MEM_get_memory_blocks_in_use();
+  MeshDeformShared shared = {me, NULL};
+
+  /* Without shape keys, this modifier doesn't request a mesh. */
+  ModifierData *md = BKE_modifier_new(eModifierType_ShapeKey);
+  deform(md, &shared);
+  EXPECT_EQ(shared.mesh, nullptr);
+
+  BKE_mesh_deform_shared_free(&shared);
+  BKE_modifier_free(md);
+  EXPECT_EQ(MEM_get_memory_blocks_in_use(), blocks_in_use);
+}
+
+TEST_F(MeshDeformSharedTest, SharedByModifiers)
+{
+  const uint blocks_in_use = MEM_get_memory_blocks_in_use();
+  MeshDeformShared shared = {me, NULL};
+  ModifierData *md_a = BKE_modifier_new(eModifierType_Smooth);
+  ModifierData *md_b = BKE_modifier_new(eModifierType_Smooth);
+
+  deform(md_a, &shared);
+  Mesh *mesh_shared = shared.mesh;
+  ASSERT_NE(mesh_shared, nullptr);
+  /* The input layers are referenced, not copied. */
+  EXPECT_NE(mesh_shared, me);
+  EXPECT_EQ(mesh_shared->mvert, me->mvert);
+  EXPECT_EQ(mesh_shared->medge, me->medge);
+
+  /* The second modifier gets the same mesh, the coordinates still come from the array. */
+  float co_prev[3];
+  copy_v3_v3(co_prev, vert_coords[0]);
+  deform(md_b, &shared);
+  EXPECT_EQ(shared.mesh, mesh_shared);
+  EXPECT_FALSE(equals_v3v3(vert_coords[0], co_prev));
+
+  BKE_mesh_deform_shared_free(&shared);
+  EXPECT_EQ(shared.mesh, nullptr);
+  BKE_modifier_free(md_b);
+  BKE_modifier_free(md_a);
+  EXPECT_EQ(MEM_get_memory_blocks_in_use(), blocks_in_use);
+}
@@ -0,0 +1,642 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "testing/testing.h"
+
+#include <string.h>
+
+#include "MEM_guardedalloc.h"
+
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+
+#include "BKE_customdata.h"
+#include "BKE_mesh.h"
+
+#include "BLI_edgehash.h"
+#include "BLI_math.h"
+#include "BLI_rand.h"
+#include "BLI_task.h"
+#include "BLI_utildefines.h"
+
+/* Meshes are built directly from custom-data layers, since the functions tested here only need
+ * the arrays (this avoids needing ID types to be registered). */
+
+static void test_mesh_init(Mesh *me, const int totloop, const int totpoly)
+{
+  memset(me, 0, sizeof(*me));
+  CustomData_reset(&me->vdata);
+  CustomData_reset(&me->edata);
+  CustomData_reset(&me->fdata);
+  CustomData_reset(&me->ldata);
+  CustomData_reset(&me->pdata);
+  me->totloop = totloop;
+  me->totpoly = totpoly;
+  me->mloop = (MLoop *)CustomData_add_layer(&me->ldata, CD_MLOOP, CD_CALLOC, NULL, totloop);
+  me->mpoly = (MPoly *)CustomData_add_layer(&me->pdata, CD_MPOLY, CD_CALLOC, NULL, totpoly);
+}
+
+static void test_mesh_free(Mesh *me)
+{
+  CustomData_free(&me->vdata, me->totvert);
+  CustomData_free(&me->edata, me->totedge);
+  CustomData_free(&me->ldata, me->totloop);
+  CustomData_free(&me->pdata, me->totpoly);
+}
+
+/**
+ * A grid of quads with shuffled vertex indices and polygon order, so edges are visited in an
+ * order unrelated to their vertex indices. Vertices get a random height up to \a z_random.
+ */
+static void test_mesh_grid(Mesh *me, const int size, const uint seed, const float z_random = 0.0f)
+{
+  const int verts_len = (size + 1) * (size + 1);
+  test_mesh_init(me, size * size * 4, size * size);
+  me->totvert = verts_len;
+  me->mvert = (MVert *)CustomData_add_layer(&me->vdata, CD_MVERT, CD_CALLOC, NULL, verts_len);
+
+  RNG *rng = BLI_rng_new(seed);
+  uint *vert_map = (uint *)MEM_mallocN(sizeof(*vert_map) * verts_len, __func__);
+  for (int i = 0; i < verts_len; i++) {
+    vert_map[i] = (uint)i;
+  }
+  BLI_rng_shuffle_array(rng, vert_map, sizeof(*vert_map), (uint)verts_len);
+  for (int i = 0; i < verts_len; i++) {
+    float *co = me->mvert[vert_map[i]].co;
+    co[0] = (float)(i % (size + 1));
+    co[1] = (float)(i / (size + 1));
+    co[2] = BLI_rng_get_float(rng) * z_random;
+  }
+
+  int *poly_order = (int *)MEM_mallocN(sizeof(*poly_order) * me->totpoly, __func__);
+  for (int i = 0; i < me->totpoly; i++) {
+    poly_order[i] = i;
+  }
+  BLI_rng_shuffle_array(rng, poly_order, sizeof(*poly_order), (uint)me->totpoly);
+
+  for (int i = 0; i < me->totpoly; i++) {
+    const int x = poly_order[i] % size;
+    const int y = poly_order[i] / size;
+    const int v = y * (size + 1) + x;
+    MPoly *mp = &me->mpoly[i];
+    mp->loopstart = i * 4;
+    mp->totloop = 4;
+    me->mloop[i * 4 + 0].v = vert_map[v];
+    me->mloop[i * 4 + 1].v = vert_map[v + 1];
+    me->mloop[i * 4 + 2].v = vert_map[v + size + 2];
+    me->mloop[i * 4 + 3].v = vert_map[v + size + 1];
+  }
+
+  MEM_freeN(poly_order);
+  MEM_freeN(vert_map);
+  BLI_rng_free(rng);
+}
+
+/** The #EdgeHash based version #BKE_mesh_calc_edges used to be, as a reference. */
+static MEdge *test_calc_edges_reference(const Mesh *me,
+                                        const MEdge *medge_orig,
+                                        const int totedge_orig,
+                                        uint *r_loop_edges,
+                                        int *r_totedge)
+{
+  EdgeHash *eh = BLI_edgehash_new(__func__);
+  for (int i = 0; i < totedge_orig; i++) {
+    BLI_edgehash_insert(eh, medge_orig[i].v1, medge_orig[i].v2, (void *)&medge_orig[i]);
+  }
+  for (int i = 0; i < me->totpoly; i++) {
+    const MPoly *mp = &me->mpoly[i];
+    uint v_prev = me->mloop[mp->loopstart + mp->totloop - 1].v;
+    for (int j = 0; j < mp->totloop; j++) {
+      const uint v = me->mloop[mp->loopstart + j].v;
+      if (v_prev != v) {
+        void **val_p;
+        if (!BLI_edgehash_ensure_p(eh, v_prev, v, &val_p)) {
+          *val_p = NULL;
+        }
+      }
+      v_prev = v;
+    }
+  }
+
+  const int totedge = BLI_edgehash_len(eh);
+  MEdge *medge = (MEdge *)MEM_callocN(sizeof(*medge) * totedge, __func__);
+  EdgeHashIterator *ehi = BLI_edgehashIterator_new(eh);
+  for (int i = 0; !BLI_edgehashIterator_isDone(ehi); BLI_edgehashIterator_step(ehi), i++) {
+    const MEdge *med_orig = (const MEdge *)BLI_edgehashIterator_getValue(ehi);
+    if (med_orig) {
+      medge[i] = *med_orig;
+    }
+    else {
+      BLI_edgehashIterator_getKey(ehi, &medge[i].v1, &medge[i].v2);
+      medge[i].flag = ME_EDGEDRAW | ME_EDGERENDER;
+    }
+    BLI_edgehashIterator_setValue(ehi, POINTER_FROM_INT(i));
+  }
+  BLI_edgehashIterator_free(ehi);
+
+  for (int i = 0; i < me->totpoly; i++) {
+    const MPoly *mp = &me->mpoly[i];
+    int l_prev = mp->loopstart + mp->totloop - 1;
+    for (int l = mp->loopstart; l < mp->loopstart + mp->totloop; l_prev = l++) {
+      const uint v1 = me->mloop[l_prev].v, v2 = me->mloop[l].v;
+      r_loop_edges[l_prev] = (v1 != v2) ? POINTER_AS_UINT(BLI_edgehash_lookup(eh, v1, v2)) : 0;
+    }
+  }
+  BLI_edgehash_free(eh, NULL);
+
+  *r_totedge = totedge;
+  return medge;
+}
+
+static void test_calc_edges_compare(Mesh *me, const bool update)
+{
+  const MEdge *medge_orig = update ? (const MEdge *)MEM_dupallocN(me->medge) : NULL;
+  const int totedge_orig = update ? me->totedge : 0;
+
+  uint *loop_edges = (uint *)MEM_mallocN(sizeof(*loop_edges) * me->totloop, __func__);
+  int totedge_ref;
+  MEdge *medge_ref = test_calc_edges_reference(
+      me, medge_orig, totedge_orig, loop_edges, &totedge_ref);
+
+  BKE_mesh_calc_edges(me, update, false);
+
+  ASSERT_EQ(me->totedge, totedge_ref);
+  for (int i = 0; i < totedge_ref; i++) {
+    EXPECT_EQ(me->medge[i].v1, medge_ref[i].v1);
+    EXPECT_EQ(me->medge[i].v2, medge_ref[i].v2);
+    EXPECT_EQ(me->medge[i].flag, medge_ref[i].flag);
+  }
+  for (int i = 0; i < me->totloop; i++) {
+    EXPECT_EQ(me->mloop[i].e, loop_edges[i]);
+  }
+
+  MEM_freeN(medge_ref);
+  MEM_freeN(loop_edges);
+  if (medge_orig) {
+    MEM_freeN((void *)medge_orig);
+  }
+}
+
+TEST(mesh_calc_edges, Small)
+{
+  Mesh me;
+  test_mesh_grid(&me, 3, 0);
+  test_calc_edges_compare(&me, false);
+  test_mesh_free(&me);
+}
+
+TEST(mesh_calc_edges, Empty)
+{
+  Mesh me;
+  test_mesh_init(&me, 0, 0);
+  BKE_mesh_calc_edges(&me, false, false);
+  EXPECT_EQ(me.totedge, 0);
+  test_mesh_free(&me);
+}
+
+TEST(mesh_calc_edges, DegenerateLoop)
+{
+  Mesh me;
+  test_mesh_init(&me, 4, 1);
+  me.totvert = 3;
+  me.mpoly[0].totloop = 4;
+  const uint verts[4] = {0, 1, 1, 2};
+  for (int i = 0; i < 4; i++) {
+    me.mloop[i].v = verts[i];
+  }
+  test_calc_edges_compare(&me, false);
+  EXPECT_EQ(me.totedge, 3);
+  test_mesh_free(&me);
+}
+
+TEST(mesh_calc_edges, LargeThreaded)
+{
+  BLI_threadapi_init();
+  Mesh me;
+  test_mesh_grid(&me, 300, 1);
+  test_calc_edges_compare(&me, false);
+  test_mesh_free(&me);
+  BLI_threadapi_exit();
+}
+
+TEST(mesh_calc_edges, UnorderedPolys)
+{
+  BLI_threadapi_init();
+  Mesh me;
+  test_mesh_grid(&me, 40, 4);
+  /* Polygons stored in the reverse order of their loops. */
+  for (int i = 0; i < me.totpoly / 2; i++) {
+    SWAP(MPoly, me.mpoly[i], me.mpoly[me.totpoly - 1 - i]);
+  }
+  test_calc_edges_compare(&me, false);
+  test_mesh_free(&me);
+  BLI_threadapi_exit();
+}
+
+TEST(mesh_calc_edges, Update)
+{
+  BLI_threadapi_init();
+  Mesh me;
+  test_mesh_grid(&me, 150, 2);
+  BKE_mesh_calc_edges(&me, false, false);
+
+  /* Keep some existing edges (in a different order and with custom flags),
+   * they have to come first and keep their data. */
+  const int totedge_keep = me.totedge / 3;
+  MEdge *medge_keep = (MEdge *)MEM_mallocN(sizeof(*medge_keep) * totedge_keep, __func__);
+  for (int i = 0; i < totedge_keep; i++) {
+    medge_keep[i] = me.medge[me.totedge - 1 - i * 3];
+    medge_keep[i].flag = ME_SEAM;
+    medge_keep[i].crease = (char)i;
+  }
+  CustomData_free(&me.edata, me.totedge);
+  CustomData_reset(&me.edata);
+  me.totedge = totedge_keep;
+  me.medge = (MEdge *)CustomData_add_layer(
+      &me.edata, CD_MEDGE, CD_ASSIGN, medge_keep, totedge_keep);
+
+  test_calc_edges_compare(&me, true);
+  for (int i = 0; i < totedge_keep; i++) {
+    EXPECT_EQ(me.medge[i].flag, ME_SEAM);
+    EXPECT_EQ(me.medge[i].crease, (char)i);
+  }
+  test_mesh_free(&me);
+  BLI_threadapi_exit();
+}
+
+TEST(mesh_calc_normals_poly, Flat)
+{
+  BLI_threadapi_init();
+  Mesh me;
+  test_mesh_grid(&me, 120, 3);
+  float(*pnors)[3] = (float(*)[3])MEM_mallocN(sizeof(*pnors) * me.totpoly, __func__);
+  BKE_mesh_calc_normals_poly(
+      me.mvert, NULL, me.totvert, me.mloop, me.mpoly, me.totloop, me.totpoly, pnors, false);
+  const float up[3] = {0.0f, 0.0f, 1.0f};
+  for (int i = 0; i < me.totpoly; i++) {
+    EXPECT_V3_NEAR(pnors[i], up, 1e-6f);
+  }
+  for (int i = 0; i < me.totvert; i++) {
+    EXPECT_EQ(me.mvert[i].no[0], 0);
+    EXPECT_EQ(me.mvert[i].no[1], 0);
+    EXPECT_EQ(me.mvert[i].no[2], 32767);
+  }
+  MEM_freeN(pnors);
+  test_mesh_free(&me);
+  BLI_threadapi_exit();
+}
+
+TEST(mesh_calc_normals_poly, MatchesAccumulate)
+{
+  BLI_threadapi_init();
+  Mesh me;
+  test_mesh_grid(&me, 120, 4, 0.5f);
+
+  /* Reference: polygon normals accumulated into the vertices one polygon at a time. */
+  float(*vnors_ref)[3] = (float(*)[3])MEM_callocN(sizeof(*vnors_ref) * me.totvert, __func__);
+  for (int i = 0; i < me.totpoly; i++) {
+    const MPoly *mp = &me.mpoly[i];
+    float pnor[3], edgevecs[4][3];
+    float *vnors[4];
+    const float *cos[4];
+    BKE_mesh_calc_poly_normal(mp, &me.mloop[mp->loopstart], me.mvert, pnor);
+    for (int j = 0; j < 4; j++) {
+      const uint v = me.mloop[mp->loopstart + j].v;
+      vnors[j] = vnors_ref[v];
+      cos[j] = me.mvert[v].co;
+    }
+    accumulate_vertex_normals_poly_v3(vnors, pnor, cos, edgevecs, 4);
+  }
+
+  float(*vnors)[3] = (float(*)[3])MEM_mallocN(sizeof(*vnors) * me.totvert, __func__);
+  BKE_mesh_calc_normals_poly(
+      me.mvert, vnors, me.totvert, me.mloop, me.mpoly, me.totloop, me.totpoly, NULL, false);
+  for (int i = 0; i < me.totvert; i++) {
+    normalize_v3(vnors_ref[i]);
+    EXPECT_V3_NEAR(vnors[i], vnors_ref[i], 1e-5f);
+  }
+
+  MEM_freeN(vnors);
+  MEM_freeN(vnors_ref);
+  test_mesh_free(&me);
+  BLI_threadapi_exit();
+}
+
+TEST(mesh_recalc_looptri, Grid)
+{
+  BLI_threadapi_init();
+  Mesh me;
+  test_mesh_grid(&me, 120, 5, 0.5f);
+  const int looptri_len = poly_to_tri_count(me.totpoly, me.totloop);
+  MLoopTri *mlooptri = (MLoopTri *)MEM_mallocN(sizeof(*mlooptri) * looptri_len, __func__);
+  BKE_mesh_recalc_looptri(me.mloop, me.mpoly, me.mvert, me.totloop, me.totpoly, mlooptri);
+  for (int i = 0; i < looptri_len; i++) {
+    const MLoopTri *lt = &mlooptri[i];
+    const MPoly *mp = &me.mpoly[lt->poly];
+    EXPECT_EQ(lt->poly, (uint)i / 2);
+    for (int j = 0; j < 3; j++) {
+      EXPECT_GE(lt->tri[j], (uint)mp->loopstart);
+      EXPECT_LT(lt->tri[j], (uint)(mp->loopstart + mp->totloop));
+    }
+  }
+  MEM_freeN(mlooptri);
+  test_mesh_free(&me);
+  BLI_threadapi_exit();
+}
+
+TEST(mesh_recalc_looptri, NGon)
+{
+  /* A triangle, followed by a concave n-gon (a "comb" shape), followed by a quad. */
+  const float cos[][3] = {
+      {0, 0, 0},  {1, 0, 0},  {0, 1, 0},                                   /* Triangle. */
+      {0, 0, 1},  {4, 0, 1},  {4, 2, 1},  {3, 2, 1}, {3, 1, 1}, {2, 1, 1}, /* N-gon. */
+      {2, 2, 1},  {1, 2, 1},  {1, 1, 1},  {0, 1, 1},                       /* N-gon. */
+      {0, 0, 2},  {1, 0, 2},  {1, 1, 2},  {0, 1, 2},                       /* Quad. */
+  };
+  const int poly_sizes[3] = {3, 10, 4};
+  const int totvert = (int)ARRAY_SIZE(cos);
+
+  Mesh me;
+  test_mesh_init(&me, totvert, 3);
+  me.totvert = totvert;
+  me.mvert = (MVert *)CustomData_add_layer(&me.vdata, CD_MVERT, CD_CALLOC, NULL, totvert);
+  for (int i = 0; i < totvert; i++) {
+    copy_v3_v3(me.mvert[i].co, cos[i]);
+    me.mloop[i].v = (uint)i;
+  }
+  for (int i = 0, loopstart = 0; i < 3; loopstart += poly_sizes[i++]) {
+    me.mpoly[i].loopstart = loopstart;
+    me.mpoly[i].totloop = poly_sizes[i];
+  }
+
+  const int looptri_len = poly_to_tri_count(me.totpoly, me.totloop);
+  EXPECT_EQ(looptri_len, 1 + 8 + 2);
+  MLoopTri *mlooptri = (MLoopTri *)MEM_mallocN(sizeof(*mlooptri) * looptri_len, __func__);
+  BKE_mesh_recalc_looptri(me.mloop, me.mpoly, me.mvert, me.totloop, me.totpoly, mlooptri);
+
+  /* The triangles of each polygon cover its area. */
+  float areas[3] = {0.0f, 0.0f, 0.0f};
+  for (int i = 0; i < looptri_len; i++) {
+    const MLoopTri *lt = &mlooptri[i];
+    areas[lt->poly] += area_tri_v3(
+        cos[me.mloop[lt->tri[0]].v], cos[me.mloop[lt->tri[1]].v], cos[me.mloop[lt->tri[2]].v]);
+  }
+  EXPECT_FLOAT_EQ(areas[0], 0.5f);
+  EXPECT_FLOAT_EQ(areas[1], 6.0f);
+  EXPECT_FLOAT_EQ(areas[2], 1.0f);
+
+  MEM_freeN(mlooptri);
+  test_mesh_free(&me);
+}
+
+TEST(mesh_recalc_looptri, UnorderedPolys)
+{
+  /* A quad whose loops are stored after the ones of a triangle, and a polygon with two loops. */
+  const float cos[][3] = {
+      {0, 0, 0}, {1, 0, 0}, {0, 1, 0},            /* Triangle. */
+      {0, 0, 1}, {1, 0, 1}, {1, 1, 1}, {0, 1, 1}, /* Quad. */
+  };
+  const int totvert = (int)ARRAY_SIZE(cos);
+
+  Mesh me;
+  test_mesh_init(&me, totvert, 3);
+  me.totvert = totvert;
+  me.mvert = (MVert *)CustomData_add_layer(&me.vdata, CD_MVERT, CD_CALLOC, NULL, totvert);
+  for (int i = 0; i < totvert; i++) {
+    copy_v3_v3(me.mvert[i].co, cos[i]);
+    me.mloop[i].v = (uint)i;
+  }
+  me.mpoly[0].loopstart = 3;
+  me.mpoly[0].totloop = 4;
+  me.mpoly[1].loopstart = 0;
+  me.mpoly[1].totloop = 2;
+  me.mpoly[2].loopstart = 0;
+  me.mpoly[2].totloop = 3;
+
+  const int looptri_len = 2 + 1;
+  MLoopTri *mlooptri = (MLoopTri *)MEM_mallocN(sizeof(*mlooptri) * looptri_len, __func__);
+  BKE_mesh_recalc_looptri(me.mloop, me.mpoly, me.mvert, me.totloop, me.totpoly, mlooptri);
+
+  const uint looptri_polys[looptri_len] = {0, 0, 2};
+  for (int i = 0; i < looptri_len; i++) {
+    const MLoopTri *lt = &mlooptri[i];
+    const MPoly *mp = &me.mpoly[lt->poly];
+    EXPECT_EQ(lt->poly, looptri_polys[i]);
+    for (int j = 0; j < 3; j++) {
+      EXPECT_GE(lt->tri[j], (uint)mp->loopstart);
+      EXPECT_LT(lt->tri[j], (uint)(mp->loopstart + mp->totloop));
+    }
+  }
+
+  MEM_freeN(mlooptri);
+  test_mesh_free(&me);
+}
+
+/** A smooth grid with edges, loop normals are computed with a split angle of 30 degrees. */
+static void test_mesh_grid_smooth(Mesh *me, const int size, const uint seed, const float z_random)
+{
+  test_mesh_grid(me, size, seed, z_random);
+  BKE_mesh_calc_edges(me, false, false);
+  for (int i = 0; i < me->totpoly; i++) {
+    me->mpoly[i].flag |= ME_SMOOTH;
+  }
+}
+
+static void test_normals_loop_split(Mesh *me,
+                                    MeshLoopFanCache **fan_cache_p,
+                                    float (*r_loopnors)[3],
+                                    MLoopNorSpaceArray *r_lnors_spacearr = NULL,
+                                    short (*clnors)[2] = NULL)
+{
+  float(*pnors)[3] = (float(*)[3])MEM_mallocN(sizeof(*pnors) * me->totpoly, __func__);
+  BKE_mesh_calc_normals_poly(
+      me->mvert, NULL, me->totvert, me->mloop, me->mpoly, me->totloop, me->totpoly, pnors, false);
+  BKE_mesh_normals_loop_split_ex(me->mvert,
+                                 me->totvert,
+                                 me->medge,
+                                 me->totedge,
+                                 me->mloop,
+                                 r_loopnors,
+                                 me->totloop,
+                                 me->mpoly,
+                                 pnors,
+                                 me->totpoly,
+                                 true,
+                                 DEG2RADF(30.0f),
+                                 r_lnors_spacearr,
+                                 clnors,
+                                 NULL,
+                                 fan_cache_p);
+  MEM_freeN(pnors);
+}
+
+TEST(mesh_normals_loop_split, Smooth)
+{
+  BLI_threadapi_init();
+  Mesh me;
+  test_mesh_grid_smooth(&me, 120, 6, 0.1f);
+  float(*lnors)[3] = (float(*)[3])MEM_mallocN(sizeof(*lnors) * me.totloop, __func__);
+  test_normals_loop_split(&me, NULL, lnors);
+
+  /* No edge is sharp, so loop normals are the vertex normals. */
+  for (int i = 0; i < me.totloop; i++) {
+    float vno[3];
+    normal_short_to_float_v3(vno, me.mvert[me.mloop[i].v].no);
+    EXPECT_V3_NEAR(lnors[i], vno, 1e-4f);
+  }
+
+  MEM_freeN(lnors);
+  test_mesh_free(&me);
+  BLI_threadapi_exit();
+}
+
+TEST(mesh_normals_loop_split, FanCache)
+{
+  BLI_threadapi_init();
+  Mesh me;
+  test_mesh_grid_smooth(&me, 120, 7, 1.0f);
+  float(*lnors_ref)[3] = (float(*)[3])MEM_mallocN(sizeof(*lnors_ref) * me.totloop, __func__);
+  float(*lnors)[3] = (float(*)[3])MEM_mallocN(sizeof(*lnors) * me.totloop, __func__);
+  MeshLoopFanCache *fan_cache = BKE_mesh_loop_fan_cache_new();
+
+  for (int iter = 0; iter < 4; iter++) {
+    if (iter == 2) {
+      /* Change which edges are sharp. */
+      for (int i = 0; i < me.totvert; i++) {
+        me.mvert[i].co[2] *= 1.5f;
+      }
+    }
+    else if (iter == 3) {
+      /* Change the topology (the first loop of all polygons). */
+      for (int i = 0; i < me.totpoly; i++) {
+        MLoop *ml = &me.mloop[me.mpoly[i].loopstart];
+        const MLoop ml_first = ml[0];
+        memmove(ml, ml + 1, sizeof(*ml) * 3);
+        ml[3] = ml_first;
+      }
+    }
+    else {
+      /* Deform only. */
+      for (int i = 0; i < me.totvert; i++) {
+        me.mvert[i].co[0] += me.mvert[i].co[2] * 0.01f;
+      }
+    }
+
+    test_normals_loop_split(&me, NULL, lnors_ref);
+    test_normals_loop_split(&me, &fan_cache, lnors);
+    for (int i = 0; i < me.totloop; i++) {
+      EXPECT_V3_NEAR(lnors[i], lnors_ref[i], 1e-6f);
+    }
+  }
+
+  BKE_mesh_loop_fan_cache_free(fan_cache);
+  MEM_freeN(lnors);
+  MEM_freeN(lnors_ref);
+  test_mesh_free(&me);
+  BLI_threadapi_exit();
+}
+
+TEST(mesh_normals_loop_split, FanCacheSharedDiverged)
+{
+  BLI_threadapi_init();
+  Mesh me, me_copy;
+  test_mesh_grid_smooth(&me, 60, 9, 1.0f);
+  test_mesh_grid_smooth(&me_copy, 60, 9, 1.0f);
+  float(*lnors_ref)[3] = (float(*)[3])MEM_mallocN(sizeof(*lnors_ref) * me.totloop, __func__);
+  float(*lnors)[3] = (float(*)[3])MEM_mallocN(sizeof(*lnors) * me.totloop, __func__);
+  MeshLoopFanCache *fan_cache = BKE_mesh_loop_fan_cache_new();
+  MeshLoopFanCache *fan_cache_copy = BKE_mesh_loop_fan_cache_share(fan_cache);
+
+  /* The copy changes the topology (the first loop of all polygons). */
+  for (int i = 0; i < me_copy.totpoly; i++) {
+    MLoop *ml = &me_copy.mloop[me_copy.mpoly[i].loopstart];
+    const MLoop ml_first = ml[0];
+    memmove(ml, ml + 1, sizeof(*ml) * 3);
+    ml[3] = ml_first;
+  }
+
+  MeshLoopFanCache *fan_cache_orig = fan_cache;
+  for (int iter = 0; iter < 3; iter++) {
+    test_normals_loop_split(&me, NULL, lnors_ref);
+    test_normals_loop_split(&me, &fan_cache, lnors);
+    for (int i = 0; i < me.totloop; i++) {
+      EXPECT_V3_NEAR(lnors[i], lnors_ref[i], 1e-6f);
+    }
+
+    test_normals_loop_split(&me_copy, NULL, lnors_ref);
+    test_normals_loop_split(&me_copy, &fan_cache_copy, lnors);
+    for (int i = 0; i < me_copy.totloop; i++) {
+      EXPECT_V3_NEAR(lnors[i], lnors_ref[i], 1e-6f);
+    }
+
+    /* The diverged copy got a cache of its own, the fans of the original are kept. */
+    EXPECT_EQ(fan_cache, fan_cache_orig);
+    EXPECT_NE(fan_cache_copy, fan_cache);
+  }
+
+  BKE_mesh_loop_fan_cache_free(fan_cache_copy);
+  BKE_mesh_loop_fan_cache_free(fan_cache);
+  MEM_freeN(lnors);
+  MEM_freeN(lnors_ref);
+  test_mesh_free(&me_copy);
+  test_mesh_free(&me);
+  BLI_threadapi_exit();
+}
+
+TEST(mesh_normals_loop_split, FanCacheCustomNormals)
+{
+  BLI_threadapi_init();
+  Mesh me;
+  test_mesh_grid_smooth(&me, 60, 8, 1.0f);
+  float(*lnors_ref)[3] = (float(*)[3])MEM_mallocN(sizeof(*lnors_ref) * me.totloop, __func__);
+  float(*lnors)[3] = (float(*)[3])MEM_mallocN(sizeof(*lnors) * me.totloop, __func__);
+  short(*clnors)[2] = (short(*)[2])MEM_callocN(sizeof(*clnors) * me.totloop, __func__);
+  for (int i = 0; i < me.totloop; i++) {
+    clnors[i][0] = clnors[i][1] = (short)(me.mloop[i].v * 37 % 2000);
+  }
+  MeshLoopFanCache *fan_cache = BKE_mesh_loop_fan_cache_new();
+
+  for (int iter = 0; iter < 2; iter++) {
+    MLoopNorSpaceArray lnors_spacearr_ref = {NULL};
+    MLoopNorSpaceArray lnors_spacearr = {NULL};
+    test_normals_loop_split(&me, NULL, lnors_ref, &lnors_spacearr_ref, clnors);
+    test_normals_loop_split(&me, &fan_cache, lnors, &lnors_spacearr, clnors);
+
+    EXPECT_EQ(lnors_spacearr.num_spaces, lnors_spacearr_ref.num_spaces);
+    for (int i = 0; i < me.totloop; i++) {
+      EXPECT_V3_NEAR(lnors[i], lnors_ref[i], 1e-6f);
+      const MLoopNorSpace *lnor_space = lnors_spacearr.lspacearr[i];
+      const MLoopNorSpace *lnor_space_ref = lnors_spacearr_ref.lspacearr[i];
+      EXPECT_V3_NEAR(lnor_space->vec_lnor, lnor_space_ref->vec_lnor, 1e-6f);
+      EXPECT_FLOAT_EQ(lnor_space->ref_alpha, lnor_space_ref->ref_alpha);
+      EXPECT_FLOAT_EQ(lnor_space->ref_beta, lnor_space_ref->ref_beta);
+    }
+    BKE_lnor_spacearr_free(&lnors_spacearr);
+    BKE_lnor_spacearr_free(&lnors_spacearr_ref);
+
+    /* Deform only. */
+    for (int i = 0; i < me.totvert; i++) {
+      me.mvert[i].co[2] *= 0.5f;
+    }
+  }
+
+  BKE_mesh_loop_fan_cache_free(fan_cache);
+  MEM_freeN(clnors);
+  MEM_freeN(lnors);
+  MEM_freeN(lnors_ref);
+  test_mesh_free(&me);
+  BLI_threadapi_exit();
+}
@@ -0,0 +1,218 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "testing/testing.h"
+
+#include <string.h>
+
+#include "MEM_guardedalloc.h"
+
+extern "C" {
+#include "DNA_genfile.h"
+}
+
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+#include "DNA_modifier_types.h"
+#include "DNA_object_types.h"
+#include "DNA_userdef_types.h"
+
+#include "BKE_customdata.h"
+#include "BKE_idtype.h"
+#include "BKE_lib_id.h"
+#include "BKE_mesh.h"
+#include "BKE_modifier.h"
+
+#include "BLI_utildefines.h"
+
+class ModifierResultCacheTest : public testing::Test {
+ protected:
+  Object ob;
+  ModifierData *md;
+  ModifierEvalContext ctx;
+  CustomData_MeshMasks mask;
+
+  static void SetUpTestCase()
+  {
+    DNA_sdna_current_init();
+    BKE_idtype_init();
+    BKE_modifier_init();
+  }
+
+  static void TearDownTestCase()
+  {
+    DNA_sdna_current_free();
+  }
+
+  void SetUp() override
+  {
+    U.modifier_cache_limit = 64;
+
+    memset(&ob, 0, sizeof(ob));
+    ob.type = OB_MESH;
+    ctx = {NULL, &ob, (ModifierApplyFlag)0};
+    mask = CD_MASK_BAREMESH;
+
+    md = BKE_modifier_new(eModifierType_Triangulate);
+    md->flag |= eModifierFlag_UseResultCache;
+  }
+
+  void TearDown() override
+  {
+    BKE_modifier_free(md);
+    EXPECT_EQ(BKE_modifier_result_cache_mem_in_use(), 0);
+    BKE_modifier_result_cache_clear();
+  }
+
+  /** A grid of quads, \a offset moves it so inputs can be told apart. */
+  static Mesh *grid_new(const int size, const float offset)
+  {
+    const int verts_len = (size + 1) * (size + 1);
+    Mesh *me = BKE_mesh_new_nomain(verts_len, 0, 0, size * size * 4, size * size);
+
+    for (int i = 0; i < verts_len; i++) {
+      me->mvert[i].co[0] = (float)(i % (size + 1)) + offset;
+      me->mvert[i].co[1] = (float)(i / (size + 1));
+    }
+    for (int i = 0; i < me->totpoly; i++) {
+      const int v = (i / size) * (size + 1) + (i % size);
+      me->mpoly[i].loopstart = i * 4;
+      me->mpoly[i].totloop = 4;
+      me->mloop[i * 4 + 0].v = v;
+      me->mloop[i * 4 + 1].v = v + 1;
+      me->mloop[i * 4 + 2].v = v + size + 2;
+      me->mloop[i * 4 + 3].v = v + size + 1;
+    }
+    BKE_mesh_calc_edges(me, false, false);
+    BKE_mesh_calc_normals(me);
+    return me;
+  }
+
+  Mesh *eval(Mesh *me)
+  {
+    Mesh *result = BKE_modifier_modify_mesh_cached(md, &ctx, me, &mask);
+    EXPECT_NE(result, me);
+    EXPECT_EQ(result->totpoly, me->totpoly * 2);
+    return result;
+  }
+};
+
+TEST_F(ModifierResultCacheTest, ReuseResult)
+{
+  Mesh *me = grid_new(8, 0.0f);
+
+  Mesh *result_a = eval(me);
+  EXPECT_GT(BKE_modifier_result_cache_mem_in_use(), 0);
+  Mesh *result_b = eval(me);
+  /* Both share the data of the cached result. */
+  EXPECT_EQ(result_a->mpoly, result_b->mpoly);
+  EXPECT_TRUE(CustomData_is_referenced_layer(&result_b->pdata, CD_MPOLY));
+
+  /* A different input is evaluated again. */
+  me->mvert[0].co[2] = 1.0f;
+  Mesh *result_c = eval(me);
+  EXPECT_NE(result_a->mpoly, result_c->mpoly);
+  EXPECT_EQ(result_c->mvert[0].co[2], 1.0f);
+
+  /* Settings are part of the key too. */
+  ((TriangulateModifierData *)md)->quad_method = MOD_TRIANGULATE_QUAD_FIXED;
+  Mesh *result_d = eval(me);
+  EXPECT_NE(result_c->mpoly, result_d->mpoly);
+
+  BKE_id_free(NULL, result_a);
+  BKE_id_free(NULL, result_b);
+  BKE_id_free(NULL, result_c);
+  BKE_id_free(NULL, result_d);
+  BKE_id_free(NULL, me);
+}
+
+TEST_F(ModifierResultCacheTest, Disabled)
+{
+  md->flag &= ~eModifierFlag_UseResultCache;
+  Mesh *me = grid_new(8, 0.0f);
+
+  Mesh *result_a = eval(me);
+  Mesh *result_b = eval(me);
+  EXPECT_NE(result_a->mpoly, result_b->mpoly);
+  EXPECT_EQ(BKE_modifier_result_cache_mem_in_use(), 0);
+
+  BKE_id_free(NULL, result_a);
+  BKE_id_free(NULL, result_b);
+  BKE_id_free(NULL, me);
+}
+
+TEST_F(ModifierResultCacheTest, EvictLeastRecentlyUsed)
+{
+  Mesh *me_a = grid_new(160, 0.0f);
+  Mesh *me_b = grid_new(160, 1.0f);
+
+  Mesh *result_a = eval(me_a);
+  const size_t mem_size = BKE_modifier_result_cache_mem_in_use();
+  ASSERT_GT(mem_size, 1024 * 1024);
+  /* Room for one result only. */
+  U.modifier_cache_limit = (int)((mem_size * 3 / 2) / (1024 * 1024));
+  ASSERT_GE((size_t)U.modifier_cache_limit * 1024 * 1024, mem_size);
+  ASSERT_LT((size_t)U.modifier_cache_limit * 1024 * 1024, mem_size * 2);
+
+  Mesh *result_b = eval(me_b);
+  EXPECT_EQ(BKE_modifier_result_cache_mem_in_use(), mem_size);
+
+  /* Result of the first input was freed, the earlier evaluated mesh remains valid. */
+  Mesh *result_a_again = eval(me_a);
+  EXPECT_NE(result_a->mpoly, result_a_again->mpoly);
+  EXPECT_EQ(memcmp(result_a->mloop, result_a_again->mloop, sizeof(MLoop) * result_a->totloop),
+            0);
+
+  BKE_id_free(NULL, result_a);
+  BKE_id_free(NULL, result_a_again);
+  BKE_id_free(NULL, result_b);
+  BKE_id_free(NULL, me_a);
+  BKE_id_free(NULL, me_b);
+}
+
+TEST_F(ModifierResultCacheTest, RemoveModifier)
+{
+  Mesh *me_a = grid_new(8, 0.0f);
+  Mesh *me_b = grid_new(8, 1.0f);
+
+  Mesh *result_a = eval(me_a);
+  Mesh *result_b = eval(me_b);
+  const size_t mem_size = BKE_modifier_result_cache_mem_in_use();
+
+  /* Results of another modifier. */
+  ModifierData *md_other = md;
+  md = BKE_modifier_new(eModifierType_Triangulate);
+  md->flag |= eModifierFlag_UseResultCache;
+  Mesh *result_other = eval(me_a);
+  EXPECT_GT(BKE_modifier_result_cache_mem_in_use(), mem_size);
+  BKE_modifier_free(md);
+  md = md_other;
+
+  /* Only the results of the freed modifier are removed. */
+  EXPECT_EQ(BKE_modifier_result_cache_mem_in_use(), mem_size);
+  Mesh *result_a_again = eval(me_a);
+  EXPECT_EQ(result_a->mpoly, result_a_again->mpoly);
+  Mesh *result_b_again = eval(me_b);
+  EXPECT_EQ(result_b->mpoly, result_b_again->mpoly);
+
+  BKE_id_free(NULL, result_a);
+  BKE_id_free(NULL, result_a_again);
+  BKE_id_free(NULL, result_b);
+  BKE_id_free(NULL, result_b_again);
+  BKE_id_free(NULL, result_other);
+  BKE_id_free(NULL, me_a);
+  BKE_id_free(NULL, me_b);
+}
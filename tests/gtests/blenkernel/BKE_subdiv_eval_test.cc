@@ -0,0 +1,161 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "testing/testing.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+
+#include "BKE_idtype.h"
+#include "BKE_lib_id.h"
+#include "BKE_mesh.h"
+#include "BKE_subdiv.h"
+#include "BKE_subdiv_eval.h"
+
+#include "BLI_math.h"
+
+#include "opensubdiv_capi_type.h"
+
+/* Resolution of the grid of evaluated points on every ptex face. */
+#define TEST_GRID_RESOLUTION 5
+
+class SubdivEvalTest : public testing::Test {
+ protected:
+  Mesh *me;
+
+  static void SetUpTestCase()
+  {
+    BKE_idtype_init();
+    BKE_subdiv_init();
+  }
+
+  static void TearDownTestCase()
+  {
+    BKE_subdiv_exit();
+  }
+
+  void SetUp() override
+  {
+    /* A cube, its corners are extraordinary vertices. */
+    static const float cube_co[8][3] = {
+        {-1, -1, -1}, {1, -1, -1}, {1, 1, -1}, {-1, 1, -1},
+        {-1, -1, 1}, {1, -1, 1}, {1, 1, 1}, {-1, 1, 1},
+    };
+    static const int cube_faces[6][4] = {
+        {0, 3, 2, 1}, {4, 5, 6, 7}, {0, 1, 5, 4}, {1, 2, 6, 5}, {2, 3, 7, 6}, {3, 0, 4, 7},
+    };
+    me = BKE_mesh_new_nomain(8, 0, 0, 24, 6);
+    for (int i = 0; i < 8; i++) {
+      copy_v3_v3(me->mvert[i].co, cube_co[i]);
+    }
+    for (int i = 0; i < 6; i++) {
+      me->mpoly[i].loopstart = i * 4;
+      me->mpoly[i].totloop = 4;
+      for (int j = 0; j < 4; j++) {
+        me->mloop[i * 4 + j].v = cube_faces[i][j];
+      }
+    }
+    BKE_mesh_calc_edges(me, false, false);
+  }
+
+  void TearDown() override
+  {
+    BKE_id_free(NULL, me);
+  }
+
+  /* Evaluate a grid of points on every ptex face with a single batched query, and compare it
+   * with the single point queries. */
+  void test_batched_matches_single_points(const eSubdivEvaluatorType evaluator_type)
+  {
+    SubdivSettings settings = {0};
+    settings.is_simple = false;
+    settings.is_adaptive = true;
+    settings.level = 3;
+    settings.use_creases = true;
+    settings.vtx_boundary_interpolation = SUBDIV_VTX_BOUNDARY_EDGE_ONLY;
+    settings.fvar_linear_interpolation = SUBDIV_FVAR_LINEAR_INTERPOLATION_BOUNDARIES;
+    settings.evaluator_type = evaluator_type;
+    Subdiv *subdiv = BKE_subdiv_new_from_mesh(&settings, me);
+    ASSERT_NE(subdiv, nullptr);
+    ASSERT_TRUE(BKE_subdiv_eval_begin_from_mesh(subdiv, me, NULL));
+
+    /* All faces are quads, so there is a ptex face per face. */
+    const int num_ptex_faces = me->totpoly;
+    const int num_points = num_ptex_faces * TEST_GRID_RESOLUTION * TEST_GRID_RESOLUTION;
+    OpenSubdiv_PatchCoord *patch_coords = (OpenSubdiv_PatchCoord *)MEM_malloc_arrayN(
+        num_points, sizeof(*patch_coords), __func__);
+    float(*P)[3] = (float(*)[3])MEM_malloc_arrayN(num_points, sizeof(*P), __func__);
+    float(*dPdu)[3] = (float(*)[3])MEM_malloc_arrayN(num_points, sizeof(*dPdu), __func__);
+    float(*dPdv)[3] = (float(*)[3])MEM_malloc_arrayN(num_points, sizeof(*dPdv), __func__);
+    float(*P_only)[3] = (float(*)[3])MEM_malloc_arrayN(num_points, sizeof(*P_only), __func__);
+    int point_index = 0;
+    for (int ptex_face_index = 0; ptex_face_index < num_ptex_faces; ptex_face_index++) {
+      for (int y = 0; y < TEST_GRID_RESOLUTION; y++) {
+        for (int x = 0; x < TEST_GRID_RESOLUTION; x++) {
+          OpenSubdiv_PatchCoord *patch_coord = &patch_coords[point_index++];
+          patch_coord->ptex_face = ptex_face_index;
+          patch_coord->u = (float)x / (TEST_GRID_RESOLUTION - 1);
+          patch_coord->v = (float)y / (TEST_GRID_RESOLUTION - 1);
+        }
+      }
+    }
+
+    BKE_subdiv_eval_limit_points_and_derivatives(
+        subdiv, patch_coords, num_points, P, dPdu, dPdv);
+    BKE_subdiv_eval_limit_points_and_derivatives(
+        subdiv, patch_coords, num_points, P_only, NULL, NULL);
+
+    for (int i = 0; i < num_points; i++) {
+      const OpenSubdiv_PatchCoord *patch_coord = &patch_coords[i];
+      float P_single[3], dPdu_single[3], dPdv_single[3];
+      BKE_subdiv_eval_limit_point_and_derivatives(subdiv,
+                                                  patch_coord->ptex_face,
+                                                  patch_coord->u,
+                                                  patch_coord->v,
+                                                  P_single,
+                                                  dPdu_single,
+                                                  dPdv_single);
+      EXPECT_V3_NEAR(P[i], P_single, 1e-6f);
+      EXPECT_V3_NEAR(dPdu[i], dPdu_single, 1e-6f);
+      EXPECT_V3_NEAR(dPdv[i], dPdv_single, 1e-6f);
+
+      float P_limit[3];
+      BKE_subdiv_eval_limit_point(
+          subdiv, patch_coord->ptex_face, patch_coord->u, patch_coord->v, P_limit);
+      EXPECT_V3_NEAR(P_only[i], P_limit, 1e-6f);
+    }
+
+    MEM_freeN(patch_coords);
+    MEM_freeN(P);
+    MEM_freeN(dPdu);
+    MEM_freeN(dPdv);
+    MEM_freeN(P_only);
+    BKE_subdiv_free(subdiv);
+  }
+};
+
+TEST_F(SubdivEvalTest, LimitPointsBatchedCPU)
+{
+  test_batched_matches_single_points(SUBDIV_EVALUATOR_TYPE_CPU);
+}
+
+/* Falls back to the CPU evaluator when OpenSubdiv is built without OpenMP. */
+TEST_F(SubdivEvalTest, LimitPointsBatchedOpenMP)
+{
+  test_batched_matches_single_points(SUBDIV_EVALUATOR_TYPE_OPENMP);
+}
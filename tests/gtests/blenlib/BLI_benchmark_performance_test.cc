@@ -0,0 +1,439 @@
+/* Apache License, Version 2.0 */
+
+/** \file
+ * Benchmarks for blenlib primitives.
+ *
+ * Every benchmark records the fastest of a few runs. The results can be written to a JSON file
+ * and compared against the file of an earlier run, failing when something became slower.
+ *
+ * Like other performance tests this isn't registered with CTest, and no baseline is committed:
+ * timings only compare on the same machine and build configuration. To check a change for
+ * regressions, run the test from a build of the parent revision to write the baseline, then from
+ * a build with the change to compare against it:
+ *
+ *   bin/tests/BLI_benchmark_performance_test --benchmark_output=baseline.json
+ *   bin/tests/BLI_benchmark_performance_test --benchmark_baseline=baseline.json
+ *
+ * The second run fails when a benchmark is slower than the baseline by more than
+ * `--benchmark_tolerance` (a factor, 0.1 by default).
+ */
+
+#include "testing/testing.h"
+
+#include "BLI_benchmark_report.hh"
+#include "BLI_map.hh"
+#include "BLI_timeit.hh"
+
+#include "MEM_guardedalloc.h"
+
+extern "C" {
+#include "BLI_delaunay_2d.h"
+#include "BLI_ghash.h"
+#include "BLI_kdopbvh.h"
+#include "BLI_kdtree.h"
+#include "BLI_math.h"
+#include "BLI_mempool.h"
+#include "BLI_oahash.h"
+#include "BLI_polyfill_2d.h"
+#include "BLI_rand.h"
+#include "BLI_task.h"
+}
+
+#include "stubs/bf_intern_eigen_stubs.h"
+
+DEFINE_string(benchmark_output, "", "Write the benchmark results to this JSON file.");
+DEFINE_string(benchmark_baseline,
+              "",
+              "Compare the benchmark results against this JSON file (from --benchmark_output).");
+DEFINE_double(benchmark_tolerance,
+              0.1,
+              "Slowdown factor against the baseline that is reported as regression.");
+
+using BLI::BenchmarkReport;
+using BLI::Timeit::measure_min;
+
+#define RUNS 3
+
+static BenchmarkReport &benchmark_report()
+{
+  static BenchmarkReport report;
+  return report;
+}
+
+class BenchmarkEnvironment : public ::testing::Environment {
+ public:
+  void SetUp() override
+  {
+    BLI_threadapi_init();
+  }
+
+  void TearDown() override
+  {
+    const BenchmarkReport &report = benchmark_report();
+
+    if (!FLAGS_benchmark_output.empty()) {
+      EXPECT_TRUE(report.write_json(FLAGS_benchmark_output))
+          << "Could not write '" << FLAGS_benchmark_output << "'";
+    }
+    if (!FLAGS_benchmark_baseline.empty()) {
+      BenchmarkReport baseline;
+      if (baseline.read_json(FLAGS_benchmark_baseline)) {
+        EXPECT_EQ(report.compare(baseline, FLAGS_benchmark_tolerance), 0)
+            << "Benchmarks slower than the baseline";
+      }
+      else {
+        ADD_FAILURE() << "Could not read '" << FLAGS_benchmark_baseline << "'";
+      }
+    }
+
+    BLI_threadapi_exit();
+  }
+};
+
+static ::testing::Environment *const benchmark_environment =
+    ::testing::AddGlobalTestEnvironment(new BenchmarkEnvironment);
+
+static void rng_v3_array(float (*coords)[3], int coords_len, unsigned int seed)
+{
+  RNG *rng = BLI_rng_new(seed);
+  for (int i = 0; i < coords_len; i++) {
+    BLI_rng_get_float_unit_v3(rng, coords[i]);
+    mul_v3_fl(coords[i], BLI_rng_get_float(rng));
+  }
+  BLI_rng_free(rng);
+}
+
+/* -------------------------------------------------------------------- */
+/** \name Hashing
+ * \{ */
+
+#define HASH_KEYS_LEN 1000000
+
+/* Sum of the values looked up, checked after timing. */
+static uint64_t hash_keys_sum()
+{
+  return (uint64_t)HASH_KEYS_LEN * (HASH_KEYS_LEN - 1) / 2;
+}
+
+TEST(benchmark, Hashing)
+{
+  BenchmarkReport &report = benchmark_report();
+  uint64_t sum;
+
+  GHash *ghash = NULL;
+  report.add("ghash.int_insert",
+             measure_min([&]() { ghash = BLI_ghash_int_new(__func__); },
+                         [&]() {
+                           for (uint i = 0; i < HASH_KEYS_LEN; i++) {
+                             BLI_ghash_insert(ghash, POINTER_FROM_UINT(i), POINTER_FROM_UINT(i));
+                           }
+                         },
+                         [&]() { BLI_ghash_free(ghash, NULL, NULL); },
+                         RUNS));
+  ghash = BLI_ghash_int_new(__func__);
+  for (uint i = 0; i < HASH_KEYS_LEN; i++) {
+    BLI_ghash_insert(ghash, POINTER_FROM_UINT(i), POINTER_FROM_UINT(i));
+  }
+  report.add("ghash.int_lookup",
+             measure_min([&]() { sum = 0; },
+                         [&]() {
+                           for (uint i = 0; i < HASH_KEYS_LEN; i++) {
+                             sum += POINTER_AS_UINT(BLI_ghash_lookup(ghash, POINTER_FROM_UINT(i)));
+                           }
+                         },
+                         [&]() { EXPECT_EQ(sum, hash_keys_sum()); },
+                         RUNS));
+  BLI_ghash_free(ghash, NULL, NULL);
+
+  OAHash *oh = NULL;
+  report.add("oahash.int_insert",
+             measure_min([&]() { oh = BLI_oahash_int_new(__func__); },
+                         [&]() {
+                           for (uint i = 0; i < HASH_KEYS_LEN; i++) {
+                             BLI_oahash_insert(oh, POINTER_FROM_UINT(i), POINTER_FROM_UINT(i));
+                           }
+                         },
+                         [&]() { BLI_oahash_free(oh, NULL, NULL); },
+                         RUNS));
+  oh = BLI_oahash_int_new(__func__);
+  for (uint i = 0; i < HASH_KEYS_LEN; i++) {
+    BLI_oahash_insert(oh, POINTER_FROM_UINT(i), POINTER_FROM_UINT(i));
+  }
+  report.add("oahash.int_lookup",
+             measure_min([&]() { sum = 0; },
+                         [&]() {
+                           for (uint i = 0; i < HASH_KEYS_LEN; i++) {
+                             sum += POINTER_AS_UINT(BLI_oahash_lookup(oh, POINTER_FROM_UINT(i)));
+                           }
+                         },
+                         [&]() { EXPECT_EQ(sum, hash_keys_sum()); },
+                         RUNS));
+  BLI_oahash_free(oh, NULL, NULL);
+
+  BLI::Map<uint, uint> *map = nullptr;
+  report.add("map.int_insert",
+             measure_min([&]() { map = new BLI::Map<uint, uint>(); },
+                         [&]() {
+                           for (uint i = 0; i < HASH_KEYS_LEN; i++) {
+                             map->add_new(i, i);
+                           }
+                         },
+                         [&]() { delete map; },
+                         RUNS));
+  map = new BLI::Map<uint, uint>();
+  for (uint i = 0; i < HASH_KEYS_LEN; i++) {
+    map->add_new(i, i);
+  }
+  report.add("map.int_lookup",
+             measure_min([&]() { sum = 0; },
+                         [&]() {
+                           for (uint i = 0; i < HASH_KEYS_LEN; i++) {
+                             sum += map->lookup(i);
+                           }
+                         },
+                         [&]() { EXPECT_EQ(sum, hash_keys_sum()); },
+                         RUNS));
+  delete map;
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Memory Pool
+ * \{ */
+
+#define MEMPOOL_ELEMS_LEN 1000000
+
+TEST(benchmark, Mempool)
+{
+  BenchmarkReport &report = benchmark_report();
+  void **elems = (void **)MEM_mallocN(sizeof(*elems) * MEMPOOL_ELEMS_LEN, __func__);
+
+  BLI_mempool *pool = NULL;
+  report.add("mempool.alloc_free",
+             measure_min([&]() { pool = BLI_mempool_create(32, 0, 512, BLI_MEMPOOL_NOP); },
+                         [&]() {
+                           for (uint i = 0; i < MEMPOOL_ELEMS_LEN; i++) {
+                             elems[i] = BLI_mempool_alloc(pool);
+                           }
+                           for (uint i = 0; i < MEMPOOL_ELEMS_LEN; i += 2) {
+                             BLI_mempool_free(pool, elems[i]);
+                           }
+                           for (uint i = 0; i < MEMPOOL_ELEMS_LEN; i += 2) {
+                             elems[i] = BLI_mempool_alloc(pool);
+                           }
+                         },
+                         [&]() {
+                           EXPECT_EQ(BLI_mempool_len(pool), MEMPOOL_ELEMS_LEN);
+                           BLI_mempool_destroy(pool);
+                         },
+                         RUNS));
+
+  MEM_freeN(elems);
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Spatial Search
+ * \{ */
+
+#define POINTS_LEN 200000
+
+TEST(benchmark, Kdopbvh)
+{
+  BenchmarkReport &report = benchmark_report();
+  float(*coords)[3] = (float(*)[3])MEM_mallocN(sizeof(*coords) * POINTS_LEN, __func__);
+  rng_v3_array(coords, POINTS_LEN, 1);
+
+  BVHTree *tree = NULL;
+  report.add("kdopbvh.build",
+             measure_min([]() {},
+                         [&]() {
+                           tree = BLI_bvhtree_new(POINTS_LEN, 0.0f, 2, 6);
+                           for (int i = 0; i < POINTS_LEN; i++) {
+                             BLI_bvhtree_insert(tree, i, coords[i], 1);
+                           }
+                           BLI_bvhtree_balance(tree);
+                         },
+                         [&]() { BLI_bvhtree_free(tree); },
+                         RUNS));
+
+  tree = BLI_bvhtree_new(POINTS_LEN, 0.0f, 2, 6);
+  for (int i = 0; i < POINTS_LEN; i++) {
+    BLI_bvhtree_insert(tree, i, coords[i], 1);
+  }
+  BLI_bvhtree_balance(tree);
+  int *nearest_index = (int *)MEM_mallocN(sizeof(*nearest_index) * POINTS_LEN, __func__);
+  report.add("kdopbvh.find_nearest", measure_min([&]() {
+               for (int i = 0; i < POINTS_LEN; i++) {
+                 BVHTreeNearest nearest = {-1, {0}, {0}, FLT_MAX};
+                 nearest_index[i] = BLI_bvhtree_find_nearest(
+                     tree, coords[i], &nearest, NULL, NULL);
+               }
+             }, RUNS));
+  /* Points can coincide, then any of them is the nearest. */
+  for (int i = 0; i < POINTS_LEN; i++) {
+    EXPECT_NE(nearest_index[i], -1);
+  }
+
+  BLI_bvhtree_free(tree);
+  MEM_freeN(nearest_index);
+  MEM_freeN(coords);
+}
+
+#define KDTREE_NEAREST_LEN 8
+#define KDTREE_QUERY_LEN 20000
+
+TEST(benchmark, Kdtree)
+{
+  BenchmarkReport &report = benchmark_report();
+  float(*coords)[3] = (float(*)[3])MEM_mallocN(sizeof(*coords) * POINTS_LEN, __func__);
+  rng_v3_array(coords, POINTS_LEN, 2);
+
+  KDTree_3d *tree = NULL;
+  report.add("kdtree.build",
+             measure_min([]() {},
+                         [&]() {
+                           tree = BLI_kdtree_3d_new(POINTS_LEN);
+                           for (int i = 0; i < POINTS_LEN; i++) {
+                             BLI_kdtree_3d_insert(tree, i, coords[i]);
+                           }
+                           BLI_kdtree_3d_balance(tree);
+                         },
+                         [&]() { BLI_kdtree_3d_free(tree); },
+                         RUNS));
+
+  tree = BLI_kdtree_3d_new(POINTS_LEN);
+  for (int i = 0; i < POINTS_LEN; i++) {
+    BLI_kdtree_3d_insert(tree, i, coords[i]);
+  }
+  BLI_kdtree_3d_balance(tree);
+
+  KDTreeNearest_3d *nearest = (KDTreeNearest_3d *)MEM_mallocN(
+      sizeof(*nearest) * KDTREE_QUERY_LEN * KDTREE_NEAREST_LEN, __func__);
+  report.add("kdtree.find_nearest_n", measure_min([&]() {
+               for (int i = 0; i < KDTREE_QUERY_LEN; i++) {
+                 BLI_kdtree_3d_find_nearest_n(
+                     tree, coords[i], &nearest[i * KDTREE_NEAREST_LEN], KDTREE_NEAREST_LEN);
+               }
+             }, RUNS));
+  report.add("kdtree.find_nearest_n_batch", measure_min([&]() {
+               BLI_kdtree_3d_find_nearest_n_batch(
+                   tree, coords, KDTREE_QUERY_LEN, nearest, KDTREE_NEAREST_LEN, NULL);
+             }, RUNS));
+
+  BLI_kdtree_3d_free(tree);
+  MEM_freeN(nearest);
+  MEM_freeN(coords);
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name 2D Triangulation
+ * \{ */
+
+#define POLYFILL_VERTS_LEN 5000
+
+TEST(benchmark, Polyfill)
+{
+  BenchmarkReport &report = benchmark_report();
+  float(*coords)[2] = (float(*)[2])MEM_mallocN(sizeof(*coords) * POLYFILL_VERTS_LEN, __func__);
+  uint(*tris)[3] = (uint(*)[3])MEM_mallocN(sizeof(*tris) * (POLYFILL_VERTS_LEN - 2), __func__);
+
+  /* A star shape, so there are concave corners to deal with. */
+  for (int i = 0; i < POLYFILL_VERTS_LEN; i++) {
+    const float angle = (float)(M_PI * 2.0) * (float)i / (float)POLYFILL_VERTS_LEN;
+    const float radius = (i % 2) ? 1.0f : 0.8f;
+    coords[i][0] = cosf(angle) * radius;
+    coords[i][1] = sinf(angle) * radius;
+  }
+
+  report.add("polyfill.star", measure_min([&]() {
+               BLI_polyfill_calc(coords, POLYFILL_VERTS_LEN, 0, tris);
+             }, RUNS));
+
+  MEM_freeN(coords);
+  MEM_freeN(tris);
+}
+
+#define DELAUNAY_VERTS_LEN 20000
+
+TEST(benchmark, Delaunay)
+{
+  BenchmarkReport &report = benchmark_report();
+  float(*coords)[2] = (float(*)[2])MEM_mallocN(sizeof(*coords) * DELAUNAY_VERTS_LEN, __func__);
+
+  RNG *rng = BLI_rng_new(3);
+  for (int i = 0; i < DELAUNAY_VERTS_LEN; i++) {
+    coords[i][0] = BLI_rng_get_float(rng);
+    coords[i][1] = BLI_rng_get_float(rng);
+  }
+  BLI_rng_free(rng);
+
+  CDT_input input = {0};
+  input.verts_len = DELAUNAY_VERTS_LEN;
+  input.vert_coords = coords;
+  input.epsilon = 1e-6f;
+
+  CDT_result *result = NULL;
+  report.add("delaunay.random_points",
+             measure_min([]() {},
+                         [&]() { result = BLI_delaunay_2d_cdt_calc(&input, CDT_FULL); },
+                         [&]() { BLI_delaunay_2d_cdt_free(result); },
+                         RUNS));
+
+  MEM_freeN(coords);
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Tasks
+ * \{ */
+
+#define TASK_RANGE_LEN 10000000
+#define TASK_POOL_LEN 100000
+
+static void task_range_fn(void *__restrict userdata,
+                          const int i,
+                          const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  int *data = (int *)userdata;
+  data[i] = i * 2;
+}
+
+static void task_pool_fn(TaskPool *__restrict UNUSED(pool), void *taskdata)
+{
+  int *value = (int *)taskdata;
+  *value += 1;
+}
+
+TEST(benchmark, Task)
+{
+  BenchmarkReport &report = benchmark_report();
+  int *data = (int *)MEM_mallocN(sizeof(*data) * TASK_RANGE_LEN, __func__);
+
+  report.add("task.parallel_range", measure_min([&]() {
+               TaskParallelSettings settings;
+               BLI_parallel_range_settings_defaults(&settings);
+               BLI_task_parallel_range(0, TASK_RANGE_LEN, data, task_range_fn, &settings);
+             }, RUNS));
+
+  TaskPool *pool = NULL;
+  report.add("task.pool_push",
+             measure_min([&]() { pool = BLI_task_pool_create(NULL, TASK_PRIORITY_HIGH); },
+                         [&]() {
+                           for (int i = 0; i < TASK_POOL_LEN; i++) {
+                             BLI_task_pool_push(pool, task_pool_fn, &data[i], false, NULL);
+                           }
+                           BLI_task_pool_work_and_wait(pool);
+                         },
+                         [&]() { BLI_task_pool_free(pool); },
+                         RUNS));
+
+  MEM_freeN(data);
+}
+
+/** \} */
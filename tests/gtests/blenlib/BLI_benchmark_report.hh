@@ -0,0 +1,145 @@
+/* Apache License, Version 2.0 */
+
+#ifndef __BLI_BENCHMARK_REPORT_HH__
+#define __BLI_BENCHMARK_REPORT_HH__
+
+/** \file
+ * Collect benchmark timings, write them as JSON and compare them against a baseline file
+ * written by an earlier run.
+ *
+ * The JSON layout is:
+ * \code{.json}
+ * {
+ *   "benchmarks": [
+ *     {"name": "ghash.int_insert", "time_ns": 1234567},
+ *     {"name": "ghash.int_lookup", "time_ns": 456789},
+ *     ...
+ *   ]
+ * }
+ * \endcode
+ */
+
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "BLI_timeit.hh"
+#include "BLI_vector.hh"
+
+namespace BLI {
+
+class BenchmarkReport {
+ public:
+  struct Entry {
+    std::string name;
+    Timeit::Nanoseconds duration;
+  };
+
+ private:
+  Vector<Entry> m_entries;
+
+ public:
+  void add(std::string name, Timeit::Nanoseconds duration)
+  {
+    std::cout << "Benchmark '" << name << "' took ";
+    Timeit::print_duration(duration);
+    std::cout << '\n';
+    m_entries.append({std::move(name), duration});
+  }
+
+  const Vector<Entry> &entries() const
+  {
+    return m_entries;
+  }
+
+  const Entry *lookup(const std::string &name) const
+  {
+    for (const Entry &entry : m_entries) {
+      if (entry.name == name) {
+        return &entry;
+      }
+    }
+    return nullptr;
+  }
+
+  bool write_json(const std::string &filepath) const
+  {
+    std::ofstream file(filepath);
+    if (!file) {
+      return false;
+    }
+    file << "{\n  \"benchmarks\": [\n";
+    for (uint i = 0; i < m_entries.size(); i++) {
+      const Entry &entry = m_entries[i];
+      file << "    {\"name\": \"" << entry.name << "\", \"time_ns\": " << entry.duration.count()
+           << "}" << ((i + 1 < m_entries.size()) ? ",\n" : "\n");
+    }
+    file << "  ]\n}\n";
+    return file.good();
+  }
+
+  /**
+   * Read a file written by #write_json. This is not a general JSON parser,
+   * it only looks for the name and time pairs.
+   */
+  bool read_json(const std::string &filepath)
+  {
+    std::ifstream file(filepath);
+    if (!file) {
+      return false;
+    }
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    const std::string text = buffer.str();
+
+    const std::string name_key = "\"name\": \"";
+    const std::string time_key = "\"time_ns\": ";
+    size_t pos = 0;
+    while ((pos = text.find(name_key, pos)) != std::string::npos) {
+      const size_t name_start = pos + name_key.size();
+      const size_t name_end = text.find('"', name_start);
+      const size_t time_pos = text.find(time_key, name_end);
+      if (name_end == std::string::npos || time_pos == std::string::npos) {
+        return false;
+      }
+      const long long time_ns = std::atoll(text.c_str() + time_pos + time_key.size());
+      m_entries.append({text.substr(name_start, name_end - name_start),
+                        Timeit::Nanoseconds(time_ns)});
+      pos = time_pos;
+    }
+    return true;
+  }
+
+  /**
+   * Print how each benchmark compares to the baseline.
+   * \return the number of benchmarks that are slower than the baseline by more than the
+   * tolerance (a factor, 0.1 allows for 10% slowdown).
+   */
+  uint compare(const BenchmarkReport &baseline, const double tolerance) const
+  {
+    uint regressions_len = 0;
+    std::cout << "Comparison against baseline (tolerance " << tolerance * 100.0 << "%):\n";
+    for (const Entry &entry : m_entries) {
+      const Entry *base_entry = baseline.lookup(entry.name);
+      if (base_entry == nullptr || base_entry->duration.count() == 0) {
+        std::cout << "  " << entry.name << ": no baseline\n";
+        continue;
+      }
+      const double factor = (double)entry.duration.count() / (double)base_entry->duration.count();
+      const bool is_regression = factor > 1.0 + tolerance;
+      std::cout << "  " << entry.name << ": " << std::fixed << std::setprecision(2) << factor
+                << "x" << (is_regression ? "  <-- REGRESSION" : "") << '\n';
+      if (is_regression) {
+        regressions_len++;
+      }
+    }
+    return regressions_len;
+  }
+};
+
+}  // namespace BLI
+
+#endif /* __BLI_BENCHMARK_REPORT_HH__ */
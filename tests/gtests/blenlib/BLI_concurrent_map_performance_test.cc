@@ -0,0 +1,137 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "BLI_concurrent_map.hh"
+#include "BLI_concurrent_set.hh"
+#include "BLI_timeit.hh"
+#include "BLI_vector.hh"
+
+#include "MEM_guardedalloc.h"
+
+extern "C" {
+#include "BLI_ghash.h"
+#include "BLI_rand.h"
+}
+
+/* Compare de-duplication of keys from a parallel loop, using a single lock around a #GHash
+ * (what parallel code had to do so far) and the sharded concurrent containers. */
+
+using BLI::ConcurrentMap;
+using BLI::ConcurrentSet;
+using BLI::Vector;
+
+static Vector<uint> random_keys(const uint keys_len, const uint unique_len)
+{
+  Vector<uint> keys(keys_len);
+  RNG *rng = BLI_rng_new(0);
+  for (uint i = 0; i < keys_len; i++) {
+    keys[i] = BLI_rng_get_uint(rng) % unique_len;
+  }
+  BLI_rng_free(rng);
+  return keys;
+}
+
+template<typename FuncT> static void parallel_for_keys(const Vector<uint> &keys, FuncT func)
+{
+  struct ParallelData {
+    const Vector<uint> *keys;
+    FuncT *func;
+  } data = {&keys, &func};
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 1024;
+  BLI_task_parallel_range(
+      0,
+      (int)keys.size(),
+      &data,
+      [](void *__restrict userdata, const int i, const TaskParallelTLS *__restrict UNUSED(tls)) {
+        ParallelData *data = (ParallelData *)userdata;
+        (*data->func)((*data->keys)[i]);
+      },
+      &settings);
+}
+
+static void concurrent_dedup_test(const uint keys_len, const uint unique_len)
+{
+  printf("\n========== STARTING %s (%u keys, %u unique) ==========\n",
+         __func__,
+         keys_len,
+         unique_len);
+
+  BLI_threadapi_init();
+  const Vector<uint> keys = random_keys(keys_len, unique_len);
+
+  {
+    GSet *gset = BLI_gset_int_new(__func__);
+    SpinLock lock;
+    BLI_spin_init(&lock);
+    {
+      SCOPED_TIMER("GSet with lock");
+      parallel_for_keys(keys, [&](uint key) {
+        BLI_spin_lock(&lock);
+        BLI_gset_add(gset, POINTER_FROM_UINT(key));
+        BLI_spin_unlock(&lock);
+      });
+    }
+    const uint gset_len = BLI_gset_len(gset);
+    BLI_spin_end(&lock);
+    BLI_gset_free(gset, NULL);
+
+    ConcurrentSet<uint> set;
+    {
+      SCOPED_TIMER("ConcurrentSet");
+      parallel_for_keys(keys, [&](uint key) { set.add(key); });
+    }
+    EXPECT_EQ(set.size(), gset_len);
+  }
+
+  {
+    GHash *ghash = BLI_ghash_int_new(__func__);
+    SpinLock lock;
+    BLI_spin_init(&lock);
+    {
+      SCOPED_TIMER("GHash count with lock");
+      parallel_for_keys(keys, [&](uint key) {
+        BLI_spin_lock(&lock);
+        void **val_p;
+        if (!BLI_ghash_ensure_p(ghash, POINTER_FROM_UINT(key), &val_p)) {
+          *val_p = POINTER_FROM_UINT(0);
+        }
+        *val_p = POINTER_FROM_UINT(POINTER_AS_UINT(*val_p) + 1);
+        BLI_spin_unlock(&lock);
+      });
+    }
+    const uint ghash_len = BLI_ghash_len(ghash);
+    BLI_spin_end(&lock);
+    BLI_ghash_free(ghash, NULL, NULL);
+
+    ConcurrentMap<uint, uint> map;
+    {
+      SCOPED_TIMER("ConcurrentMap count");
+      parallel_for_keys(keys, [&](uint key) {
+        map.add_or_modify(
+            key, [](uint *value) { *value = 1; }, [](uint *value) { (*value)++; });
+      });
+    }
+    EXPECT_EQ(map.size(), ghash_len);
+
+    uint total = 0;
+    map.foreach_item([&](uint UNUSED(key), uint value) { total += value; });
+    EXPECT_EQ(total, keys_len);
+  }
+
+  BLI_threadapi_exit();
+  printf("========== ENDED %s ==========\n\n", __func__);
+}
+
+TEST(concurrent_map, DedupFewUnique)
+{
+  concurrent_dedup_test(10000000, 1000);
+}
+
+TEST(concurrent_map, DedupManyUnique)
+{
+  concurrent_dedup_test(10000000, 5000000);
+}
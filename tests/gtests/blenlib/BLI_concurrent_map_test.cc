@@ -0,0 +1,81 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "BLI_concurrent_map.hh"
+
+#include "atomic_ops.h"
+
+using BLI::ConcurrentMap;
+
+TEST(concurrent_map, DefaultConstructor)
+{
+  ConcurrentMap<int, float> map;
+  EXPECT_EQ(map.size(), 0);
+  EXPECT_TRUE(map.is_empty());
+}
+
+TEST(concurrent_map, AddContainsRemove)
+{
+  ConcurrentMap<int, float> map;
+  EXPECT_TRUE(map.add(4, 5.0f));
+  EXPECT_FALSE(map.add(4, 6.0f));
+  EXPECT_TRUE(map.add(5, 1.0f));
+  EXPECT_EQ(map.size(), 2);
+  EXPECT_TRUE(map.contains(4));
+  EXPECT_FALSE(map.contains(3));
+  EXPECT_EQ(map.lookup_default(4, 0.0f), 5.0f);
+  EXPECT_EQ(map.lookup_default(3, 0.0f), 0.0f);
+  EXPECT_TRUE(map.remove(4));
+  EXPECT_FALSE(map.remove(4));
+  EXPECT_EQ(map.size(), 1);
+  map.clear();
+  EXPECT_TRUE(map.is_empty());
+}
+
+TEST(concurrent_map, LookupOrAdd)
+{
+  ConcurrentMap<int, int> map;
+  const int value_a = map.lookup_or_add(1, []() { return 10; });
+  const int value_b = map.lookup_or_add(1, []() { return 20; });
+  EXPECT_EQ(value_a, 10);
+  EXPECT_EQ(value_b, 10);
+  EXPECT_EQ(map.size(), 1);
+}
+
+TEST(concurrent_map, ParallelAddOrModify)
+{
+  BLI_threadapi_init();
+  {
+    const int keys_len = 1000;
+    const int iter_len = 100000;
+
+    ConcurrentMap<int, int> map;
+    TaskParallelSettings settings;
+    BLI_parallel_range_settings_defaults(&settings);
+    BLI_task_parallel_range(
+        0,
+        iter_len,
+        &map,
+        [](void *__restrict userdata, const int i, const TaskParallelTLS *__restrict UNUSED(tls)) {
+          ConcurrentMap<int, int> &map = *(ConcurrentMap<int, int> *)userdata;
+          map.add_or_modify(
+              i % keys_len,
+              [](int *value) { *value = 1; },
+              [](int *value) { (*value)++; });
+        },
+        &settings);
+
+    EXPECT_EQ(map.size(), keys_len);
+
+    /* Every key was added `iter_len / keys_len` times. */
+    int items_len = 0;
+    map.parallel_foreach_item([&](int key, int value) {
+      EXPECT_TRUE(key >= 0 && key < keys_len);
+      EXPECT_EQ(value, iter_len / keys_len);
+      atomic_add_and_fetch_int32(&items_len, 1);
+    });
+    EXPECT_EQ(items_len, keys_len);
+  }
+  BLI_threadapi_exit();
+}
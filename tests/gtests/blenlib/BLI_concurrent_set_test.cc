@@ -0,0 +1,72 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "BLI_concurrent_set.hh"
+
+#include "atomic_ops.h"
+
+using BLI::ConcurrentSet;
+
+TEST(concurrent_set, DefaultConstructor)
+{
+  ConcurrentSet<int> set;
+  EXPECT_EQ(set.size(), 0);
+  EXPECT_TRUE(set.is_empty());
+}
+
+TEST(concurrent_set, AddContainsRemove)
+{
+  ConcurrentSet<int> set;
+  EXPECT_TRUE(set.add(3));
+  EXPECT_FALSE(set.add(3));
+  EXPECT_TRUE(set.add(7));
+  EXPECT_EQ(set.size(), 2);
+  EXPECT_TRUE(set.contains(3));
+  EXPECT_FALSE(set.contains(4));
+  EXPECT_TRUE(set.remove(3));
+  EXPECT_FALSE(set.remove(3));
+  EXPECT_FALSE(set.contains(3));
+  EXPECT_EQ(set.size(), 1);
+  set.clear();
+  EXPECT_TRUE(set.is_empty());
+}
+
+struct ParallelAddData {
+  ConcurrentSet<int> set;
+  int added_len = 0;
+};
+
+TEST(concurrent_set, ParallelAdd)
+{
+  BLI_threadapi_init();
+  {
+    const int values_len = 5000;
+    const int iter_len = 100000;
+
+    ParallelAddData data;
+
+    /* Every value is added multiple times, only the first add of each value returns true. */
+    TaskParallelSettings settings;
+    BLI_parallel_range_settings_defaults(&settings);
+    BLI_task_parallel_range(
+        0,
+        iter_len,
+        &data,
+        [](void *__restrict userdata, const int i, const TaskParallelTLS *__restrict UNUSED(tls)) {
+          ParallelAddData *data = (ParallelAddData *)userdata;
+          if (data->set.add((i * 7) % values_len)) {
+            atomic_add_and_fetch_int32(&data->added_len, 1);
+          }
+        },
+        &settings);
+
+    EXPECT_EQ(data.added_len, values_len);
+    EXPECT_EQ(data.set.size(), values_len);
+
+    int64_t sum = 0;
+    data.set.foreach_value([&](int value) { sum += value; });
+    EXPECT_EQ(sum, (int64_t)values_len * (values_len - 1) / 2);
+  }
+  BLI_threadapi_exit();
+}
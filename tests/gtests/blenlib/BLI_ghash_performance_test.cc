@@ -9,6 +9,7 @@
 
 extern "C" {
 #include "BLI_ghash.h"
+#include "BLI_oahash.h"
 #include "BLI_rand.h"
 #include "BLI_string.h"
 #include "BLI_utildefines.h"
@@ -54,10 +55,8 @@ extern "C" {
 
 /* Str: whole text, lines and words from a 'corpus' text. */
 
-static void str_ghash_tests(GHash *ghash, const char *id)
+static char *str_corpus_load(void)
 {
-  printf("\n========== STARTING %s ==========\n", id);
-
 #ifdef TEXT_CORPUS_PATH
   size_t sz = 0;
   char *data;
@@ -84,6 +83,14 @@ static void str_ghash_tests(GHash *ghash, const char *id)
 #else
   char *data = BLI_strdup(words10k);
 #endif
+  return data;
+}
+
+static void str_ghash_tests(GHash *ghash, const char *id)
+{
+  printf("\n========== STARTING %s ==========\n", id);
+
+  char *data = str_corpus_load();
   char *data_p = BLI_strdup(data);
   char *data_w = BLI_strdup(data);
   char *data_bis = BLI_strdup(data);
@@ -241,6 +248,14 @@ TEST(ghash, IntGHash12000)
   int_ghash_tests(ghash, "IntGHash - GHash - 12000", 12000);
 }
 
+/* Larger than the CPU caches. */
+TEST(ghash, IntGHash1000000)
+{
+  GHash *ghash = BLI_ghash_new(BLI_ghashutil_inthash_p, BLI_ghashutil_intcmp, __func__);
+
+  int_ghash_tests(ghash, "IntGHash - GHash - 1000000", 1000000);
+}
+
 #ifdef GHASH_RUN_BIG
 TEST(ghash, IntGHash100000000)
 {
@@ -661,3 +676,301 @@ TEST(ghash, MultiRandIntMurmur2a200000)
 
   multi_small_ghash_tests(ghash, "MultiSmall RandIntGHash - Murmur2a - 200000", 200000);
 }
+
+/* OAHash: same tests as above using the open addressing backend, to compare both. */
+
+static void str_oahash_tests(OAHash *oh, const char *id)
+{
+  printf("\n========== STARTING %s ==========\n", id);
+
+  char *data = str_corpus_load();
+  char *data_p = BLI_strdup(data);
+  char *data_w = BLI_strdup(data);
+  char *data_bis = BLI_strdup(data);
+
+  {
+    char *p, *w, *c_p, *c_w;
+
+    TIMEIT_START(string_insert);
+
+    BLI_oahash_insert(oh, data, POINTER_FROM_INT(data[0]));
+
+    for (p = c_p = data_p, w = c_w = data_w; *c_w; c_w++, c_p++) {
+      if (*c_p == '.') {
+        *c_p = *c_w = '\0';
+        if (!BLI_oahash_haskey(oh, p)) {
+          BLI_oahash_insert(oh, p, POINTER_FROM_INT(p[0]));
+        }
+        if (!BLI_oahash_haskey(oh, w)) {
+          BLI_oahash_insert(oh, w, POINTER_FROM_INT(w[0]));
+        }
+        p = c_p + 1;
+        w = c_w + 1;
+      }
+      else if (*c_w == ' ') {
+        *c_w = '\0';
+        if (!BLI_oahash_haskey(oh, w)) {
+          BLI_oahash_insert(oh, w, POINTER_FROM_INT(w[0]));
+        }
+        w = c_w + 1;
+      }
+    }
+
+    TIMEIT_END(string_insert);
+  }
+
+  {
+    char *p, *w, *c;
+    void *v;
+
+    TIMEIT_START(string_lookup);
+
+    v = BLI_oahash_lookup(oh, data_bis);
+    EXPECT_EQ(POINTER_AS_INT(v), data_bis[0]);
+
+    for (p = w = c = data_bis; *c; c++) {
+      if (*c == '.') {
+        *c = '\0';
+        v = BLI_oahash_lookup(oh, w);
+        EXPECT_EQ(POINTER_AS_INT(v), w[0]);
+        v = BLI_oahash_lookup(oh, p);
+        EXPECT_EQ(POINTER_AS_INT(v), p[0]);
+        p = w = c + 1;
+      }
+      else if (*c == ' ') {
+        *c = '\0';
+        v = BLI_oahash_lookup(oh, w);
+        EXPECT_EQ(POINTER_AS_INT(v), w[0]);
+        w = c + 1;
+      }
+    }
+
+    TIMEIT_END(string_lookup);
+  }
+
+  BLI_oahash_free(oh, NULL, NULL);
+  MEM_freeN(data);
+  MEM_freeN(data_p);
+  MEM_freeN(data_w);
+  MEM_freeN(data_bis);
+
+  printf("========== ENDED %s ==========\n\n", id);
+}
+
+TEST(ghash, TextOAHash)
+{
+  OAHash *oh = BLI_oahash_new(BLI_ghashutil_strhash_p, BLI_ghashutil_strcmp, __func__);
+
+  str_oahash_tests(oh, "StrGHash - OAHash");
+}
+
+static void int_oahash_tests(OAHash *oh, const char *id, const unsigned int nbr)
+{
+  printf("\n========== STARTING %s ==========\n", id);
+
+  {
+    unsigned int i = nbr;
+
+    TIMEIT_START(int_insert);
+
+#ifdef GHASH_RESERVE
+    BLI_oahash_reserve(oh, nbr);
+#endif
+
+    while (i--) {
+      BLI_oahash_insert(oh, POINTER_FROM_UINT(i), POINTER_FROM_UINT(i));
+    }
+
+    TIMEIT_END(int_insert);
+  }
+
+  {
+    unsigned int i = nbr;
+
+    TIMEIT_START(int_lookup);
+
+    while (i--) {
+      void *v = BLI_oahash_lookup(oh, POINTER_FROM_UINT(i));
+      EXPECT_EQ(POINTER_AS_UINT(v), i);
+    }
+
+    TIMEIT_END(int_lookup);
+  }
+
+  {
+    void *k, *v;
+
+    TIMEIT_START(int_pop);
+
+    OAHashIterState pop_state = {0};
+
+    while (BLI_oahash_pop(oh, &pop_state, &k, &v)) {
+      EXPECT_EQ(k, v);
+    }
+
+    TIMEIT_END(int_pop);
+  }
+  EXPECT_EQ(BLI_oahash_len(oh), 0);
+
+  BLI_oahash_free(oh, NULL, NULL);
+
+  printf("========== ENDED %s ==========\n\n", id);
+}
+
+TEST(ghash, IntOAHash12000)
+{
+  OAHash *oh = BLI_oahash_new(BLI_ghashutil_inthash_p, BLI_ghashutil_intcmp, __func__);
+
+  int_oahash_tests(oh, "IntGHash - OAHash - 12000", 12000);
+}
+
+TEST(ghash, IntOAHash1000000)
+{
+  OAHash *oh = BLI_oahash_new(BLI_ghashutil_inthash_p, BLI_ghashutil_intcmp, __func__);
+
+  int_oahash_tests(oh, "IntGHash - OAHash - 1000000", 1000000);
+}
+
+#ifdef GHASH_RUN_BIG
+TEST(ghash, IntOAHash100000000)
+{
+  OAHash *oh = BLI_oahash_new(BLI_ghashutil_inthash_p, BLI_ghashutil_intcmp, __func__);
+
+  int_oahash_tests(oh, "IntGHash - OAHash - 100000000", 100000000);
+}
+#endif
+
+static void randint_oahash_tests(OAHash *oh, const char *id, const unsigned int nbr)
+{
+  printf("\n========== STARTING %s ==========\n", id);
+
+  unsigned int *data = (unsigned int *)MEM_mallocN(sizeof(*data) * (size_t)nbr, __func__);
+  unsigned int *dt;
+  unsigned int i;
+
+  {
+    RNG *rng = BLI_rng_new(1);
+    for (i = nbr, dt = data; i--; dt++) {
+      *dt = BLI_rng_get_uint(rng);
+    }
+    BLI_rng_free(rng);
+  }
+
+  {
+    TIMEIT_START(int_insert);
+
+#ifdef GHASH_RESERVE
+    BLI_oahash_reserve(oh, nbr);
+#endif
+
+    /* Random numbers may repeat, unlike #BLI_ghash_insert duplicates are not allowed. */
+    for (i = nbr, dt = data; i--; dt++) {
+      BLI_oahash_reinsert(oh, POINTER_FROM_UINT(*dt), POINTER_FROM_UINT(*dt), NULL, NULL);
+    }
+
+    TIMEIT_END(int_insert);
+  }
+
+  {
+    TIMEIT_START(int_lookup);
+
+    for (i = nbr, dt = data; i--; dt++) {
+      void *v = BLI_oahash_lookup(oh, POINTER_FROM_UINT(*dt));
+      EXPECT_EQ(POINTER_AS_UINT(v), *dt);
+    }
+
+    TIMEIT_END(int_lookup);
+  }
+
+  BLI_oahash_free(oh, NULL, NULL);
+  MEM_freeN(data);
+
+  printf("========== ENDED %s ==========\n\n", id);
+}
+
+TEST(ghash, IntRandOAHash12000)
+{
+  OAHash *oh = BLI_oahash_new(BLI_ghashutil_inthash_p, BLI_ghashutil_intcmp, __func__);
+
+  randint_oahash_tests(oh, "RandIntGHash - OAHash - 12000", 12000);
+}
+
+#ifdef GHASH_RUN_BIG
+TEST(ghash, IntRandOAHash50000000)
+{
+  OAHash *oh = BLI_oahash_new(BLI_ghashutil_inthash_p, BLI_ghashutil_intcmp, __func__);
+
+  randint_oahash_tests(oh, "RandIntGHash - OAHash - 50000000", 50000000);
+}
+#endif
+
+TEST(ghash, Int4NoHashOAHash12000)
+{
+  OAHash *oh = BLI_oahash_new(ghashutil_tests_nohash_p, ghashutil_tests_cmp_p, __func__);
+
+  randint_oahash_tests(oh, "RandIntGHash - OAHash No Hash - 12000", 12000);
+}
+
+static void multi_small_oahash_tests_one(OAHash *oh, RNG *rng, const unsigned int nbr)
+{
+  unsigned int *data = (unsigned int *)MEM_mallocN(sizeof(*data) * (size_t)nbr, __func__);
+  unsigned int *dt;
+  unsigned int i;
+
+  for (i = nbr, dt = data; i--; dt++) {
+    *dt = BLI_rng_get_uint(rng);
+  }
+
+#ifdef GHASH_RESERVE
+  BLI_oahash_reserve(oh, nbr);
+#endif
+
+  for (i = nbr, dt = data; i--; dt++) {
+    BLI_oahash_reinsert(oh, POINTER_FROM_UINT(*dt), POINTER_FROM_UINT(*dt), NULL, NULL);
+  }
+
+  for (i = nbr, dt = data; i--; dt++) {
+    void *v = BLI_oahash_lookup(oh, POINTER_FROM_UINT(*dt));
+    EXPECT_EQ(POINTER_AS_UINT(v), *dt);
+  }
+
+  BLI_oahash_clear(oh, NULL, NULL);
+  MEM_freeN(data);
+}
+
+static void multi_small_oahash_tests(OAHash *oh, const char *id, const unsigned int nbr)
+{
+  printf("\n========== STARTING %s ==========\n", id);
+
+  RNG *rng = BLI_rng_new(1);
+
+  TIMEIT_START(multi_small_ghash);
+
+  unsigned int i = nbr;
+  while (i--) {
+    const int nbr = 1 + (BLI_rng_get_int(rng) % TESTCASE_SIZE_SMALL) *
+                            (!(i % 100) ? 100 : (!(i % 10) ? 10 : 1));
+    multi_small_oahash_tests_one(oh, rng, nbr);
+  }
+
+  TIMEIT_END(multi_small_ghash);
+
+  BLI_oahash_free(oh, NULL, NULL);
+  BLI_rng_free(rng);
+
+  printf("========== ENDED %s ==========\n\n", id);
+}
+
+TEST(ghash, MultiRandIntOAHash2000)
+{
+  OAHash *oh = BLI_oahash_new(BLI_ghashutil_inthash_p, BLI_ghashutil_intcmp, __func__);
+
+  multi_small_oahash_tests(oh, "MultiSmall RandIntGHash - OAHash - 2000", 2000);
+}
+
+TEST(ghash, MultiRandIntOAHash200000)
+{
+  OAHash *oh = BLI_oahash_new(BLI_ghashutil_inthash_p, BLI_ghashutil_intcmp, __func__);
+
+  multi_small_oahash_tests(oh, "MultiSmall RandIntGHash - OAHash - 200000", 200000);
+}
@@ -0,0 +1,160 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include <stdio.h>
+#include <string.h>
+#ifdef WIN32
+#  include <io.h>
+#else
+#  include <unistd.h>
+#endif
+
+#include "zlib.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_gzip_frames.h"
+#include "BLI_mmap.h"
+
+/* A bit more than two frames. */
+static const size_t test_data_length = 2 * (1 << 20) + 12345;
+
+static char *gzip_frames_test_data_new()
+{
+  char *data = (char *)MEM_mallocN(test_data_length, __func__);
+  unsigned int seed = 1;
+  for (size_t i = 0; i < test_data_length; i++) {
+    /* Partially compressible. */
+    seed = seed * 1103515245 + 12345;
+    data[i] = (i % 3) ? (char)(seed >> 24) : (char)(i >> 10);
+  }
+  return data;
+}
+
+static FILE *gzip_frames_test_file_create(const char *data, size_t length)
+{
+  FILE *file = tmpfile();
+  GzipFramesWriter *writer = BLI_gzip_frames_writer_new(fileno(file), 1);
+  /* Uneven writes, crossing frame boundaries. */
+  size_t offset = 0;
+  for (size_t chunk = 1; offset < length; chunk = chunk * 3 + 7) {
+    const size_t chunk_length = MIN2(chunk, length - offset);
+    EXPECT_TRUE(BLI_gzip_frames_writer_write(writer, data + offset, chunk_length));
+    offset += chunk_length;
+  }
+  EXPECT_TRUE(BLI_gzip_frames_writer_free(writer));
+  return file;
+}
+
+TEST(gzip_frames, ReadWrite)
+{
+  char *data = gzip_frames_test_data_new();
+  FILE *file = gzip_frames_test_file_create(data, test_data_length);
+
+  BLI_mmap_file *mmap_file = BLI_mmap_open(fileno(file));
+  ASSERT_NE(mmap_file, nullptr);
+  EXPECT_LT(BLI_mmap_get_length(mmap_file), test_data_length);
+  GzipFramesReader *reader = BLI_gzip_frames_reader_new(mmap_file);
+  ASSERT_NE(reader, nullptr);
+  EXPECT_EQ(BLI_gzip_frames_reader_length(reader), test_data_length);
+
+  char *result = (char *)MEM_mallocN(test_data_length, __func__);
+  EXPECT_TRUE(BLI_gzip_frames_reader_read(reader, result, 0, test_data_length));
+  EXPECT_EQ(memcmp(result, data, test_data_length), 0);
+
+  /* Random access, across frames and backwards. */
+  const size_t offsets[] = {(1 << 20) - 10, 5, test_data_length - 100, (1 << 20) + 3};
+  for (const size_t offset : offsets) {
+    char buffer[100];
+    EXPECT_TRUE(BLI_gzip_frames_reader_read(reader, buffer, offset, sizeof(buffer)));
+    EXPECT_EQ(memcmp(buffer, data + offset, sizeof(buffer)), 0);
+  }
+
+  char buffer[10];
+  EXPECT_FALSE(BLI_gzip_frames_reader_read(reader, buffer, test_data_length - 5, 10));
+
+  BLI_gzip_frames_reader_free(reader);
+  BLI_mmap_free(mmap_file);
+  MEM_freeN(result);
+  MEM_freeN(data);
+  fclose(file);
+}
+
+TEST(gzip_frames, ReadWithZlib)
+{
+  char *data = gzip_frames_test_data_new();
+  FILE *file = gzip_frames_test_file_create(data, test_data_length);
+
+  /* The frames are a regular gzip file. */
+  fseek(file, 0, SEEK_SET);
+  gzFile gzfile = gzdopen(dup(fileno(file)), "rb");
+  ASSERT_NE(gzfile, nullptr);
+  char *result = (char *)MEM_mallocN(test_data_length + 1, __func__);
+  EXPECT_EQ(gzread(gzfile, result, test_data_length + 1), test_data_length);
+  EXPECT_EQ(memcmp(result, data, test_data_length), 0);
+  gzclose(gzfile);
+
+  MEM_freeN(result);
+  MEM_freeN(data);
+  fclose(file);
+}
+
+TEST(gzip_frames, Empty)
+{
+  FILE *file = gzip_frames_test_file_create(NULL, 0);
+
+  BLI_mmap_file *mmap_file = BLI_mmap_open(fileno(file));
+  ASSERT_NE(mmap_file, nullptr);
+  GzipFramesReader *reader = BLI_gzip_frames_reader_new(mmap_file);
+  ASSERT_NE(reader, nullptr);
+  EXPECT_EQ(BLI_gzip_frames_reader_length(reader), 0);
+
+  BLI_gzip_frames_reader_free(reader);
+  BLI_mmap_free(mmap_file);
+  fclose(file);
+}
+
+TEST(gzip_frames, NotFrames)
+{
+  FILE *file = tmpfile();
+  gzFile gzfile = gzdopen(dup(fileno(file)), "wb1");
+  ASSERT_NE(gzfile, nullptr);
+  gzwrite(gzfile, "BLENDER", 7);
+  gzclose(gzfile);
+
+  BLI_mmap_file *mmap_file = BLI_mmap_open(fileno(file));
+  ASSERT_NE(mmap_file, nullptr);
+  EXPECT_EQ(BLI_gzip_frames_reader_new(mmap_file), nullptr);
+
+  BLI_mmap_free(mmap_file);
+  fclose(file);
+}
+
+TEST(gzip_frames, Corrupt)
+{
+  char *data = gzip_frames_test_data_new();
+  FILE *file = gzip_frames_test_file_create(data, test_data_length);
+
+  /* Damage the compressed data at the end of the file, in the last frame. */
+  fseek(file, -20, SEEK_END);
+  const int c = fgetc(file);
+  fseek(file, -20, SEEK_END);
+  fputc(c ^ 0xff, file);
+  fflush(file);
+
+  BLI_mmap_file *mmap_file = BLI_mmap_open(fileno(file));
+  ASSERT_NE(mmap_file, nullptr);
+  GzipFramesReader *reader = BLI_gzip_frames_reader_new(mmap_file);
+  ASSERT_NE(reader, nullptr);
+
+  char buffer[100];
+  EXPECT_TRUE(BLI_gzip_frames_reader_read(reader, buffer, 0, sizeof(buffer)));
+  EXPECT_FALSE(
+      BLI_gzip_frames_reader_read(reader, buffer, test_data_length - 100, sizeof(buffer)));
+
+  BLI_gzip_frames_reader_free(reader);
+  BLI_mmap_free(mmap_file);
+  MEM_freeN(data);
+  fclose(file);
+}
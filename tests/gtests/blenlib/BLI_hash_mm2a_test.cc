@@ -74,3 +74,48 @@ TEST(hash_mm2a, MM2AIntegers)
 #endif
   EXPECT_EQ(BLI_hash_mm2a_end(&mm2), hash);
 }
+
+TEST(hash_mm2a, MM64AConcatenateStrings)
+{
+  BLI_HashMurmur64A mm64;
+  uint64_t hash;
+
+  const char *data1 = "Blender";
+  const char *data2 = " is ";
+  const char *data3 = "FaNtAsTiC";
+  const char *data123 = "Blender is FaNtAsTiC";
+
+  BLI_hash_mm64a_init(&mm64, 0);
+  BLI_hash_mm64a_add(&mm64, (const unsigned char *)data1, strlen(data1));
+  BLI_hash_mm64a_add(&mm64, (const unsigned char *)data2, strlen(data2));
+  BLI_hash_mm64a_add(&mm64, (const unsigned char *)data3, strlen(data3));
+  hash = BLI_hash_mm64a_end(&mm64);
+  BLI_hash_mm64a_init(&mm64, 0);
+  BLI_hash_mm64a_add(&mm64, (const unsigned char *)data123, strlen(data123));
+  EXPECT_EQ(BLI_hash_mm64a_end(&mm64), hash);
+
+  /* Same bytes with another seed, or split differently into strings. */
+  BLI_hash_mm64a_init(&mm64, 1);
+  BLI_hash_mm64a_add(&mm64, (const unsigned char *)data123, strlen(data123));
+  EXPECT_NE(BLI_hash_mm64a_end(&mm64), hash);
+  BLI_hash_mm64a_init(&mm64, 0);
+  BLI_hash_mm64a_add(&mm64, (const unsigned char *)data123, strlen(data123) - 1);
+  EXPECT_NE(BLI_hash_mm64a_end(&mm64), hash);
+}
+
+TEST(hash_mm2a, MM64AIntegers)
+{
+  BLI_HashMurmur64A mm64;
+  uint64_t hash;
+
+  const int ints[5] = {1, 2, 3, 4, 5};
+
+  BLI_hash_mm64a_init(&mm64, 0);
+  for (int i = 0; i < 5; i++) {
+    BLI_hash_mm64a_add_int(&mm64, ints[i]);
+  }
+  hash = BLI_hash_mm64a_end(&mm64);
+  BLI_hash_mm64a_init(&mm64, 0);
+  BLI_hash_mm64a_add(&mm64, (const unsigned char *)ints, sizeof(ints));
+  EXPECT_EQ(BLI_hash_mm64a_end(&mm64), hash);
+}
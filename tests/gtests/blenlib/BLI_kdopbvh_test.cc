@@ -70,11 +70,16 @@ static void optimal_check_callback(void *userdata,
  * Note that a small epsilon is added to the BVH nodes bounds, even if we pass in zero.
  * Use rounding to ensure very close nodes don't cause the wrong node to be found as nearest.
  */
-static void find_nearest_points_test(
-    int points_len, float scale, int round, int random_seed, bool optimal = false)
+static void find_nearest_points_test(int points_len,
+                                     float scale,
+                                     int round,
+                                     int random_seed,
+                                     bool optimal = false,
+                                     int build_flag = 0,
+                                     char tree_type = 8)
 {
   struct RNG *rng = BLI_rng_new(random_seed);
-  BVHTree *tree = BLI_bvhtree_new(points_len, 0.0, 8, 8);
+  BVHTree *tree = BLI_bvhtree_new_ex(points_len, 0.0, tree_type, 8, build_flag);
 
   void *mem = MEM_mallocN(sizeof(float[3]) * points_len, __func__);
   float(*points)[3] = (float(*)[3])mem;
@@ -136,3 +141,239 @@ TEST(kdopbvh, OptimalFindNearest_500)
 {
   find_nearest_points_test(500, 1.0, 1000, 12, true);
 }
+
+TEST(kdopbvh, SAHFindNearest_500)
+{
+  find_nearest_points_test(500, 1.0, 1000, 12, false, BVH_BUILD_SAH);
+}
+TEST(kdopbvh, SAHFindNearest_Binary_500)
+{
+  find_nearest_points_test(500, 1.0, 1000, 12, false, BVH_BUILD_SAH, 2);
+}
+TEST(kdopbvh, SAHOptimalFindNearest_500)
+{
+  find_nearest_points_test(500, 1.0, 1000, 12, true, BVH_BUILD_SAH);
+}
+
+TEST(kdopbvh, PackedFindNearest_1)
+{
+  find_nearest_points_test(1, 1.0, 1000, 1234, false, BVH_BUILD_PACKED);
+}
+TEST(kdopbvh, PackedFindNearest_2)
+{
+  find_nearest_points_test(2, 1.0, 1000, 123, false, BVH_BUILD_PACKED);
+}
+TEST(kdopbvh, PackedFindNearest_500)
+{
+  find_nearest_points_test(500, 1.0, 1000, 12, false, BVH_BUILD_PACKED);
+}
+TEST(kdopbvh, PackedFindNearest_Binary_500)
+{
+  find_nearest_points_test(500, 1.0, 1000, 12, false, BVH_BUILD_PACKED, 2);
+}
+TEST(kdopbvh, SAHPackedFindNearest_Quad_5000)
+{
+  find_nearest_points_test(5000, 1.0, 1000, 12, false, BVH_BUILD_SAH | BVH_BUILD_PACKED, 4);
+}
+
+/**
+ * Cast rays at random boxes, comparing the result with a tree that uses the default layout.
+ */
+static void raycast_boxes_test(
+    int boxes_len, int rays_len, float radius, int random_seed, int build_flag, char tree_type)
+{
+  struct RNG *rng = BLI_rng_new(random_seed);
+  BVHTree *tree_ref = BLI_bvhtree_new(boxes_len, 0.0, tree_type, 6);
+  BVHTree *tree = BLI_bvhtree_new_ex(boxes_len, 0.0, tree_type, 6, build_flag);
+
+  for (int i = 0; i < boxes_len; i++) {
+    float co[2][3];
+    rng_v3_round(co[0], 3, rng, 1000, 1.0f);
+    rng_v3_round(co[1], 3, rng, 1000, 0.05f);
+    add_v3_v3(co[1], co[0]);
+    BLI_bvhtree_insert(tree_ref, i, co[0], 2);
+    BLI_bvhtree_insert(tree, i, co[0], 2);
+  }
+  BLI_bvhtree_balance(tree_ref);
+  BLI_bvhtree_balance(tree);
+
+  for (int i = 0; i < rays_len; i++) {
+    float co[3], dir[3];
+    rng_v3_round(co, 3, rng, 1000, 2.0f);
+    BLI_rng_get_float_unit_v3(rng, dir);
+
+    BVHTreeRayHit hit_ref = {-1, {0.0f}, {0.0f}, BVH_RAYCAST_DIST_MAX};
+    BVHTreeRayHit hit = hit_ref;
+    BLI_bvhtree_ray_cast(tree_ref, co, dir, radius, &hit_ref, NULL, NULL);
+    BLI_bvhtree_ray_cast(tree, co, dir, radius, &hit, NULL, NULL);
+
+    EXPECT_EQ(hit_ref.index != -1, hit.index != -1);
+    if (hit_ref.index != -1 && hit.index != -1) {
+      EXPECT_NEAR(hit_ref.dist, hit.dist, 1e-5f);
+    }
+  }
+
+  BLI_bvhtree_free(tree_ref);
+  BLI_bvhtree_free(tree);
+  BLI_rng_free(rng);
+}
+
+TEST(kdopbvh, PackedRayCast_500)
+{
+  raycast_boxes_test(500, 1000, 0.0f, 12, BVH_BUILD_PACKED, 4);
+}
+TEST(kdopbvh, PackedRayCastRadius_500)
+{
+  raycast_boxes_test(500, 1000, 0.01f, 12, BVH_BUILD_PACKED, 2);
+}
+TEST(kdopbvh, SAHPackedRayCast_5000)
+{
+  raycast_boxes_test(5000, 1000, 0.0f, 123, BVH_BUILD_SAH | BVH_BUILD_PACKED, 8);
+}
+TEST(kdopbvh, SAHRayCast_5000)
+{
+  raycast_boxes_test(5000, 1000, 0.0f, 1234, BVH_BUILD_SAH, 2);
+}
+
+/**
+ * Run batched nearest and ray-cast queries, comparing the result with single queries.
+ */
+static void batch_query_test(int boxes_len, int queries_len, int random_seed, int nearest_flag)
+{
+  struct RNG *rng = BLI_rng_new(random_seed);
+  BVHTree *tree = BLI_bvhtree_new_ex(boxes_len, 0.0, 4, 6, BVH_BUILD_SAH | BVH_BUILD_PACKED);
+
+  for (int i = 0; i < boxes_len; i++) {
+    float co[2][3];
+    rng_v3_round(co[0], 3, rng, 1000, 1.0f);
+    rng_v3_round(co[1], 3, rng, 1000, 0.05f);
+    add_v3_v3(co[1], co[0]);
+    BLI_bvhtree_insert(tree, i, co[0], 2);
+  }
+  BLI_bvhtree_balance(tree);
+
+  float(*co)[3] = (float(*)[3])MEM_mallocN(sizeof(*co) * queries_len, __func__);
+  float(*dir)[3] = (float(*)[3])MEM_mallocN(sizeof(*dir) * queries_len, __func__);
+  BVHTreeNearest *nearest = (BVHTreeNearest *)MEM_mallocN(sizeof(*nearest) * queries_len,
+                                                          __func__);
+  BVHTreeRayHit *hit = (BVHTreeRayHit *)MEM_mallocN(sizeof(*hit) * queries_len, __func__);
+
+  for (int i = 0; i < queries_len; i++) {
+    rng_v3_round(co[i], 3, rng, 1000, 2.0f);
+    BLI_rng_get_float_unit_v3(rng, dir[i]);
+    nearest[i].index = -1;
+    nearest[i].dist_sq = FLT_MAX;
+    hit[i].index = -1;
+    hit[i].dist = BVH_RAYCAST_DIST_MAX;
+  }
+
+  BLI_bvhtree_find_nearest_batch(tree, co, queries_len, nearest, NULL, NULL, nearest_flag);
+  BLI_bvhtree_ray_cast_batch(tree, co, dir, queries_len, 0.0f, hit, NULL, NULL, 0);
+
+  for (int i = 0; i < queries_len; i++) {
+    BVHTreeNearest nearest_ref = {-1, {0.0f}, {0.0f}, FLT_MAX, 0};
+    BVHTreeRayHit hit_ref = {-1, {0.0f}, {0.0f}, BVH_RAYCAST_DIST_MAX};
+    BLI_bvhtree_find_nearest(tree, co[i], &nearest_ref, NULL, NULL);
+    BLI_bvhtree_ray_cast(tree, co[i], dir[i], 0.0f, &hit_ref, NULL, NULL);
+
+    EXPECT_NE(nearest[i].index, -1);
+    EXPECT_NEAR(nearest_ref.dist_sq, nearest[i].dist_sq, 1e-5f);
+    EXPECT_EQ(hit_ref.index, hit[i].index);
+    if (hit_ref.index != -1 && hit[i].index != -1) {
+      EXPECT_NEAR(hit_ref.dist, hit[i].dist, 1e-5f);
+    }
+  }
+
+  BLI_bvhtree_free(tree);
+  BLI_rng_free(rng);
+  MEM_freeN(co);
+  MEM_freeN(dir);
+  MEM_freeN(nearest);
+  MEM_freeN(hit);
+}
+
+TEST(kdopbvh, BatchQuery_1)
+{
+  batch_query_test(500, 1, 12, 0);
+}
+TEST(kdopbvh, BatchQuery_5000)
+{
+  batch_query_test(500, 5000, 123, 0);
+}
+TEST(kdopbvh, BatchQueryUsePrevious_5000)
+{
+  batch_query_test(500, 5000, 1234, BVH_NEAREST_USE_PREVIOUS);
+}
+
+static int refit_point_callback(void *userdata, int index, float (*r_co)[3])
+{
+  const float(*points)[3] = (const float(*)[3])userdata;
+  copy_v3_v3(r_co[0], points[index]);
+  return 1;
+}
+
+/**
+ * Move the points of a balanced tree and refit it,
+ * finding each point again to check the bounds contain the new positions.
+ */
+static void refit_points_test(int points_len, float offset, int random_seed, int build_flag)
+{
+  struct RNG *rng = BLI_rng_new(random_seed);
+  BVHTree *tree = BLI_bvhtree_new_ex(points_len, 0.0, 4, 6, build_flag);
+
+  void *mem = MEM_mallocN(sizeof(float[3]) * points_len, __func__);
+  float(*points)[3] = (float(*)[3])mem;
+
+  /* Insert in reverse order, leafs must be refitted by index (not by insertion order). */
+  for (int i = points_len - 1; i >= 0; i--) {
+    rng_v3_round(points[i], 3, rng, 1000, 1.0f);
+    BLI_bvhtree_insert(tree, i, points[i], 1);
+  }
+  BLI_bvhtree_balance(tree);
+  EXPECT_EQ(BLI_bvhtree_get_refit_quality(tree), 1.0f);
+
+  /* Translating all points keeps the quality. */
+  for (int i = 0; i < points_len; i++) {
+    add_v3_fl(points[i], 10.0f);
+  }
+  BLI_bvhtree_refit(tree, refit_point_callback, points);
+  EXPECT_NEAR(BLI_bvhtree_get_refit_quality(tree), 1.0f, 1e-3f);
+
+  for (int i = 0; i < points_len; i++) {
+    float co[3];
+    rng_v3_round(co, 3, rng, 1000, offset);
+    add_v3_v3(points[i], co);
+  }
+  BLI_bvhtree_refit(tree, refit_point_callback, points);
+  const float quality = BLI_bvhtree_get_refit_quality(tree);
+  EXPECT_GT(quality, 0.0f);
+  EXPECT_LE(quality, 1.0f);
+
+  for (int i = 0; i < points_len; i++) {
+    const int j = BLI_bvhtree_find_nearest(tree, points[i], NULL, NULL, NULL);
+    EXPECT_GE(j, 0);
+    EXPECT_LT(j, points_len);
+    EXPECT_EQ_ARRAY(points[i], points[j], 3);
+  }
+
+  BLI_bvhtree_free(tree);
+  BLI_rng_free(rng);
+  MEM_freeN(points);
+}
+
+TEST(kdopbvh, Refit_1)
+{
+  refit_points_test(1, 1.0f, 1234, 0);
+}
+TEST(kdopbvh, Refit_500)
+{
+  refit_points_test(500, 0.01f, 12, 0);
+}
+TEST(kdopbvh, RefitScramble_500)
+{
+  refit_points_test(500, 2.0f, 12, 0);
+}
+TEST(kdopbvh, SAHPackedRefit_5000)
+{
+  refit_points_test(5000, 0.5f, 123, BVH_BUILD_SAH | BVH_BUILD_PACKED);
+}
@@ -0,0 +1,160 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "MEM_guardedalloc.h"
+
+extern "C" {
+#include "BLI_kdtree.h"
+#include "BLI_math_vector.h"
+#include "BLI_rand.h"
+#include "BLI_threads.h"
+}
+
+/* Above #KD_BALANCE_PARALLEL_THRESHOLD, so balancing runs in tasks. */
+#define POINTS_LEN 20000
+#define QUERY_LEN 1000
+#define NEAREST_LEN 8
+
+/* -------------------------------------------------------------------- */
+/* Helper Functions */
+
+static void rng_v3_array(float (*coords)[3], int coords_len, unsigned int seed)
+{
+  RNG *rng = BLI_rng_new(seed);
+  for (int i = 0; i < coords_len; i++) {
+    BLI_rng_get_float_unit_v3(rng, coords[i]);
+    mul_v3_fl(coords[i], BLI_rng_get_float(rng));
+  }
+  BLI_rng_free(rng);
+}
+
+static KDTree_3d *kdtree_from_coords(const float (*coords)[3], int coords_len)
+{
+  KDTree_3d *tree = BLI_kdtree_3d_new((unsigned int)coords_len);
+  for (int i = 0; i < coords_len; i++) {
+    BLI_kdtree_3d_insert(tree, i, coords[i]);
+  }
+  BLI_kdtree_3d_balance(tree);
+  return tree;
+}
+
+static int find_nearest_brute_force(const float (*coords)[3], int coords_len, const float co[3])
+{
+  int index = -1;
+  float dist_sq_best = FLT_MAX;
+  for (int i = 0; i < coords_len; i++) {
+    const float dist_sq = len_squared_v3v3(coords[i], co);
+    if (dist_sq < dist_sq_best) {
+      dist_sq_best = dist_sq;
+      index = i;
+    }
+  }
+  return index;
+}
+
+/* -------------------------------------------------------------------- */
+/* Tests */
+
+TEST(kdtree, BalanceParallel)
+{
+  BLI_threadapi_init();
+
+  float(*coords)[3] = (float(*)[3])MEM_mallocN(sizeof(*coords) * POINTS_LEN, __func__);
+  float(*query)[3] = (float(*)[3])MEM_mallocN(sizeof(*query) * QUERY_LEN, __func__);
+  rng_v3_array(coords, POINTS_LEN, 1);
+  rng_v3_array(query, QUERY_LEN, 2);
+
+  KDTree_3d *tree = kdtree_from_coords(coords, POINTS_LEN);
+
+  for (int i = 0; i < QUERY_LEN; i++) {
+    EXPECT_EQ(BLI_kdtree_3d_find_nearest(tree, query[i], NULL),
+              find_nearest_brute_force(coords, POINTS_LEN, query[i]));
+  }
+
+  BLI_kdtree_3d_free(tree);
+  MEM_freeN(coords);
+  MEM_freeN(query);
+
+  BLI_threadapi_exit();
+}
+
+TEST(kdtree, FindNearestNBatch)
+{
+  BLI_threadapi_init();
+
+  float(*coords)[3] = (float(*)[3])MEM_mallocN(sizeof(*coords) * POINTS_LEN, __func__);
+  float(*query)[3] = (float(*)[3])MEM_mallocN(sizeof(*query) * QUERY_LEN, __func__);
+  rng_v3_array(coords, POINTS_LEN, 3);
+  rng_v3_array(query, QUERY_LEN, 4);
+
+  KDTree_3d *tree = kdtree_from_coords(coords, POINTS_LEN);
+
+  KDTreeNearest_3d *nearest_batch = (KDTreeNearest_3d *)MEM_mallocN(
+      sizeof(*nearest_batch) * QUERY_LEN * NEAREST_LEN, __func__);
+  int nearest_len_batch[QUERY_LEN];
+  BLI_kdtree_3d_find_nearest_n_batch(
+      tree, query, QUERY_LEN, nearest_batch, NEAREST_LEN, nearest_len_batch);
+
+  for (int i = 0; i < QUERY_LEN; i++) {
+    KDTreeNearest_3d nearest[NEAREST_LEN];
+    const int nearest_len = BLI_kdtree_3d_find_nearest_n(tree, query[i], nearest, NEAREST_LEN);
+    EXPECT_EQ(nearest_len, NEAREST_LEN);
+    EXPECT_EQ(nearest_len_batch[i], nearest_len);
+    for (int j = 0; j < nearest_len; j++) {
+      EXPECT_EQ(nearest_batch[i * NEAREST_LEN + j].index, nearest[j].index);
+      EXPECT_EQ(nearest_batch[i * NEAREST_LEN + j].dist, nearest[j].dist);
+    }
+  }
+
+  BLI_kdtree_3d_free(tree);
+  MEM_freeN(nearest_batch);
+  MEM_freeN(coords);
+  MEM_freeN(query);
+
+  BLI_threadapi_exit();
+}
+
+static bool range_search_count_cb(void *user_data, int index, const float co[3], float dist_sq)
+{
+  UNUSED_VARS(index, co, dist_sq);
+  (*(int *)user_data)++;
+  return true;
+}
+
+static bool range_search_batch_count_cb(
+    void *user_data, int co_index, int index, const float co[3], float dist_sq)
+{
+  UNUSED_VARS(index, co, dist_sq);
+  ((int *)user_data)[co_index]++;
+  return true;
+}
+
+TEST(kdtree, RangeSearchBatch)
+{
+  BLI_threadapi_init();
+
+  const float range = 0.1f;
+  float(*coords)[3] = (float(*)[3])MEM_mallocN(sizeof(*coords) * POINTS_LEN, __func__);
+  float(*query)[3] = (float(*)[3])MEM_mallocN(sizeof(*query) * QUERY_LEN, __func__);
+  rng_v3_array(coords, POINTS_LEN, 5);
+  rng_v3_array(query, QUERY_LEN, 6);
+
+  KDTree_3d *tree = kdtree_from_coords(coords, POINTS_LEN);
+
+  int found_batch[QUERY_LEN] = {0};
+  BLI_kdtree_3d_range_search_batch_cb(
+      tree, query, QUERY_LEN, range, range_search_batch_count_cb, found_batch);
+
+  for (int i = 0; i < QUERY_LEN; i++) {
+    int found = 0;
+    BLI_kdtree_3d_range_search_cb(tree, query[i], range, range_search_count_cb, &found);
+    EXPECT_EQ(found_batch[i], found);
+  }
+
+  BLI_kdtree_3d_free(tree);
+  MEM_freeN(coords);
+  MEM_freeN(query);
+
+  BLI_threadapi_exit();
+}
@@ -0,0 +1,72 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include <stdio.h>
+#ifndef WIN32
+#  include <unistd.h>
+#endif
+
+#include "BLI_mmap.h"
+
+static const size_t test_file_length = 3 * 65536 + 100;
+
+static FILE *mmap_test_file_create()
+{
+  FILE *file = tmpfile();
+  for (size_t i = 0; i < test_file_length; i++) {
+    fputc((int)(i % 251), file);
+  }
+  fflush(file);
+  return file;
+}
+
+TEST(mmap, Read)
+{
+  FILE *file = mmap_test_file_create();
+  BLI_mmap_file *mmap_file = BLI_mmap_open(fileno(file));
+  ASSERT_NE(mmap_file, nullptr);
+  EXPECT_EQ(BLI_mmap_get_length(mmap_file), test_file_length);
+
+  char buffer[300];
+  EXPECT_TRUE(BLI_mmap_read(mmap_file, buffer, 65536 - 150, sizeof(buffer)));
+  for (size_t i = 0; i < sizeof(buffer); i++) {
+    EXPECT_EQ((unsigned char)buffer[i], (65536 - 150 + i) % 251);
+  }
+  EXPECT_TRUE(BLI_mmap_read(mmap_file, buffer, test_file_length - 1, 1));
+  EXPECT_EQ((unsigned char)buffer[0], (test_file_length - 1) % 251);
+
+  /* Reading up to the end is fine, past the end is not. */
+  EXPECT_TRUE(BLI_mmap_read(mmap_file, buffer, test_file_length - 10, 10));
+  EXPECT_FALSE(BLI_mmap_read(mmap_file, buffer, test_file_length - 10, 11));
+  EXPECT_FALSE(BLI_mmap_read(mmap_file, buffer, test_file_length + 1, 0));
+
+  BLI_mmap_free(mmap_file);
+  fclose(file);
+}
+
+TEST(mmap, EmptyFile)
+{
+  FILE *file = tmpfile();
+  EXPECT_EQ(BLI_mmap_open(fileno(file)), nullptr);
+  fclose(file);
+}
+
+#ifndef WIN32
+TEST(mmap, TruncatedFile)
+{
+  FILE *file = mmap_test_file_create();
+  BLI_mmap_file *mmap_file = BLI_mmap_open(fileno(file));
+  ASSERT_NE(mmap_file, nullptr);
+
+  /* Pages past the new end of the file can't be read anymore, this is reported as failure
+   * instead of crashing. */
+  ASSERT_EQ(ftruncate(fileno(file), 1000), 0);
+  char buffer[100];
+  EXPECT_TRUE(BLI_mmap_read(mmap_file, buffer, 0, sizeof(buffer)));
+  EXPECT_FALSE(BLI_mmap_read(mmap_file, buffer, 2 * 65536, sizeof(buffer)));
+
+  BLI_mmap_free(mmap_file);
+  fclose(file);
+}
+#endif
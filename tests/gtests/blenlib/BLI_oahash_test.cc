@@ -0,0 +1,237 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "MEM_guardedalloc.h"
+
+extern "C" {
+#include "BLI_oahash.h"
+#include "BLI_string.h"
+#include "BLI_utildefines.h"
+}
+
+#define TESTCASE_SIZE 10000
+
+/* Distinct keys, spread over the whole range of integers. */
+static void init_keys(unsigned int keys[TESTCASE_SIZE])
+{
+  for (unsigned int i = 0; i < TESTCASE_SIZE; i++) {
+    keys[i] = (i + 1) * 2654435761u;
+  }
+}
+
+TEST(oahash, InsertLookup)
+{
+  OAHash *oh = BLI_oahash_int_new(__func__);
+  unsigned int keys[TESTCASE_SIZE];
+  init_keys(keys);
+
+  for (int i = 0; i < TESTCASE_SIZE; i++) {
+    BLI_oahash_insert(oh, POINTER_FROM_UINT(keys[i]), POINTER_FROM_UINT(keys[i]));
+  }
+  EXPECT_EQ(BLI_oahash_len(oh), TESTCASE_SIZE);
+
+  for (int i = 0; i < TESTCASE_SIZE; i++) {
+    void *v = BLI_oahash_lookup(oh, POINTER_FROM_UINT(keys[i]));
+    EXPECT_EQ(POINTER_AS_UINT(v), keys[i]);
+  }
+  EXPECT_FALSE(BLI_oahash_haskey(oh, POINTER_FROM_UINT(1)));
+  EXPECT_EQ(BLI_oahash_lookup_p(oh, POINTER_FROM_UINT(1)), nullptr);
+
+  BLI_oahash_free(oh, NULL, NULL);
+}
+
+TEST(oahash, InsertRemove)
+{
+  OAHash *oh = BLI_oahash_int_new(__func__);
+  unsigned int keys[TESTCASE_SIZE];
+  init_keys(keys);
+
+  /* Remove and re-add several times, so the table fills with dummies. */
+  for (int pass = 0; pass < 4; pass++) {
+    for (int i = 0; i < TESTCASE_SIZE; i++) {
+      BLI_oahash_insert(oh, POINTER_FROM_UINT(keys[i]), POINTER_FROM_UINT(keys[i] + pass));
+    }
+    EXPECT_EQ(BLI_oahash_len(oh), TESTCASE_SIZE);
+
+    for (int i = 0; i < TESTCASE_SIZE; i += 2) {
+      void *v = BLI_oahash_popkey(oh, POINTER_FROM_UINT(keys[i]), NULL);
+      EXPECT_EQ(POINTER_AS_UINT(v), keys[i] + pass);
+    }
+    EXPECT_EQ(BLI_oahash_len(oh), TESTCASE_SIZE / 2);
+
+    for (int i = 0; i < TESTCASE_SIZE; i++) {
+      EXPECT_EQ(BLI_oahash_haskey(oh, POINTER_FROM_UINT(keys[i])), (i % 2) == 1);
+    }
+    for (int i = 1; i < TESTCASE_SIZE; i += 2) {
+      EXPECT_TRUE(BLI_oahash_remove(oh, POINTER_FROM_UINT(keys[i]), NULL, NULL));
+    }
+    EXPECT_EQ(BLI_oahash_len(oh), 0);
+  }
+
+  BLI_oahash_free(oh, NULL, NULL);
+}
+
+static unsigned int collide_hash(const void *UNUSED(key))
+{
+  return 0;
+}
+
+TEST(oahash, CollidingRemove)
+{
+  /* All keys probe the same groups, removed keys must not hide the ones found after them. */
+  OAHash *oh = BLI_oahash_new(collide_hash, BLI_ghashutil_intcmp, __func__);
+  const unsigned int len = 100;
+
+  for (unsigned int i = 0; i < len; i++) {
+    BLI_oahash_insert(oh, POINTER_FROM_UINT(i), POINTER_FROM_UINT(i));
+  }
+  for (unsigned int i = 0; i < len; i += 3) {
+    EXPECT_TRUE(BLI_oahash_remove(oh, POINTER_FROM_UINT(i), NULL, NULL));
+  }
+  for (unsigned int i = 0; i < len; i++) {
+    EXPECT_EQ(BLI_oahash_haskey(oh, POINTER_FROM_UINT(i)), (i % 3) != 0);
+  }
+
+  for (unsigned int i = 0; i < len; i += 3) {
+    void **val_p;
+    EXPECT_FALSE(BLI_oahash_ensure_p(oh, POINTER_FROM_UINT(i), &val_p));
+    *val_p = POINTER_FROM_UINT(i);
+  }
+  EXPECT_EQ(BLI_oahash_len(oh), len);
+  for (unsigned int i = 0; i < len; i++) {
+    EXPECT_EQ(POINTER_AS_UINT(BLI_oahash_lookup(oh, POINTER_FROM_UINT(i))), i);
+  }
+
+  BLI_oahash_free(oh, NULL, NULL);
+}
+
+TEST(oahash, EnsureReinsert)
+{
+  OAHash *oh = BLI_oahash_int_new(__func__);
+  void **val_p;
+
+  EXPECT_FALSE(BLI_oahash_ensure_p(oh, POINTER_FROM_INT(1), &val_p));
+  *val_p = POINTER_FROM_INT(10);
+  EXPECT_TRUE(BLI_oahash_ensure_p(oh, POINTER_FROM_INT(1), &val_p));
+  EXPECT_EQ(POINTER_AS_INT(*val_p), 10);
+
+  EXPECT_FALSE(BLI_oahash_reinsert(oh, POINTER_FROM_INT(1), POINTER_FROM_INT(20), NULL, NULL));
+  EXPECT_TRUE(BLI_oahash_reinsert(oh, POINTER_FROM_INT(2), POINTER_FROM_INT(30), NULL, NULL));
+  EXPECT_EQ(POINTER_AS_INT(BLI_oahash_lookup(oh, POINTER_FROM_INT(1))), 20);
+  EXPECT_EQ(POINTER_AS_INT(BLI_oahash_lookup(oh, POINTER_FROM_INT(2))), 30);
+  void *v = BLI_oahash_lookup_default(oh, POINTER_FROM_INT(3), POINTER_FROM_INT(-1));
+  EXPECT_EQ(POINTER_AS_INT(v), -1);
+  EXPECT_EQ(BLI_oahash_len(oh), 2);
+
+  BLI_oahash_free(oh, NULL, NULL);
+}
+
+TEST(oahash, StrKeys)
+{
+  OAHash *oh = BLI_oahash_str_new(__func__);
+  char buf[32];
+
+  for (int i = 0; i < 1000; i++) {
+    BLI_snprintf(buf, sizeof(buf), "key_%d", i);
+    char **key_p;
+    void **val_p;
+    EXPECT_FALSE(BLI_oahash_ensure_p_ex(oh, buf, (void ***)&key_p, &val_p));
+    *key_p = BLI_strdup(buf);
+    *val_p = POINTER_FROM_INT(i);
+  }
+  for (int i = 0; i < 1000; i++) {
+    BLI_snprintf(buf, sizeof(buf), "key_%d", i);
+    EXPECT_EQ(POINTER_AS_INT(BLI_oahash_lookup(oh, buf)), i);
+  }
+
+  BLI_oahash_free(oh, MEM_freeN, NULL);
+}
+
+TEST(oahash, Iter)
+{
+  OAHash *oh = BLI_oahash_int_new(__func__);
+  unsigned int keys[TESTCASE_SIZE];
+  init_keys(keys);
+
+  for (int i = 0; i < TESTCASE_SIZE; i++) {
+    BLI_oahash_insert(oh, POINTER_FROM_UINT(keys[i]), POINTER_FROM_INT(i));
+  }
+
+  /* Removing the current item while iterating is supported. */
+  OAHashIterator ohi;
+  int count = 0;
+  OAHASH_ITER (ohi, oh) {
+    const int i = POINTER_AS_INT(BLI_oahashIterator_getValue(&ohi));
+    EXPECT_EQ(POINTER_AS_UINT(BLI_oahashIterator_getKey(&ohi)), keys[i]);
+    if (i % 2) {
+      BLI_oahash_remove(oh, BLI_oahashIterator_getKey(&ohi), NULL, NULL);
+    }
+    count++;
+  }
+  EXPECT_EQ(count, TESTCASE_SIZE);
+  EXPECT_EQ(BLI_oahash_len(oh), TESTCASE_SIZE / 2);
+
+  OAHashIterState pop_state = {0};
+  void *k, *v;
+  count = 0;
+  while (BLI_oahash_pop(oh, &pop_state, &k, &v)) {
+    count++;
+  }
+  EXPECT_EQ(count, TESTCASE_SIZE / 2);
+  EXPECT_EQ(BLI_oahash_len(oh), 0);
+
+  BLI_oahash_free(oh, NULL, NULL);
+}
+
+TEST(oahash, Copy)
+{
+  OAHash *oh = BLI_oahash_int_new(__func__);
+  unsigned int keys[TESTCASE_SIZE];
+  init_keys(keys);
+
+  for (int i = 0; i < TESTCASE_SIZE; i++) {
+    BLI_oahash_insert(oh, POINTER_FROM_UINT(keys[i]), POINTER_FROM_UINT(keys[i]));
+  }
+
+  OAHash *oh_copy = BLI_oahash_copy(oh, NULL, NULL);
+  BLI_oahash_clear(oh, NULL, NULL);
+  EXPECT_EQ(BLI_oahash_len(oh), 0);
+  EXPECT_EQ(BLI_oahash_len(oh_copy), TESTCASE_SIZE);
+
+  for (int i = 0; i < TESTCASE_SIZE; i++) {
+    void *v = BLI_oahash_lookup(oh_copy, POINTER_FROM_UINT(keys[i]));
+    EXPECT_EQ(POINTER_AS_UINT(v), keys[i]);
+  }
+
+  BLI_oahash_free(oh, NULL, NULL);
+  BLI_oahash_free(oh_copy, NULL, NULL);
+}
+
+TEST(oaset, AddRemoveIter)
+{
+  OASet *os = BLI_oaset_ptr_new(__func__);
+  int data[TESTCASE_SIZE];
+
+  for (int i = 0; i < TESTCASE_SIZE; i++) {
+    EXPECT_TRUE(BLI_oaset_add(os, &data[i]));
+  }
+  EXPECT_FALSE(BLI_oaset_add(os, &data[0]));
+  EXPECT_EQ(BLI_oaset_len(os), TESTCASE_SIZE);
+
+  for (int i = 0; i < TESTCASE_SIZE; i += 2) {
+    EXPECT_EQ(BLI_oaset_pop_key(os, &data[i]), &data[i]);
+  }
+  EXPECT_EQ(BLI_oaset_len(os), TESTCASE_SIZE / 2);
+
+  OASetIterator osi;
+  int count = 0;
+  OASET_ITER (osi, os) {
+    const int *elem = (const int *)BLI_oasetIterator_getKey(&osi);
+    EXPECT_EQ((elem - data) % 2, 1);
+    count++;
+  }
+  EXPECT_EQ(count, TESTCASE_SIZE / 2);
+
+  BLI_oaset_free(os, NULL);
+}
@@ -67,6 +67,65 @@ TEST(task, RangeIter)
   BLI_threadapi_exit();
 }
 
+static void task_range_adaptive_iter_func(void *userdata,
+                                          int index,
+                                          const TaskParallelTLS *__restrict tls)
+{
+  task_range_iter_func(userdata, index, tls);
+}
+
+TEST(task, RangeIterAdaptive)
+{
+  int data[NUM_ITEMS] = {0};
+  int sum = 0;
+
+  BLI_threadapi_init();
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_adaptive_grain_size = true;
+
+  settings.userdata_chunk = &sum;
+  settings.userdata_chunk_size = sizeof(sum);
+  settings.func_reduce = task_range_iter_reduce_func;
+
+  BLI_task_parallel_range_stats_clear();
+  for (int i = 0; i < 2; i++) {
+    sum = 0;
+    BLI_task_parallel_range(0, NUM_ITEMS, data, task_range_adaptive_iter_func, &settings);
+  }
+
+  int expected_sum = 0;
+  for (int i = 0; i < NUM_ITEMS; i++) {
+    EXPECT_EQ(data[i], i);
+    expected_sum += i;
+  }
+  EXPECT_EQ(sum, expected_sum);
+
+  /* Adaptive ranges always record statistics, other ranges only while profiling. */
+  TaskParallelRangeStats *stats;
+  const int stats_len = BLI_task_parallel_range_stats_get(&stats);
+  ASSERT_EQ(stats_len, 1);
+  EXPECT_EQ(stats[0].func, task_range_adaptive_iter_func);
+  EXPECT_EQ(stats[0].calls, 2);
+  EXPECT_EQ(stats[0].iterations, 2 * NUM_ITEMS);
+  EXPECT_GE(stats[0].chunks, 2);
+  EXPECT_GE(stats[0].grain_size, 1);
+  MEM_freeN(stats);
+
+  BLI_task_parallel_range_profile_enable(true);
+  BLI_task_parallel_range(0, NUM_ITEMS, data, task_range_iter_func, &settings);
+  BLI_task_parallel_range_profile_enable(false);
+  EXPECT_EQ(BLI_task_parallel_range_stats_get(&stats), 2);
+  MEM_freeN(stats);
+
+  BLI_task_parallel_range_stats_clear();
+  EXPECT_EQ(BLI_task_parallel_range_stats_get(&stats), 0);
+  EXPECT_EQ(stats, nullptr);
+
+  BLI_threadapi_exit();
+}
+
 /* *** Parallel iterations over mempool items. *** */
 
 static void task_mempool_iter_func(void *userdata, MempoolIterData *item)
@@ -136,6 +195,71 @@ TEST(task, MempoolIter)
   BLI_threadapi_exit();
 }
 
+/* *** Concurrent allocations from a mempool. *** */
+
+static void task_mempool_alloc_func(void *__restrict userdata,
+                                    const int index,
+                                    const TaskParallelTLS *__restrict tls)
+{
+  void **data = (void **)userdata;
+  BLI_mempool *mempool = (BLI_mempool *)data[0];
+  /* Some items bypass the thread caches, allocating from and freeing into the pool directly. */
+  const int thread_id = ((index % 5) == 0) ? -1 : BLI_task_parallel_thread_id(tls);
+
+  /* Free the elements allocated in the first pass, from whichever thread runs this one. */
+  if (data[index + 1] != NULL) {
+    BLI_mempool_free_threadsafe(mempool, data[index + 1], thread_id);
+    data[index + 1] = NULL;
+  }
+  if ((index % 3) != 0) {
+    int *elem = (int *)BLI_mempool_alloc_threadsafe(mempool, thread_id);
+    *elem = index;
+    data[index + 1] = elem;
+  }
+}
+
+TEST(task, MempoolAllocThreadsafe)
+{
+  void **data = (void **)MEM_callocN(sizeof(*data) * (NUM_ITEMS + 1), __func__);
+  BLI_threadapi_init();
+  BLI_mempool *mempool = BLI_mempool_create(
+      sizeof(int), 0, 32, BLI_MEMPOOL_ALLOW_ITER | BLI_MEMPOOL_CONCURRENT);
+  data[0] = mempool;
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 1;
+
+  /* Second pass frees everything from the first one and allocates again. */
+  for (int pass = 0; pass < 2; pass++) {
+    BLI_task_parallel_range(0, NUM_ITEMS, data, task_mempool_alloc_func, &settings);
+    BLI_mempool_threadsafe_sync(mempool);
+  }
+
+  int num_items = 0;
+  for (int i = 0; i < NUM_ITEMS; i++) {
+    if (data[i + 1] != NULL) {
+      EXPECT_EQ(*(int *)data[i + 1], i);
+      num_items++;
+    }
+  }
+  EXPECT_EQ(BLI_mempool_len(mempool), num_items);
+
+  /* Iteration must see exactly the elements in use. */
+  BLI_mempool_iter iter;
+  BLI_mempool_iternew(mempool, &iter);
+  int num_iter = 0;
+  for (int *elem; (elem = (int *)BLI_mempool_iterstep(&iter));) {
+    EXPECT_EQ(data[*elem + 1], elem);
+    num_iter++;
+  }
+  EXPECT_EQ(num_iter, num_items);
+
+  BLI_mempool_destroy(mempool);
+  MEM_freeN(data);
+  BLI_threadapi_exit();
+}
+
 /* *** Parallel iterations over double-linked list items. *** */
 
 static void task_listbase_iter_func(void *userdata,
@@ -1,9 +1,19 @@
 #include "testing/testing.h"
 
 #include "BLI_math.h"
+#include "BLI_task.h"
 #include "BLI_utildefines.h"
 #include "bmesh.h"
 
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+
+#include "BKE_customdata.h"
+#include "BKE_idtype.h"
+#include "BKE_lib_id.h"
+
+#include "MEM_guardedalloc.h"
+
 TEST(bmesh_core, BMVertCreate)
 {
   BMesh *bm;
@@ -38,3 +48,107 @@ TEST(bmesh_core, BMVertCreate)
   EXPECT_EQ(BM_mesh_elem_count(bm, BM_VERT), 3);
   BM_mesh_free(bm);
 }
+
+/* Large enough for the conversion to run multi-threaded (see #BM_OMP_LIMIT). */
+#define GRID_SIZE 120
+
+TEST(bmesh_core, MeshConvertRoundTrip)
+{
+  BLI_threadapi_init();
+  BKE_idtype_init();
+
+  BMeshCreateParams bm_params = {0};
+  BMesh *bm = BM_mesh_create(&bm_mesh_allocsize_default, &bm_params);
+  BM_data_layer_add(bm, &bm->vdata, CD_PROP_FLT);
+  BM_data_layer_add(bm, &bm->pdata, CD_PROP_INT);
+
+  BMVert **verts = (BMVert **)MEM_mallocN(sizeof(*verts) * (GRID_SIZE + 1) * (GRID_SIZE + 1),
+                                          __func__);
+  for (int y = 0; y <= GRID_SIZE; y++) {
+    for (int x = 0; x <= GRID_SIZE; x++) {
+      const float co[3] = {(float)x, (float)y, 0.0f};
+      const int i = y * (GRID_SIZE + 1) + x;
+      verts[i] = BM_vert_create(bm, co, NULL, BM_CREATE_NOP);
+      BM_elem_float_data_set(&bm->vdata, verts[i], CD_PROP_FLT, (float)i);
+    }
+  }
+  for (int y = 0; y < GRID_SIZE; y++) {
+    for (int x = 0; x < GRID_SIZE; x++) {
+      const int i = y * (GRID_SIZE + 1) + x;
+      BMFace *f = BM_face_create_quad_tri(bm,
+                                          verts[i],
+                                          verts[i + 1],
+                                          verts[i + GRID_SIZE + 2],
+                                          verts[i + GRID_SIZE + 1],
+                                          NULL,
+                                          BM_CREATE_NO_DOUBLE);
+      *(int *)CustomData_bmesh_get(&bm->pdata, f->head.data, CD_PROP_INT) = y * GRID_SIZE + x;
+      if (x == 7 && y == 3) {
+        bm->act_face = f;
+      }
+    }
+  }
+  MEM_freeN(verts);
+
+  Mesh *me = (Mesh *)BKE_id_new_nomain(ID_ME, NULL);
+  BM_mesh_bm_to_me_for_eval(bm, me, NULL);
+
+  EXPECT_EQ(me->totvert, bm->totvert);
+  EXPECT_EQ(me->totedge, bm->totedge);
+  EXPECT_EQ(me->totloop, bm->totloop);
+  EXPECT_EQ(me->totpoly, bm->totface);
+
+  const float *vert_float = (const float *)CustomData_get_layer(&me->vdata, CD_PROP_FLT);
+  const int *poly_int = (const int *)CustomData_get_layer(&me->pdata, CD_PROP_INT);
+  const int *vert_origindex = (const int *)CustomData_get_layer(&me->vdata, CD_ORIGINDEX);
+  ASSERT_TRUE(vert_float != NULL);
+  ASSERT_TRUE(poly_int != NULL);
+  ASSERT_TRUE(vert_origindex != NULL);
+  for (int i = 0; i < me->totvert; i++) {
+    EXPECT_EQ(vert_float[i], (float)i);
+    EXPECT_EQ(vert_origindex[i], i);
+    EXPECT_EQ(me->mvert[i].co[0], (float)(i % (GRID_SIZE + 1)));
+  }
+  int totloop = 0;
+  for (int i = 0; i < me->totpoly; i++) {
+    const MPoly *mp = &me->mpoly[i];
+    EXPECT_EQ(poly_int[i], i);
+    EXPECT_EQ(mp->loopstart, totloop);
+    EXPECT_EQ(mp->totloop, 4);
+    for (int j = 0; j < mp->totloop; j++) {
+      const MLoop *ml = &me->mloop[mp->loopstart + j];
+      const MEdge *med = &me->medge[ml->e];
+      EXPECT_TRUE(ELEM(ml->v, med->v1, med->v2));
+    }
+    totloop += mp->totloop;
+  }
+  EXPECT_EQ(me->act_face, 3 * GRID_SIZE + 7);
+
+  BMesh *bm_copy = BM_mesh_create(&bm_mesh_allocsize_default, &bm_params);
+  BMeshFromMeshParams from_me_params = {0};
+  from_me_params.calc_face_normal = true;
+  BM_mesh_bm_from_me(bm_copy, me, &from_me_params);
+
+  EXPECT_EQ(bm_copy->totvert, bm->totvert);
+  EXPECT_EQ(bm_copy->totedge, bm->totedge);
+  EXPECT_EQ(bm_copy->totface, bm->totface);
+  EXPECT_EQ(BM_elem_index_get(bm_copy->act_face), 3 * GRID_SIZE + 7);
+
+  BMIter iter;
+  BMVert *v;
+  int i;
+  BM_ITER_MESH_INDEX (v, &iter, bm_copy, BM_VERTS_OF_MESH, i) {
+    EXPECT_EQ(BM_elem_float_data_get(&bm_copy->vdata, v, CD_PROP_FLT), (float)i);
+    EXPECT_EQ(v->co[1], (float)(i / (GRID_SIZE + 1)));
+  }
+  BMFace *f;
+  BM_ITER_MESH_INDEX (f, &iter, bm_copy, BM_FACES_OF_MESH, i) {
+    EXPECT_EQ(*(int *)CustomData_bmesh_get(&bm_copy->pdata, f->head.data, CD_PROP_INT), i);
+    EXPECT_EQ(f->no[2], 1.0f);
+  }
+
+  BM_mesh_free(bm_copy);
+  BKE_id_free(NULL, me);
+  BM_mesh_free(bm);
+  BLI_threadapi_exit();
+}